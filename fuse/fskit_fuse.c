@@ -687,6 +687,22 @@ int fskit_fuse_opendir(const char *path, struct fuse_file_info *fi) {
    return 0;
 }
 
+// drop a directory handle's unsent entries
+static void fskit_fuse_dir_batch_free( struct fskit_fuse_file_info* ffi ) {
+
+   if( ffi->dir_batch != NULL ) {
+      fskit_dir_entry_plus_free_list( ffi->dir_batch );
+   }
+
+   ffi->dir_batch = NULL;
+   ffi->dir_batch_len = 0;
+   ffi->dir_batch_next = 0;
+}
+
+// stream directory entries into the kernel's buffer, starting after offset.
+// entries are fetched FSKIT_FUSE_READDIR_BATCH at a time from the dir handle's cursor, and each is given its cookie as its offset.
+// when filler reports a full buffer, the rest of the batch waits in ffi for the next call.
+// an offset other than where the stream left off (e.g. after rewinddir or seekdir) repositions the dir handle there.
 int fskit_fuse_readdir(const char *path, void *buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info *fi) {
 
    struct fskit_fuse_state* state = fskit_fuse_get_state();
@@ -699,35 +715,61 @@ int fskit_fuse_readdir(const char *path, void *buf, fuse_fill_dir_t filler, off_
    struct fskit_dir_handle* fdh = NULL;
    struct fskit_fuse_file_info* ffi = NULL;
    int rc = 0;
-   uint64_t num_read = 0;
 
    ffi = (struct fskit_fuse_file_info*)((uintptr_t)fi->fh);
    fdh = ffi->handle.dh;
 
-   struct fskit_dir_entry** dirents = fskit_listdir( state->core, fdh, &num_read, &rc );
+   if( offset != ffi->dir_offset ) {
 
-   if( dirents == NULL || rc != 0 ) {
-      fskit_debug("readdir(%s, %jd, %p, %p) rc = %d\n", path, offset, buf, fi, rc );
-      return rc;
+      // not where we left off--offsets are cookies, so just seek there
+      fskit_fuse_dir_batch_free( ffi );
+      fskit_seekdir( fdh, offset );
+
+      ffi->dir_offset = offset;
    }
 
-   for( uint64_t i = 0; i < num_read; i++ ) {
+   while( true ) {
 
-      rc = filler( buf, dirents[i]->name, NULL, 0 );
-      if( rc != 0 ) {
-         rc = -ENOMEM;
-         break;
+      if( ffi->dir_batch_next >= ffi->dir_batch_len ) {
+
+         // need more entries
+         uint64_t num_read = 0;
+
+         fskit_fuse_dir_batch_free( ffi );
+
+         ffi->dir_batch = fskit_readdirplus( state->core, fdh, FSKIT_FUSE_READDIR_BATCH, &num_read, &rc );
+         if( rc != 0 ) {
+
+            fskit_debug("readdir(%s, %jd, %p, %p) rc = %d\n", path, offset, buf, fi, rc );
+            return rc;
+         }
+
+         if( ffi->dir_batch == NULL ) {
+
+            // end of directory
+            break;
+         }
+
+         // may be 0 if the readdir route omitted the whole batch
+         ffi->dir_batch_len = num_read;
+         continue;
       }
-   }
 
-   fskit_dir_entry_free_list( dirents );
+      struct fskit_dir_entry_plus* dirent = ffi->dir_batch[ ffi->dir_batch_next ];
+      off_t cookie = fskit_entry_name_cookie( dirent->dirent.name );
 
-   if( rc > 0 ) {
-      rc = 0;
+      if( filler( buf, dirent->dirent.name, &dirent->sb, cookie ) != 0 ) {
+
+         // kernel buffer is full; resume here next time
+         break;
+      }
+
+      ffi->dir_batch_next++;
+      ffi->dir_offset = cookie;
    }
 
-   fskit_debug("readdir(%s, %jd, %p, %p) rc = %d\n", path, offset, buf, fi, rc );
-   return rc;
+   fskit_debug("readdir(%s, %jd, %p, %p) rc = %d\n", path, offset, buf, fi, 0 );
+   return 0;
 }
 
 int fskit_fuse_releasedir(const char *path, struct fuse_file_info *fi) {
@@ -746,6 +788,7 @@ int fskit_fuse_releasedir(const char *path, struct fuse_file_info *fi) {
 
    rc = fskit_closedir( state->core, ffi->handle.dh );
 
+   fskit_fuse_dir_batch_free( ffi );
    free( ffi );
 
    fskit_debug("releasedir(%s, %p) rc = %d\n", path, fi, rc );
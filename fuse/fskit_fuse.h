@@ -87,8 +87,18 @@ struct fskit_fuse_file_info {
       struct fskit_file_handle* fh;
       struct fskit_dir_handle* dh;
    } handle;
+   
+   // directory stream state for readdir (directories only).
+   // entries are read from the dir handle in batches; the ones the kernel has not accepted yet are kept here.
+   struct fskit_dir_entry_plus** dir_batch;
+   uint64_t dir_batch_len;
+   uint64_t dir_batch_next;     // index in dir_batch of the next entry to send
+   off_t dir_offset;            // cookie of the last entry sent (FSKIT_DIR_COOKIE_START if none)
 };
 
+// number of directory entries to read from fskit at a time in readdir
+#define FSKIT_FUSE_READDIR_BATCH 128
+
 // access to state
 struct fskit_fuse_state* fskit_fuse_state_new();
 void fskit_fuse_state_free( struct fskit_fuse_state* );
@@ -0,0 +1,47 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+
+#ifndef _FSKIT_AGGREGATE_H_
+#define _FSKIT_AGGREGATE_H_
+
+#include <fskit/debug.h>
+#include <fskit/entry.h>
+
+// totals of everything in a directory's subtree, itself included (so dirs is at least 1).
+// a file with several hard links counts once, under the link fskit records for it (see fskit_entry_get_path).
+struct fskit_aggregate {
+
+   uint64_t bytes;      // sum of the sizes of the files (and symlinks, etc.) below
+   uint64_t files;      // number of entries below that are not directories
+   uint64_t dirs;       // number of directories below
+};
+
+FSKIT_C_LINKAGE_BEGIN 
+
+int fskit_core_enable_aggregates( struct fskit_core* core );
+
+int fskit_stat_aggregate( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, struct fskit_aggregate* aggr );
+int fskit_entry_get_aggregate( struct fskit_entry* fent, struct fskit_aggregate* aggr );
+
+FSKIT_C_LINKAGE_END 
+
+#endif
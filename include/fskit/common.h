@@ -45,6 +45,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <errno.h>
 #include <unistd.h>
 #include <string.h>
@@ -65,6 +66,7 @@
 #include <sys/stat.h>
 
 #include <pthread.h>
+#include <sched.h>
 #include <semaphore.h>
 
 #include <utime.h>
@@ -28,8 +28,16 @@
 
 FSKIT_C_LINKAGE_BEGIN 
 
+// one child to create with fskit_create_many or fskit_mkdir_many
+struct fskit_create_spec {
+   
+   char const* name;    // name within the directory (a single path component)
+   mode_t mode;
+};
+
 struct fskit_file_handle* fskit_create( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, mode_t mode, int* err );
 struct fskit_file_handle* fskit_create_ex( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, mode_t mode, void* cls, int* err );
+int fskit_create_many( struct fskit_core* core, char const* dir_path, uint64_t user, uint64_t group, struct fskit_create_spec const* specs, size_t num_specs, int* rcs );
 
 FSKIT_C_LINKAGE_END 
 
@@ -28,9 +28,18 @@
 
 #define FSKIT_FILESYSTEM_NAMEMAX 255
 
-#define FSKIT_ENTRY_SET_ENTRY_CMP( s1, s2 ) (strcmp((s1)->name, (s2)->name))
+// directory entries are ordered by name cookie (see fskit_entry_name_cookie), then by name
+#define FSKIT_ENTRY_SET_ENTRY_CMP( s1, s2 ) ((s1)->cookie < (s2)->cookie ? -1 : ((s1)->cookie > (s2)->cookie ? 1 : strcmp((s1)->name, (s2)->name)))
 #define FSKIT_XATTR_SET_ENTRY_CMP( x1, x2 ) (strcmp((x1)->name, (x2)->name))
 
+// directory stream positions.  Every other position is the cookie of the last entry read.
+#define FSKIT_DIR_COOKIE_START        0             // before the first entry
+#define FSKIT_DIR_COOKIE_EOF          INT64_MAX     // after the last entry
+#define FSKIT_DIR_COOKIE_FIRST        (FSKIT_DIR_COOKIE_START + 3)     // lowest position of a name other than . and ..
+
+// most shards a directory can be split into (see fskit_entry_enable_shards)
+#define FSKIT_DIR_MAX_SHARDS          1024
+
 // inode types
 #define FSKIT_ENTRY_TYPE_DEAD         0
 #define FSKIT_ENTRY_TYPE_FILE         1
@@ -105,6 +114,7 @@ int fskit_core_inode_free_cb( struct fskit_core* core, fskit_inode_free_t inode_
 
 // core methods
 uint64_t fskit_core_inode_alloc( struct fskit_core* core, struct fskit_entry* parent, struct fskit_entry* child );
+int fskit_core_inode_alloc_many( struct fskit_core* core, struct fskit_entry* parent, struct fskit_entry** children, uint64_t* file_ids, size_t num_children );
 int fskit_core_inode_free( struct fskit_core* core, uint64_t inode );
 struct fskit_entry* fskit_core_resolve_root( struct fskit_core* core, bool writelock );
 void* fskit_core_get_user_data( struct fskit_core* core );
@@ -112,6 +122,9 @@ void* fskit_core_get_user_data( struct fskit_core* core );
 // lookup
 struct fskit_entry* fskit_dir_find_by_name( struct fskit_entry* dir, char const* name );
 
+// sharded directories
+int fskit_entry_enable_shards( struct fskit_entry* dir, int num_shards );
+
 // entry sets
 SGLIB_DEFINE_RBTREE_PROTOTYPES( fskit_entry_set, left, right, color, FSKIT_ENTRY_SET_ENTRY_CMP );
 typedef struct sglib_fskit_entry_set_iterator fskit_entry_set_itr;
@@ -124,6 +137,7 @@ fskit_entry_set* fskit_entry_set_find_itr( fskit_entry_set* set, char const* nam
 bool fskit_entry_set_remove( fskit_entry_set** set, char const* name );
 bool fskit_entry_set_replace( fskit_entry_set* set, char const* name, struct fskit_entry* replacement );
 unsigned int fskit_entry_set_count( fskit_entry_set* set );
+uint64_t fskit_entry_name_cookie( char const* name );
 
 // xattr sets 
 struct fskit_xattr_set_entry;
@@ -149,7 +163,9 @@ fskit_xattr_set* fskit_xattr_set_next( fskit_xattr_set_itr* itr );
 // iteration 
 fskit_entry_set* fskit_entry_set_begin( fskit_entry_set_itr* itr, fskit_entry_set* dirents );
 fskit_entry_set* fskit_entry_set_next( fskit_entry_set_itr* itr );
+fskit_entry_set* fskit_entry_set_seek( fskit_entry_set_itr* itr, fskit_entry_set* dirents, uint64_t cookie );
 char const* fskit_entry_set_name_at( fskit_entry_set* dp );
+uint64_t fskit_entry_set_cookie_at( fskit_entry_set* dp );
 struct fskit_entry* fskit_entry_set_child_at( fskit_entry_set* dp );
 
 // initialization
@@ -223,6 +239,7 @@ uint64_t fskit_entry_get_owner( struct fskit_entry* ent );
 uint64_t fskit_entry_get_group( struct fskit_entry* ent );
 mode_t fskit_entry_get_mode( struct fskit_entry* ent );
 int32_t fskit_entry_get_link_count( struct fskit_entry* ent );
+int32_t fskit_entry_get_open_count( struct fskit_entry* ent );
 void fskit_entry_get_atime( struct fskit_entry* ent, int64_t* atime_sec, int32_t* atime_nsec );
 void fskit_entry_get_mtime( struct fskit_entry* ent, int64_t* mtime_sec, int32_t* mtime_nsec );
 void fskit_entry_get_ctime( struct fskit_entry* ent, int64_t* ctime_sec, int32_t* ctime_nsec );
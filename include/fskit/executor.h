@@ -0,0 +1,57 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#ifndef _FSKIT_EXECUTOR_H_
+#define _FSKIT_EXECUTOR_H_
+
+#include <fskit/common.h>
+
+// a pool of worker threads that route callbacks (and other work) can be run on.
+// each worker has its own job queue; idle workers steal from their peers.
+struct fskit_executor;
+
+// a unit of work 
+typedef void (*fskit_executor_job_func)( void* );
+
+// executor counters 
+struct fskit_executor_stats {
+   
+   int num_threads;             // number of worker threads
+   uint64_t num_submitted;      // number of jobs submitted
+   uint64_t num_completed;      // number of jobs run to completion
+   uint64_t num_stolen;         // number of jobs a worker took from a peer's queue
+   int64_t queue_depth;         // number of jobs waiting to be run
+};
+
+FSKIT_C_LINKAGE_BEGIN 
+
+struct fskit_executor* fskit_executor_new(void);
+int fskit_executor_init( struct fskit_executor* exec, int num_threads );
+int fskit_executor_destroy( struct fskit_executor* exec );
+
+int fskit_executor_submit( struct fskit_executor* exec, fskit_executor_job_func func, void* arg );
+int fskit_executor_call( struct fskit_executor* exec, fskit_executor_job_func func, void* arg );
+
+int fskit_executor_get_stats( struct fskit_executor* exec, struct fskit_executor_stats* stats );
+
+FSKIT_C_LINKAGE_END 
+
+#endif
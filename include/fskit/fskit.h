@@ -29,11 +29,14 @@
 #include <fskit/random.h>
 
 #include <fskit/access.h>
+#include <fskit/aggregate.h>
+#include <fskit/cache.h>
 #include <fskit/chmod.h>
 #include <fskit/chown.h>
 #include <fskit/close.h>
 #include <fskit/closedir.h>
 #include <fskit/create.h>
+#include <fskit/executor.h>
 #include <fskit/getxattr.h>
 #include <fskit/link.h>
 #include <fskit/listxattr.h>
@@ -57,6 +60,7 @@
 #include <fskit/trunc.h>
 #include <fskit/unlink.h>
 #include <fskit/utime.h>
+#include <fskit/walk.h>
 #include <fskit/write.h>
 
 #define FSKIT_FILESYSTEM_TYPE 0x19880119
@@ -24,11 +24,15 @@
 
 #include <fskit/debug.h>
 #include <fskit/entry.h>
+#include <fskit/create.h>
 
 FSKIT_C_LINKAGE_BEGIN
 
 int fskit_mkdir( struct fskit_core* core, char const* path, mode_t mode, uint64_t user, uint64_t group );
 int fskit_mkdir_ex( struct fskit_core* core, char const* path, mode_t mode, uint64_t user, uint64_t group, void* cls );
+int fskit_mkdir_p( struct fskit_core* core, char const* path, mode_t mode, uint64_t user, uint64_t group );
+int fskit_mkdir_p_ex( struct fskit_core* core, char const* path, mode_t mode, uint64_t user, uint64_t group, void* cls );
+int fskit_mkdir_many( struct fskit_core* core, char const* dir_path, uint64_t user, uint64_t group, struct fskit_create_spec const* specs, size_t num_specs, int* rcs );
 
 FSKIT_C_LINKAGE_END 
 
@@ -26,6 +26,10 @@
 #include <fskit/common.h>
 #include <fskit/entry.h>
 
+// fskit-specific open flag: with O_CREAT, also make the missing directories on the way to the file (as by fskit_mkdir_p).
+// They get the file's mode, plus search permission wherever it grants read, plus u+wx.
+#define FSKIT_O_MKPARENTS       (1 << 30)
+
 FSKIT_C_LINKAGE_BEGIN 
 
 struct fskit_file_handle* fskit_open( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, int flags, mode_t mode, int* err );
@@ -39,6 +39,27 @@ size_t fskit_basename_len( char const* path );
 int fskit_depth( char const* path );
 int fskit_path_split( char* path, char*** names );
 
+// path views: these refer to the caller's string instead of copying it
+size_t fskit_dirname_len( char const* path );
+char const* fskit_basename_view( char const* path, size_t* len );
+int fskit_path_name_copy( char const* name, size_t len, char* dest );
+
+// walks the names in a path, one at a time, without copying it.
+// the current name is name[0..len), and is not NUL-terminated.
+struct fskit_path_cursor {
+
+   char const* path;
+   char const* end;
+
+   char const* name;
+   size_t len;
+};
+
+void fskit_path_cursor_init( struct fskit_path_cursor* cur, char const* path, size_t path_len );
+bool fskit_path_cursor_next( struct fskit_path_cursor* cur );
+bool fskit_path_cursor_last( struct fskit_path_cursor const* cur );
+size_t fskit_path_cursor_offset( struct fskit_path_cursor const* cur );
+
 // path resolution
 struct fskit_entry* fskit_entry_resolve_path_cls( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, bool writelock, int* err, int (*ent_eval)( struct fskit_entry*, void* ), void* cls );
 struct fskit_entry* fskit_entry_resolve_path( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, bool writelock, int* err );
@@ -60,8 +81,12 @@ char* fskit_path_iterator_path( struct fskit_path_iterator* itr );
 char* fskit_path_iterator_name( struct fskit_path_iterator* itr );
 int fskit_path_iterator_length( struct fskit_path_iterator* itr );
 
+// path materialization
+char* fskit_entry_get_path( struct fskit_entry* fent, int* err );
+
 // referencing 
 struct fskit_entry* fskit_entry_ref( struct fskit_core* core, char const* fs_path, int* rc );
+int fskit_entry_ref_many( struct fskit_core* core, char const** paths, size_t num_paths, uint64_t user, uint64_t group, struct fskit_entry** fents, int* rcs );
 int fskit_entry_ref_entry( struct fskit_entry* fent );
 int fskit_entry_unref( struct fskit_core* core, char const* fs_path, struct fskit_entry* fent );
 
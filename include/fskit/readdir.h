@@ -25,14 +25,51 @@
 #include <fskit/debug.h>
 #include <fskit/entry.h>
 
+// a directory entry, plus a snapshot of its attributes (see fskit_readdirplus)
+struct fskit_dir_entry_plus {
+   struct fskit_dir_entry dirent;      // must be first: the readdir route sees it as a plain fskit_dir_entry
+   struct stat sb;
+};
+
+// a packed, variable-length directory record, as written by fskit_getdents (cf. getdents64(2)).
+// records are 8-byte aligned; the next one starts reclen bytes after this one.
+struct fskit_dirent64 {
+   uint64_t file_id;
+   uint64_t cookie;     // this entry's position: give it to fskit_getdents to continue after this entry
+   uint16_t reclen;     // length of this record, including the name's terminator and padding
+   uint8_t type;
+   char name[];         // null-terminated
+};
+
+// length of the record for a name of the given length
+#define FSKIT_DIRENT64_RECLEN( namelen ) ((offsetof( struct fskit_dirent64, name ) + (namelen) + 1 + 7) & ~((size_t)7))
+
+// an immutable version of a directory's children (see fskit_dir_snapshot_get)
+struct fskit_dir_snapshot;
+
 FSKIT_C_LINKAGE_BEGIN 
 
 struct fskit_dir_entry** fskit_readdir( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t num_children, uint64_t* num_read, int* err );
 struct fskit_dir_entry** fskit_listdir( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t* num_read, int* err );
 struct fskit_dir_entry** fskit_listdir_locked( struct fskit_core* core, struct fskit_entry* dent, uint64_t* num_read, int* err );
 
+struct fskit_dir_entry_plus** fskit_readdirplus( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t num_children, uint64_t* num_read, int* err );
+struct fskit_dir_entry_plus** fskit_listdirplus( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t* num_read, int* err );
+
+ssize_t fskit_getdents( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t cookie, char* buf, size_t buflen );
+
+int fskit_entry_enable_listing_cache( struct fskit_entry* dir );
+int fskit_entry_disable_listing_cache( struct fskit_entry* dir );
+
+int fskit_entry_enable_snapshots( struct fskit_entry* dir );
+struct fskit_dir_snapshot* fskit_dir_snapshot_get( struct fskit_core* core, struct fskit_dir_handle* dirh, int* err );
+ssize_t fskit_dir_snapshot_getdents( struct fskit_dir_snapshot* snap, uint64_t cookie, char* buf, size_t buflen );
+uint64_t fskit_dir_snapshot_count( struct fskit_dir_snapshot* snap );
+void fskit_dir_snapshot_put( struct fskit_dir_snapshot* snap );
+
 void fskit_dir_entry_free_list( struct fskit_dir_entry** dir_ents );
 void fskit_dir_entry_free( struct fskit_dir_entry* d_ent );
+void fskit_dir_entry_plus_free_list( struct fskit_dir_entry_plus** dir_ents );
 
 int fskit_readdir_omit( struct fskit_dir_entry** dents, int i );
 
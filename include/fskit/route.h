@@ -26,6 +26,7 @@
 
 #include <fskit/common.h>
 #include <fskit/fskit.h>
+#include <fskit/executor.h>
 
 // prototypes
 struct fskit_core;
@@ -53,7 +54,9 @@ struct fskit_path_route;
 #define FSKIT_ROUTE_MATCH_SETXATTR              17
 #define FSKIT_ROUTE_MATCH_REMOVEXATTR           18
 #define FSKIT_ROUTE_MATCH_SETMETADATA           19
-#define FSKIT_ROUTE_NUM_ROUTE_TYPES             20
+#define FSKIT_ROUTE_MATCH_CREATE_MANY           20
+#define FSKIT_ROUTE_MATCH_DESTROY_MANY          21
+#define FSKIT_ROUTE_NUM_ROUTE_TYPES             22
 
 // route consistency disciplines
 #define FSKIT_SEQUENTIAL        1       // route method calls will be serialized
@@ -95,10 +98,40 @@ typedef int (*fskit_entry_route_listxattr_callback_t)( struct fskit_core*, struc
 typedef int (*fskit_entry_route_setxattr_callback_t)( struct fskit_core*, struct fskit_route_metadata*, struct fskit_entry*, char const*, char const*, size_t, int );
 typedef int (*fskit_entry_route_removexattr_callback_t)( struct fskit_core*, struct fskit_route_metadata*, struct fskit_entry*, char const* );
 typedef int (*fskit_entry_route_setmetadata_callback_t)( struct fskit_core*, struct fskit_route_metadata*, struct fskit_entry*, struct fskit_inode_metadata* );
+typedef int (*fskit_entry_route_create_many_callback_t)( struct fskit_core*, struct fskit_route_metadata*, struct fskit_entry*, char const**, struct fskit_entry**, size_t, void** );    // fskit_create_many() and fskit_mkdir_many(): parent, names, children, number of children, inode data (output)
+typedef int (*fskit_entry_route_destroy_many_callback_t)( struct fskit_core*, struct fskit_route_metadata*, char const**, uint64_t const*, void**, size_t );   // fskit_detach_all() and unlink()/rmdir(): paths, inode numbers, inode data, number of entries
 
 // I/O continuation for successful read/write/trunc (i.e. to be called with the route's consistency discipline enforced)
 typedef int (*fskit_route_io_continuation)( struct fskit_core*, struct fskit_entry*, off_t, ssize_t );
 
+// optional route execution options, given to fskit_route_*_ex().
+// zero-initialize (or use fskit_route_opts_init) to get the default behavior.
+struct fskit_route_opts {
+   
+   int max_concurrency;                 // at most this many callbacks will run at once (0 for unlimited)
+   int max_queued;                      // at most this many callers will wait for admission; the rest fail with -EAGAIN (0 for unlimited).  Requires max_concurrency.
+   struct fskit_executor* executor;     // if non-NULL, callbacks run on this thread pool instead of the calling thread
+   bool coalesce;                       // if true, identical concurrent calls share the result of a single callback.  Only honored for stat, read, getxattr, listxattr, and readdir routes.
+                                        // reads are only identical if they are made through handles with the same handle data.
+   uint64_t cache_ttl_ms;               // if non-zero, cache each inode's callback results for this many milliseconds.  Only honored for stat, getxattr, and listxattr routes.
+   struct fskit_entry* subtree;         // if non-NULL, bind the route to this directory and everything beneath it instead of matching a regex (route_regex may then be NULL).
+                                        // the nearest bound ancestor wins, and bound routes take precedence over regex routes.  At most one route of each type may be bound to a directory.
+};
+
+// route admission counters 
+struct fskit_route_stats {
+   
+   uint64_t num_calls;                  // number of callbacks admitted
+   uint64_t num_queued;                 // number of callbacks that had to wait for admission 
+   uint64_t num_rejected;               // number of callbacks rejected because the queue was full 
+   int num_running;                     // number of callbacks running right now
+   uint64_t queue_depth;                // number of callers waiting right now
+   uint64_t max_queue_depth;            // most callers ever waiting at once
+   uint64_t wait_time_ns;               // total time spent waiting for admission 
+   uint64_t max_wait_time_ns;           // longest time a caller waited for admission
+   uint64_t num_coalesced;              // number of calls that shared another in-flight call's result
+};
+
 // define various types of routes
 int fskit_route_create( struct fskit_core* core, char const* route_regex, fskit_entry_route_create_callback_t create_cb, int consistency_discipline );
 int fskit_route_mknod( struct fskit_core* core, char const* route_regex, fskit_entry_route_mknod_callback_t create_cb, int consistency_discipline );
@@ -120,6 +153,28 @@ int fskit_route_listxattr( struct fskit_core* core, char const* route_regex, fsk
 int fskit_route_setxattr( struct fskit_core* core, char const* route_regex, fskit_entry_route_setxattr_callback_t setxattr_callback, int consistency_discipline );
 int fskit_route_removexattr( struct fskit_core* core, char const* route_regex, fskit_entry_route_removexattr_callback_t removexattr_callback, int consistency_discipline );
 int fskit_route_setmetadata( struct fskit_core* core, char const* route_regex, fskit_entry_route_setmetadata_callback_t setmetadata_cb, int consistency_discipline );
+int fskit_route_create_many( struct fskit_core* core, char const* route_regex, fskit_entry_route_create_many_callback_t create_many_cb, int consistency_discipline );
+int fskit_route_destroy_many( struct fskit_core* core, char const* route_regex, fskit_entry_route_destroy_many_callback_t destroy_many_cb, int consistency_discipline );
+
+// define various types of routes, with execution options
+int fskit_route_opts_init( struct fskit_route_opts* opts );
+int fskit_route_create_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_create_callback_t create_cb, int consistency_discipline, struct fskit_route_opts const* opts );
+int fskit_route_mknod_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_mknod_callback_t create_cb, int consistency_discipline, struct fskit_route_opts const* opts );
+int fskit_route_mkdir_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_mkdir_callback_t mkdir_cb, int consistency_discipline, struct fskit_route_opts const* opts );
+int fskit_route_open_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_open_callback_t open_cb, int consistency_discipline, struct fskit_route_opts const* opts );
+int fskit_route_close_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_close_callback_t close_cb, int consistency_discipline, struct fskit_route_opts const* opts );
+int fskit_route_readdir_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_readdir_callback_t readdir_cb, int consistency_discipline, struct fskit_route_opts const* opts );
+int fskit_route_read_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_io_callback_t io_cb, int consistency_discipline, struct fskit_route_opts const* opts );
+int fskit_route_write_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_io_callback_t io_cb, int consistency_discipline, struct fskit_route_opts const* opts );
+int fskit_route_trunc_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_trunc_callback_t io_cb, int consistency_discipline, struct fskit_route_opts const* opts );
+int fskit_route_stat_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_stat_callback_t stat_cb, int consistency_discipline, struct fskit_route_opts const* opts );
+int fskit_route_sync_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_sync_callback_t sync_cb, int consistency_discipline, struct fskit_route_opts const* opts );
+int fskit_route_getxattr_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_getxattr_callback_t getxattr_callback, int consistency_discipline, struct fskit_route_opts const* opts );
+int fskit_route_listxattr_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_listxattr_callback_t listxattr_callback, int consistency_discipline, struct fskit_route_opts const* opts );
+int fskit_route_setxattr_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_setxattr_callback_t setxattr_callback, int consistency_discipline, struct fskit_route_opts const* opts );
+int fskit_route_removexattr_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_removexattr_callback_t removexattr_callback, int consistency_discipline, struct fskit_route_opts const* opts );
+int fskit_route_create_many_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_create_many_callback_t create_many_cb, int consistency_discipline, struct fskit_route_opts const* opts );
+int fskit_route_destroy_many_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_destroy_many_callback_t destroy_many_cb, int consistency_discipline, struct fskit_route_opts const* opts );
 
 // undefine various types of routes
 int fskit_unroute_create( struct fskit_core* core, int route_handle );
@@ -141,10 +196,15 @@ int fskit_unroute_getxattr( struct fskit_core* core, int route_handle );
 int fskit_unroute_listxattr( struct fskit_core* core, int route_handle );
 int fskit_unroute_setxattr( struct fskit_core* core, int route_handle );
 int fskit_unroute_removexattr( struct fskit_core* core, int route_handle );
+int fskit_unroute_create_many( struct fskit_core* core, int route_handle );
+int fskit_unroute_destroy_many( struct fskit_core* core, int route_handle );
 
 // unroute everything 
 int fskit_unroute_all( struct fskit_core* core );
 
+// route admission counters 
+int fskit_route_get_stats( struct fskit_core* core, int route_type, int route_handle, struct fskit_route_stats* stats );
+
 // access route metadata 
 char* fskit_route_metadata_get_path( struct fskit_route_metadata* route_metadata );
 char* fskit_route_metadata_get_name( struct fskit_route_metadata* route_metadata );
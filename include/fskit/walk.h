@@ -0,0 +1,53 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#ifndef _FSKIT_WALK_H_
+#define _FSKIT_WALK_H_
+
+#include <fskit/debug.h>
+#include <fskit/entry.h>
+
+#include <sys/stat.h>
+
+// what a visitor returns (or a negative errno, which ends the walk and is returned by fskit_walk)
+#define FSKIT_WALK_CONTINUE     0       // keep going (into this entry, if it's a directory)
+#define FSKIT_WALK_PRUNE        1       // don't go into this directory
+#define FSKIT_WALK_STOP         2       // end the walk
+
+// a snapshot of one entry met by fskit_walk.  It is only valid during the visitor's call.
+struct fskit_walk_entry {
+
+   char const* path;    // absolute path
+   char const* name;    // last name in path
+   int depth;           // 0 for the entry the walk started at, 1 for its children, etc.
+   struct stat sb;      // attributes, as by fskit_entry_fstat
+};
+
+// visit an entry.  Called with no entries locked, so it may call back into fskit.
+typedef int (*fskit_walk_visitor_t)( struct fskit_core*, struct fskit_walk_entry const*, void* );
+
+FSKIT_C_LINKAGE_BEGIN 
+
+int fskit_walk( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, int num_threads, fskit_walk_visitor_t visitor, void* cls );
+
+FSKIT_C_LINKAGE_END 
+
+#endif
@@ -45,6 +45,14 @@ struct fskit_xattr_set_entry {
    char color;
 };
 
+// another hard link to an entry, besides the one recorded in its parent and name (see fskit_entry_name_set)
+struct fskit_entry_link {
+   struct fskit_entry* parent;
+   char* name;                          // NULL if lost to OOM
+   struct fskit_entry_link* next;
+};
+
+
 // fskit inode structure
 struct fskit_entry {
    uint64_t file_id;             // inode number
@@ -71,11 +79,42 @@ struct fskit_entry {
 
    bool deletion_in_progress;   // set to true if this node is flagged for garbage-collection.  valid only for directories
    bool deletion_through_rename;    // set to true if this node is being deleted because it got renamed-over
+   bool creating;               // set to true while this node's name is reserved by a create whose route has not yet finished.  Protected by the parent's lock.
 
    // if this is a directory, this is allocated and points to a fskit_entry_set
    int64_t num_children;
    fskit_entry_set* children;
 
+   // where this entry is linked: the directory it is in, and its name there (see fskit_entry_get_path).
+   // a file with several hard links records one of them here and the rest in links; when the recorded one goes away,
+   // one of the others takes its place.  An entry without a parent is named by its absolute path instead: "/" for
+   // the root, or where it was when it got unlinked while still open (NULL if it wasn't open).
+   // all are guarded by name_lock (see path.c).  A directory only moves to another directory with the core's
+   // rename_lock held, so its parent can also be read atomically with that held.
+   struct fskit_entry* parent;
+   char* name;
+   struct fskit_entry_link* links;
+   pthread_rwlock_t name_lock;
+
+   // bumped whenever children is changed (see fskit_entry_children_changed), so a cached listing can tell it is stale
+   uint64_t children_gen;
+
+   // if this is a directory with listing caching on, this is its cached listing (see readdir.c).  NULL otherwise.
+   struct fskit_dir_listing_cache* listing_cache;
+
+   // if this is a directory with snapshots on, these are its published children versions (see snapshot.c).  NULL otherwise.
+   struct fskit_dir_versions* versions;
+
+   // if this is a sharded directory, these hold its children other than . and .. (see shard.c).  NULL otherwise.
+   struct fskit_dir_shards* shards;
+
+   // if this is a directory and aggregates are on, these are the totals of its subtree (see aggregate.c).  NULL otherwise.
+   struct fskit_dir_aggregate* aggregate;
+
+   // set while this entry is counted in the totals of the directories above it, so a resize knows to carry the change up.
+   // changed under name_lock
+   bool aggregated;
+
    // application-defined entry data
    void* app_data;
 
@@ -85,19 +124,82 @@ struct fskit_entry {
    // lock governing access to the above structure fields
    pthread_rwlock_t lock;
 
+   // sequence counter over the attributes fskit_entry_fstat() reports, so stat can read them without lock.
+   // odd while a writer is mid-update.  Writers hold meta_lock, since I/O continuations may change attributes under a
+   // route discipline that leaves lock shared or untaken; meta_write_depth is guarded by meta_lock (see fskit_entry_meta_write_begin).
+   uint64_t meta_seq;
+   int meta_write_depth;
+   pthread_mutex_t meta_lock;           // recursive, so updates can nest
+
    // extended attributes
    fskit_xattr_set* xattrs;
    
    // if this is a symlink, this is the target
    char* symlink_target;
+
+   // cached route results (see cache.c).  Guarded by the core's cache lock for this entry, not by lock.
+   struct fskit_route_cache_entry* route_cache;
+   uint64_t route_cache_gen;            // bumped atomically on every invalidation; results cached under an older one are stale
+
+   // routes bound to the subtree this entry is in (see scope.c).  Written under the core's scope lock, not by lock; read atomically.
+   struct fskit_route_scope* scope;
+};
+
+// a directory's route scope: the routes bound to it and everything beneath it.
+// every directory owns one; every other entry refers to the scope of the directory it was last attached to.
+struct fskit_route_scope {
+   
+   struct fskit_route_scope* parent;                                    // scope of the enclosing directory (NULL for root, or if not attached)
+   struct fskit_path_route* routes[ FSKIT_ROUTE_NUM_ROUTE_TYPES ];      // routes bound here, by type (NULL if none)
+   int refcount;                                                        // entries, child scopes, and routes that refer to this scope
+   struct fskit_core* core;                                             // core this scope belongs to
+   struct fskit_route_scope* retired_next;                              // next scope in the core's retired list, once refcount hits 0
+};
+
+// a route resolved ahead of time for a file handle's path (see fskit_route_call_pinned).
+// immutable once published; replaced wholesale when the route table changes.
+struct fskit_route_pin {
+
+   uint64_t route_gen;                  // core->route_gen when this was resolved
+   struct fskit_path_route* route;      // the matched route, or NULL if no route matched
+
+   // match groups
+   char* path;
+   int argc;
+   char** argv;
+
+   struct fskit_route_pin* next;        // linkage in the handle's retired list
 };
 
+// routes pinned into each file handle 
+#define FSKIT_FILE_HANDLE_PIN_READ      0
+#define FSKIT_FILE_HANDLE_PIN_WRITE     1
+#define FSKIT_FILE_HANDLE_PIN_TRUNC     2
+#define FSKIT_FILE_HANDLE_PIN_SYNC      3
+#define FSKIT_FILE_HANDLE_PIN_CLOSE     4
+#define FSKIT_FILE_HANDLE_NUM_PINS      5
+
 // file handle structure
+// number of in-flight I/O counters per file handle.
+// threads are spread across them, so that concurrent I/O on a shared handle doesn't contend on one cache line.
+#define FSKIT_FILE_HANDLE_NUM_IO_SLOTS  16
+
+// set in every slot while the handle is being closed; I/O then ends under the handle's drain_lock
+#define FSKIT_FILE_HANDLE_IO_CLOSING    ((int64_t)1 << 62)
+
+struct fskit_file_handle_io_slot {
+   
+   int64_t num_inflight;                // in-flight I/O, or'ed with FSKIT_FILE_HANDLE_IO_CLOSING
+   char pad[ 64 - sizeof(int64_t) ];
+};
+
+// fent, path, flags, file_id and app_data are immutable until the handle is closed, so I/O reads them without locking.
+// fskit_close() marks the handle as closing and waits for in-flight I/O to drain (see fskit_file_handle_io_begin).
 struct fskit_file_handle {
 
    struct fskit_entry* fent;
 
-   char* path;
+   char* path;          // built on first use (see fskit_file_handle_get_path)
    int flags;
    uint64_t file_id;
 
@@ -106,32 +208,82 @@ struct fskit_file_handle {
 
    // application-defined data
    void* app_data;
+
+   // routes resolved for this handle's path, indexed by FSKIT_FILE_HANDLE_PIN_*.  Swapped atomically.
+   struct fskit_route_pin* route_pins[ FSKIT_FILE_HANDLE_NUM_PINS ];
+
+   // pins replaced after a route table change, which may still be in use until the handle is destroyed
+   struct fskit_route_pin* retired_pins;
+   pthread_mutex_t pin_lock;            // guards retired_pins
+
+   // in-flight I/O, and whether or not the handle is being closed (guarded by lock)
+   struct fskit_file_handle_io_slot io_slots[ FSKIT_FILE_HANDLE_NUM_IO_SLOTS ];
+   bool closing;
+
+   // the closer sleeps on drain_cond until in-flight I/O is done; I/O that ends while it is closing decrements
+   // its count and wakes it up with drain_lock held
+   pthread_mutex_t drain_lock;
+   pthread_cond_t drain_cond;
 };
 
 // directory handle structure
-struct fskit_telldir_entry;
-
 struct fskit_dir_handle {
 
    struct fskit_entry* dent;
 
-   char* path;
+   char* path;          // built on first use (see fskit_dir_handle_get_path)
    uint64_t file_id;
    
-   // for iteration
-   char curr_name[ FSKIT_FILESYSTEM_NAMEMAX+1 ];
-   
-   // for seekdir/telldir 
-   struct fskit_telldir_entry* telldir_list;
+   // stream position: the cookie of the last entry read (see fskit_entry_name_cookie),
+   // FSKIT_DIR_COOKIE_START if nothing has been read yet, or FSKIT_DIR_COOKIE_EOF once the end was reached.
+   // telldir/seekdir just get and set it.
+   uint64_t cookie;
 
    // lock governing access to this structure
    pthread_rwlock_t lock;
 
    // application-defined data
    void* app_data;
-   
-   // eof?
-   bool eof;
+};
+
+// number of locks guarding entries' cached route results
+#define FSKIT_CORE_NUM_CACHE_LOCKS      64
+
+// a cached route result
+struct fskit_route_cache_entry {
+
+   int route_type;                      // one of FSKIT_ROUTE_MATCH_STAT, FSKIT_ROUTE_MATCH_GETXATTR, FSKIT_ROUTE_MATCH_LISTXATTR
+   char* xattr_name;                    // getxattr() only
+   size_t xattr_buf_len;                // getxattr(), listxattr(): size of the caller's buffer
+
+   int cbrc;                            // callback return code
+   uint64_t expires_ns;                 // CLOCK_MONOTONIC deadline
+   uint64_t gen;                        // the entry's route_cache_gen when this was cached
+
+   struct stat sb;                      // stat() only
+   char* data;                          // getxattr(), listxattr() only
+   size_t data_len;
+
+   struct fskit_route_cache_entry* next;
+};
+
+// number of slots a directory's subtree totals are spread across.
+// threads are spread across them, so that resizes under the same directories don't contend on one cache line.
+#define FSKIT_DIR_AGGREGATE_NUM_SLOTS   8
+
+struct fskit_dir_aggregate_slot {
+
+   int64_t bytes;
+   int64_t files;
+   int64_t dirs;
+   char pad[ 64 - 3 * sizeof(int64_t) ];
+};
+
+// a directory's subtree totals (see fskit_aggregate): the sums of its slots' counters.
+// each counter is changed with atomic adds, under the directory's name_lock.
+struct fskit_dir_aggregate {
+
+   struct fskit_dir_aggregate_slot slots[ FSKIT_DIR_AGGREGATE_NUM_SLOTS ];
 };
 
 // fskit core filesystem structure
@@ -158,11 +310,29 @@ struct fskit_core {
    // path routes, indexed by FSKIT_ROUTE_MATCH_*
    fskit_route_table* routes;
 
+   // bumped whenever a route is declared or undeclared, so pinned routes can tell when they are stale
+   uint64_t route_gen;
+
    // lock governing access to the above fields of this structure
    pthread_rwlock_t route_lock;
 
    // extra features to enable 
    uint64_t features;
+
+   // locks guarding entries' cached route results, hashed by entry 
+   pthread_mutex_t cache_locks[ FSKIT_CORE_NUM_CACHE_LOCKS ];
+
+   // serializes renames across directories, so no directory's ancestry changes while a rename checks it for loops
+   pthread_mutex_t rename_lock;
+
+   // serializes changes to entries' route scopes; dispatch reads them without it (see scope.c)
+   pthread_mutex_t scope_lock;
+
+   // number of routes bound to this core's scopes, so dispatch can skip the scope walk when there are none
+   int scope_num_bound;
+
+   // scopes no longer referenced, but possibly still being walked by dispatch.  Guarded by scope_lock.
+   struct fskit_route_scope* scope_retired;
 };
 
 // route method type 
@@ -186,6 +356,8 @@ union fskit_route_method {
    fskit_entry_route_listxattr_callback_t    listxattr_cb;
    fskit_entry_route_removexattr_callback_t  removexattr_cb;
    fskit_entry_route_setmetadata_callback_t  setmetadata_cb;
+   fskit_entry_route_create_many_callback_t  create_many_cb;
+   fskit_entry_route_destroy_many_callback_t destroy_many_cb;
 };
 
 // metadata about the patch matched to the route
@@ -257,6 +429,42 @@ struct fskit_route_dispatch_args {
 
    // for chmod, chown, etc.
    struct fskit_inode_metadata* imd;
+
+   // for create_many() only
+   char const** batch_names;
+   struct fskit_entry** batch_fents;
+   size_t batch_len;
+   void** batch_inode_data;  // output
+
+   // for destroy_many() only (along with batch_len and batch_inode_data)
+   char const** batch_paths;
+   uint64_t const* batch_file_ids;
+};
+
+// an in-flight coalesced route call.
+// lives on the stack of the thread running the callback (the leader); 
+// concurrent identical calls (followers) wait on it and copy the leader's outputs.
+struct fskit_route_flight {
+
+   // key
+   struct fskit_entry* fent;
+   void* handle_data;           // reads only share results within one open handle's backend state
+   off_t iooff;
+   size_t iolen;
+   char const* xattr_name;
+   size_t xattr_buf_len;
+   uint64_t num_dents;
+   uint64_t dents_hash;
+
+   // the leader's arguments, which hold the results once done
+   struct fskit_route_dispatch_args* dargs;
+   int cbrc;
+
+   bool done;
+   int num_waiters;
+   pthread_cond_t cond;
+
+   struct fskit_route_flight* next;
 };
 
 // a path route
@@ -272,25 +480,170 @@ struct fskit_path_route {
    union fskit_route_method method;           // which method to call
 
    pthread_rwlock_t lock;               // lock used to enforce the consistency discipline
+
+   // admission control (see struct fskit_route_opts)
+   int max_concurrency;                 // max number of callbacks running at once (0 for unlimited)
+   int max_queued;                      // max number of callers waiting for admission (0 for unlimited)
+   struct fskit_executor* executor;     // if non-NULL, run callbacks on this pool
+
+   pthread_mutex_t admit_lock;          // guards the fields below
+   pthread_cond_t admit_cond;           // signaled when a callback finishes, or when the queue advances
+   uint64_t admit_head;                 // ticket of the next caller to admit
+   uint64_t admit_tail;                 // next ticket to hand out
+   struct fskit_route_stats stats;
+
+   // result caching (see struct fskit_route_opts)
+   uint64_t cache_ttl_ns;               // how long to cache results (0 to disable)
+
+   // single-flight coalescing (see struct fskit_route_opts)
+   bool coalesce;
+   pthread_mutex_t flight_lock;         // guards flights
+   struct fskit_route_flight* flights;  // calls in progress
+
+   // if non-NULL, this route is bound to a directory subtree instead of a regex (see struct fskit_route_opts)
+   struct fskit_route_scope* scope;
 };
 
+struct fskit_dir_shard;
+struct fskit_create_spec;
+
 // private--needed by closedir()
-int fskit_run_user_close( struct fskit_core* core, char const* path, struct fskit_entry* fent, void* handle_data );
+int fskit_run_user_close( struct fskit_core* core, char const* path, struct fskit_entry* fent, void* handle_data, struct fskit_file_handle* fh );
 
 // private--needed by open()
 int fskit_run_user_create( struct fskit_core* core, char const* path, struct fskit_entry* parent, struct fskit_entry* fent, mode_t mode, void* cls, void** inode_data, void** handle_data );
-int fskit_do_create( struct fskit_core* core, struct fskit_entry* parent, char const* path, mode_t mode, uint64_t user, uint64_t group, void* cls, struct fskit_entry** ret_child, void** handle_data );
+int fskit_do_create( struct fskit_core* core, struct fskit_entry* parent, struct fskit_dir_shard* shard, char const* path, mode_t mode, uint64_t user, uint64_t group, void* cls, struct fskit_entry** ret_child, void** handle_data, bool* parent_pinned );
 struct fskit_file_handle* fskit_open_ex( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, int flags, mode_t mode, void* cls, int* err );
 
+// private--two-phase create, needed by create, mkdir, and mknod
+// runs a create-type route on a reserved child.  Called without the parent locked.
+typedef int (*fskit_reserved_route_t)( struct fskit_core* core, char const* path, struct fskit_entry* parent, struct fskit_entry* child, void* cls );
+int fskit_entry_create_reserved( struct fskit_core* core, char const* path, struct fskit_entry* parent, struct fskit_dir_shard* shard, char const* name, struct fskit_entry* child, fskit_reserved_route_t route, void* route_cls, bool* parent_pinned );
+int fskit_entry_create_many( struct fskit_core* core, char const* dir_path, uint64_t user, uint64_t group, struct fskit_create_spec const* specs, size_t num_specs, int* rcs, int type, fskit_reserved_route_t route );
+
+// private--needed by rename()
+int fskit_entry_attach_lowlevel_move( struct fskit_entry* parent, struct fskit_entry* fent, char const* name );
+int fskit_entry_detach_lowlevel_move( struct fskit_entry* parent, char const* child_name );
+
+// private--walk a path, making missing directories; needed by mkdir -p and open() with parents
+struct fskit_entry* fskit_entry_mkdir_parents( struct fskit_core* core, char const* path, size_t path_len, mode_t mode, uint64_t user, uint64_t group, void* cls, bool parent_lookup, int* err );
+
 // private--needed by opendir()
 int fskit_run_user_open( struct fskit_core* core, char const* path, struct fskit_entry* fent, int flags, void** handle_data );
 
 // private--needed by read
-ssize_t fskit_run_user_read( struct fskit_core* core, char const* path, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data );
+ssize_t fskit_run_user_read( struct fskit_core* core, char const* path, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data, struct fskit_file_handle* fh );
 
 // private--needed by any detach logic
 int fskit_run_user_detach( struct fskit_core* core, char const* path, struct fskit_entry* parent, struct fskit_entry* fent );
 
+// private--entries' names, kept up to date by attach, detach, and rename (see path.c)
+void fskit_entry_name_set( struct fskit_entry* fent, struct fskit_entry* old_parent, char const* old_name, struct fskit_entry* new_parent, char* new_name );
+void fskit_entry_name_clear( struct fskit_entry* fent, struct fskit_entry* parent, char const* name, char const* last_path );
+void fskit_entry_name_free( struct fskit_entry* fent );
+void fskit_entry_copy_name( struct fskit_entry* fent, char* name );
+void fskit_entry_name_rlock( struct fskit_entry* fent );
+void fskit_entry_name_unlock( struct fskit_entry* fent );
+struct fskit_entry* fskit_entry_name_walk_up( struct fskit_entry* fent, struct fskit_entry** locked );
+
+// private--subtree totals, kept up to date by resizes and by fskit_entry_name_set/clear (see aggregate.c)
+int fskit_dir_aggregate_init( struct fskit_entry* dir, struct fskit_entry* parent );
+void fskit_dir_aggregate_free( struct fskit_entry* dir );
+void fskit_entry_aggregate_move_locked( struct fskit_entry* fent, struct fskit_entry* old_parent, struct fskit_entry* new_parent );
+void fskit_entry_resize( struct fskit_entry* fent, off_t size );
+
+// routes pinned into file handles 
+int fskit_route_call_pinned( struct fskit_core* core, struct fskit_file_handle* fh, int route_type, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_file_handle_pin_routes( struct fskit_core* core, struct fskit_file_handle* fh, char const* path );
+int fskit_file_handle_unpin_routes( struct fskit_file_handle* fh );
+
+// route result cache
+int fskit_route_cache_lookup( struct fskit_core* core, struct fskit_path_route* route, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc, uint64_t* gen );
+int fskit_route_cache_insert( struct fskit_core* core, struct fskit_path_route* route, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int cbrc, uint64_t gen );
+int fskit_route_cache_free( struct fskit_entry* fent );
+void fskit_route_cache_stale( struct fskit_entry* fent );
+
+// reference counting
+bool fskit_entry_unref_nonlast( struct fskit_entry* fent );
+
+// cached directory listings 
+void fskit_entry_children_changed( struct fskit_entry* dir );
+void fskit_dir_listing_cache_free( struct fskit_entry* dir );
+
+// directory shards
+struct fskit_dir_shard {
+
+   pthread_rwlock_t lock;
+   fskit_entry_set* children;
+};
+
+struct fskit_dir_shards {
+
+   int num_shards;
+   uint64_t width;              // number of cookies each shard covers, from FSKIT_DIR_COOKIE_FIRST up
+   pthread_mutex_t meta_lock;   // serializes shard writers' updates to the directory's mtime
+   struct fskit_dir_shard* shards;
+};
+
+// iterator over a directory's children and all of its shards, in cookie order
+struct fskit_dir_itr {
+
+   struct fskit_entry* dir;
+   int shard;                   // -1 while in dir->children
+   bool locked;                 // whether we hold shard's read lock
+   fskit_entry_set_itr itr;
+};
+
+struct fskit_dir_shard* fskit_entry_dir_shard( struct fskit_entry* dir, char const* name );
+struct fskit_dir_shard* fskit_entry_dir_shard_rlock( struct fskit_entry* dir, char const* name );
+struct fskit_dir_shard* fskit_entry_dir_shard_wlock( struct fskit_entry* dir, char const* name );
+void fskit_entry_dir_shard_unlock( struct fskit_dir_shard* shard );
+void fskit_entry_dir_unlock( struct fskit_entry* dir, struct fskit_dir_shard* shard );
+void fskit_entry_dir_relock( struct fskit_entry* dir, struct fskit_dir_shard* shard );
+int fskit_entry_dir_insert( struct fskit_entry* dir, char const* name, struct fskit_entry* child );
+bool fskit_entry_dir_remove( struct fskit_entry* dir, char const* name );
+uint64_t fskit_entry_dir_count( struct fskit_entry* dir );
+void fskit_entry_dir_touch( struct fskit_entry* dir );
+int fskit_entry_dir_gather_shards( struct fskit_entry* dir );
+void fskit_dir_shards_free( struct fskit_entry* dir );
+
+fskit_entry_set* fskit_dir_itr_seek( struct fskit_dir_itr* itr, struct fskit_entry* dir, uint64_t cookie );
+fskit_entry_set* fskit_dir_itr_next( struct fskit_dir_itr* itr );
+void fskit_dir_itr_end( struct fskit_dir_itr* itr );
+
+struct fskit_entry* fskit_entry_resolve_dir( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, bool writelock, int* err );
+struct fskit_entry* fskit_entry_resolve_path_parent( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, int* err );
+
+// multi-version directory snapshots
+void fskit_dir_versions_insert( struct fskit_entry* dir, char const* name, struct fskit_entry* child );
+void fskit_dir_versions_remove( struct fskit_entry* dir, char const* name );
+void fskit_dir_versions_reset( struct fskit_entry* dir );
+void fskit_dir_versions_free( struct fskit_entry* dir );
+
+// lock-free attribute snapshots 
+void fskit_entry_meta_write_begin( struct fskit_entry* fent );
+void fskit_entry_meta_write_end( struct fskit_entry* fent );
+uint64_t fskit_entry_meta_read_begin( struct fskit_entry* fent );
+bool fskit_entry_meta_read_retry( struct fskit_entry* fent, uint64_t seq );
+
+// lock-free file handle I/O 
+int fskit_file_handle_io_begin( struct fskit_file_handle* fh );
+void fskit_file_handle_io_end( struct fskit_file_handle* fh );
+int fskit_file_handle_io_drain( struct fskit_file_handle* fh );
+void fskit_file_handle_io_undrain( struct fskit_file_handle* fh );
+
+// subtree-bound routes 
+int fskit_route_scope_init_dir( struct fskit_entry* dir, struct fskit_entry* parent );
+int fskit_route_scope_attach( struct fskit_entry* parent, struct fskit_entry* fent );
+int fskit_route_scope_release( struct fskit_entry* fent );
+int fskit_route_scope_ref_dir( struct fskit_entry* dir, struct fskit_route_scope** scope );
+int fskit_route_scope_bind( struct fskit_path_route* route );
+int fskit_route_scope_unbind( struct fskit_path_route* route );
+int fskit_route_scope_put( struct fskit_route_scope* scope );
+struct fskit_path_route* fskit_route_scope_find( struct fskit_core* core, int route_type, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs );
+bool fskit_route_scope_any_bound( struct fskit_core* core );
+void fskit_route_scope_free_retired( struct fskit_core* core );
+
 // routes 
 typedef struct fskit_path_route* fskit_path_route_entry;
 SGLIB_DEFINE_VECTOR_PROTOTYPES( fskit_path_route_entry );
@@ -330,8 +683,11 @@ int fskit_route_setxattr_args( struct fskit_route_dispatch_args* args, char cons
 int fskit_route_listxattr_args( struct fskit_route_dispatch_args* args, char* xattr_buf, size_t xattr_buf_len );
 int fskit_route_removexattr_args( struct fskit_route_dispatch_args* args, char const* xattr_name );
 int fskit_route_setmetadata_args( struct fskit_route_dispatch_args* dargs, struct fskit_inode_metadata* imd );
+int fskit_route_create_many_args( struct fskit_route_dispatch_args* dargs, char const** names, struct fskit_entry** fents, size_t num_fents, void** inode_data, void* cls );
+int fskit_route_destroy_many_args( struct fskit_route_dispatch_args* dargs, char const** paths, uint64_t const* file_ids, void** inode_data, size_t num_entries );
 
 // call user-supplied routes (internal API)
+int fskit_route_call( struct fskit_core* core, int route_type, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
 int fskit_route_call_create( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
 int fskit_route_call_mknod( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
 int fskit_route_call_mkdir( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
@@ -352,11 +708,14 @@ int fskit_route_call_listxattr( struct fskit_core* core, char const* path, struc
 int fskit_route_call_setxattr( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
 int fskit_route_call_removexattr( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
 int fskit_route_call_setmetadata( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_create_many( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_destroy_many( struct fskit_core* core, char const* path, struct fskit_route_dispatch_args* dargs, int* cbrc );
+bool fskit_route_exists( struct fskit_core* core, int route_type );
 
 // memory management (internal API)
 int fskit_path_route_free( struct fskit_path_route* route );
 
 // private--needed by open()
-int fskit_run_user_trunc( struct fskit_core* core, char const* path, struct fskit_entry* fent, off_t new_size, void* handle_data );
+int fskit_run_user_trunc( struct fskit_core* core, char const* path, struct fskit_entry* fent, off_t new_size, void* handle_data, struct fskit_file_handle* fh );
 
 #endif
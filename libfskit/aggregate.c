@@ -0,0 +1,307 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+
+#include <fskit/aggregate.h>
+#include <fskit/path.h>
+#include <fskit/util.h>
+
+#include "fskit_private/private.h"
+
+// Every directory keeps the totals of its subtree, so du and quota checks read them in O(1) instead of walking it.
+// A change is carried up the chain of parents by walking up from the entry that changed, with that entry's name lock
+// held and each directory above it name-locked in turn while its totals are updated (see fskit_entry_name_walk_up):
+// * a resize holds the entry's name lock shared, and adds the size delta to each directory above it;
+// * attaching, detaching, and moving an entry hold its name lock exclusively (see fskit_entry_name_set/clear),
+//   and subtract the entry's totals from the directories it left and add them to the ones it joined.
+// a move reads a directory's totals with the directory's name lock held exclusively, so a change coming up from below
+// either reaches the directory first (and moves with its totals) or after (and follows it to its new parent); either
+// way the totals stay exact.
+// each directory's totals are spread across slots that threads add to (see fskit_dir_aggregate_slot_self) and are summed
+// when read, so writes and resizes under the same directories don't all contend on one counter per directory.
+
+
+// which slot of a directory's totals this thread adds to (-1 if not yet assigned)
+static _Thread_local int fskit_dir_aggregate_slot = -1;
+static int fskit_dir_aggregate_next_slot = 0;
+
+static int fskit_dir_aggregate_slot_self(void) {
+
+   if( fskit_dir_aggregate_slot < 0 ) {
+      fskit_dir_aggregate_slot = __atomic_fetch_add( &fskit_dir_aggregate_next_slot, 1, __ATOMIC_RELAXED ) % FSKIT_DIR_AGGREGATE_NUM_SLOTS;
+   }
+
+   return fskit_dir_aggregate_slot;
+}
+
+
+// fold a directory's slots into its totals.
+// the sums are exact if the directory is name-locked exclusively; otherwise, concurrent changes may or may not be in them.
+static void fskit_dir_aggregate_sum( struct fskit_dir_aggregate* aggr, int64_t* bytes, int64_t* files, int64_t* dirs ) {
+
+   *bytes = 0;
+   *files = 0;
+   *dirs = 0;
+
+   for( int i = 0; i < FSKIT_DIR_AGGREGATE_NUM_SLOTS; i++ ) {
+
+      *bytes += __atomic_load_n( &aggr->slots[i].bytes, __ATOMIC_RELAXED );
+      *files += __atomic_load_n( &aggr->slots[i].files, __ATOMIC_RELAXED );
+      *dirs += __atomic_load_n( &aggr->slots[i].dirs, __ATOMIC_RELAXED );
+   }
+}
+
+
+// add to the totals of dir and of every directory above it, in this thread's slot of each.
+// dir's child that changed must be name-locked, so dir stays linked while this walks up from it.
+static void fskit_aggregate_add_locked( struct fskit_entry* dir, int64_t bytes, int64_t files, int64_t dirs ) {
+
+   struct fskit_entry* locked = NULL;
+
+   if( dir != NULL && __atomic_load_n( &dir->parent, __ATOMIC_ACQUIRE ) != NULL ) {
+
+      fskit_entry_name_rlock( dir );
+      locked = dir;
+   }
+
+   for( ; dir != NULL; dir = fskit_entry_name_walk_up( dir, &locked ) ) {
+
+      struct fskit_dir_aggregate* aggr = __atomic_load_n( &dir->aggregate, __ATOMIC_ACQUIRE );
+      if( aggr == NULL ) {
+         continue;
+      }
+
+      struct fskit_dir_aggregate_slot* slot = &aggr->slots[ fskit_dir_aggregate_slot_self() ];
+
+      if( bytes != 0 ) {
+         __atomic_add_fetch( &slot->bytes, bytes, __ATOMIC_RELAXED );
+      }
+      if( files != 0 ) {
+         __atomic_add_fetch( &slot->files, files, __ATOMIC_RELAXED );
+      }
+      if( dirs != 0 ) {
+         __atomic_add_fetch( &slot->dirs, dirs, __ATOMIC_RELAXED );
+      }
+   }
+
+   if( locked != NULL ) {
+      fskit_entry_name_unlock( locked );
+   }
+}
+
+
+// does dir keep totals?
+static bool fskit_dir_has_aggregate( struct fskit_entry* dir ) {
+   return dir != NULL && __atomic_load_n( &dir->aggregate, __ATOMIC_ACQUIRE ) != NULL;
+}
+
+
+// move what fent counts for from the totals above old_parent to the totals above new_parent.
+// either may be NULL, for an entry being attached for the first time or being detached.
+// called by fskit_entry_name_set/clear, with fent's name lock held exclusively.
+void fskit_entry_aggregate_move_locked( struct fskit_entry* fent, struct fskit_entry* old_parent, struct fskit_entry* new_parent ) {
+
+   int64_t bytes = 0;
+   int64_t files = 0;
+   int64_t dirs = 0;
+
+   if( !fskit_dir_has_aggregate( old_parent ) && !fskit_dir_has_aggregate( new_parent ) ) {
+
+      // aggregates are off
+      __atomic_store_n( &fent->aggregated, false, __ATOMIC_RELEASE );
+      return;
+   }
+
+   if( fent->type == FSKIT_ENTRY_TYPE_DIR ) {
+
+      struct fskit_dir_aggregate* aggr = __atomic_load_n( &fent->aggregate, __ATOMIC_ACQUIRE );
+      if( aggr != NULL ) {
+         fskit_dir_aggregate_sum( aggr, &bytes, &files, &dirs );
+      }
+      else {
+         dirs = 1;
+      }
+   }
+   else {
+
+      // resizes of an aggregated entry hold its name lock, so this is stable
+      bytes = __atomic_load_n( &fent->size, __ATOMIC_ACQUIRE );
+      files = 1;
+   }
+
+   fskit_aggregate_add_locked( old_parent, -bytes, -files, -dirs );
+   fskit_aggregate_add_locked( new_parent, bytes, files, dirs );
+
+   __atomic_store_n( &fent->aggregated, fskit_dir_has_aggregate( new_parent ), __ATOMIC_RELEASE );
+}
+
+
+// set an entry's size, and carry the change up to the totals of the directories above it.
+// the size is swapped in atomically and the delta taken from the size it replaced, so concurrent resizes (e.g. from
+// write continuations under a concurrent route discipline) each carry exactly their own change.
+// NOTE: fent must be ref'ed, and this must be called between fskit_entry_meta_write_begin/end
+void fskit_entry_resize( struct fskit_entry* fent, off_t size ) {
+
+   off_t old_size = 0;
+
+   // only attaching fent makes it aggregated, and that needs fent locked too
+   if( !__atomic_load_n( &fent->aggregated, __ATOMIC_ACQUIRE ) ) {
+
+      __atomic_store_n( &fent->size, size, __ATOMIC_RELEASE );
+      return;
+   }
+
+   fskit_entry_name_rlock( fent );
+
+   old_size = __atomic_exchange_n( &fent->size, size, __ATOMIC_ACQ_REL );
+
+   if( size != old_size ) {
+      fskit_aggregate_add_locked( fent->parent, (int64_t)size - (int64_t)old_size, 0, 0 );
+   }
+
+   fskit_entry_name_unlock( fent );
+}
+
+
+// give a new directory totals, if the directory it is being made in has them.
+// NOTE: parent must be locked
+// return 0 on success
+// return -ENOMEM on OOM
+int fskit_dir_aggregate_init( struct fskit_entry* dir, struct fskit_entry* parent ) {
+
+   if( parent == dir || !fskit_dir_has_aggregate( parent ) ) {
+      return 0;
+   }
+
+   struct fskit_dir_aggregate* aggr = CALLOC_LIST( struct fskit_dir_aggregate, 1 );
+   if( aggr == NULL ) {
+      return -ENOMEM;
+   }
+
+   // itself
+   aggr->slots[0].dirs = 1;
+
+   dir->aggregate = aggr;
+   return 0;
+}
+
+
+// free a directory's totals
+void fskit_dir_aggregate_free( struct fskit_entry* dir ) {
+
+   fskit_safe_free( dir->aggregate );
+}
+
+
+// turn on subtree totals for every directory in the filesystem.
+// directories made from now on get them as well, and they can't be turned off again.
+// the totals start out empty, so this must be called before anything is made.
+// return 0 on success (including if they were already on)
+// return -ENOTEMPTY if the root directory has children
+// return -ENOMEM on OOM
+int fskit_core_enable_aggregates( struct fskit_core* core ) {
+
+   int rc = 0;
+   struct fskit_dir_aggregate* aggr = NULL;
+
+   fskit_entry_wlock( &core->root );
+
+   if( core->root.aggregate != NULL ) {
+
+      fskit_entry_unlock( &core->root );
+      return 0;
+   }
+
+   // only . and ..
+   if( fskit_entry_dir_count( &core->root ) > 2 ) {
+
+      fskit_entry_unlock( &core->root );
+      return -ENOTEMPTY;
+   }
+
+   aggr = CALLOC_LIST( struct fskit_dir_aggregate, 1 );
+   if( aggr == NULL ) {
+
+      rc = -ENOMEM;
+   }
+   else {
+
+      aggr->slots[0].dirs = 1;
+      __atomic_store_n( &core->root.aggregate, aggr, __ATOMIC_RELEASE );
+   }
+
+   fskit_entry_unlock( &core->root );
+   return rc;
+}
+
+
+// get the totals of the subtree at fent.  A file (or symlink, etc.) has only itself.
+// each counter is exact once concurrent changes to the subtree land; together, they are not a snapshot.
+// NOTE: fent must be at least read-locked
+// return 0 on success
+// return -ENOTSUP if fent is a directory without totals (i.e. aggregates are off)
+int fskit_entry_get_aggregate( struct fskit_entry* fent, struct fskit_aggregate* aggr ) {
+
+   int64_t bytes = 0;
+   int64_t files = 0;
+   int64_t dirs = 0;
+
+   memset( aggr, 0, sizeof(struct fskit_aggregate) );
+
+   if( fent->type != FSKIT_ENTRY_TYPE_DIR ) {
+
+      aggr->bytes = __atomic_load_n( &fent->size, __ATOMIC_ACQUIRE );
+      aggr->files = 1;
+      return 0;
+   }
+
+   struct fskit_dir_aggregate* dir_aggr = __atomic_load_n( &fent->aggregate, __ATOMIC_ACQUIRE );
+   if( dir_aggr == NULL ) {
+      return -ENOTSUP;
+   }
+
+   fskit_dir_aggregate_sum( dir_aggr, &bytes, &files, &dirs );
+
+   aggr->bytes = bytes;
+   aggr->files = files;
+   aggr->dirs = dirs;
+
+   return 0;
+}
+
+
+// get the totals of the subtree at path (see fskit_entry_get_aggregate)
+// return 0 on success
+// return -ENOTSUP if aggregates are off
+// return the path resolution error if path can't be resolved
+int fskit_stat_aggregate( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, struct fskit_aggregate* aggr ) {
+
+   int rc = 0;
+   struct fskit_entry* fent = fskit_entry_resolve_path( core, path, user, group, false, &rc );
+   if( fent == NULL ) {
+      return rc;
+   }
+
+   rc = fskit_entry_get_aggregate( fent, aggr );
+
+   fskit_entry_unlock( fent );
+   return rc;
+}
@@ -0,0 +1,321 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include <fskit/cache.h>
+#include <fskit/route.h>
+#include <fskit/util.h>
+
+#include "fskit_private/private.h"
+
+// get the lock that guards an entry's cached route results
+static pthread_mutex_t* fskit_route_cache_lock( struct fskit_core* core, struct fskit_entry* fent ) {
+   
+   uintptr_t h = (uintptr_t)fent;
+   
+   // entries are at least 8-byte aligned 
+   h ^= (h >> 17);
+   return &core->cache_locks[ (h >> 3) % FSKIT_CORE_NUM_CACHE_LOCKS ];
+}
+
+
+// current CLOCK_MONOTONIC time, in nanoseconds
+static uint64_t fskit_route_cache_now_ns(void) {
+   
+   struct timespec now;
+   clock_gettime( CLOCK_MONOTONIC, &now );
+   
+   return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+
+// free a cached result 
+static void fskit_route_cache_entry_free( struct fskit_route_cache_entry* ent ) {
+   
+   fskit_safe_free( ent->xattr_name );
+   fskit_safe_free( ent->data );
+   fskit_safe_free( ent );
+}
+
+
+// does a cached result answer this call?
+static bool fskit_route_cache_entry_matches( struct fskit_route_cache_entry* ent, int route_type, struct fskit_route_dispatch_args* dargs ) {
+   
+   if( ent->route_type != route_type ) {
+      return false;
+   }
+   
+   switch( route_type ) {
+      
+      case FSKIT_ROUTE_MATCH_STAT:
+         return true;
+         
+      case FSKIT_ROUTE_MATCH_GETXATTR:
+         return ent->xattr_buf_len == dargs->xattr_buf_len && strcmp( ent->xattr_name, dargs->xattr_name ) == 0;
+         
+      case FSKIT_ROUTE_MATCH_LISTXATTR:
+         return ent->xattr_buf_len == dargs->xattr_buf_len;
+         
+      default:
+         return false;
+   }
+}
+
+
+// can this call's result be cached?
+static bool fskit_route_cache_enabled( struct fskit_path_route* route, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs ) {
+   
+   if( route->cache_ttl_ns == 0 || fent == NULL ) {
+      return false;
+   }
+   
+   switch( route->route_type ) {
+      
+      case FSKIT_ROUTE_MATCH_STAT:
+         return dargs->sb != NULL;
+         
+      case FSKIT_ROUTE_MATCH_GETXATTR:
+         return dargs->xattr_name != NULL;
+         
+      case FSKIT_ROUTE_MATCH_LISTXATTR:
+         return true;
+         
+      default:
+         return false;
+   }
+}
+
+
+// look up a cached result for a route call, and copy it into dargs.
+// set *gen to the entry's cache generation, which must be passed to fskit_route_cache_insert on a miss.
+// return 0 on hit, and set *cbrc to the cached callback return code
+// return -ENOENT on miss, or if the route does not cache results
+int fskit_route_cache_lookup( struct fskit_core* core, struct fskit_path_route* route, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc, uint64_t* gen ) {
+   
+   int rc = -ENOENT;
+   pthread_mutex_t* lock = NULL;
+   struct fskit_route_cache_entry* ent = NULL;
+   uint64_t now = 0;
+   
+   if( !fskit_route_cache_enabled( route, fent, dargs ) ) {
+      return -ENOENT;
+   }
+   
+   now = fskit_route_cache_now_ns();
+   lock = fskit_route_cache_lock( core, fent );
+   
+   pthread_mutex_lock( lock );
+   
+   *gen = __atomic_load_n( &fent->route_cache_gen, __ATOMIC_ACQUIRE );
+   
+   for( ent = fent->route_cache; ent != NULL; ent = ent->next ) {
+      
+      if( !fskit_route_cache_entry_matches( ent, route->route_type, dargs ) ) {
+         continue;
+      }
+      
+      if( ent->expires_ns <= now || ent->gen != *gen ) {
+         // stale 
+         break;
+      }
+      
+      switch( route->route_type ) {
+         
+         case FSKIT_ROUTE_MATCH_STAT:
+            
+            memcpy( dargs->sb, &ent->sb, sizeof(struct stat) );
+            break;
+            
+         case FSKIT_ROUTE_MATCH_GETXATTR:
+         case FSKIT_ROUTE_MATCH_LISTXATTR:
+            
+            if( ent->data != NULL && dargs->xattr_buf != NULL ) {
+               memcpy( dargs->xattr_buf, ent->data, MIN( ent->data_len, dargs->xattr_buf_len ) );
+            }
+            break;
+      }
+      
+      *cbrc = ent->cbrc;
+      rc = 0;
+      break;
+   }
+   
+   pthread_mutex_unlock( lock );
+   
+   return rc;
+}
+
+
+// remember the result of a route call.
+// does nothing if the entry was invalidated since the lookup that returned gen, or if the callback failed.
+// return 0 on success (including if nothing was cached)
+// return -ENOMEM on OOM
+int fskit_route_cache_insert( struct fskit_core* core, struct fskit_path_route* route, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int cbrc, uint64_t gen ) {
+   
+   pthread_mutex_t* lock = NULL;
+   struct fskit_route_cache_entry* ent = NULL;
+   struct fskit_route_cache_entry** itr = NULL;
+   uint64_t now = 0;
+   
+   if( cbrc < 0 || !fskit_route_cache_enabled( route, fent, dargs ) ) {
+      return 0;
+   }
+   
+   now = fskit_route_cache_now_ns();
+   
+   ent = CALLOC_LIST( struct fskit_route_cache_entry, 1 );
+   if( ent == NULL ) {
+      return -ENOMEM;
+   }
+   
+   ent->route_type = route->route_type;
+   ent->cbrc = cbrc;
+   ent->expires_ns = now + route->cache_ttl_ns;
+   ent->gen = gen;
+   
+   switch( route->route_type ) {
+      
+      case FSKIT_ROUTE_MATCH_STAT:
+         
+         memcpy( &ent->sb, dargs->sb, sizeof(struct stat) );
+         break;
+         
+      case FSKIT_ROUTE_MATCH_GETXATTR:
+      case FSKIT_ROUTE_MATCH_LISTXATTR:
+         
+         ent->xattr_buf_len = dargs->xattr_buf_len;
+         
+         if( dargs->xattr_name != NULL ) {
+            
+            ent->xattr_name = strdup( dargs->xattr_name );
+            if( ent->xattr_name == NULL ) {
+               
+               fskit_route_cache_entry_free( ent );
+               return -ENOMEM;
+            }
+         }
+         
+         if( cbrc > 0 && dargs->xattr_buf != NULL && dargs->xattr_buf_len > 0 ) {
+            
+            ent->data_len = MIN( (size_t)cbrc, dargs->xattr_buf_len );
+            ent->data = CALLOC_LIST( char, ent->data_len );
+            if( ent->data == NULL ) {
+               
+               fskit_route_cache_entry_free( ent );
+               return -ENOMEM;
+            }
+            
+            memcpy( ent->data, dargs->xattr_buf, ent->data_len );
+         }
+         break;
+   }
+   
+   lock = fskit_route_cache_lock( core, fent );
+   
+   pthread_mutex_lock( lock );
+   
+   if( __atomic_load_n( &fent->route_cache_gen, __ATOMIC_ACQUIRE ) != gen ) {
+      
+      // invalidated while the callback ran; this result may be stale
+      pthread_mutex_unlock( lock );
+      
+      fskit_route_cache_entry_free( ent );
+      return 0;
+   }
+   
+   // replace the old result for this call, and drop expired ones 
+   itr = &fent->route_cache;
+   while( *itr != NULL ) {
+      
+      struct fskit_route_cache_entry* old = *itr;
+      
+      if( old->expires_ns <= now || old->gen != gen || fskit_route_cache_entry_matches( old, route->route_type, dargs ) ) {
+         
+         *itr = old->next;
+         fskit_route_cache_entry_free( old );
+      }
+      else {
+         
+         itr = &old->next;
+      }
+   }
+   
+   ent->next = fent->route_cache;
+   fent->route_cache = ent;
+   
+   pthread_mutex_unlock( lock );
+   
+   return 0;
+}
+
+
+// free all of an entry's cached results, without locking.
+// only call this when no other thread can reference fent (i.e. when destroying it)
+// return 0 on success
+int fskit_route_cache_free( struct fskit_entry* fent ) {
+   
+   struct fskit_route_cache_entry* ent = fent->route_cache;
+   
+   while( ent != NULL ) {
+      
+      struct fskit_route_cache_entry* next = ent->next;
+      fskit_route_cache_entry_free( ent );
+      ent = next;
+   }
+   
+   fent->route_cache = NULL;
+   return 0;
+}
+
+
+// drop all of an entry's cached route results, so the next stat, getxattr, or listxattr calls its route.
+// fent may be locked or unlocked, but must be referenced.
+// return 0 on success
+int fskit_entry_invalidate( struct fskit_core* core, struct fskit_entry* fent ) {
+   
+   struct fskit_route_cache_entry* ent = NULL;
+   pthread_mutex_t* lock = fskit_route_cache_lock( core, fent );
+   
+   pthread_mutex_lock( lock );
+   
+   ent = fent->route_cache;
+   fent->route_cache = NULL;
+   __atomic_add_fetch( &fent->route_cache_gen, 1, __ATOMIC_RELEASE );
+   
+   pthread_mutex_unlock( lock );
+   
+   while( ent != NULL ) {
+      
+      struct fskit_route_cache_entry* next = ent->next;
+      fskit_route_cache_entry_free( ent );
+      ent = next;
+   }
+   
+   return 0;
+}
+
+
+// mark an entry's cached route results stale, without freeing them (the next insert drops them).
+// for places that change what stat reports (e.g. link counts, or a directory's mtime) but don't have the core;
+// needs no locks, but fent must be referenced or locked.
+void fskit_route_cache_stale( struct fskit_entry* fent ) {
+   
+   __atomic_add_fetch( &fent->route_cache_gen, 1, __ATOMIC_RELEASE );
+}
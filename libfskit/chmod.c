@@ -22,6 +22,7 @@
 #include <fskit/chmod.h>
 #include <fskit/path.h>
 #include <fskit/entry.h>
+#include <fskit/cache.h>
 
 #include "fskit_private/private.h"
 
@@ -30,7 +31,9 @@
 // NOTE: fent must be write-locked 
 int fskit_entry_set_mode( struct fskit_entry* fent, mode_t mode ) {
    
+   fskit_entry_meta_write_begin( fent );
    fent->mode = mode;
+   fskit_entry_meta_write_end( fent );
    return 0;
 }
 
@@ -78,6 +81,7 @@ int fskit_chmod( struct fskit_core* core, char const* path, uint64_t user, uint6
    }
 
    fskit_entry_set_mode( fent, mode );
+   fskit_entry_invalidate( core, fent );
    fskit_entry_unlock( fent );
 
    return err;
@@ -22,6 +22,7 @@
 #include <fskit/chown.h>
 #include <fskit/path.h>
 #include <fskit/entry.h>
+#include <fskit/cache.h>
 
 #include "fskit_private/private.h"
 
@@ -30,8 +31,10 @@
 // NOTE: fent must be write-locked 
 int fskit_entry_set_owner_and_group( struct fskit_entry* fent, uint64_t new_user, uint64_t new_group ) {
    
+   fskit_entry_meta_write_begin( fent );
    fent->owner = new_user;
    fent->group = new_group;
+   fskit_entry_meta_write_end( fent );
    return 0;
 }
 
@@ -40,7 +43,9 @@ int fskit_entry_set_owner_and_group( struct fskit_entry* fent, uint64_t new_user
 // NOTE: fent must be write-locked
 int fskit_entry_set_owner( struct fskit_entry* fent, uint64_t new_user ) {
    
+   fskit_entry_meta_write_begin( fent );
    fent->owner = new_user;
+   fskit_entry_meta_write_end( fent );
    return 0;
 }
 
@@ -49,7 +54,9 @@ int fskit_entry_set_owner( struct fskit_entry* fent, uint64_t new_user ) {
 // NOTE: fent must be write-locked 
 int fskit_entry_set_group( struct fskit_entry* fent, uint64_t new_group ) {
 
+   fskit_entry_meta_write_begin( fent );
    fent->group = new_group;
+   fskit_entry_meta_write_end( fent );
    return 0;
 }
 
@@ -134,6 +141,7 @@ int fskit_chown( struct fskit_core* core, char const* path, uint64_t user, uint6
 
    // success! propagate
    fskit_entry_set_owner_and_group( fent, new_user, new_group );
+   fskit_entry_invalidate( core, fent );
    fskit_entry_unlock( fent );
    return err;
 }
@@ -38,7 +38,10 @@ static int fskit_file_handle_destroy( struct fskit_file_handle* fh ) {
       fh->path = NULL;
    }
 
+   fskit_file_handle_unpin_routes( fh );
    pthread_rwlock_destroy( &fh->lock );
+   pthread_mutex_destroy( &fh->drain_lock );
+   pthread_cond_destroy( &fh->drain_cond );
 
    memset( fh, 0, sizeof(struct fskit_file_handle) );
 
@@ -52,7 +55,7 @@ static int fskit_file_handle_destroy( struct fskit_file_handle* fh ) {
 // return 0 on success, or if there are no routes
 // return negative on callback failure
 // fent *cannot* be locked, but it must have a positive open count
-int fskit_run_user_close( struct fskit_core* core, char const* path, struct fskit_entry* fent, void* handle_data ) {
+int fskit_run_user_close( struct fskit_core* core, char const* path, struct fskit_entry* fent, void* handle_data, struct fskit_file_handle* fh ) {
 
    // route?
    struct fskit_route_dispatch_args dargs;
@@ -60,7 +63,7 @@ int fskit_run_user_close( struct fskit_core* core, char const* path, struct fski
    int cbrc = 0;
 
    fskit_route_close_args( &dargs, handle_data );
-   rc = fskit_route_call_close( core, path, fent, &dargs, &cbrc );
+   rc = fskit_route_call_pinned( core, fh, FSKIT_ROUTE_MATCH_CLOSE, path, fent, &dargs, &cbrc );
 
    if( rc == -EPERM || rc == -ENOSYS ) {
 
@@ -101,16 +104,35 @@ int fskit_close( struct fskit_core* core, struct fskit_file_handle* fh ) {
       return -EBADF;
    }
 
+   // I/O doesn't lock the handle, so turn away new I/O and wait for in-flight I/O to finish 
+   rc = fskit_file_handle_io_drain( fh );
+   if( rc != 0 ) {
+      fskit_file_handle_unlock( fh );
+      return rc;
+   }
+
    // clean up the handle
-   rc = fskit_run_user_close( core, fh->path, fh->fent, fh->app_data );
+   rc = fskit_run_user_close( core, NULL, fh->fent, fh->app_data, fh );
    if( rc != 0 ) {
       // failed to run user close
-      fskit_error("fskit_run_user_close(%s) rc = %d\n", fh->path, rc );
+      fskit_error("fskit_run_user_close(%" PRIX64 ") rc = %d\n", fh->file_id, rc );
 
+      // still open
+      fskit_file_handle_io_undrain( fh );
       fskit_file_handle_unlock( fh );
       return rc;
    }
    
+   // no longer open by this handle.
+   // unless this was the last reference, there's nothing else to do, and no need to lock the entry
+   if( fskit_entry_unref_nonlast( fh->fent ) ) {
+      
+      fskit_file_handle_unlock( fh );
+      fskit_file_handle_destroy( fh );
+      
+      return 0;
+   }
+   
    rc = fskit_entry_wlock( fh->fent );
    if( rc != 0 ) {
       // shouldn't happen: indicates deadlock
@@ -120,11 +142,11 @@ int fskit_close( struct fskit_core* core, struct fskit_file_handle* fh ) {
    }
 
    // no longer open by this handle
-   fh->fent->open_count--;
+   __atomic_sub_fetch( &fh->fent->open_count, 1, __ATOMIC_ACQ_REL );
 
    // maybe this entry has been fully unref'ed?
    // this may unlock fh->fent and re-lock it, but only if fent is already fully unlinked
-   rc = fskit_entry_try_destroy_and_free( core, fh->path, NULL, fh->fent );
+   rc = fskit_entry_try_destroy_and_free( core, NULL, NULL, fh->fent );
 
    if( rc < 0 ) {
 
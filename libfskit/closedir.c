@@ -68,15 +68,24 @@ int fskit_closedir( struct fskit_core* core, struct fskit_dir_handle* dirh ) {
    }
 
    // run user-given close route.  Note that this may unlock dirh->dent and re-lock it, but only if it is fully unlinked.
-   rc = fskit_run_user_close( core, dirh->path, dirh->dent, dirh->app_data );
+   rc = fskit_run_user_close( core, NULL, dirh->dent, dirh->app_data, NULL );
    if( rc != 0 ) {
 
-      fskit_error("fskit_run_user_close(%s) rc = %d\n", dirh->path, rc );
+      fskit_error("fskit_run_user_close(%" PRIX64 ") rc = %d\n", dirh->file_id, rc );
       
       fskit_dir_handle_unlock( dirh );
       return rc;
    }
 
+   // no longer open.  Only the last reference needs the directory locked.
+   if( fskit_entry_unref_nonlast( dirh->dent ) ) {
+      
+      fskit_dir_handle_unlock( dirh );
+      fskit_dir_handle_destroy( dirh );
+      
+      return 0;
+   }
+
    rc = fskit_entry_wlock( dirh->dent );
    if( rc != 0 ) {
 
@@ -88,11 +97,11 @@ int fskit_closedir( struct fskit_core* core, struct fskit_dir_handle* dirh ) {
    }
    
    // no longer open
-   dirh->dent->open_count--;
+   __atomic_sub_fetch( &dirh->dent->open_count, 1, __ATOMIC_ACQ_REL );
 
    // see if we can destroy this....
    // NOTE: this may unlock and free dirh->dent
-   rc = fskit_entry_try_destroy_and_free( core, dirh->path, NULL, dirh->dent );
+   rc = fskit_entry_try_destroy_and_free( core, NULL, NULL, dirh->dent );
    if( rc > 0 ) {
 
       // dent was unlocked and destroyed
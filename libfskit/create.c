@@ -67,17 +67,477 @@ int fskit_run_user_create( struct fskit_core* core, char const* path, struct fsk
 
 
 
-// do a file create.
+// reserve name in parent for child (see fskit_entry_create_reserved), and reference child while its route runs.
+// parent must be write-locked (or, if sharded, read-locked with name's shard write-locked)
+// return 0 on success
+// return -ENOMEM on OOM, in which case child is freed
+static int fskit_entry_reserve( struct fskit_core* core, struct fskit_entry* parent, char const* name, struct fskit_entry* child ) {
+
+   int rc = 0;
+
+   child->creating = true;
+
+   fskit_entry_wlock( child );
+   rc = fskit_entry_attach_lowlevel( parent, child, name );
+   fskit_entry_unlock( child );
+
+   if( rc != 0 ) {
+
+      fskit_entry_destroy( core, child, true );
+      fskit_safe_free( child );
+      return rc;
+   }
+
+   fskit_entry_ref_entry( child );
+   return 0;
+}
+
+
+// re-lock parent once its reservations' routes have run, and drop the reference that kept it alive while it was unlocked.
+// return true if parent was torn down in the meantime, in which case the caller must instead fskit_entry_unref it once it unlocks it.
+static bool fskit_entry_reserve_relock( struct fskit_entry* parent, struct fskit_dir_shard* shard ) {
+
+   fskit_entry_dir_relock( parent, shard );
+
+   if( parent->deletion_in_progress ) {
+      return true;
+   }
+
+   __atomic_sub_fetch( &parent->open_count, 1, __ATOMIC_ACQ_REL );
+   return false;
+}
+
+
+// finish a reservation, given the result (rc) of its route: publish child, or withdraw it.
+// parent must be locked again (see fskit_entry_reserve_relock)
+// return 0 if the child was published.
+// return rc if it was withdrawn (child is freed)
+// return -ENOENT if parent was torn down before the child could be published (child is destroyed)
+static int fskit_entry_reserve_finish( struct fskit_core* core, char const* path, struct fskit_entry* parent, char const* name, struct fskit_entry* child, int rc ) {
+
+   bool attached = false;
+
+   __atomic_sub_fetch( &child->open_count, 1, __ATOMIC_ACQ_REL );
+
+   if( !parent->deletion_in_progress ) {
+      attached = (fskit_dir_find_by_name( parent, name ) == child);
+   }
+
+   if( rc == 0 && attached ) {
+
+      // publish
+      __atomic_store_n( &child->creating, false, __ATOMIC_RELEASE );
+
+      fskit_dir_versions_insert( parent, name, child );
+      fskit_entry_children_changed( parent );
+      fskit_entry_dir_touch( parent );
+
+      return 0;
+   }
+
+   if( attached ) {
+
+      // withdraw
+      fskit_entry_detach_lowlevel( parent, name );
+   }
+
+   if( rc == 0 ) {
+
+      // lost the name along with parent, so undo the route's work
+      fskit_entry_wlock( child );
+
+      rc = fskit_entry_try_destroy_and_free( core, path, NULL, child );
+      if( rc <= 0 ) {
+
+         // still referenced elsewhere
+         fskit_entry_unlock( child );
+      }
+
+      return -ENOENT;
+   }
+
+   // route failed
+   fskit_error("create route (%s) rc = %d\n", path, rc );
+
+   fskit_entry_destroy( core, child, true );
+   fskit_safe_free( child );
+
+   return rc;
+}
+
+
+// Two-phase create.
+// Reserve name in parent for child (initialized, but without an inode number yet): the name is taken, but lookups, listings,
+// and other creates don't see it.  Then release parent, number the child and run route on it while other threads create
+// other names in parent, and re-lock parent to publish the child, or to withdraw it if the route failed.
+// parent must be write-locked (or, if sharded, read-locked with name's shard write-locked), and will be re-locked the same way on return.
+// parent is referenced while it is unlocked.  If *parent_pinned is true on return, parent was torn down in the meantime and
+// the caller must fskit_entry_unref it once it unlocks it; otherwise, the reference has been dropped.
+// return 0 if the child was published.
+// return the route's error, or -EIO if no inode number could be allocated, if it was withdrawn (child is freed)
+// return -ENOENT if parent was torn down before the child could be published (child is destroyed)
+// return -ENOMEM on OOM
+int fskit_entry_create_reserved( struct fskit_core* core, char const* path, struct fskit_entry* parent, struct fskit_dir_shard* shard, char const* name, struct fskit_entry* child, fskit_reserved_route_t route, void* route_cls, bool* parent_pinned ) {
+
+   int rc = 0;
+   uint64_t file_id = 0;
+
+   *parent_pinned = false;
+
+   rc = fskit_entry_reserve( core, parent, name, child );
+   if( rc != 0 ) {
+      return rc;
+   }
+
+   // the reservation keeps rmdir and rename-over out of parent, and the references keep a recursive detach from freeing either entry
+   fskit_entry_ref_entry( parent );
+   fskit_entry_dir_unlock( parent, shard );
+
+   // get an inode for this entry
+   file_id = fskit_core_inode_alloc( core, parent, child );
+   if( file_id == 0 ) {
+
+      fskit_error("fskit_core_inode_alloc(%s) failed\n", path );
+      rc = -EIO;
+   }
+   else {
+
+      fskit_entry_wlock( child );
+      fskit_entry_set_file_id( child, file_id );
+      fskit_entry_unlock( child );
+
+      rc = (*route)( core, path, parent, child, route_cls );
+   }
+
+   *parent_pinned = fskit_entry_reserve_relock( parent, shard );
+
+   return fskit_entry_reserve_finish( core, path, parent, name, child, rc );
+}
+
+
+// make sure name is free in parent, garbage-collecting a deleted entry that still holds it.
 // parent must be write-locked
+// return 0 if the name is free
+// return -EEXIST if it is taken
+// return -EAGAIN if another create has it reserved
+// return -EIO on error
+static int fskit_entry_claim_name( struct fskit_core* core, char const* path, struct fskit_entry* parent, char const* name ) {
+
+   int rc = 0;
+   struct fskit_entry* child = fskit_dir_find_by_name( parent, name );
+
+   if( child == NULL ) {
+      return 0;
+   }
+
+   if( child->creating ) {
+      return -EAGAIN;
+   }
+
+   fskit_entry_wlock( child );
+
+   // it might have been marked for garbage-collection
+   rc = fskit_entry_try_garbage_collect( core, path, parent, child );
+   if( rc >= 0 ) {
+
+      if( rc == 0 ) {
+
+         // detached but not destroyed
+         fskit_entry_unlock( child );
+      }
+
+      return 0;
+   }
+
+   fskit_entry_unlock( child );
+
+   if( rc == -EEXIST ) {
+      return -EEXIST;
+   }
+
+   // shouldn't happen
+   fskit_error("BUG: fskit_entry_try_garbage_collect(%s) rc = %d\n", path, rc );
+   return -EIO;
+}
+
+
+// create a batch of children of one type in the directory at dir_path, resolving and locking it only once.
+// Every name is reserved under one write-lock, inode numbers are allocated in one go, and the directory is
+// unlocked while the batch is routed--through the vectored create_many route if one matches dir_path,
+// or else through route for each child on its own (given the child's spec as its cls).
+// Each child is then published or withdrawn under one more write-lock.
+// If rcs is not NULL, rcs[i] is set to the result for specs[i]:
+//   0 on success, -EEXIST if the name is taken, -EAGAIN if another thread is creating it (or it is repeated in the batch),
+//   -EINVAL if it is not a single path component, -ENAMETOOLONG if it is too long, or the route's error.
+// return the number of children created on success
+// return -ENOTDIR, -EACCES, or a path resolution error if the directory can't be created in
+// return -ENOMEM on OOM
+int fskit_entry_create_many( struct fskit_core* core, char const* dir_path, uint64_t user, uint64_t group, struct fskit_create_spec const* specs, size_t num_specs, int* rcs, int type, fskit_reserved_route_t route ) {
+
+   int rc = 0;
+   int cbrc = 0;
+   int num_created = 0;
+   size_t num_batch = 0;
+   bool parent_pinned = false;
+   struct fskit_entry* parent = NULL;
+   struct fskit_route_dispatch_args dargs;
+
+   char* path = strdup( dir_path );
+   int* results = (rcs != NULL ? rcs : CALLOC_LIST( int, num_specs + 1 ));
+   struct fskit_entry** children = CALLOC_LIST( struct fskit_entry*, num_specs + 1 );
+   char** paths = CALLOC_LIST( char*, num_specs + 1 );
+   uint64_t* file_ids = CALLOC_LIST( uint64_t, num_specs + 1 );
+   size_t* batch_idx = CALLOC_LIST( size_t, num_specs + 1 );
+   char const** batch_names = CALLOC_LIST( char const*, num_specs + 1 );
+   struct fskit_entry** batch_fents = CALLOC_LIST( struct fskit_entry*, num_specs + 1 );
+   void** batch_inode_data = CALLOC_LIST( void*, num_specs + 1 );
+
+   if( path == NULL || results == NULL || children == NULL || paths == NULL || file_ids == NULL || batch_idx == NULL || batch_names == NULL || batch_fents == NULL || batch_inode_data == NULL ) {
+
+      rc = -ENOMEM;
+      goto fskit_entry_create_many_out;
+   }
+
+   fskit_sanitize_path( path );
+
+   parent = fskit_entry_resolve_path( core, path, user, group, true, &rc );
+   if( parent == NULL ) {
+      goto fskit_entry_create_many_out;
+   }
+
+   if( parent->type != FSKIT_ENTRY_TYPE_DIR ) {
+      rc = -ENOTDIR;
+   }
+   else if( !FSKIT_ENTRY_IS_WRITEABLE( parent->mode, parent->owner, parent->group, user, group ) ) {
+      rc = -EACCES;
+   }
+
+   if( rc != 0 ) {
+
+      fskit_entry_unlock( parent );
+      goto fskit_entry_create_many_out;
+   }
+
+   // reserve every name we can
+   for( size_t i = 0; i < num_specs; i++ ) {
+
+      char const* name = specs[i].name;
+
+      if( name == NULL || name[0] == '\0' || strchr( name, '/' ) != NULL || strcmp( name, "." ) == 0 || strcmp( name, ".." ) == 0 ) {
+         results[i] = -EINVAL;
+         continue;
+      }
+
+      if( strlen( name ) > FSKIT_FILESYSTEM_NAMEMAX ) {
+         results[i] = -ENAMETOOLONG;
+         continue;
+      }
+
+      paths[i] = fskit_fullpath( path, name, NULL );
+      if( paths[i] == NULL ) {
+         results[i] = -ENOMEM;
+         continue;
+      }
+
+      results[i] = fskit_entry_claim_name( core, paths[i], parent, name );
+      if( results[i] != 0 ) {
+         continue;
+      }
+
+      struct fskit_entry* child = CALLOC_LIST( struct fskit_entry, 1 );
+      if( child == NULL ) {
+         results[i] = -ENOMEM;
+         continue;
+      }
+
+      if( type == FSKIT_ENTRY_TYPE_DIR ) {
+         results[i] = fskit_entry_init_dir( child, parent, 0, user, group, specs[i].mode );
+      }
+      else {
+         results[i] = fskit_entry_init_file( child, 0, user, group, specs[i].mode );
+      }
+
+      if( results[i] != 0 ) {
+
+         fskit_error("fskit_entry_init(%s) rc = %d\n", paths[i], results[i] );
+         fskit_entry_destroy( core, child, false );
+         fskit_safe_free( child );
+         continue;
+      }
+
+      results[i] = fskit_entry_reserve( core, parent, name, child );
+      if( results[i] == 0 ) {
+         children[i] = child;
+      }
+   }
+
+   // a name repeated in the batch is taken by its first occurrence
+   for( size_t i = 0; i < num_specs; i++ ) {
+
+      if( results[i] != -EAGAIN ) {
+         continue;
+      }
+
+      for( size_t j = 0; j < i; j++ ) {
+
+         if( children[j] != NULL && strcmp( specs[j].name, specs[i].name ) == 0 ) {
+            results[i] = -EEXIST;
+            break;
+         }
+      }
+   }
+
+   // see fskit_entry_create_reserved
+   fskit_entry_ref_entry( parent );
+   fskit_entry_unlock( parent );
+
+   // number the batch all at once
+   rc = fskit_core_inode_alloc_many( core, parent, children, file_ids, num_specs );
+
+   for( size_t i = 0; i < num_specs; i++ ) {
+
+      if( children[i] == NULL ) {
+         continue;
+      }
+
+      if( rc != 0 || file_ids[i] == 0 ) {
+
+         fskit_error("fskit_core_inode_alloc(%s) failed\n", paths[i] );
+         results[i] = -EIO;
+         continue;
+      }
+
+      fskit_entry_wlock( children[i] );
+      fskit_entry_set_file_id( children[i], file_ids[i] );
+      fskit_entry_unlock( children[i] );
+
+      batch_idx[ num_batch ] = i;
+      batch_names[ num_batch ] = specs[i].name;
+      batch_fents[ num_batch ] = children[i];
+      num_batch++;
+   }
+
+   rc = 0;
+
+   if( num_batch > 0 ) {
+
+      // route the batch in one call, if we can
+      fskit_route_create_many_args( &dargs, batch_names, batch_fents, num_batch, batch_inode_data, NULL );
+
+      rc = fskit_route_call_create_many( core, path, parent, &dargs, &cbrc );
+
+      for( size_t j = 0; j < num_batch; j++ ) {
+
+         size_t i = batch_idx[j];
+
+         if( rc == -EPERM || rc == -ENOSYS ) {
+
+            // no vectored route
+            results[i] = (*route)( core, paths[i], parent, children[i], (void*)&specs[i] );
+         }
+         else if( cbrc != 0 ) {
+
+            // the whole batch failed
+            results[i] = cbrc;
+         }
+         else {
+
+            fskit_entry_set_user_data( children[i], batch_inode_data[j] );
+         }
+      }
+
+      rc = 0;
+   }
+
+   // publish or withdraw each reservation
+   parent_pinned = fskit_entry_reserve_relock( parent, NULL );
+
+   for( size_t i = 0; i < num_specs; i++ ) {
+
+      if( children[i] == NULL ) {
+         continue;
+      }
+
+      results[i] = fskit_entry_reserve_finish( core, paths[i], parent, specs[i].name, children[i], results[i] );
+      if( results[i] == 0 ) {
+         num_created++;
+      }
+   }
+
+   fskit_entry_unlock( parent );
+
+   if( parent_pinned ) {
+      fskit_entry_unref( core, path, parent );
+   }
+
+fskit_entry_create_many_out:
+
+   if( paths != NULL ) {
+      for( size_t i = 0; i < num_specs; i++ ) {
+         fskit_safe_free( paths[i] );
+      }
+   }
+
+   if( results != rcs ) {
+      fskit_safe_free( results );
+   }
+
+   fskit_safe_free( path );
+   fskit_safe_free( children );
+   fskit_safe_free( paths );
+   fskit_safe_free( file_ids );
+   fskit_safe_free( batch_idx );
+   fskit_safe_free( batch_names );
+   fskit_safe_free( batch_fents );
+   fskit_safe_free( batch_inode_data );
+
+   if( rc != 0 ) {
+      return rc;
+   }
+
+   return num_created;
+}
+
+
+// create-route adapter for fskit_entry_create_reserved
+struct fskit_create_route_args {
+
+   mode_t mode;
+   void* cls;
+   void** handle_data;
+};
+
+static int fskit_create_route( struct fskit_core* core, char const* path, struct fskit_entry* parent, struct fskit_entry* child, void* route_cls ) {
+
+   struct fskit_create_route_args* args = (struct fskit_create_route_args*)route_cls;
+   void* inode_data = NULL;
+   int rc = 0;
+
+   rc = fskit_run_user_create( core, path, parent, child, args->mode, args->cls, &inode_data, args->handle_data );
+   if( rc != 0 ) {
+      return rc;
+   }
+
+   // insert app data
+   fskit_entry_set_user_data( child, inode_data );
+   return 0;
+}
+
+
+// do a file create.
+// parent must be write-locked (or, if sharded, read-locked with the child's shard write-locked), but it will be unlocked
+// while the create route runs, and re-locked (see fskit_entry_create_reserved, including for *parent_pinned).
 // on success, fill in *ret_child with a newly-created child (which will NOT be locked), and *handle_data with the file handle's app-specific data (generated from the user route)
 // also, the child will have been inserted into the parent's children list
 // NOTE: the child will have an open count of 1
-int fskit_do_create( struct fskit_core* core, struct fskit_entry* parent, char const* path, mode_t mode, uint64_t user, uint64_t group, void* cls, struct fskit_entry** ret_child, void** handle_data ) {
+int fskit_do_create( struct fskit_core* core, struct fskit_entry* parent, struct fskit_dir_shard* shard, char const* path, mode_t mode, uint64_t user, uint64_t group, void* cls, struct fskit_entry** ret_child, void** handle_data, bool* parent_pinned ) {
 
    char path_basename[FSKIT_FILESYSTEM_NAMEMAX + 1];
-   void* inode_data = NULL;
+   struct fskit_create_route_args args;
    int rc = 0;
 
+   *parent_pinned = false;
+
    memset( path_basename, 0, FSKIT_FILESYSTEM_NAMEMAX + 1 );
 
    fskit_basename( path, path_basename );
@@ -99,54 +559,60 @@ int fskit_do_create( struct fskit_core* core, struct fskit_entry* parent, char c
 
       return rc;
    }
-   else {
 
-      // get an inode for this file
-      uint64_t child_inode = fskit_core_inode_alloc( core, parent, child );
-      if( child_inode == 0 ) {
-         // error in allocating
-         fskit_error("fskit_core_inode_alloc(%s) failed\n", path );
+   args.mode = mode;
+   args.cls = cls;
+   args.handle_data = handle_data;
 
-         fskit_entry_destroy( core, child, false );
-         fskit_safe_free( child );
+   rc = fskit_entry_create_reserved( core, path, parent, shard, path_basename, child, fskit_create_route, &args, parent_pinned );
+   if( rc != 0 ) {
+      return rc;
+   }
 
-         return -EIO;
-      }
+   // reference the child for the caller.
+   // it can't be unlinked in the meantime, since parent is locked again.
+   fskit_entry_ref_entry( child );
 
-      // set the inode
-      child->file_id = child_inode;
-      
-      // reference the child...
-      child->open_count++;
+   *ret_child = child;
 
-      // Generate any app data we need to
-      rc = fskit_run_user_create( core, path, parent, child, mode, cls, &inode_data, handle_data );
-      
-      if( rc != 0 ) {
+   return 0;
+}
 
-         // callback error
-         fskit_error("fskit_run_user_create(%s) rc = %d\n", path, rc );
 
-         fskit_entry_destroy( core, child, false );
-         fskit_safe_free( child );
+// per-child route for fskit_create_many: create, then close, as fskit_create and fskit_close would
+static int fskit_create_many_route( struct fskit_core* core, char const* path, struct fskit_entry* parent, struct fskit_entry* child, void* route_cls ) {
 
-         return rc;
-      }
+   struct fskit_create_spec const* spec = (struct fskit_create_spec const*)route_cls;
+   void* inode_data = NULL;
+   void* handle_data = NULL;
+   int rc = 0;
 
-      // insert app data
-      fskit_entry_set_user_data( child, inode_data );
+   rc = fskit_run_user_create( core, path, parent, child, spec->mode, NULL, &inode_data, &handle_data );
+   if( rc != 0 ) {
+      return rc;
+   }
 
-      // insert it into the filesystem
-      fskit_entry_wlock( child );
-      
-      fskit_entry_attach_lowlevel( parent, child, path_basename );
+   fskit_entry_set_user_data( child, inode_data );
 
-      fskit_entry_unlock( child );
+   // no handle gets opened, so let the app release its handle data
+   rc = fskit_run_user_close( core, path, child, handle_data, NULL );
+   if( rc != 0 ) {
+      fskit_error("fskit_run_user_close(%s) rc = %d\n", path, rc );
+   }
 
-      *ret_child = child;
+   return 0;
+}
 
-      return 0;
-   }
+
+// create many files in one directory, as if by fskit_create and fskit_close on each, but resolving and locking the directory once.
+// If a create_many route matches dir_path, it is called once for the whole batch; otherwise, each file's create route is called.
+// If rcs is not NULL, rcs[i] is set to the result for specs[i] (see fskit_entry_create_many).
+// return the number of files created on success
+// return -ENOTDIR, -EACCES, or a path resolution error if the directory can't be created in
+// return -ENOMEM on OOM
+int fskit_create_many( struct fskit_core* core, char const* dir_path, uint64_t user, uint64_t group, struct fskit_create_spec const* specs, size_t num_specs, int* rcs ) {
+
+   return fskit_entry_create_many( core, dir_path, user, group, specs, num_specs, rcs, FSKIT_ENTRY_TYPE_FILE, fskit_create_many_route );
 }
 
 
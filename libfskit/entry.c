@@ -31,6 +31,7 @@
 
 struct fskit_entry_set_entry {
    
+   uint64_t cookie;     // fskit_entry_name_cookie( name ); the primary sort key
    char* name;
    struct fskit_entry* dirent;
    
@@ -42,12 +43,24 @@ struct fskit_entry_set_entry {
 // linked list entry for destroying an entry and all of its children
 struct fskit_detach_entry {
    
-   char* path;
+   char* path;                  // NULL if nothing will need it (see fskit_detach_queue_child)
    struct fskit_entry* ent;
    
    struct fskit_detach_entry* next;
 };
 
+// entries that fskit_detach_all_ex has claimed for destruction, whose destroy routes will be called in one go
+#define FSKIT_DETACH_BATCH_MAX 1024
+
+struct fskit_detach_batch {
+
+   size_t len;
+   char* paths[ FSKIT_DETACH_BATCH_MAX ];
+   uint64_t file_ids[ FSKIT_DETACH_BATCH_MAX ];
+   void* inode_data[ FSKIT_DETACH_BATCH_MAX ];
+   struct fskit_entry* fents[ FSKIT_DETACH_BATCH_MAX ];
+};
+
 struct fskit_detach_ctx {
    
    struct fskit_detach_entry* head;
@@ -56,6 +69,9 @@ struct fskit_detach_ctx {
 
    int flags;
    int cbrc;
+
+   bool need_paths;                     // are there destroy routes that will need the paths of the entries removed?
+   struct fskit_detach_batch* batch;    // allocated on first use
 };
 
 struct fskit_inode_metadata {
@@ -68,6 +84,7 @@ struct fskit_inode_metadata {
 
 // prototypes...
 int fskit_run_user_destroy( struct fskit_core* core, char const* path, struct fskit_entry* parent, struct fskit_entry* fent );
+static int fskit_run_user_destroy_many( struct fskit_core* core, char const* dir_path, char const** paths, uint64_t const* file_ids, void** inode_data, size_t num_entries, int* cbrc );
 
 SGLIB_DEFINE_RBTREE_FUNCTIONS( fskit_entry_set, left, right, color, FSKIT_ENTRY_SET_ENTRY_CMP );
 
@@ -85,6 +102,74 @@ fskit_entry_set* fskit_entry_set_next( fskit_entry_set_itr* itr ) {
    return sglib_fskit_entry_set_it_next( itr );
 }
 
+// start iterating over a set of directory entries from the first one whose cookie is greater than the given cookie,
+// i.e. resume a listing that last returned the entry with that cookie.
+// runs in O(log n): the iterator's stack is built from the ancestors we descend left from, as an in-order traversal would have left it.
+// return the first such entry, or NULL if there are none
+fskit_entry_set* fskit_entry_set_seek( fskit_entry_set_itr* itr, fskit_entry_set* dirents, uint64_t cookie ) {
+   
+   memset( itr, 0, sizeof(fskit_entry_set_itr) );
+   itr->order = 1;      // in-order
+   
+   for( fskit_entry_set* t = dirents; t != NULL; ) {
+      
+      if( t->cookie > cookie ) {
+         
+         // t comes after the cookie, but so might some of its left subtree.
+         // mark t as "left subtree done", so it is returned once that subtree is exhausted.
+         if( itr->pathi >= SGLIB_MAX_TREE_DEEP ) {
+            
+            // can't happen for a red-black tree of addressable size
+            fskit_error("BUG: tree deeper than %d\n", SGLIB_MAX_TREE_DEEP );
+            break;
+         }
+         
+         itr->path[ itr->pathi ] = t;
+         itr->pass[ itr->pathi ] = 1;
+         itr->pathi++;
+         
+         t = t->left;
+      }
+      else {
+         
+         // t and its left subtree have been read 
+         t = t->right;
+      }
+   }
+   
+   if( itr->pathi > 0 ) {
+      itr->currentelem = itr->path[ itr->pathi - 1 ];
+   }
+   
+   return itr->currentelem;
+}
+
+// get a directory entry name's cookie: its 63-bit position in the directory stream.
+// "." and ".." always come first; other names are ordered by hash, so a position can be resumed from in O(log n)
+// without the cursor having to hold on to a name.  Two names with the same cookie are ordered by name.
+uint64_t fskit_entry_name_cookie( char const* name ) {
+   
+   if( strcmp( name, "." ) == 0 ) {
+      return FSKIT_DIR_COOKIE_START + 1;
+   }
+   
+   if( strcmp( name, ".." ) == 0 ) {
+      return FSKIT_DIR_COOKIE_START + 2;
+   }
+   
+   // 64-bit FNV-1a
+   uint64_t hash = 14695981039346656037ULL;
+   
+   for( char const* c = name; *c != '\0'; c++ ) {
+      
+      hash ^= (unsigned char)(*c);
+      hash *= 1099511628211ULL;
+   }
+   
+   // fold into the positions between .. and EOF
+   return FSKIT_DIR_COOKIE_FIRST + (hash % (FSKIT_DIR_COOKIE_EOF - FSKIT_DIR_COOKIE_FIRST));
+}
+
 // free up all entries in an fskit_entry_set, as well as the entry set itself.
 // don't free the contained entries
 int fskit_entry_set_free( fskit_entry_set* dirents ) {
@@ -128,6 +213,7 @@ fskit_entry_set* fskit_entry_set_new( struct fskit_entry* node, struct fskit_ent
        return NULL;
    }
    
+   ret->cookie = fskit_entry_name_cookie( name_dup );
    ret->name = name_dup;
    ret->dirent = node;
    
@@ -162,6 +248,7 @@ int fskit_entry_set_insert( fskit_entry_set** set, char const* name, struct fski
       return -ENOMEM;
    }
    
+   new_entry->cookie = fskit_entry_name_cookie( name_dup );
    new_entry->name = name_dup;
    new_entry->dirent = child;
    
@@ -179,6 +266,7 @@ fskit_entry_set* fskit_entry_set_find_itr( fskit_entry_set* set, char const* nam
    fskit_entry_set lookup;
    
    memset( &lookup, 0, sizeof( fskit_entry_set ) );
+   lookup.cookie = fskit_entry_name_cookie( name );
    lookup.name = (char*)name;
    
    return sglib_fskit_entry_set_find_member( set, &lookup );
@@ -217,6 +305,7 @@ bool fskit_entry_set_remove( fskit_entry_set** set, char const* name ) {
    }
    
    memset( &lookup, 0, sizeof( fskit_entry_set ) );
+   lookup.cookie = fskit_entry_name_cookie( name );
    lookup.name = (char*)name;
    
    sglib_fskit_entry_set_delete_if_member( set, &lookup, &member );
@@ -242,6 +331,7 @@ bool fskit_entry_set_replace( fskit_entry_set* set, char const* name, struct fsk
    fskit_entry_set lookup;
    
    memset( &lookup, 0, sizeof( fskit_entry_set ) );
+   lookup.cookie = fskit_entry_name_cookie( name );
    lookup.name = (char*)name;
    
    member = sglib_fskit_entry_set_find_member( set, &lookup );
@@ -275,6 +365,17 @@ struct fskit_entry* fskit_entry_set_child_at( fskit_entry_set* dp ) {
    }
 }
 
+// get the child's cookie (or FSKIT_DIR_COOKIE_EOF if it's off the end of the set)
+uint64_t fskit_entry_set_cookie_at( fskit_entry_set* dp ) {
+
+   if( dp == NULL ) {
+      return FSKIT_DIR_COOKIE_EOF;
+   }
+   else {
+      return dp->cookie;
+   }
+}
+
 // get the child's name (or NULL if it's off the end of the set)
 char const* fskit_entry_set_name_at( fskit_entry_set* dp ) {
 
@@ -288,11 +389,15 @@ char const* fskit_entry_set_name_at( fskit_entry_set* dp ) {
 
 
 // find a child by name.
-// dir must be at least read-locked
 // return NULL if not found, or if not a directory
-// NOTE: dir must be write-locked
+// NOTE: dir must be write-locked, or (if it is sharded) read-locked with name's shard locked
 struct fskit_entry* fskit_dir_find_by_name( struct fskit_entry* dir, char const* name ) {
 
+   struct fskit_dir_shard* shard = fskit_entry_dir_shard( dir, name );
+   if( shard != NULL ) {
+      return fskit_entry_set_find_name( shard->children, name );
+   }
+
    if( dir->children == NULL ) {
       return NULL;
    }
@@ -305,39 +410,74 @@ struct fskit_entry* fskit_dir_find_by_name( struct fskit_entry* dir, char const*
 // both fskit_entry structures must be write-locked
 // return 0 on success 
 // return -ENOMEM on OOM
-// NOTE: parent must be write-locked, as well as fent
-int fskit_entry_attach_lowlevel( struct fskit_entry* parent, struct fskit_entry* fent, char const* name ) {
+// NOTE: parent must be write-locked (or, if sharded, read-locked with name's shard write-locked), as well as fent
+// unless moving is set (i.e. fent is being renamed from another directory), fent gets a new link recorded under name.
+static int fskit_entry_attach_lowlevel_ex( struct fskit_entry* parent, struct fskit_entry* fent, char const* name, bool moving ) {
 
    if( parent != fent ) {
-      fent->link_count++;
+      __atomic_add_fetch( &fent->link_count, 1, __ATOMIC_ACQ_REL );
+      fskit_route_cache_stale( fent );
    }
    
-   parent->num_children++;
+   __atomic_add_fetch( &parent->num_children, 1, __ATOMIC_RELAXED );
 
-   struct timespec ts;
-   clock_gettime( CLOCK_REALTIME, &ts );
-   parent->mtime_sec = ts.tv_sec;
-   parent->mtime_nsec = ts.tv_nsec;
+   // a reserved entry (see fskit_entry_create_reserved) changes the directory only once it is published
+   if( !fent->creating ) {
+      fskit_entry_dir_touch( parent );
+   }
    
    // if this is a directory, then set .. to point to the parent 
    if( fent->type == FSKIT_ENTRY_TYPE_DIR ) {
        
        fskit_entry_set_replace( fent->children, "..", parent );
+       fskit_entry_children_changed( fent );
+       fskit_dir_versions_insert( fent, "..", parent );
    }
+   
+   // inherit routes bound to the parent's subtree
+   fskit_route_scope_attach( parent, fent );
 
-   return fskit_entry_set_insert( &parent->children, name, fent );
+   int rc = fskit_entry_dir_insert( parent, name, fent );
+   if( rc == 0 && !fent->creating ) {
+      fskit_dir_versions_insert( parent, name, fent );
+      fskit_entry_children_changed( parent );
+   }
+
+   // a moved entry gets its new name from the caller
+   if( rc == 0 && parent != fent && !moving ) {
+      fskit_entry_name_set( fent, NULL, NULL, parent, strdup_or_null( name ) );
+   }
+
+   return rc;
+}
+
+
+// attach an entry as a child directly
+// both fskit_entry structures must be write-locked
+// return 0 on success 
+// return -ENOMEM on OOM
+// NOTE: parent must be write-locked (or, if sharded, read-locked with name's shard write-locked), as well as fent
+int fskit_entry_attach_lowlevel( struct fskit_entry* parent, struct fskit_entry* fent, char const* name ) {
+   return fskit_entry_attach_lowlevel_ex( parent, fent, name, false );
+}
+
+// attach an entry detached from another directory with fskit_entry_detach_lowlevel_move (see fskit_rename).
+// the caller moves its name over with fskit_entry_name_set.
+int fskit_entry_attach_lowlevel_move( struct fskit_entry* parent, struct fskit_entry* fent, char const* name ) {
+   return fskit_entry_attach_lowlevel_ex( parent, fent, name, true );
 }
 
 
 // detach an entry from a parent.
 // both entries must be write-locked.
 // child's link count will be decremented
-// parent must be write-locked
+// parent must be write-locked (or, if sharded, read-locked with child_name's shard write-locked)
 // child must be write-locked, or otherwise inaccessible
 // the child will not be destroyed even if its link count reaches zero; the caller must take care of that.
-static int fskit_entry_detach_lowlevel_ex( struct fskit_entry* parent, char const* child_name, bool update_mtime ) {
+// unless moving is set (i.e. the child is being renamed into another directory), a directory must be empty.
+static int fskit_entry_detach_lowlevel_ex( struct fskit_entry* parent, char const* child_name, bool update_mtime, bool moving ) {
 
-   struct fskit_entry* child = fskit_entry_set_find_name( parent->children, child_name );
+   struct fskit_entry* child = fskit_dir_find_by_name( parent, child_name );
    if( child == NULL ) {
       
       fskit_error("fskit_entry_set_find_name(%p, '%s') == NULL\n", parent, child_name );
@@ -350,34 +490,44 @@ static int fskit_entry_detach_lowlevel_ex( struct fskit_entry* parent, char cons
    }
    
    // if the child is a directory, and it's not empty, then don't proceed
-   if( child->type == FSKIT_ENTRY_TYPE_DIR && fskit_entry_get_num_children( child ) > 2 ) {
+   if( !moving && child->type == FSKIT_ENTRY_TYPE_DIR && fskit_entry_get_num_children( child ) > 2 ) {
       // not empty
       return -ENOTEMPTY;
    }
 
    // unlink
-   bool rc = fskit_entry_set_remove( &parent->children, child_name );
+   bool rc = fskit_entry_dir_remove( parent, child_name );
    if( !rc ) {
       
       fskit_error("fskit_entry_set_remove(%" PRIX64 ", '%s') rc = false\n", parent->file_id, child_name );
       return -ENOENT;
    }
    
-   struct timespec ts;
-   clock_gettime( CLOCK_REALTIME, &ts );
-   parent->mtime_sec = ts.tv_sec;
-   parent->mtime_nsec = ts.tv_nsec;
-   parent->num_children--;
+   // withdrawing a reservation leaves no trace
+   if( !child->creating ) {
+      
+      fskit_entry_children_changed( parent );
+      fskit_dir_versions_remove( parent, child_name );
+   
+      fskit_entry_dir_touch( parent );
+   }
+   
+   __atomic_sub_fetch( &parent->num_children, 1, __ATOMIC_RELAXED );
 
    if( parent != child ) {
       
-      child->link_count--;
-
+      // a moved entry gets its new name from the caller
+      if( !moving ) {
+         fskit_entry_name_clear( child, parent, child_name, NULL );
+      }
+      
       // should *never* happen
-      if( child->link_count < 0 ) {
+      if( __atomic_sub_fetch( &child->link_count, 1, __ATOMIC_ACQ_REL ) < 0 ) {
          fskit_error("BUG: negative link count on %" PRIX64 " ('%s')\n", child->file_id, child_name );
-         child->link_count = 0;
+         __atomic_store_n( &child->link_count, 0, __ATOMIC_RELEASE );
       }
+      
+      fskit_route_cache_stale( child );
    }
 
    return 0;
@@ -390,7 +540,13 @@ static int fskit_entry_detach_lowlevel_ex( struct fskit_entry* parent, char cons
 // parent must be write-locked, so it won't matter if the child is not.
 // the child will not be destroyed even if its link count reaches zero; the caller must take care of that.
 int fskit_entry_detach_lowlevel( struct fskit_entry* parent, char const* child_name ) {
-   return fskit_entry_detach_lowlevel_ex( parent, child_name, true );
+   return fskit_entry_detach_lowlevel_ex( parent, child_name, true, false );
+}
+
+// detach an entry from a parent, in order to attach it to another one (see fskit_rename).
+// like fskit_entry_detach_lowlevel, but a directory need not be empty.
+int fskit_entry_detach_lowlevel_move( struct fskit_entry* parent, char const* child_name ) {
+   return fskit_entry_detach_lowlevel_ex( parent, child_name, true, true );
 }
 
 // default inode allocator: pick a random 64-bit number
@@ -438,6 +594,17 @@ int fskit_core_init( struct fskit_core* core, void* app_fs_data ) {
       return rc;
    }
 
+   // every other directory's scope inherits the core from its parent's
+   core->root.scope->core = core;
+
+   // the root is named by its path (see fskit_entry_get_path)
+   core->root.name = strdup_or_null( "/" );
+   if( core->root.name == NULL ) {
+
+      fskit_safe_free( routes );
+      return -ENOMEM;
+   }
+
    core->root.link_count = 1;
    core->app_fs_data = app_fs_data;
 
@@ -449,6 +616,16 @@ int fskit_core_init( struct fskit_core* core, void* app_fs_data ) {
    pthread_rwlock_init( &core->lock, NULL );
    pthread_rwlock_init( &core->route_lock, NULL );
 
+   for( int i = 0; i < FSKIT_CORE_NUM_CACHE_LOCKS; i++ ) {
+      pthread_mutex_init( &core->cache_locks[i], NULL );
+   }
+
+   pthread_mutex_init( &core->rename_lock, NULL );
+   pthread_mutex_init( &core->scope_lock, NULL );
+
+   core->scope_num_bound = 0;
+   core->scope_retired = NULL;
+
    return 0;
 }
 
@@ -475,6 +652,7 @@ int fskit_core_destroy( struct fskit_core* core, void** app_fs_data ) {
    fskit_entry_destroy( core, &core->root, true );
 
    fskit_route_table_free( core->routes );
+   fskit_route_scope_free_retired( core );
    
    fs_data = core->app_fs_data;
    core->app_fs_data = NULL;
@@ -482,6 +660,13 @@ int fskit_core_destroy( struct fskit_core* core, void** app_fs_data ) {
    pthread_rwlock_destroy( &core->lock );
    pthread_rwlock_destroy( &core->route_lock );
 
+   for( int i = 0; i < FSKIT_CORE_NUM_CACHE_LOCKS; i++ ) {
+      pthread_mutex_destroy( &core->cache_locks[i] );
+   }
+
+   pthread_mutex_destroy( &core->rename_lock );
+   pthread_mutex_destroy( &core->scope_lock );
+
    if( app_fs_data != NULL ) {
       *app_fs_data = fs_data;
    }
@@ -492,20 +677,24 @@ int fskit_core_destroy( struct fskit_core* core, void** app_fs_data ) {
 }
 
 
-// queue a child for detach.  It must have been detached from a parent already (in fskit_detach_all_ex), but it may have children of its own.
+// queue a child for detach.  It must have been detached from a parent (dir) already (in fskit_detach_all_ex), but it may have children of its own.
+// its path is only built if something will need it: its own children's paths, a destroy route, or its last close (if it is still open).
 // NOTE: the child is not guaranteed to be locked
 // return 0 on success
 // return -ENOMEM on OOM
 // return -EPERM if the child is not fully unlinked
-int fskit_detach_queue_child( struct fskit_detach_ctx* ctx, char const* dir_path, char const* name, struct fskit_entry* child ) {
+int fskit_detach_queue_child( struct fskit_detach_ctx* ctx, struct fskit_entry* dir, char const* dir_path, char const* name, struct fskit_entry* child ) {
 
    struct fskit_detach_entry* next = NULL;
    char* child_path = NULL;
    
-   child_path = fskit_fullpath( dir_path, name, NULL );
-   if( child_path == NULL ) {
+   if( dir_path != NULL && (ctx->need_paths || child->type == FSKIT_ENTRY_TYPE_DIR || fskit_entry_get_open_count( child ) > 0) ) {
+      
+      child_path = fskit_fullpath( dir_path, name, NULL );
+      if( child_path == NULL ) {
 
-      return -ENOMEM;
+         return -ENOMEM;
+      }
    }
    
    next = CALLOC_LIST( struct fskit_detach_entry, 1 );
@@ -515,6 +704,8 @@ int fskit_detach_queue_child( struct fskit_detach_ctx* ctx, char const* dir_path
       return -ENOMEM;
    }
    
+   fskit_entry_name_clear( child, dir, name, child_path );
+   
    // enqueue...
    next->path = child_path;
    next->ent = child;
@@ -545,12 +736,13 @@ int fskit_detach_queue_children( struct fskit_detach_ctx* ctx, char const* dir_p
    int rc = 0;
    fskit_entry_set_itr itr;
    fskit_entry_set* dirent = NULL;
-   fskit_entry_set* children = NULL;
-    
-   struct fskit_detach_entry* erased = ctx->tail;
-   struct fskit_detach_entry* tmp = NULL;
+   struct fskit_entry* dir = fskit_entry_set_find_name( *dir_children, "." );
    
-   char erased_name[FSKIT_FILESYSTEM_NAMEMAX+1];
+   // what's left once the children are consumed.  Allocated up front, so we don't fail after queuing them.
+   fskit_entry_set* consumed = fskit_entry_set_new( dir, fskit_entry_set_find_name( *dir_children, ".." ) );
+   if( consumed == NULL ) {
+      return -ENOMEM;
+   }
    
    for( dirent = fskit_entry_set_begin( &itr, *dir_children ); dirent != NULL; dirent = fskit_entry_set_next( &itr ) ) {
     
@@ -577,38 +769,121 @@ int fskit_detach_queue_children( struct fskit_detach_ctx* ctx, char const* dir_p
          continue;
       }
       
-      rc = fskit_detach_queue_child( ctx, dir_path, name, child );
+      rc = fskit_detach_queue_child( ctx, dir, dir_path, name, child );
 
       if( rc != 0 ) {
+         
+         fskit_entry_set_free( consumed );
          return rc;
       }
    }
    
-   // go through all the children we enqueued and remove them from the dir_children set
-   for( tmp = erased; tmp != NULL; tmp = tmp->next ) {
-      
-      fskit_dirname( tmp->path, erased_name );
-      
-      fskit_entry_set_remove( dir_children, erased_name );
-   }
+   // all enqueued; leave only . and ..
+   fskit_entry_set_free( *dir_children );
+   *dir_children = consumed;
 
    return 0;
 }
 
 
-// unlink a directory's immediate children and subsequent descendants.
-// *dir_children must be the directory's old set of children; the directory must have been given a new set of children in which none of these children are present.
-// (e.g. this is a "mass-unlink" function that takes care of updating all the children).
-// run any detach route callbacks if their link counts reach 0.
-// destroy the contents of dir_children for which the entries have been fully unlinked (besides . and ..).
+// claim a fully-unlinked, unopened entry for the next batch of destroy routes (see fskit_detach_batch_flush)
+// fent must be write-locked, and will be unlocked if it is claimed.  The batch takes ownership of path.
+// return true if claimed
+// return false if fent is still linked or open, or if there's no memory for a batch (in which case the caller destroys it on its own)
+static bool fskit_detach_batch_add( struct fskit_detach_ctx* ctx, char* path, struct fskit_entry* fent ) {
+
+   struct fskit_detach_batch* batch = ctx->batch;
+
+   if( fskit_entry_get_link_count( fent ) != 0 || fskit_entry_get_open_count( fent ) != 0 ) {
+      return false;
+   }
+
+   if( batch == NULL ) {
+
+      batch = CALLOC_LIST( struct fskit_detach_batch, 1 );
+      if( batch == NULL ) {
+         return false;
+      }
+
+      ctx->batch = batch;
+   }
+
+   // ref it ourselves, as fskit_entry_try_destroy does, so it can't be destroyed in another thread while it waits
+   __atomic_add_fetch( &fent->open_count, 1, __ATOMIC_ACQ_REL );
+
+   batch->paths[ batch->len ] = path;
+   batch->file_ids[ batch->len ] = fent->file_id;
+   batch->inode_data[ batch->len ] = fent->app_data;
+   batch->fents[ batch->len ] = fent;
+   batch->len++;
+
+   fskit_entry_unlock( fent );
+   return true;
+}
+
+
+// run the destroy routes for the batch of entries claimed by fskit_detach_batch_add, and destroy and free them.
+// a destroy_many route that matches dir_path gets the whole batch in one call; otherwise, each entry's destroy route is called.
+// the entries are destroyed even if the routes fail.
 // return 0 on success
-// return -ENOMEM if out of memory
-// return -EFAULT if the FSKIT_DETACH_CTX_CB_FAIL flag is set, and the callback fails.
-// NOTE: the owner of dir_children should be write-locked
-// NOTE: if -ENOMEM is encountered, this method will fail fast and return.
-// This is because it will be unable to safely run user-defined routes.
-// If this occurs, free up some memory and call this method again with the same detach context, but NULL for dir_children
-int fskit_detach_all_ex( struct fskit_core* core, char const* dir_path, fskit_entry_set** dir_children, struct fskit_detach_ctx* ctx ) {
+// return -EFAULT if the FSKIT_DETACH_CTX_CB_FAIL flag is set, and a route fails.
+static int fskit_detach_batch_flush( struct fskit_core* core, char const* dir_path, struct fskit_detach_ctx* ctx ) {
+
+   int rc = 0;
+   int cbrc = 0;
+   struct fskit_detach_batch* batch = ctx->batch;
+
+   if( batch == NULL || batch->len == 0 ) {
+      return 0;
+   }
+
+   // (if there are no destroy routes, there are no paths to give them, either)
+   if( ctx->need_paths ) {
+
+      rc = fskit_run_user_destroy_many( core, dir_path, (char const**)batch->paths, batch->file_ids, batch->inode_data, batch->len, &cbrc );
+      if( rc != 0 ) {
+
+         // no batch route; run each entry's own
+         for( size_t i = 0; i < batch->len; i++ ) {
+
+            rc = fskit_run_user_destroy( core, batch->paths[i], NULL, batch->fents[i] );
+            if( rc != 0 ) {
+
+               fskit_error("WARN: fskit_run_user_destroy(%s) rc = %d\n", batch->paths[i], rc );
+               if( cbrc == 0 ) {
+                  cbrc = rc;
+               }
+            }
+         }
+      }
+      else if( cbrc != 0 ) {
+
+         fskit_error("WARN: fskit_run_user_destroy_many(%s, %zu entries) rc = %d\n", dir_path, batch->len, cbrc );
+      }
+   }
+
+   for( size_t i = 0; i < batch->len; i++ ) {
+
+      fskit_entry_destroy( core, batch->fents[i], false );
+      fskit_safe_free( batch->fents[i] );
+      fskit_safe_free( batch->paths[i] );
+   }
+
+   batch->len = 0;
+
+   if( (ctx->flags & FSKIT_DETACH_CTX_CB_FAIL) && cbrc < 0 ) {
+
+      fskit_error("Callback failed (rc = %d)\n", cbrc );
+      ctx->cbrc = cbrc;
+      return -EFAULT;
+   }
+
+   return 0;
+}
+
+
+// reap the entries in the detach queue (see fskit_detach_all_ex), leaving the last batch unflushed
+static int fskit_detach_all_reap( struct fskit_core* core, char const* dir_path, fskit_entry_set** dir_children, struct fskit_detach_ctx* ctx ) {
 
    // NOTE: it is important that we go in breadth-first order.  This is because fskit
    // locks the parent before the child when resolving a path.  So it must be the case
@@ -617,6 +892,9 @@ int fskit_detach_all_ex( struct fskit_core* core, char const* dir_path, fskit_en
    int rc = 0;
    int cbrc = 0;
 
+   // only build the paths of removed files if a destroy route could want them
+   ctx->need_paths = fskit_route_exists( core, FSKIT_ROUTE_MATCH_DESTROY ) || fskit_route_exists( core, FSKIT_ROUTE_MATCH_DESTROY_MANY );
+
    // queue immediate children for destruction
    if( dir_children != NULL ) {
 
@@ -666,12 +944,28 @@ int fskit_detach_all_ex( struct fskit_core* core, char const* dir_path, fskit_en
       
       // mark this entry for garbage-collection.
       // it was detached from exactly one parent by this method.
-      fent->link_count--;
+      __atomic_sub_fetch( &fent->link_count, 1, __ATOMIC_ACQ_REL );
       
       if( fent->type == FSKIT_ENTRY_TYPE_DIR ) {
          fent->deletion_in_progress = true;
       }
       
+      if( fskit_detach_batch_add( ctx, fent_path, fent ) ) {
+
+         // claimed for the next batch, which now owns the path
+         ctx->head = ctx->head->next;
+         ctx->size--;
+
+         fskit_safe_free( next );
+
+         if( ctx->batch->len == FSKIT_DETACH_BATCH_MAX ) {
+
+            rc = fskit_detach_batch_flush( core, dir_path, ctx );
+         }
+
+         continue;
+      }
+
       // maybe this entry is fully unref'ed...
       rc = fskit_entry_try_destroy_and_free_ex( core, fent_path, NULL, fent, &cbrc );
       if( (ctx->flags & FSKIT_DETACH_CTX_CB_FAIL) && cbrc < 0 ) {
@@ -693,7 +987,7 @@ int fskit_detach_all_ex( struct fskit_core* core, char const* dir_path, fskit_en
       }
       else {
          // shouldn't happen: failed to destroy and free
-         fskit_error("BUG: fskit_entry_try_destroy_and_free(%s) rc = %d\n", fent_path, rc );
+         fskit_error("BUG: fskit_entry_try_destroy_and_free(%" PRIX64 ") rc = %d\n", fent->file_id, rc );
          
          fskit_entry_unlock( fent );
          return rc;
@@ -712,6 +1006,33 @@ int fskit_detach_all_ex( struct fskit_core* core, char const* dir_path, fskit_en
 }
 
 
+// unlink a directory's immediate children and subsequent descendants.
+// *dir_children must be the directory's old set of children; the directory must have been given a new set of children in which none of these children are present.
+// (e.g. this is a "mass-unlink" function that takes care of updating all the children).
+// run any detach route callbacks if their link counts reach 0.
+// destroy the contents of dir_children for which the entries have been fully unlinked (besides . and ..).
+// return 0 on success
+// return -ENOMEM if out of memory
+// return -EFAULT if the FSKIT_DETACH_CTX_CB_FAIL flag is set, and the callback fails.
+// NOTE: the owner of dir_children should be write-locked
+// NOTE: if -ENOMEM is encountered, this method will fail fast and return.
+// This is because it will be unable to safely run user-defined routes.
+// If this occurs, free up some memory and call this method again with the same detach context, but NULL for dir_children
+// NOTE: entries that are fully unreferenced are destroyed in batches, so their destroy routes can be called in bulk
+// (see fskit_route_destroy_many).  Each batch is flushed before this method returns.
+int fskit_detach_all_ex( struct fskit_core* core, char const* dir_path, fskit_entry_set** dir_children, struct fskit_detach_ctx* ctx ) {
+
+   int rc = fskit_detach_all_reap( core, dir_path, dir_children, ctx );
+   int flush_rc = fskit_detach_batch_flush( core, dir_path, ctx );
+
+   if( rc == 0 ) {
+      rc = flush_rc;
+   }
+
+   return rc;
+}
+
+
 // create a detach context 
 struct fskit_detach_ctx* fskit_detach_ctx_new() {
    return CALLOC_LIST( struct fskit_detach_ctx, 1 );
@@ -755,6 +1076,9 @@ int fskit_detach_ctx_free( struct fskit_detach_ctx* ctx ) {
    ctx->head = NULL;
    ctx->tail = NULL;
 
+   // batches are always flushed by fskit_detach_all_ex, so this is empty
+   fskit_safe_free( ctx->batch );
+
    return 0;
 }
 
@@ -861,6 +1185,32 @@ uint64_t fskit_core_inode_alloc( struct fskit_core* core, struct fskit_entry* pa
    return next_inode;
 }
 
+// get free inodes for a batch of children of parent, taking the core lock once.
+// file_ids[i] is set to 0 if children[i] is NULL, or if the allocator failed for it.
+// return 0 on success
+// return -errno if the core could not be locked
+int fskit_core_inode_alloc_many( struct fskit_core* core, struct fskit_entry* parent, struct fskit_entry** children, uint64_t* file_ids, size_t num_children ) {
+
+   int rc = 0;
+
+   rc = fskit_core_rlock( core );
+   if( rc != 0 ) {
+      return -rc;
+   }
+
+   for( size_t i = 0; i < num_children; i++ ) {
+
+      file_ids[i] = 0;
+      if( children[i] != NULL ) {
+         file_ids[i] = (*core->fskit_inode_alloc)( parent, children[i], core->app_fs_data );
+      }
+   }
+
+   fskit_core_unlock( core );
+
+   return 0;
+}
+
 // release an inode
 int fskit_core_inode_free( struct fskit_core* core, uint64_t inode ) {
 
@@ -914,8 +1264,17 @@ int fskit_entry_init_lowlevel( struct fskit_entry* fent, uint8_t type, uint64_t
 
    int rc = 0;
 
+   pthread_mutexattr_t meta_lock_attr;
+
    memset( fent, 0, sizeof(struct fskit_entry) );
 
+   pthread_mutexattr_init( &meta_lock_attr );
+   pthread_mutexattr_settype( &meta_lock_attr, PTHREAD_MUTEX_RECURSIVE );
+   pthread_mutex_init( &fent->meta_lock, &meta_lock_attr );
+   pthread_mutexattr_destroy( &meta_lock_attr );
+
+   pthread_rwlock_init( &fent->name_lock, NULL );
+
    fent->type = type;
    fent->file_id = file_id;
    fent->owner = owner;
@@ -989,6 +1348,18 @@ int fskit_entry_init_dir( struct fskit_entry* fent, struct fskit_entry* parent,
       return rc;
    }
 
+   rc = fskit_route_scope_init_dir( fent, parent );
+   if( rc != 0 ) {
+      fskit_entry_set_free( children );
+      return rc;
+   }
+
+   rc = fskit_dir_aggregate_init( fent, parent );
+   if( rc != 0 ) {
+      fskit_entry_set_free( children );
+      return rc;
+   }
+
    fent->children = children;
    return 0;
 }
@@ -1154,8 +1525,25 @@ int fskit_run_user_destroy( struct fskit_core* core, char const* path, struct fs
    rc = fskit_route_call_destroy( core, path, fent, &dargs, &cbrc );
 
    if( rc == -EPERM || rc == -ENOSYS ) {
-      // no routes
-      return 0;
+      
+      // no route for this entry, but there might be a batch route for its directory
+      char* dir_path = fskit_dirname( path, NULL );
+      uint64_t file_id = fent->file_id;
+      void* inode_data = fent->app_data;
+
+      if( dir_path == NULL ) {
+         return 0;
+      }
+
+      rc = fskit_run_user_destroy_many( core, dir_path, &path, &file_id, &inode_data, 1, &cbrc );
+      fskit_safe_free( dir_path );
+
+      if( rc != 0 ) {
+         // no routes
+         return 0;
+      }
+
+      return cbrc;
    }
 
    else if( cbrc != 0 ) {
@@ -1170,6 +1558,29 @@ int fskit_run_user_destroy( struct fskit_core* core, char const* path, struct fs
 }
 
 
+// run the user-supplied route callback to destroy a batch of entries' inode data, all removed from the directory at dir_path
+// set *cbrc to the callback's return code
+// return 0 if a route was called
+// return -EPERM if there is no route for dir_path
+static int fskit_run_user_destroy_many( struct fskit_core* core, char const* dir_path, char const** paths, uint64_t const* file_ids, void** inode_data, size_t num_entries, int* cbrc ) {
+
+   int rc = 0;
+   struct fskit_route_dispatch_args dargs;
+
+   *cbrc = 0;
+
+   fskit_route_destroy_many_args( &dargs, paths, file_ids, inode_data, num_entries );
+
+   rc = fskit_route_call_destroy_many( core, dir_path, &dargs, cbrc );
+   if( rc == -EPERM || rc == -ENOSYS ) {
+      *cbrc = 0;
+      return -EPERM;
+   }
+
+   return 0;
+}
+
+
 // destroy a fskit entry
 // NOTE: fent must be write-locked if is attached to the filesystem, or needlock must be true
 // NOTE: the user-given callback will *NOT* be run.  Call fskit_entry_try_destroy for that.
@@ -1193,23 +1604,36 @@ int fskit_entry_destroy( struct fskit_core* core, struct fskit_entry* fent, bool
       fskit_entry_set_free( fent->children );
       fent->children = NULL;
    }
+   
+   fskit_dir_listing_cache_free( fent );
+   fskit_dir_versions_free( fent );
+   fskit_dir_shards_free( fent );
+   fskit_dir_aggregate_free( fent );
 
    if( fent->symlink_target != NULL ) {
       fskit_safe_free( fent->symlink_target );
       fent->symlink_target = NULL;
    }
    
+   // nothing links to it anymore, so nothing else can see its names
+   fskit_entry_name_free( fent );
+   
    if( fent->xattrs != NULL ) {
       fskit_xattr_set_free( fent->xattrs );
       fent->xattrs = NULL;
    }
    
+   fskit_route_cache_free( fent );
+   fskit_route_scope_release( fent );
+   
    (*core->fskit_inode_free)( fent->file_id, core->app_fs_data );
   
    if( needlock ) { 
        fskit_entry_unlock( fent );
    }
    pthread_rwlock_destroy( &fent->lock );
+   pthread_mutex_destroy( &fent->meta_lock );
+   pthread_rwlock_destroy( &fent->name_lock );
 
    return 0;
 }
@@ -1219,35 +1643,59 @@ int fskit_entry_destroy( struct fskit_core* core, struct fskit_entry* fent, bool
 // return 0 if not destroyed
 // return 1 if destroyed (even if the user-given detach callback fails)
 // fent and parent must be write-locked.  If it is fully unlinked (i.e. this call will destroy it), it will be unlocked.
+// fs_path may be NULL, in which case the path fent had when it was unlinked is used, if a destroy route needs it.
 // NOTE: we mask any failures in the user callback.
 // NOTE: even if this method returns an error code, the entry will be destroyed if it is no longer linked.
 static int fskit_entry_try_destroy( struct fskit_core* core, char const* fs_path, struct fskit_entry* parent, struct fskit_entry* fent, int* cbrc ) {
 
    int rc = 0;
+   int err = 0;
    uint64_t file_id = 0;
+   char* entry_path = NULL;
+
+   int32_t link_count = fskit_entry_get_link_count( fent );
+   int32_t open_count = fskit_entry_get_open_count( fent );
 
-   if( fent->link_count <= 0 && fent->open_count <= 0 ) {
+   if( link_count <= 0 && open_count <= 0 ) {
 
-      if( fent->link_count < 0 ) {
-         fskit_error("BUG: entry %p has a negative link count (%d)\n", fent, fent->link_count );
+      if( link_count < 0 ) {
+         fskit_error("BUG: entry %p has a negative link count (%d)\n", fent, link_count );
          exit(1);
       }
       
-      if( fent->open_count < 0 ) {
-         fskit_error("BUG: entry %p has a negative open count (%d)\n", fent, fent->open_count );
+      if( open_count < 0 ) {
+         fskit_error("BUG: entry %p has a negative open count (%d)\n", fent, open_count );
          exit(1);
       }
       
       // do the detach--nothing references it anymore
       // but, we should ref it ourselves, so this method won't succeed in another thread.
-      fent->open_count++;
+      __atomic_add_fetch( &fent->open_count, 1, __ATOMIC_ACQ_REL );
       file_id = fent->file_id;
       fskit_entry_unlock( fent );
+      
+      if( fs_path == NULL && (fskit_route_exists( core, FSKIT_ROUTE_MATCH_DESTROY ) || fskit_route_exists( core, FSKIT_ROUTE_MATCH_DESTROY_MANY )) ) {
+         
+         entry_path = fskit_entry_get_path( fent, &err );
+         if( entry_path == NULL ) {
+            
+            // can't tell whether a destroy route matches, so report it as having failed
+            fskit_error("WARN: fskit_entry_get_path(%" PRIX64 ") rc = %d; not running destroy route\n", file_id, err );
+            *cbrc = err;
+         }
+         
+         fs_path = entry_path;
+      }
      
-      *cbrc = fskit_run_user_destroy( core, fs_path, parent, fent );
-      if( *cbrc != 0 ) {
-         fskit_error("WARN: fskit_run_user_destroy(%s) rc = %d\n", fs_path, *cbrc );
+      if( fs_path != NULL ) {
+         
+         *cbrc = fskit_run_user_destroy( core, fs_path, parent, fent );
+         if( *cbrc != 0 ) {
+            fskit_error("WARN: fskit_run_user_destroy(%s) rc = %d\n", fs_path, *cbrc );
+         }
       }
+      
+      fskit_safe_free( entry_path );
 
       fskit_entry_destroy( core, fent, false );
 
@@ -1258,6 +1706,93 @@ static int fskit_entry_try_destroy( struct fskit_core* core, char const* fs_path
 }
 
 
+// drop an open reference to an entry without locking it, provided it is not the last one.
+// the last reference has to be dropped with the entry write-locked, so that exactly one thread sees
+// both counts reach zero and calls fskit_entry_try_destroy.
+// return true if the reference was dropped 
+// return false if this is the last open reference, in which case nothing was changed
+bool fskit_entry_unref_nonlast( struct fskit_entry* fent ) {
+   
+   int32_t open_count = __atomic_load_n( &fent->open_count, __ATOMIC_ACQUIRE );
+   
+   while( open_count > 1 ) {
+      
+      if( __atomic_compare_exchange_n( &fent->open_count, &open_count, open_count - 1, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) ) {
+         return true;
+      }
+   }
+   
+   return false;
+}
+
+
+// start changing an entry's stat-visible attributes (mode, owner, group, size, times, ...).
+// makes meta_seq odd, so lock-free readers (fskit_entry_meta_read_begin) wait or retry.
+// nests: only the outermost begin/end pair moves the counter, so a caller can group several setters into one update.
+// writers take turns on meta_lock, so this is safe with fent read-locked or unlocked (e.g. in a write continuation
+// running under FSKIT_CONCURRENT or FSKIT_INODE_CONCURRENT); fent need only be ref'ed.
+void fskit_entry_meta_write_begin( struct fskit_entry* fent ) {
+   
+   pthread_mutex_lock( &fent->meta_lock );
+   
+   if( fent->meta_write_depth == 0 ) {
+      
+      __atomic_add_fetch( &fent->meta_seq, 1, __ATOMIC_RELAXED );
+      
+      // order the odd counter before the field stores that follow
+      __atomic_thread_fence( __ATOMIC_RELEASE );
+   }
+   
+   fent->meta_write_depth++;
+}
+
+// finish changing an entry's stat-visible attributes; makes meta_seq even again.
+void fskit_entry_meta_write_end( struct fskit_entry* fent ) {
+   
+   fent->meta_write_depth--;
+   
+   if( fent->meta_write_depth == 0 ) {
+      __atomic_add_fetch( &fent->meta_seq, 1, __ATOMIC_RELEASE );
+   }
+   
+   pthread_mutex_unlock( &fent->meta_lock );
+}
+
+// start a lock-free read of an entry's attributes.
+// waits out any writer in progress, and returns the sequence number to pass to fskit_entry_meta_read_retry.
+// fent must be ref'ed, but need not be locked.
+uint64_t fskit_entry_meta_read_begin( struct fskit_entry* fent ) {
+   
+   uint64_t seq = __atomic_load_n( &fent->meta_seq, __ATOMIC_ACQUIRE );
+   
+   while( (seq & 1) != 0 ) {
+      
+      sched_yield();
+      seq = __atomic_load_n( &fent->meta_seq, __ATOMIC_ACQUIRE );
+   }
+   
+   return seq;
+}
+
+// finish a lock-free read of an entry's attributes.
+// return true if a writer changed them since fskit_entry_meta_read_begin returned seq, in which case the copy is torn and must be redone.
+bool fskit_entry_meta_read_retry( struct fskit_entry* fent, uint64_t seq ) {
+   
+   // order the field loads before re-reading the counter
+   __atomic_thread_fence( __ATOMIC_ACQUIRE );
+   
+   return __atomic_load_n( &fent->meta_seq, __ATOMIC_RELAXED ) != seq;
+}
+
+
+// note that a directory's set of children changed, so any cached listing of it is stale.
+// NOTE: dir must be write-locked (or, if sharded, read-locked with the changed name's shard write-locked)
+void fskit_entry_children_changed( struct fskit_entry* dir ) {
+   
+   __atomic_add_fetch( &dir->children_gen, 1, __ATOMIC_RELEASE );
+}
+
+
 // try to destroy an fskit_entry, if it is unlinked and no longer open.
 // Free it and decrement the number of children in the filesystem if we succeed.
 // return 0 if not destroyed
@@ -1306,7 +1841,7 @@ int fskit_entry_try_garbage_collect( struct fskit_core* core, char const* path,
       child_inode_id = child->file_id;
 
       // detach from the parent, but don't update mtime (since it was already detached)
-      rc = fskit_entry_detach_lowlevel_ex( parent, path_basename, false );
+      rc = fskit_entry_detach_lowlevel_ex( parent, path_basename, false, false );
       if( rc < 0 ) {
          
          if( rc == -ENOENT ) {
@@ -1329,8 +1864,10 @@ int fskit_entry_try_garbage_collect( struct fskit_core* core, char const* path,
             if( rc > 0 ) {
                
                // destroyed! clear its name from the parent's children
-               fskit_entry_set_remove( &parent->children, path_basename );
-               parent->num_children--;
+               fskit_entry_dir_remove( parent, path_basename );
+               fskit_entry_children_changed( parent );
+               fskit_dir_versions_remove( parent, path_basename );
+               __atomic_sub_fetch( &parent->num_children, 1, __ATOMIC_RELAXED );
                
                fskit_debug( "Garbage-collected %s (%" PRIX64 ")\n", path, child_inode_id );
             }
@@ -1393,10 +1930,12 @@ int fskit_entry_wlock2( struct fskit_entry* fent, char const* from_str, int line
 
 // unlock a file
 int fskit_entry_unlock2( struct fskit_entry* fent, char const* from_str, int line_no ) {
+   // once unlocked, another thread may destroy fent
+   uint64_t file_id = fent->file_id;
    int rc = pthread_rwlock_unlock( &fent->lock );
    if( rc == 0 ) {
       if( FSKIT_GLOBAL_DEBUG_LOCKS ) {
-         fskit_debug( "%p: %" PRIX64 ", from %s:%d\n", fent, fent->file_id, from_str, line_no );
+         fskit_debug( "%p: %" PRIX64 ", from %s:%d\n", fent, file_id, from_str, line_no );
       }
    }
    else {
@@ -1421,6 +1960,123 @@ int fskit_file_handle_unlock( struct fskit_file_handle* fh ) {
    return pthread_rwlock_unlock( &fh->lock );
 }
 
+// which of a file handle's in-flight I/O counters this thread uses (-1 if not yet assigned)
+static _Thread_local int fskit_file_handle_io_slot = -1;
+static int fskit_file_handle_next_io_slot = 0;
+
+static int fskit_file_handle_io_slot_self(void) {
+   
+   if( fskit_file_handle_io_slot < 0 ) {
+      fskit_file_handle_io_slot = __atomic_fetch_add( &fskit_file_handle_next_io_slot, 1, __ATOMIC_RELAXED ) % FSKIT_FILE_HANDLE_NUM_IO_SLOTS;
+   }
+   
+   return fskit_file_handle_io_slot;
+}
+
+// stop counting an I/O as in flight, and wake up the closer if there is one.
+// once a closer has marked the slot, the count only goes down under drain_lock, and the closer only sees it reach zero
+// under drain_lock too; so when the closer is done waiting, no I/O thread is still about to touch the handle.
+static void fskit_file_handle_io_put( struct fskit_file_handle* fh, int64_t* num_inflight ) {
+   
+   int64_t count = __atomic_load_n( num_inflight, __ATOMIC_ACQUIRE );
+   
+   while( (count & FSKIT_FILE_HANDLE_IO_CLOSING) == 0 ) {
+      
+      // no closer (yet)
+      if( __atomic_compare_exchange_n( num_inflight, &count, count - 1, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) ) {
+         return;
+      }
+   }
+   
+   pthread_mutex_lock( &fh->drain_lock );
+   
+   __atomic_sub_fetch( num_inflight, 1, __ATOMIC_ACQ_REL );
+   pthread_cond_broadcast( &fh->drain_cond );
+   
+   pthread_mutex_unlock( &fh->drain_lock );
+}
+
+// start doing I/O on a file handle, without locking it.
+// the handle's fent, path, flags and app_data stay valid until fskit_file_handle_io_end.
+// return 0 on success
+// return -EBADF if the handle is being closed
+int fskit_file_handle_io_begin( struct fskit_file_handle* fh ) {
+   
+   int64_t* num_inflight = &fh->io_slots[ fskit_file_handle_io_slot_self() ].num_inflight;
+   
+   // announce ourselves, and see whether a closer got here first.  Pairs with fskit_file_handle_io_drain.
+   if( (__atomic_add_fetch( num_inflight, 1, __ATOMIC_ACQ_REL ) & FSKIT_FILE_HANDLE_IO_CLOSING) != 0 ) {
+      
+      // the closer may have counted us
+      fskit_file_handle_io_put( fh, num_inflight );
+      return -EBADF;
+   }
+   
+   return 0;
+}
+
+// finish doing I/O on a file handle
+void fskit_file_handle_io_end( struct fskit_file_handle* fh ) {
+   
+   fskit_file_handle_io_put( fh, &fh->io_slots[ fskit_file_handle_io_slot_self() ].num_inflight );
+}
+
+// stop new I/O on a file handle, and sleep until in-flight I/O finishes (which may take as long as a route call).
+// once this returns, no I/O thread touches the handle again, so it can be destroyed.
+// fh must be write-locked.
+// return 0 on success
+// return -EBADF if the handle is already being closed
+int fskit_file_handle_io_drain( struct fskit_file_handle* fh ) {
+   
+   int64_t num_inflight = 0;
+   
+   if( fh->closing ) {
+      return -EBADF;
+   }
+   
+   fh->closing = true;
+   
+   pthread_mutex_lock( &fh->drain_lock );
+   
+   // from here on, I/O ends under drain_lock (see fskit_file_handle_io_put)
+   for( int i = 0; i < FSKIT_FILE_HANDLE_NUM_IO_SLOTS; i++ ) {
+      __atomic_or_fetch( &fh->io_slots[i].num_inflight, FSKIT_FILE_HANDLE_IO_CLOSING, __ATOMIC_ACQ_REL );
+   }
+   
+   while( true ) {
+      
+      num_inflight = 0;
+      for( int i = 0; i < FSKIT_FILE_HANDLE_NUM_IO_SLOTS; i++ ) {
+         num_inflight += __atomic_load_n( &fh->io_slots[i].num_inflight, __ATOMIC_ACQUIRE ) & ~FSKIT_FILE_HANDLE_IO_CLOSING;
+      }
+      
+      if( num_inflight == 0 ) {
+         break;
+      }
+      
+      pthread_cond_wait( &fh->drain_cond, &fh->drain_lock );
+   }
+   
+   pthread_mutex_unlock( &fh->drain_lock );
+   
+   return 0;
+}
+
+// allow I/O on a file handle again, if closing it failed
+// fh must be write-locked.
+void fskit_file_handle_io_undrain( struct fskit_file_handle* fh ) {
+   
+   pthread_mutex_lock( &fh->drain_lock );
+   
+   for( int i = 0; i < FSKIT_FILE_HANDLE_NUM_IO_SLOTS; i++ ) {
+      __atomic_and_fetch( &fh->io_slots[i].num_inflight, ~FSKIT_FILE_HANDLE_IO_CLOSING, __ATOMIC_ACQ_REL );
+   }
+   
+   pthread_mutex_unlock( &fh->drain_lock );
+   
+   fh->closing = false;
+}
+
 // lock a directory handle for reading
 int fskit_dir_handle_rlock( struct fskit_dir_handle* dh ) {
    return pthread_rwlock_rdlock( &dh->lock );
@@ -1510,13 +2166,17 @@ int fskit_entry_set_user_data( struct fskit_entry* ent, void* app_data ) {
 // NOTE: don't do this outside of creat(), mkdir(), or mknod(), unless you want to suffer the consequences.
 // ent must be write-locked
 void fskit_entry_set_file_id( struct fskit_entry* ent, uint64_t file_id ) {
+   fskit_entry_meta_write_begin( ent );
    ent->file_id = file_id;
+   fskit_entry_meta_write_end( ent );
 }
 
 // put a new set of children in place 
 fskit_entry_set* fskit_entry_swap_children( struct fskit_entry* ent, fskit_entry_set* new_children ) {
    fskit_entry_set* old_children = ent->children;
    ent->children = new_children;
+   fskit_entry_children_changed( ent );
+   fskit_dir_versions_reset( ent );
    return old_children;
 }
 
@@ -1537,13 +2197,17 @@ char* fskit_entry_swap_symlink_target( struct fskit_entry* ent, char* new_symlin
    char* old_target = ent->symlink_target;
    ent->symlink_target = new_symlink_target;
    
+   fskit_entry_meta_write_begin( ent );
+   
    if( new_symlink_target != NULL ) {
-      ent->size = strlen(new_symlink_target);
+      fskit_entry_resize( ent, strlen(new_symlink_target) );
    }
    else {
-      ent->size = 0;
+      fskit_entry_resize( ent, 0 );
    }
    
+   fskit_entry_meta_write_end( ent );
+   
    return old_target;
 }
 
@@ -1561,7 +2225,7 @@ char* fskit_entry_swap_symlink_target( struct fskit_entry* ent, char* new_symlin
 // return -EIO if ent is a directory and lacks a .. entry.
 int fskit_entry_tag_garbage( struct fskit_entry* ent, fskit_entry_set** children ) {
     
-    fskit_debug("Tag %" PRIX64 " as garbage (link count %d, open count %d)\n", ent->file_id, ent->link_count, ent->open_count );
+    fskit_debug("Tag %" PRIX64 " as garbage (link count %d, open count %d)\n", ent->file_id, fskit_entry_get_link_count( ent ), fskit_entry_get_open_count( ent ) );
     
     if( ent->type == FSKIT_ENTRY_TYPE_DIR ) {
         
@@ -1581,10 +2245,20 @@ int fskit_entry_tag_garbage( struct fskit_entry* ent, fskit_entry_set** children
             return -ENOMEM;
         }
         
+        // a sharded directory hands over all of its children
+        int rc = fskit_entry_dir_gather_shards( ent );
+        if( rc != 0 ) {
+            
+            fskit_entry_set_free( empty_children );
+            return rc;
+        }
+        
         // do the swap 
         *children = ent->children;
         ent->children = empty_children;
         ent->num_children = 0;
+        fskit_entry_children_changed( ent );
+        fskit_dir_versions_reset( ent );
         ent->deletion_in_progress = true;
     }
     else {
@@ -1604,9 +2278,38 @@ void* fskit_entry_get_user_data( struct fskit_entry* ent ) {
    return ent->app_data;
 }
 
-// get a reference (not a copy) of the path used to open this handle
+// get a handle's path, building it from its entry's names the first time it is asked for.
+// handles don't keep a path otherwise; their routes are pinned when they are opened (see fskit_file_handle_pin_routes).
+// return a reference (not a copy) to the path on success
+// return NULL if the entry is no longer linked (and was not open when it was unlinked), or on OOM
+static char* fskit_handle_get_path( char** handle_path, struct fskit_entry* fent ) {
+
+   char* path = __atomic_load_n( handle_path, __ATOMIC_ACQUIRE );
+   char* expected = NULL;
+   int rc = 0;
+
+   if( path != NULL ) {
+      return path;
+   }
+
+   path = fskit_entry_get_path( fent, &rc );
+   if( path == NULL ) {
+      return NULL;
+   }
+
+   if( !__atomic_compare_exchange_n( handle_path, &expected, path, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) ) {
+
+      // someone else got here first
+      fskit_safe_free( path );
+      path = expected;
+   }
+
+   return path;
+}
+
+// get a reference (not a copy) of this handle's path.  It reflects any renames up to the first time it is asked for.
 char* fskit_file_handle_get_path( struct fskit_file_handle* fh ) {
-   return fh->path;
+   return fskit_handle_get_path( &fh->path, fh->fent );
 }
 
 // get the inode structure for this file handle
@@ -1619,9 +2322,9 @@ void* fskit_file_handle_get_user_data( struct fskit_file_handle* fh ) {
    return fh->app_data;
 }
 
-// get a reference (not a copy) of the path used to open this handle
+// get a reference (not a copy) of this handle's path.  It reflects any renames up to the first time it is asked for.
 char* fskit_dir_handle_get_path( struct fskit_dir_handle* dh ) {
-   return dh->path;
+   return fskit_handle_get_path( &dh->path, dh->dent );
 }
 
 // get the inode structure for this file handle
@@ -1702,9 +2405,14 @@ mode_t fskit_entry_get_mode( struct fskit_entry* ent ) {
    return ent->mode;
 }
 
-// get link count 
+// get link count (need not be locked)
 int32_t fskit_entry_get_link_count( struct fskit_entry* ent ) {
-   return ent->link_count;
+   return __atomic_load_n( &ent->link_count, __ATOMIC_ACQUIRE );
+}
+
+// get open count (need not be locked)
+int32_t fskit_entry_get_open_count( struct fskit_entry* ent ) {
+   return __atomic_load_n( &ent->open_count, __ATOMIC_ACQUIRE );
 }
 
 // get number of children.  if this is not a directory, return -1
@@ -0,0 +1,478 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include <fskit/executor.h>
+#include <fskit/util.h>
+
+#include "fskit_private/private.h"
+
+// a queued job 
+struct fskit_executor_job {
+   
+   fskit_executor_job_func func;
+   void* arg;
+   
+   bool owned;          // if true, the executor frees this job once it is dequeued
+   
+   struct fskit_executor_job* prev;
+   struct fskit_executor_job* next;
+};
+
+// a worker thread, and its job deque.
+// the owner pushes and pops at the tail; thieves take from the head.
+struct fskit_executor_worker {
+   
+   struct fskit_executor* exec;
+   int id;
+   pthread_t thread;
+   
+   struct fskit_executor_job* head;
+   struct fskit_executor_job* tail;
+   pthread_mutex_t lock;
+};
+
+// thread pool 
+struct fskit_executor {
+   
+   struct fskit_executor_worker* workers;
+   int num_threads;
+   
+   // round-robin submission cursor for non-worker threads 
+   uint64_t next_worker;
+   
+   // number of jobs pushed but not yet taken, and whether or not jobs are accepted.  Guarded by lock;
+   // jobs are pushed with it held, so none can arrive once running is cleared.
+   int64_t pending;
+   bool running;
+   
+   pthread_mutex_t lock;
+   pthread_cond_t cond;
+   
+   // counters 
+   uint64_t num_submitted;
+   uint64_t num_completed;
+   uint64_t num_stolen;
+};
+
+// synchronous call context (see fskit_executor_call)
+struct fskit_executor_call_ctx {
+   
+   fskit_executor_job_func func;
+   void* arg;
+   
+   bool done;
+   pthread_mutex_t lock;
+   pthread_cond_t cond;
+};
+
+// the worker the calling thread is, if any 
+static _Thread_local struct fskit_executor_worker* fskit_executor_self = NULL;
+
+
+// append a job to a worker's deque 
+static void fskit_executor_worker_push( struct fskit_executor_worker* worker, struct fskit_executor_job* job ) {
+   
+   pthread_mutex_lock( &worker->lock );
+   
+   job->next = NULL;
+   job->prev = worker->tail;
+   
+   if( worker->tail != NULL ) {
+      worker->tail->next = job;
+   }
+   else {
+      worker->head = job;
+   }
+   
+   worker->tail = job;
+   
+   pthread_mutex_unlock( &worker->lock );
+}
+
+
+// take a job from a worker's deque.
+// the owning worker takes its most recently pushed job (for cache locality);
+// a thief takes the oldest job (to steal the most work).
+// return NULL if empty
+static struct fskit_executor_job* fskit_executor_worker_pop( struct fskit_executor_worker* worker, bool steal ) {
+   
+   struct fskit_executor_job* job = NULL;
+   
+   pthread_mutex_lock( &worker->lock );
+   
+   if( steal ) {
+      
+      job = worker->head;
+      if( job != NULL ) {
+         
+         worker->head = job->next;
+         if( worker->head != NULL ) {
+            worker->head->prev = NULL;
+         }
+         else {
+            worker->tail = NULL;
+         }
+      }
+   }
+   else {
+      
+      job = worker->tail;
+      if( job != NULL ) {
+         
+         worker->tail = job->prev;
+         if( worker->tail != NULL ) {
+            worker->tail->next = NULL;
+         }
+         else {
+            worker->head = NULL;
+         }
+      }
+   }
+   
+   pthread_mutex_unlock( &worker->lock );
+   
+   return job;
+}
+
+
+// find the next job for a worker: first from its own deque, then from its peers' 
+// return NULL if there is no work anywhere
+static struct fskit_executor_job* fskit_executor_next_job( struct fskit_executor_worker* worker ) {
+   
+   struct fskit_executor* exec = worker->exec;
+   struct fskit_executor_job* job = fskit_executor_worker_pop( worker, false );
+   
+   // (grows while fskit_executor_init is still starting workers)
+   int num_threads = __atomic_load_n( &exec->num_threads, __ATOMIC_ACQUIRE );
+   
+   for( int i = 1; job == NULL && i < num_threads; i++ ) {
+      
+      struct fskit_executor_worker* victim = &exec->workers[ (worker->id + i) % num_threads ];
+      
+      job = fskit_executor_worker_pop( victim, true );
+      if( job != NULL ) {
+         __atomic_fetch_add( &exec->num_stolen, 1, __ATOMIC_RELAXED );
+      }
+   }
+   
+   if( job != NULL ) {
+      
+      pthread_mutex_lock( &exec->lock );
+      exec->pending--;
+      pthread_mutex_unlock( &exec->lock );
+   }
+   
+   return job;
+}
+
+
+// worker thread main loop.
+// runs until the executor is stopped and all queued work has been drained
+static void* fskit_executor_worker_main( void* arg ) {
+   
+   struct fskit_executor_worker* worker = (struct fskit_executor_worker*)arg;
+   struct fskit_executor* exec = worker->exec;
+   
+   fskit_executor_self = worker;
+   
+   while( true ) {
+      
+      struct fskit_executor_job* job = fskit_executor_next_job( worker );
+      
+      if( job == NULL ) {
+         
+         // nothing to do.  wait for more work
+         pthread_mutex_lock( &exec->lock );
+         
+         while( exec->pending <= 0 && exec->running ) {
+            pthread_cond_wait( &exec->cond, &exec->lock );
+         }
+         
+         if( exec->pending <= 0 && !exec->running ) {
+            
+            // drained and stopped 
+            pthread_mutex_unlock( &exec->lock );
+            break;
+         }
+         
+         pthread_mutex_unlock( &exec->lock );
+         continue;
+      }
+      
+      // NOTE: the job may not be referenced once it runs--it may live on the stack of a thread waiting for it
+      fskit_executor_job_func func = job->func;
+      void* job_arg = job->arg;
+      
+      if( job->owned ) {
+         fskit_safe_free( job );
+      }
+      
+      (*func)( job_arg );
+      
+      __atomic_fetch_add( &exec->num_completed, 1, __ATOMIC_RELAXED );
+   }
+   
+   fskit_executor_self = NULL;
+   return NULL;
+}
+
+
+// enqueue a job.
+// jobs submitted by a worker go on its own deque; all others are spread round-robin.
+// return 0 on success 
+// return -EINVAL if the executor is not running 
+static int fskit_executor_enqueue( struct fskit_executor* exec, struct fskit_executor_job* job ) {
+   
+   struct fskit_executor_worker* worker = NULL;
+   
+   if( fskit_executor_self != NULL && fskit_executor_self->exec == exec ) {
+      worker = fskit_executor_self;
+   }
+   else {
+      
+      uint64_t next = __atomic_fetch_add( &exec->next_worker, 1, __ATOMIC_RELAXED );
+      worker = &exec->workers[ next % __atomic_load_n( &exec->num_threads, __ATOMIC_ACQUIRE ) ];
+   }
+   
+   // push while holding lock, so fskit_executor_destroy can't stop the workers between the check and the push
+   pthread_mutex_lock( &exec->lock );
+   
+   if( !exec->running ) {
+      
+      pthread_mutex_unlock( &exec->lock );
+      return -EINVAL;
+   }
+   
+   fskit_executor_worker_push( worker, job );
+   
+   exec->pending++;
+   pthread_cond_signal( &exec->cond );
+   
+   pthread_mutex_unlock( &exec->lock );
+   
+   __atomic_fetch_add( &exec->num_submitted, 1, __ATOMIC_RELAXED );
+   
+   return 0;
+}
+
+
+// allocate an executor 
+struct fskit_executor* fskit_executor_new(void) {
+   return CALLOC_LIST( struct fskit_executor, 1 );
+}
+
+
+// set up an executor and start its worker threads 
+// return 0 on success
+// return -EINVAL if num_threads is not positive
+// return -ENOMEM on OOM 
+// return -errno if we fail to start a thread
+int fskit_executor_init( struct fskit_executor* exec, int num_threads ) {
+   
+   int rc = 0;
+   
+   if( num_threads <= 0 ) {
+      return -EINVAL;
+   }
+   
+   memset( exec, 0, sizeof(struct fskit_executor) );
+   
+   exec->workers = CALLOC_LIST( struct fskit_executor_worker, num_threads );
+   if( exec->workers == NULL ) {
+      return -ENOMEM;
+   }
+   
+   pthread_mutex_init( &exec->lock, NULL );
+   pthread_cond_init( &exec->cond, NULL );
+   
+   exec->running = true;
+   
+   for( int i = 0; i < num_threads; i++ ) {
+      
+      exec->workers[i].exec = exec;
+      exec->workers[i].id = i;
+      pthread_mutex_init( &exec->workers[i].lock, NULL );
+   }
+   
+   for( int i = 0; i < num_threads; i++ ) {
+      
+      rc = pthread_create( &exec->workers[i].thread, NULL, fskit_executor_worker_main, &exec->workers[i] );
+      if( rc != 0 ) {
+         
+         fskit_error("pthread_create rc = %d\n", rc );
+         
+         // stop the ones we started 
+         __atomic_store_n( &exec->num_threads, i, __ATOMIC_RELEASE );
+         fskit_executor_destroy( exec );
+         return -rc;
+      }
+      
+      // workers only look at peers that have been started 
+      __atomic_store_n( &exec->num_threads, i + 1, __ATOMIC_RELEASE );
+   }
+   
+   return 0;
+}
+
+
+// stop an executor: run all outstanding jobs, join the worker threads, and free its memory.
+// the caller must free exec itself.
+// return 0 on success
+int fskit_executor_destroy( struct fskit_executor* exec ) {
+   
+   if( exec->workers == NULL ) {
+      return 0;
+   }
+   
+   pthread_mutex_lock( &exec->lock );
+   
+   exec->running = false;
+   pthread_cond_broadcast( &exec->cond );
+   
+   pthread_mutex_unlock( &exec->lock );
+   
+   for( int i = 0; i < exec->num_threads; i++ ) {
+      pthread_join( exec->workers[i].thread, NULL );
+   }
+   
+   for( int i = 0; i < exec->num_threads; i++ ) {
+      pthread_mutex_destroy( &exec->workers[i].lock );
+   }
+   
+   pthread_mutex_destroy( &exec->lock );
+   pthread_cond_destroy( &exec->cond );
+   
+   fskit_safe_free( exec->workers );
+   
+   memset( exec, 0, sizeof(struct fskit_executor) );
+   return 0;
+}
+
+
+// run func(arg) asynchronously on the executor
+// return 0 on success
+// return -ENOMEM on OOM 
+// return -EINVAL if the executor is not running
+int fskit_executor_submit( struct fskit_executor* exec, fskit_executor_job_func func, void* arg ) {
+   
+   int rc = 0;
+   struct fskit_executor_job* job = CALLOC_LIST( struct fskit_executor_job, 1 );
+   if( job == NULL ) {
+      return -ENOMEM;
+   }
+   
+   job->func = func;
+   job->arg = arg;
+   job->owned = true;
+   
+   rc = fskit_executor_enqueue( exec, job );
+   if( rc != 0 ) {
+      fskit_safe_free( job );
+   }
+   
+   return rc;
+}
+
+
+// run a synchronous call's function, and wake up the caller 
+static void fskit_executor_call_main( void* arg ) {
+   
+   struct fskit_executor_call_ctx* ctx = (struct fskit_executor_call_ctx*)arg;
+   
+   (*ctx->func)( ctx->arg );
+   
+   pthread_mutex_lock( &ctx->lock );
+   
+   ctx->done = true;
+   pthread_cond_signal( &ctx->cond );
+   
+   pthread_mutex_unlock( &ctx->lock );
+}
+
+
+// run func(arg) on the executor, and wait for it to finish.
+// if called from one of exec's own workers, func is run inline so a job can never wait on the pool it is occupying.
+// does not allocate.
+// return 0 on success 
+// return -EINVAL if the executor is not running
+int fskit_executor_call( struct fskit_executor* exec, fskit_executor_job_func func, void* arg ) {
+   
+   int rc = 0;
+   struct fskit_executor_call_ctx ctx;
+   struct fskit_executor_job job;
+   
+   if( fskit_executor_self != NULL && fskit_executor_self->exec == exec ) {
+      
+      (*func)( arg );
+      return 0;
+   }
+   
+   memset( &ctx, 0, sizeof(struct fskit_executor_call_ctx) );
+   memset( &job, 0, sizeof(struct fskit_executor_job) );
+   
+   ctx.func = func;
+   ctx.arg = arg;
+   pthread_mutex_init( &ctx.lock, NULL );
+   pthread_cond_init( &ctx.cond, NULL );
+   
+   job.func = fskit_executor_call_main;
+   job.arg = &ctx;
+   
+   rc = fskit_executor_enqueue( exec, &job );
+   if( rc == 0 ) {
+      
+      pthread_mutex_lock( &ctx.lock );
+      
+      while( !ctx.done ) {
+         pthread_cond_wait( &ctx.cond, &ctx.lock );
+      }
+      
+      pthread_mutex_unlock( &ctx.lock );
+   }
+   
+   pthread_mutex_destroy( &ctx.lock );
+   pthread_cond_destroy( &ctx.cond );
+   
+   return rc;
+}
+
+
+// get a snapshot of the executor's counters 
+// return 0 on success
+int fskit_executor_get_stats( struct fskit_executor* exec, struct fskit_executor_stats* stats ) {
+   
+   memset( stats, 0, sizeof(struct fskit_executor_stats) );
+   
+   stats->num_threads = exec->num_threads;
+   stats->num_submitted = __atomic_load_n( &exec->num_submitted, __ATOMIC_RELAXED );
+   stats->num_completed = __atomic_load_n( &exec->num_completed, __ATOMIC_RELAXED );
+   stats->num_stolen = __atomic_load_n( &exec->num_stolen, __ATOMIC_RELAXED );
+   
+   pthread_mutex_lock( &exec->lock );
+   stats->queue_depth = exec->pending;
+   pthread_mutex_unlock( &exec->lock );
+   
+   if( stats->queue_depth < 0 ) {
+      stats->queue_depth = 0;
+   }
+   
+   return 0;
+}
@@ -113,7 +113,7 @@ int fskit_link( struct fskit_core* core, char const* from, char const* to, uint6
    }
 
    // does the requested child exist in the parent of 'to'?
-   to_fent = fskit_entry_set_find_name( to_parent_fent->children, to_child );
+   to_fent = fskit_dir_find_by_name( to_parent_fent, to_child );
    if( to_fent != NULL ) {
 
       // exists
@@ -61,18 +61,52 @@ int fskit_run_user_mkdir( struct fskit_core* core, char const* path, struct fski
 }
 
 
+// mkdir-route adapter for fskit_entry_create_reserved
+struct fskit_mkdir_route_args {
+
+   mode_t mode;
+   void* cls;
+};
+
+static int fskit_mkdir_route( struct fskit_core* core, char const* path, struct fskit_entry* parent, struct fskit_entry* child, void* route_cls ) {
+
+   struct fskit_mkdir_route_args* args = (struct fskit_mkdir_route_args*)route_cls;
+   void* app_dir_data = NULL;
+   int rc = 0;
+
+   rc = fskit_run_user_mkdir( core, path, parent, child, args->mode, args->cls, &app_dir_data );
+   if( rc != 0 ) {
+      return rc;
+   }
+
+   fskit_entry_set_user_data( child, app_dir_data );
+   return 0;
+}
+
+
 // low-level mkdir: create a child and insert it into the parent.
 // parent must be a directory
-// parent must be write-locked
+// parent must be write-locked, but it will be unlocked while the mkdir route runs (see fskit_entry_create_reserved, including for *parent_pinned)
+// set *busy if another thread is still creating an entry with the same name
 // return -EEXIST if an entry with the given name (path_basename) already exists in parent.
 // return -EIO if we couldn't allocate an inode
 // return -ENOMEM if we couldn't allocate memory
-static int fskit_mkdir_lowlevel( struct fskit_core* core, char const* path, struct fskit_entry* parent, char const* path_basename, mode_t mode, uint64_t user, uint64_t group, void* cls ) {
+static int fskit_mkdir_lowlevel( struct fskit_core* core, char const* path, struct fskit_entry* parent, char const* path_basename, mode_t mode, uint64_t user, uint64_t group, void* cls, bool* busy, bool* parent_pinned ) {
 
    // resolve the child within the parent
-   struct fskit_entry* child = fskit_entry_set_find_name( parent->children, path_basename );
+   struct fskit_entry* child = fskit_dir_find_by_name( parent, path_basename );
    int err = 0;
-   void* app_dir_data = NULL;
+   struct fskit_mkdir_route_args args;
+
+   *busy = false;
+   *parent_pinned = false;
+
+   if( child != NULL && child->creating ) {
+
+      // not ours to decide yet
+      *busy = true;
+      return 0;
+   }
 
    if( child != NULL ) {
 
@@ -116,20 +150,8 @@ static int fskit_mkdir_lowlevel( struct fskit_core* core, char const* path, stru
          return -ENOMEM;
       }
 
-      // get an inode for this child
-      uint64_t child_inode = fskit_core_inode_alloc( core, parent, child );
-      if( child_inode == 0 ) {
-
-         // error in allocation
-         fskit_error("fskit_core_inode_alloc(%s) failed\n", path );
-
-         fskit_safe_free( child );
-
-         return -EIO;
-      }
-      
-      // set up the directory
-      err = fskit_entry_init_dir( child, parent, child_inode, user, group, mode );
+      // set up the directory.  It gets its inode number once its name is reserved.
+      err = fskit_entry_init_dir( child, parent, 0, user, group, mode );
       if( err != 0 ) {
          fskit_error("fskit_entry_init_dir(%s) rc = %d\n", path, err );
 
@@ -137,29 +159,11 @@ static int fskit_mkdir_lowlevel( struct fskit_core* core, char const* path, stru
          return err;
       }
 
-      // reference this directory, so it won't disappear during the user's route
-      child->open_count++;
-      
-      // almost done.  run the route callback for this path if needed
-      err = fskit_run_user_mkdir( core, path, parent, child, mode, cls, &app_dir_data );
-      
-      child->open_count--;
-      
-      if( err != 0 ) {
-
-         // user route failed
-         fskit_error("fskit_run_user_mkdir(%s) rc = %d\n", path, err );
+      // reserve the name, run the route callback for this path if needed, and attach for real
+      args.mode = mode;
+      args.cls = cls;
 
-         fskit_entry_destroy( core, child, false );
-         fskit_safe_free( child );
-      }
-      else {
-
-         fskit_entry_set_user_data( child, app_dir_data );
-
-         // attach to parent
-         fskit_entry_attach_lowlevel( parent, child, path_basename );
-      }
+      err = fskit_entry_create_reserved( core, path, parent, NULL, path_basename, child, fskit_mkdir_route, &args, parent_pinned );
    }
 
    else {
@@ -172,38 +176,32 @@ static int fskit_mkdir_lowlevel( struct fskit_core* core, char const* path, stru
 }
 
 
-// create a directory
+// create a directory, unless another thread is in the middle of creating the same name (in which case, set *busy)
 // return -ENOTDIR if one of the elements on the path isn't a directory
 // return -EACCES if one of the directories is not searchable
-int fskit_mkdir_ex( struct fskit_core* core, char const* path, mode_t mode, uint64_t user, uint64_t group, void* cls ) {
+static int fskit_mkdir_once( struct fskit_core* core, char const* path, mode_t mode, uint64_t user, uint64_t group, void* cls, bool* busy ) {
 
    int err = 0;
+   bool parent_pinned = false;
 
-   size_t basename_len = fskit_basename_len( path );
-   if( basename_len > FSKIT_FILESYSTEM_NAMEMAX ) {
+   *busy = false;
 
-      return -ENAMETOOLONG;
-   }
-
-   // resolve the parent of this child (and write-lock it)
-   char* fpath = strdup( path );
-   fskit_sanitize_path( fpath );
+   char path_basename[FSKIT_FILESYSTEM_NAMEMAX+1];
+   size_t basename_len = 0;
+   char const* base = fskit_basename_view( path, &basename_len );
 
-   char* path_dirname = fskit_dirname( fpath, NULL );
-   char* path_basename = fskit_basename( fpath, NULL );
-
-   fskit_sanitize_path( path_dirname );
+   err = fskit_path_name_copy( base, basename_len, path_basename );
+   if( err != 0 ) {
 
-   fskit_safe_free( fpath );
+      return err;
+   }
 
-   struct fskit_entry* parent = fskit_entry_resolve_path( core, path_dirname, user, group, true, &err );
+   // resolve the parent of this child (and write-lock it)
+   struct fskit_entry* parent = fskit_entry_resolve_dir( core, path, user, group, true, &err );
 
    if( parent == NULL || err ) {
 
       // parent not found
-      fskit_safe_free( path_basename );
-      fskit_safe_free( path_dirname );
-
       // err is set appropriately
       return err;
    }
@@ -212,8 +210,6 @@ int fskit_mkdir_ex( struct fskit_core* core, char const* path, mode_t mode, uint
 
       // parent is not a directory
       fskit_entry_unlock( parent );
-      fskit_safe_free( path_basename );
-      fskit_safe_free( path_dirname );
 
       return -ENOTDIR;
    }
@@ -221,16 +217,14 @@ int fskit_mkdir_ex( struct fskit_core* core, char const* path, mode_t mode, uint
    if( !FSKIT_ENTRY_IS_WRITEABLE(parent->mode, parent->owner, parent->group, user, group) ) {
 
       // parent is not writeable
-      fskit_error( "%s is not writable by %" PRIu64 " (%o, %" PRIu64 ", %" PRIu64 ", %" PRIu64 ", %" PRIu64 ")\n", path_dirname, user, parent->mode, parent->owner, parent->group, user, group );
+      fskit_error( "parent of %s is not writable by %" PRIu64 " (%o, %" PRIu64 ", %" PRIu64 ", %" PRIu64 ", %" PRIu64 ")\n", path, user, parent->mode, parent->owner, parent->group, user, group );
 
       fskit_entry_unlock( parent );
-      fskit_safe_free( path_basename );
-      fskit_safe_free( path_dirname );
 
       return -EACCES;
    }
 
-   err = fskit_mkdir_lowlevel( core, path, parent, path_basename, mode, user, group, cls );
+   err = fskit_mkdir_lowlevel( core, path, parent, path_basename, mode, user, group, cls, busy, &parent_pinned );
 
    if( err != 0 ) {
       fskit_error( "fskit_entry_mkdir_lowlevel(%s) rc = %d\n", path, err );
@@ -238,13 +232,314 @@ int fskit_mkdir_ex( struct fskit_core* core, char const* path, mode_t mode, uint
 
    // clean up
    fskit_entry_unlock( parent );
-   fskit_safe_free( path_basename );
-   fskit_safe_free( path_dirname );
+
+   if( parent_pinned ) {
+      fskit_entry_unref( core, NULL, parent );
+   }
 
    return err;
 }
 
 
+// create a directory
+// return -ENOTDIR if one of the elements on the path isn't a directory
+// return -EACCES if one of the directories is not searchable
+int fskit_mkdir_ex( struct fskit_core* core, char const* path, mode_t mode, uint64_t user, uint64_t group, void* cls ) {
+
+   int err = 0;
+   bool busy = false;
+
+   do {
+
+      err = fskit_mkdir_once( core, path, mode, user, group, cls, &busy );
+      if( busy ) {
+
+         // someone else is creating this name; wait to see whether or not it succeeds
+         sched_yield();
+      }
+
+   } while( busy );
+
+   return err;
+}
+
+
+// trade the lock on a directory met by fskit_entry_mkdir_parents for a write lock, yielding in between if asked.
+// dir_path[0..dir_path_len) is the directory's path, in case it was removed while unlocked and must be destroyed.
+// return 0 on success, in which case dir is write-locked
+// return -ENOENT if dir was removed while unlocked, in which case it is no longer locked
+static int fskit_mkdir_parents_relock( struct fskit_core* core, char const* dir_path, size_t dir_path_len, struct fskit_entry* dir, bool yield ) {
+
+   char* path = NULL;
+   int rc = 0;
+
+   // pin it while it's unlocked
+   fskit_entry_ref_entry( dir );
+   fskit_entry_unlock( dir );
+
+   if( yield ) {
+      sched_yield();
+   }
+
+   fskit_entry_wlock( dir );
+
+   if( fskit_entry_get_link_count( dir ) > 0 && dir->type != FSKIT_ENTRY_TYPE_DEAD && !dir->deletion_in_progress ) {
+
+      // still here, and still linked, so this isn't the last reference
+      __atomic_sub_fetch( &dir->open_count, 1, __ATOMIC_ACQ_REL );
+      return 0;
+   }
+
+   // removed in the meantime
+   fskit_entry_unlock( dir );
+
+   path = dir_path_len > 0 ? strndup( dir_path, dir_path_len ) : strdup( "/" );
+   if( path == NULL ) {
+
+      // can't destroy it by path; leak it rather than crash
+      return -ENOENT;
+   }
+
+   rc = fskit_entry_unref( core, path, dir );
+   if( rc != 0 ) {
+      fskit_error("fskit_entry_unref(%s) rc = %d\n", path, rc );
+   }
+
+   fskit_safe_free( path );
+   return -ENOENT;
+}
+
+
+// walk path[0..path_len) from the root, making each directory that is missing along the way.
+// Directories are made with mode (plus u+wx for all but the last, so the walk can go on), and cls is passed to their mkdir routes.
+// Entries are read-locked hand-over-hand; only a directory that a missing name is made in gets write-locked, and only while it is.
+// If parent_lookup is set, the directory at the end is locked as by fskit_entry_resolve_path_parent; otherwise, it is read- or write-locked.
+// return the locked directory at the end of path on success
+// return NULL on error, and set *err:
+//   -ENOTDIR if an entry along the path is not a directory, or -EEXIST if the last one isn't
+//   -EACCES if a directory can't be searched, or can't be written when a name must be made in it
+//   -ENOENT if a directory was removed during the walk
+//   -ENAMETOOLONG if a name is too long, -ENOMEM on OOM, or the mkdir route's error
+struct fskit_entry* fskit_entry_mkdir_parents( struct fskit_core* core, char const* path, size_t path_len, mode_t mode, uint64_t user, uint64_t group, void* cls, bool parent_lookup, int* err ) {
+
+   char name[FSKIT_FILESYSTEM_NAMEMAX+1];
+   struct fskit_path_cursor names;
+   char* child_path = NULL;
+   size_t cur_len = 0;          // cur's path is path[0..cur_len)
+   bool last = false;
+   bool busy = false;
+   bool pinned = false;
+   bool wlocked = false;
+   bool made = false;
+   int rc = 0;
+   struct fskit_entry* cur = NULL;
+   struct fskit_entry* child = NULL;
+   struct fskit_dir_shard* shard = NULL;
+
+   cur = fskit_core_resolve_root( core, false );
+   if( fskit_entry_get_link_count( cur ) == 0 || cur->type == FSKIT_ENTRY_TYPE_DEAD ) {
+
+      // filesystem was nuked
+      fskit_entry_unlock( cur );
+      *err = -ENOENT;
+      return NULL;
+   }
+
+   fskit_path_cursor_init( &names, path, path_len );
+
+   // cur is write-locked only while the current name is being made in it, so stay on that name until we descend
+   while( wlocked || fskit_path_cursor_next( &names ) ) {
+
+      rc = fskit_path_name_copy( names.name, names.len, name );
+      if( rc != 0 ) {
+         break;
+      }
+
+      last = fskit_path_cursor_last( &names );
+
+      if( cur->type != FSKIT_ENTRY_TYPE_DIR ) {
+         rc = -ENOTDIR;
+         break;
+      }
+
+      if( !FSKIT_ENTRY_IS_DIR_SEARCHABLE( cur->mode, cur->owner, cur->group, user, group ) ) {
+         rc = -EACCES;
+         break;
+      }
+
+      // hold the name's shard (if any) until the child is locked, so a shard writer can't remove it under us
+      shard = fskit_entry_dir_shard_rlock( cur, name );
+      child = fskit_dir_find_by_name( cur, name );
+
+      if( child != NULL && !child->creating && !child->deletion_in_progress && child->type != FSKIT_ENTRY_TYPE_DEAD ) {
+
+         if( child->type != FSKIT_ENTRY_TYPE_DIR ) {
+
+            fskit_entry_dir_shard_unlock( shard );
+            rc = last ? -EEXIST : -ENOTDIR;
+            break;
+         }
+
+         // descend
+         fskit_entry_rlock( child );
+         fskit_entry_dir_shard_unlock( shard );
+
+         if( fskit_entry_get_link_count( child ) == 0 || child->type == FSKIT_ENTRY_TYPE_DEAD || child->deletion_in_progress ) {
+
+            // just got removed
+            fskit_entry_unlock( child );
+            rc = -ENOENT;
+            break;
+         }
+
+         fskit_entry_unlock( cur );
+
+         cur = child;
+         cur_len = fskit_path_cursor_offset( &names );
+         wlocked = false;
+         made = false;
+         continue;
+      }
+
+      // missing, or reserved by another create, or on its way out
+      busy = ( child != NULL && child->creating );
+      fskit_entry_dir_shard_unlock( shard );
+
+      if( !wlocked || busy ) {
+
+         // write-lock cur (waiting out the other create, if need be) and look again
+         rc = fskit_mkdir_parents_relock( core, path, cur_len, cur, busy );
+         if( rc != 0 ) {
+            cur = NULL;
+            break;
+         }
+
+         wlocked = true;
+         continue;
+      }
+
+      if( made ) {
+
+         // mkdir found an entry here that can't be garbage-collected yet
+         rc = -EEXIST;
+         break;
+      }
+
+      if( !FSKIT_ENTRY_IS_WRITEABLE( cur->mode, cur->owner, cur->group, user, group ) ) {
+         rc = -EACCES;
+         break;
+      }
+
+      child_path = strndup( path, fskit_path_cursor_offset( &names ) );
+      if( child_path == NULL ) {
+         rc = -ENOMEM;
+         break;
+      }
+
+      rc = fskit_mkdir_lowlevel( core, child_path, cur, name, last ? mode : (mode | S_IWUSR | S_IXUSR), user, group, cls, &busy, &pinned );
+
+      fskit_safe_free( child_path );
+
+      if( pinned ) {
+
+         // cur got torn down while the route ran
+         fskit_entry_unlock( cur );
+         child_path = cur_len > 0 ? strndup( path, cur_len ) : strdup( "/" );
+         if( child_path != NULL ) {
+
+            fskit_entry_unref( core, child_path, cur );
+            fskit_safe_free( child_path );
+         }
+
+         cur = NULL;
+         rc = -ENOENT;
+         break;
+      }
+
+      if( rc != 0 && rc != -EEXIST ) {
+
+         fskit_error("fskit_mkdir_lowlevel(%s) rc = %d\n", path, rc );
+         break;
+      }
+
+      // made (by us or someone else); look it up again, with cur still write-locked
+      rc = 0;
+      made = true;
+   }
+
+   if( rc == 0 && parent_lookup && !wlocked && __atomic_load_n( &cur->shards, __ATOMIC_ACQUIRE ) == NULL ) {
+
+      rc = fskit_mkdir_parents_relock( core, path, cur_len, cur, false );
+      if( rc != 0 ) {
+         cur = NULL;
+      }
+   }
+
+   if( rc != 0 ) {
+
+      if( cur != NULL ) {
+         fskit_entry_unlock( cur );
+      }
+
+      *err = rc;
+      return NULL;
+   }
+
+   *err = 0;
+   return cur;
+}
+
+
+// create a directory and any of its parents that are missing, as by `mkdir -p`.
+// the parents get mode plus u+wx; the directory itself gets mode.  cls is passed to each mkdir route.
+// return 0 on success, including if the directory already exists
+// return -EEXIST if path or one of its parents exists but is not a directory (-ENOTDIR for a parent)
+// return -EACCES if a directory on the path can't be searched, or can't be written when a name must be made in it
+int fskit_mkdir_p_ex( struct fskit_core* core, char const* path, mode_t mode, uint64_t user, uint64_t group, void* cls ) {
+
+   int err = 0;
+   struct fskit_entry* dir = fskit_entry_mkdir_parents( core, path, strlen(path), mode, user, group, cls, false, &err );
+
+   if( dir == NULL ) {
+      return err;
+   }
+
+   fskit_entry_unlock( dir );
+   return 0;
+}
+
+
+// like fskit_mkdir_p_ex, but with a NULL cls
+int fskit_mkdir_p( struct fskit_core* core, char const* path, mode_t mode, uint64_t user, uint64_t group ) {
+   return fskit_mkdir_p_ex( core, path, mode, user, group, NULL );
+}
+
+
+// per-child route for fskit_mkdir_many
+static int fskit_mkdir_many_route( struct fskit_core* core, char const* path, struct fskit_entry* parent, struct fskit_entry* child, void* route_cls ) {
+
+   struct fskit_create_spec const* spec = (struct fskit_create_spec const*)route_cls;
+   struct fskit_mkdir_route_args args;
+
+   args.mode = spec->mode;
+   args.cls = NULL;
+
+   return fskit_mkdir_route( core, path, parent, child, &args );
+}
+
+
+// create many directories in one directory, as if by fskit_mkdir on each, but resolving and locking the parent once.
+// If a create_many route matches dir_path, it is called once for the whole batch; otherwise, each directory's mkdir route is called.
+// If rcs is not NULL, rcs[i] is set to the result for specs[i] (see fskit_entry_create_many).
+// return the number of directories created on success
+// return -ENOTDIR, -EACCES, or a path resolution error if the parent can't be created in
+// return -ENOMEM on OOM
+int fskit_mkdir_many( struct fskit_core* core, char const* dir_path, uint64_t user, uint64_t group, struct fskit_create_spec const* specs, size_t num_specs, int* rcs ) {
+
+   return fskit_entry_create_many( core, dir_path, user, group, specs, num_specs, rcs, FSKIT_ENTRY_TYPE_DIR, fskit_mkdir_many_route );
+}
+
+
 // like fskit_mkdir_ex, but with a NULL cls 
 int fskit_mkdir( struct fskit_core* core, char const* path, mode_t mode, uint64_t user, uint64_t group ) {
    return fskit_mkdir_ex( core, path, mode, user, group, NULL );
@@ -61,28 +61,60 @@ int fskit_run_user_mknod( struct fskit_core* core, char const* path, struct fski
 }
 
 
-// make a node
-int fskit_mknod_ex( struct fskit_core* core, char const* fs_path, mode_t mode, dev_t dev, uint64_t user, uint64_t group, void* cls ) {
+// mknod-route adapter for fskit_entry_create_reserved
+struct fskit_mknod_route_args {
 
-   int err = 0;
+   mode_t mode;
+   dev_t dev;
+   void* cls;
+};
+
+static int fskit_mknod_route( struct fskit_core* core, char const* path, struct fskit_entry* parent, struct fskit_entry* child, void* route_cls ) {
+
+   struct fskit_mknod_route_args* args = (struct fskit_mknod_route_args*)route_cls;
    void* inode_data = NULL;
+   int rc = 0;
+
+   rc = fskit_run_user_mknod( core, path, parent, child, args->mode, args->dev, args->cls, &inode_data );
+   if( rc != 0 ) {
+      return rc;
+   }
+
+   fskit_entry_set_user_data( child, inode_data );
+   return 0;
+}
+
+
+// make a node, unless another thread is in the middle of creating the same name (in which case, set *busy)
+static int fskit_mknod_once( struct fskit_core* core, char const* fs_path, mode_t mode, dev_t dev, uint64_t user, uint64_t group, void* cls, bool* busy ) {
+
+   int err = 0;
    struct fskit_entry* child = NULL;
+   struct fskit_mknod_route_args args;
+   bool parent_pinned = false;
+
+   *busy = false;
 
    // sanity check
-   size_t basename_len = fskit_basename_len( fs_path );
-   if( basename_len > FSKIT_FILESYSTEM_NAMEMAX ) {
+   char path_basename[FSKIT_FILESYSTEM_NAMEMAX+1];
+   size_t basename_len = 0;
+   char const* base = fskit_basename_view( fs_path, &basename_len );
+
+   err = fskit_path_name_copy( base, basename_len, path_basename );
+   if( err != 0 ) {
 
-      return -ENAMETOOLONG;
+      return err;
    }
 
    char* path = strdup( fs_path );
+   if( path == NULL ) {
+      return -ENOMEM;
+   }
+
    fskit_sanitize_path( path );
 
    // get the parent directory and lock it
-   char* path_dirname = fskit_dirname( path, NULL );
-   struct fskit_entry* parent = fskit_entry_resolve_path( core, path_dirname, user, group, true, &err );
-
-   fskit_safe_free( path_dirname );
+   struct fskit_entry* parent = fskit_entry_resolve_dir( core, path, user, group, true, &err );
 
    if( err != 0 || parent == NULL ) {
 
@@ -104,9 +136,17 @@ int fskit_mknod_ex( struct fskit_core* core, char const* fs_path, mode_t mode, d
       return -EACCES;
    }
 
-   char* path_basename = fskit_basename( path, NULL );
+   child = fskit_dir_find_by_name( parent, path_basename );
+
+   if( child != NULL && child->creating ) {
 
-   child = fskit_entry_set_find_name( parent->children, path_basename );
+      // not ours to decide yet
+      fskit_entry_unlock( parent );
+      fskit_safe_free( path );
+
+      *busy = true;
+      return 0;
+   }
 
    if( child != NULL ) {
 
@@ -195,7 +235,6 @@ int fskit_mknod_ex( struct fskit_core* core, char const* fs_path, mode_t mode, d
       fskit_error("Invalid/unsupported mode %o\n", mode );
 
       fskit_entry_unlock( parent );
-      fskit_safe_free( path_basename );
       fskit_entry_destroy( core, child, false );
       fskit_safe_free( child );
       fskit_safe_free( path );
@@ -205,62 +244,47 @@ int fskit_mknod_ex( struct fskit_core* core, char const* fs_path, mode_t mode, d
 
    if( err == 0 ) {
 
-      // success! get the inode number
-      uint64_t file_id = fskit_core_inode_alloc( core, parent, child );
-      if( file_id == 0 ) {
+      // reserve the name, perform any user-defined creations, and attach for real
+      args.mode = mode;
+      args.dev = dev;
+      args.cls = cls;
 
-         fskit_error("fskit_core_inode_alloc(%s) failed\n", path );
+      err = fskit_entry_create_reserved( core, path, parent, NULL, path_basename, child, fskit_mknod_route, &args, &parent_pinned );
+   }
+   else {
+      fskit_error("%s(%s) rc = %d\n", method_name, path, err );
+      fskit_entry_destroy( core, child, false );
+      fskit_safe_free( child );
+   }
 
-         fskit_entry_unlock( parent );
-         fskit_safe_free( path_basename );
-         fskit_entry_destroy( core, child, false );
-         fskit_safe_free( child );
-         fskit_safe_free( path );
+   fskit_entry_unlock( parent );
 
-         return -EIO;
-      }
+   if( parent_pinned ) {
+      fskit_entry_unref( core, NULL, parent );
+   }
 
-      child->file_id = file_id;
-      
-      // reference, so it won't disappear
-      child->open_count++;
+   fskit_safe_free( path );
 
-      // perform any user-defined creations
-      err = fskit_run_user_mknod( core, path, parent, child, mode, dev, cls, &inode_data );
-      
-      child->open_count--;
-      
-      if( err != 0 ) {
+   return err;
+}
 
-         // failed. abort creation
-         fskit_error("fskit_run_user_mknod(%s) rc = %d\n", path, err );
 
-         fskit_entry_unlock( parent );
-         fskit_safe_free( path_basename );
-         fskit_entry_destroy( core, child, true );
-         fskit_safe_free( child );
-         fskit_safe_free( path );
+// make a node
+int fskit_mknod_ex( struct fskit_core* core, char const* fs_path, mode_t mode, dev_t dev, uint64_t user, uint64_t group, void* cls ) {
 
-         return err;
-      }
+   int err = 0;
+   bool busy = false;
 
-      fskit_entry_wlock( child );
-      
-      // attach the file
-      fskit_entry_attach_lowlevel( parent, child, path_basename );
+   do {
 
-      fskit_entry_unlock( child );
-   }
-   else {
-      fskit_error("%s(%s) rc = %d\n", method_name, path, err );
-      fskit_entry_destroy( core, child, false );
-      fskit_safe_free( child );
-   }
+      err = fskit_mknod_once( core, fs_path, mode, dev, user, group, cls, &busy );
+      if( busy ) {
 
-   fskit_entry_unlock( parent );
+         // someone else is creating this name; wait to see whether or not it succeeds
+         sched_yield();
+      }
 
-   fskit_safe_free( path_basename );
-   fskit_safe_free( path );
+   } while( busy );
 
    return err;
 }
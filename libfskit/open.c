@@ -41,11 +41,15 @@ static struct fskit_file_handle* fskit_file_handle_create( struct fskit_core* co
 
    fh->fent = ent;
    fh->file_id = ent->file_id;
-   fh->path = strdup( opened_path );
    fh->flags = flags;
    fh->app_data = handle_data;
 
    pthread_rwlock_init( &fh->lock, NULL );
+   pthread_mutex_init( &fh->drain_lock, NULL );
+   pthread_cond_init( &fh->drain_cond, NULL );
+
+   // resolve I/O routes once, up front.  On failure, they get resolved on first use.
+   fskit_file_handle_pin_routes( core, fh, opened_path );
 
    return fh;
 }
@@ -129,19 +133,30 @@ static int fskit_do_parent_check( struct fskit_entry* parent, int flags, uint64_
 }
 
 
+// mode for the directories made by an open with FSKIT_O_MKPARENTS:
+// the file's permission bits, searchable wherever they are readable, and always owner-writable and -searchable
+static mode_t fskit_open_parent_mode( mode_t mode ) {
+
+   mode &= 0777;
+   return mode | ((mode & 0444) >> 2) | S_IWUSR | S_IXUSR;
+}
+
+
 // do a file open
 // child must *not* be locked.
-// parent must be write-locked, but it will be unlocked and re-locked.  The child will be referenced during that time, so the parent is guaranteed not to disappear
+// parent must be write-locked (or, if sharded, read-locked with the child's shard write-locked), but it will be unlocked and re-locked.
+// The child will be referenced during that time, so the parent is guaranteed not to disappear
 // on success, fill in the handle data
-int fskit_do_open( struct fskit_core* core, char const* path, struct fskit_entry* parent, struct fskit_entry* child, int flags, uint64_t user, uint64_t group, void** handle_data ) {
+int fskit_do_open( struct fskit_core* core, char const* path, struct fskit_entry* parent, struct fskit_dir_shard* shard, struct fskit_entry* child, int flags, uint64_t user, uint64_t group, void** handle_data ) {
 
    int rc = 0;
 
-   // block other processes so we can do access checks
-   fskit_entry_wlock( child );
+   // block writers so we can do access checks.
+   // a read lock suffices to take a reference, since it keeps fskit_entry_try_destroy out.
+   fskit_entry_rlock( child );
    
    // sanity check
-   if( child->link_count == 0 || child->deletion_in_progress || child->type == FSKIT_ENTRY_TYPE_DEAD ) {
+   if( fskit_entry_get_link_count( child ) == 0 || child->deletion_in_progress || child->type == FSKIT_ENTRY_TYPE_DEAD ) {
       rc = -ENOENT;
    }
 
@@ -176,13 +191,13 @@ int fskit_do_open( struct fskit_core* core, char const* path, struct fskit_entry
    }
    
    // safe to allow access to the child while the user route is running, since the child (and thus the parent) can't get unlinked
-   fskit_entry_unlock( parent );
+   fskit_entry_dir_unlock( parent, shard );
    
    // open will succeed according to fskit.  invoke the user callback to generate handle data
    rc = fskit_run_user_open( core, path, child, flags, handle_data );
    
    // reaquire...
-   fskit_entry_wlock( parent );
+   fskit_entry_dir_relock( parent, shard );
    
    if( rc != 0 ) {
       fskit_error("fskit_run_user_open(%s) rc = %d\n", path, rc );
@@ -194,76 +209,101 @@ int fskit_do_open( struct fskit_core* core, char const* path, struct fskit_entry
 }
 
 
-// create/open a file, with the given flags and (if creating) mode
+// create/open a file, with the given flags and (if creating) mode, unless another thread is in the middle of creating it (in which case, set *busy)
 // on success, return a file handle to the created/opened file.
 // on failure, return NULL and set *err to the appropriate errno
-struct fskit_file_handle* fskit_open_ex( struct fskit_core* core, char const* _path, uint64_t user, uint64_t group, int flags, mode_t mode, void* cls, int* err ) {
-
-   if( fskit_check_flags( flags ) != 0 ) {
-      *err = -EINVAL;
-      return NULL;
-   }
+static struct fskit_file_handle* fskit_open_once( struct fskit_core* core, char const* _path, uint64_t user, uint64_t group, int flags, mode_t mode, void* cls, int* err, bool* busy ) {
 
    int rc = 0;
+   bool parent_pinned = false;
 
-   char* path = strdup(_path);
+   *busy = false;
 
-   if( path == NULL ) {
-      *err = -ENOMEM;
-      return NULL;
+   // only copy the path if it must be sanitized
+   char* path_copy = NULL;
+   char const* path = _path;
+   size_t path_len = strlen(_path);
+
+   if( path_len > 1 && _path[path_len - 1] == '/' ) {
+
+      path_copy = strdup( _path );
+      if( path_copy == NULL ) {
+         *err = -ENOMEM;
+         return NULL;
+      }
+
+      fskit_sanitize_path( path_copy );
+      path = path_copy;
    }
 
-   fskit_sanitize_path( path );
+   char path_basename[FSKIT_FILESYSTEM_NAMEMAX + 1];
+   size_t basename_len = 0;
+   char const* base = fskit_basename_view( path, &basename_len );
 
-   size_t basename_len = fskit_basename_len( path );
-   if( basename_len > FSKIT_FILESYSTEM_NAMEMAX ) {
+   rc = fskit_path_name_copy( base, basename_len, path_basename );
+   if( rc != 0 ) {
 
-      free( path );
-      *err = -ENAMETOOLONG;
+      fskit_safe_free( path_copy );
+      *err = rc;
 
       return NULL;
    }
 
    void* handle_data = NULL;
 
-   // resolve the parent of this child (and write-lock it)
-   char* path_dirname = fskit_dirname( path, NULL );
-   char path_basename[FSKIT_FILESYSTEM_NAMEMAX + 1];
+   struct fskit_file_handle* ret = NULL;
 
-   memset( path_basename, 0, FSKIT_FILESYSTEM_NAMEMAX + 1 );
+   // write-lock parent (or just the child's shard, if it is sharded)--we need to ensure that the child does not disappear on us between attaching it and routing the user-given callback
+   struct fskit_entry* parent = NULL;
 
-   fskit_basename( path, path_basename );
+   if( (flags & O_CREAT) && (flags & FSKIT_O_MKPARENTS) ) {
 
-   struct fskit_file_handle* ret = NULL;
+      // make the parents on the way
+      parent = fskit_entry_mkdir_parents( core, path, fskit_dirname_len( path ), fskit_open_parent_mode( mode ), user, group, NULL, true, err );
+      if( parent == NULL && *err == -EEXIST ) {
+
+         // the would-be parent is a file
+         *err = -ENOTDIR;
+      }
+   }
+   else {
 
-   // write-lock parent--we need to ensure that the child does not disappear on us between attaching it and routing the user-given callback
-   struct fskit_entry* parent = fskit_entry_resolve_path( core, path_dirname, user, group, true, err );
+      parent = fskit_entry_resolve_path_parent( core, path, user, group, err );
+   }
 
    if( parent == NULL ) {
 
-      fskit_safe_free( path_dirname );
-      fskit_safe_free( path );
+      fskit_safe_free( path_copy );
 
       // err is set appropriately
       return NULL;
    }
 
-   fskit_safe_free( path_dirname );
+   struct fskit_dir_shard* shard = fskit_entry_dir_shard_wlock( parent, path_basename );
 
    rc = fskit_do_parent_check( parent, flags, user, group );
    if( rc != 0 ) {
 
       // can't perform this operation
-      fskit_entry_unlock( parent );
-      fskit_safe_free( path );
+      fskit_entry_dir_unlock( parent, shard );
+      fskit_safe_free( path_copy );
       *err = rc;
       return NULL;
    }
 
-   // resolve the child (which may be in the process of being deleted)
-   struct fskit_entry* child = fskit_entry_set_find_name( parent->children, path_basename );
+   // resolve the child (which may be in the process of being deleted, or created)
+   struct fskit_entry* child = fskit_dir_find_by_name( parent, path_basename );
    bool created = false;
 
+   if( child != NULL && child->creating ) {
+
+      // not ours to decide yet
+      fskit_entry_dir_unlock( parent, shard );
+      fskit_safe_free( path_copy );
+      *busy = true;
+      return NULL;
+   }
+
    if( flags & O_CREAT ) {
 
       if( child != NULL ) {
@@ -287,9 +327,9 @@ struct fskit_file_handle* fskit_open_ex( struct fskit_core* core, char const* _p
          else {
 
             // can't garbage-collect--child still exists
-            fskit_entry_unlock( parent );
+            fskit_entry_dir_unlock( parent, shard );
             fskit_entry_unlock( child );
-            fskit_safe_free( path );
+            fskit_safe_free( path_copy );
 
             if( rc == -EEXIST ) {
 
@@ -312,11 +352,16 @@ struct fskit_file_handle* fskit_open_ex( struct fskit_core* core, char const* _p
 
          // can create!
          // NOTE: do *not* lock child--it has to be unlocked for running user-given routes
-         rc = fskit_do_create( core, parent, path, mode, user, group, cls, &child, &handle_data );
+         rc = fskit_do_create( core, parent, shard, path, mode, user, group, cls, &child, &handle_data, &parent_pinned );
          if( rc != 0 ) {
 
-            fskit_entry_unlock( parent );
-            fskit_safe_free( path );
+            fskit_entry_dir_unlock( parent, shard );
+
+            if( parent_pinned ) {
+               fskit_entry_unref( core, NULL, parent );
+            }
+
+            fskit_safe_free( path_copy );
             *err = rc;
             return NULL;
          }
@@ -329,8 +374,8 @@ struct fskit_file_handle* fskit_open_ex( struct fskit_core* core, char const* _p
    else if( child == NULL ) {
 
       // not found
-      fskit_entry_unlock( parent );
-      fskit_safe_free( path );
+      fskit_entry_dir_unlock( parent, shard );
+      fskit_safe_free( path_copy );
       *err = -ENOENT;
       return NULL;
    }
@@ -343,12 +388,12 @@ struct fskit_file_handle* fskit_open_ex( struct fskit_core* core, char const* _p
 
       // run user truncate
       // NOTE: do *not* lock it--it has to be unlocked for running user-given routes
-      rc = fskit_run_user_trunc( core, path, child, 0, NULL );
+      rc = fskit_run_user_trunc( core, path, child, 0, NULL, NULL );
       if( rc != 0 ) {
 
          // truncate failed
-         fskit_entry_unlock( parent );
-         fskit_safe_free( path );
+         fskit_entry_dir_unlock( parent, shard );
+         fskit_safe_free( path_copy );
          *err = rc;
          return NULL;
       }
@@ -358,25 +403,25 @@ struct fskit_file_handle* fskit_open_ex( struct fskit_core* core, char const* _p
       
       // do the open
       // NOTE: do *not* lock it--it has to be unlocked for running user-given routes
-      rc = fskit_do_open( core, path, parent, child, flags, user, group, &handle_data );
+      rc = fskit_do_open( core, path, parent, shard, child, flags, user, group, &handle_data );
       if( rc != 0 ) {
 
          // open failed
-         fskit_entry_unlock( parent );
-         fskit_safe_free( path );
+         fskit_entry_dir_unlock( parent, shard );
+         fskit_safe_free( path_copy );
          *err = rc;
          return NULL;
       }
    }
    
    // done with parent 
-   fskit_entry_unlock( parent );
+   fskit_entry_dir_unlock( parent, shard );
 
    // still here--we can open the file now!
    fskit_entry_set_atime( child, NULL );
    ret = fskit_file_handle_create( core, child, path, flags, handle_data );
 
-   fskit_safe_free( path );
+   fskit_safe_free( path_copy );
 
    if( ret == NULL ) {
       // only possible if we're out of memory!
@@ -387,6 +432,34 @@ struct fskit_file_handle* fskit_open_ex( struct fskit_core* core, char const* _p
 }
 
 
+// create/open a file, with the given flags and (if creating) mode
+// on success, return a file handle to the created/opened file.
+// on failure, return NULL and set *err to the appropriate errno
+struct fskit_file_handle* fskit_open_ex( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, int flags, mode_t mode, void* cls, int* err ) {
+
+   struct fskit_file_handle* ret = NULL;
+   bool busy = false;
+
+   if( fskit_check_flags( flags ) != 0 ) {
+      *err = -EINVAL;
+      return NULL;
+   }
+
+   do {
+
+      ret = fskit_open_once( core, path, user, group, flags, mode, cls, err, &busy );
+      if( busy ) {
+
+         // someone else is creating this name; wait to see whether or not it succeeds
+         sched_yield();
+      }
+
+   } while( busy );
+
+   return ret;
+}
+
+
 // fskit_open() without the cls (used only by creat)
 struct fskit_file_handle* fskit_open( struct fskit_core* core, char const* _path, uint64_t user, uint64_t group, int flags, mode_t mode, int* err ) {
    return fskit_open_ex( core, _path, user, group, flags, mode, NULL, err );
@@ -28,7 +28,7 @@
 
 
 // create a directory handle from an fskit_entry
-static struct fskit_dir_handle* fskit_dir_handle_create( struct fskit_entry* dir, char const* path, void* app_handle_data ) {
+static struct fskit_dir_handle* fskit_dir_handle_create( struct fskit_entry* dir, void* app_handle_data ) {
 
    struct fskit_dir_handle* dirh = CALLOC_LIST( struct fskit_dir_handle, 1 );
    if( dirh == NULL ) {
@@ -36,7 +36,6 @@ static struct fskit_dir_handle* fskit_dir_handle_create( struct fskit_entry* dir
    }
    
    dirh->dent = dir;
-   dirh->path = strdup( path );
    dirh->file_id = dir->file_id;
    dirh->app_data = app_handle_data;
 
@@ -75,7 +74,7 @@ struct fskit_dir_handle* fskit_opendir( struct fskit_core* core, char const* _pa
 
    fskit_sanitize_path( path );
 
-   dir = fskit_entry_resolve_path( core, path, user, group, true, err );
+   dir = fskit_entry_resolve_path( core, path, user, group, false, err );
    if( dir == NULL ) {
       // resolution error; err is set appropriately
       return NULL;
@@ -95,7 +94,7 @@ struct fskit_dir_handle* fskit_opendir( struct fskit_core* core, char const* _pa
    // generate handle data
    rc = fskit_run_user_open( core, path, dir, 0, &app_handle_data );
    
-   fskit_entry_wlock( dir );
+   fskit_entry_rlock( dir );
    
    if( rc != 0 ) {
 
@@ -109,7 +108,7 @@ struct fskit_dir_handle* fskit_opendir( struct fskit_core* core, char const* _pa
    }
    
    // make a handle to it
-   dirh = fskit_dir_handle_create( dir, path, app_handle_data );
+   dirh = fskit_dir_handle_create( dir, app_handle_data );
    if( dirh == NULL ) {
       
       // OOM
@@ -269,6 +269,131 @@ void fskit_sanitize_path( char* path ) {
    }
 }
 
+
+// how long is the prefix of path that names its directory?
+// trailing '/''s are ignored, so the directory of /foo/bar/ is /foo.
+// the directory of / (or of a top-level name like /foo) is /, so this returns 1.
+// returns 0 if path has no directory (i.e. it is empty or relative with a single name)
+size_t fskit_dirname_len( char const* path ) {
+
+   size_t i = strlen(path);
+
+   // skip trailing '/''s, then the basename, then the '/''s before it
+   while( i > 0 && path[i-1] == '/' ) {
+      i--;
+   }
+
+   while( i > 0 && path[i-1] != '/' ) {
+      i--;
+   }
+
+   while( i > 0 && path[i-1] == '/' ) {
+      i--;
+   }
+
+   if( i == 0 && path[0] == '/' ) {
+      return 1;
+   }
+
+   return i;
+}
+
+// find the basename of a path in place, ignoring trailing '/''s.
+// the basename of / is /.
+// returns a pointer into path, and sets *len to the basename's length (it is not NUL-terminated if path ends in '/')
+char const* fskit_basename_view( char const* path, size_t* len ) {
+
+   size_t end = strlen(path);
+   size_t start = 0;
+
+   while( end > 1 && path[end-1] == '/' ) {
+      end--;
+   }
+
+   if( end == 1 && path[0] == '/' ) {
+      *len = 1;
+      return path;
+   }
+
+   start = end;
+   while( start > 0 && path[start-1] != '/' ) {
+      start--;
+   }
+
+   *len = end - start;
+   return path + start;
+}
+
+// copy a name from a path view into dest, which must hold FSKIT_FILESYSTEM_NAMEMAX+1 bytes
+// return 0 on success
+// return -ENAMETOOLONG if the name does not fit
+int fskit_path_name_copy( char const* name, size_t len, char* dest ) {
+
+   if( len > FSKIT_FILESYSTEM_NAMEMAX ) {
+      return -ENAMETOOLONG;
+   }
+
+   memcpy( dest, name, len );
+   dest[len] = '\0';
+   return 0;
+}
+
+// set up a cursor over the first path_len bytes of path.
+// the cursor refers to path, so path must stay valid (and unchanged) while the cursor is in use
+void fskit_path_cursor_init( struct fskit_path_cursor* cur, char const* path, size_t path_len ) {
+
+   cur->path = path;
+   cur->end = path + path_len;
+   cur->name = path;
+   cur->len = 0;
+}
+
+// advance a cursor to the next name in its path, skipping '/''s and '.' names.
+// return true if there is a name, and false if the path is exhausted
+bool fskit_path_cursor_next( struct fskit_path_cursor* cur ) {
+
+   char const* p = cur->name + cur->len;
+
+   while( true ) {
+
+      while( p < cur->end && *p == '/' ) {
+         p++;
+      }
+
+      if( p == cur->end ) {
+
+         cur->name = p;
+         cur->len = 0;
+         return false;
+      }
+
+      cur->name = p;
+      while( p < cur->end && *p != '/' ) {
+         p++;
+      }
+
+      cur->len = p - cur->name;
+
+      if( cur->len != 1 || cur->name[0] != '.' ) {
+         return true;
+      }
+   }
+}
+
+// is the cursor's current name the last one in its path?
+// (i.e. only '/''s and '.' names follow it)
+bool fskit_path_cursor_last( struct fskit_path_cursor const* cur ) {
+
+   struct fskit_path_cursor rest = *cur;
+   return !fskit_path_cursor_next( &rest );
+}
+
+// how long is the prefix of the cursor's path that ends with its current name?
+size_t fskit_path_cursor_offset( struct fskit_path_cursor const* cur ) {
+
+   return (cur->name + cur->len) - cur->path;
+}
+
 // Run the eval function on cur_ent.  The ent_eval callback should return 0 to indicate successful processing, and non-zero to indicate error.
 // This method returns the return code of the ent_eval callback regardless.
 // The ent_eval callback may *NOT* free an inode's memory.
@@ -288,43 +413,50 @@ static int fskit_entry_ent_eval( struct fskit_entry* prev_ent, struct fskit_entr
    return eval_rc;
 }
 
-// resolve an absolute path, running a given function on each entry as the path is walked
+// decide whether the resolver write-locks an entry on the path.
+// a parent lookup (see fskit_entry_resolve_path_parent) write-locks only the last entry, and only if it isn't sharded.
+static bool fskit_entry_resolve_wants_wlock( struct fskit_entry* ent, bool writelock, bool parent_lookup, bool last ) {
+
+   if( !parent_lookup ) {
+      return writelock;
+   }
+
+   return last && __atomic_load_n( &ent->shards, __ATOMIC_ACQUIRE ) == NULL;
+}
+
+// resolve an absolute path, running a given function on each entry as the path is walked.
+// if parent_lookup is set, writelock is ignored, and the entry at the end is locked as by fskit_entry_resolve_path_parent
 // returns the locked fskit_entry at the end of the path on success
-struct fskit_entry* fskit_entry_resolve_path_cls( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, bool writelock, int* err, int (*ent_eval)( struct fskit_entry*, void* ), void* cls ) {
+static struct fskit_entry* fskit_entry_resolve_path_ex( struct fskit_core* core, char const* path, size_t path_len, uint64_t user, uint64_t group, bool writelock, bool parent_lookup, int* err, int (*ent_eval)( struct fskit_entry*, void* ), void* cls ) {
+
+   struct fskit_path_cursor cur;
+   char name_buf[FSKIT_FILESYSTEM_NAMEMAX+1];
+   char* name = NULL;
 
-   // if this path ends in '/', then append a '.'
-   char* fpath = NULL;
-   if( strlen(path) == 0 ) {
+   if( path_len == 0 ) {
       *err = -EINVAL;
       return NULL;
    }
 
-   if( path[strlen(path)-1] == '/' ) {
-      fpath = fskit_fullpath( path, ".", NULL );
-   }
-   else {
-      fpath = strdup( path );
+   // walk the names in place; '.' names and trailing '/''s are skipped
+   fskit_path_cursor_init( &cur, path, path_len );
+   if( fskit_path_cursor_next( &cur ) ) {
 
-      if( fpath == NULL ) {
-         *err = -ENOMEM;
+      *err = fskit_path_name_copy( cur.name, cur.len, name_buf );
+      if( *err != 0 ) {
          return NULL;
       }
-   }
 
-   char* tmp = NULL;
-
-   char* name = strtok_r( fpath, "/", &tmp );
-   while( name != NULL && strcmp(name, ".") == 0 ) {
-      name = strtok_r( NULL, "/", &tmp );
+      name = name_buf;
    }
 
    // if name == NULL, then root was requested.
-   struct fskit_entry* cur_ent = fskit_core_resolve_root( core, (writelock && name == NULL) );
+   struct fskit_entry* cur_ent = fskit_core_resolve_root( core, fskit_entry_resolve_wants_wlock( fskit_core_get_root( core ), writelock && name == NULL, parent_lookup, name == NULL ) );
    struct fskit_entry* prev_ent = NULL;
+   struct fskit_dir_shard* shard = NULL;
 
-   if( cur_ent->link_count == 0 || cur_ent->type == FSKIT_ENTRY_TYPE_DEAD ) {
+   if( fskit_entry_get_link_count( cur_ent ) == 0 || cur_ent->type == FSKIT_ENTRY_TYPE_DEAD ) {
       // filesystem was nuked
-      fskit_safe_free( fpath );
       fskit_entry_unlock( cur_ent );
       *err = -ENOENT;
       return NULL;
@@ -336,14 +468,12 @@ struct fskit_entry* fskit_entry_resolve_path_cls( struct fskit_core* core, char
       int eval_rc = fskit_entry_ent_eval( prev_ent, cur_ent, ent_eval, cls );
       if( eval_rc != 0 ) {
          *err = eval_rc;
-         fskit_safe_free( fpath );
          fskit_entry_unlock( cur_ent );
          return NULL;
       }
       
       if( cur_ent->deletion_in_progress || cur_ent->type == FSKIT_ENTRY_TYPE_DEAD ) {
          // no longer exists 
-         fskit_safe_free( fpath );
          fskit_entry_unlock( cur_ent );
          *err = -ENOENT;
          return NULL;
@@ -361,7 +491,6 @@ struct fskit_entry* fskit_entry_resolve_path_cls( struct fskit_core* core, char
             *err = -ENOENT;
          }
 
-         fskit_safe_free( fpath );
          fskit_entry_unlock( cur_ent );
 
          return NULL;
@@ -375,7 +504,6 @@ struct fskit_entry* fskit_entry_resolve_path_cls( struct fskit_core* core, char
 
          // the appropriate read flag is not set
          *err = -EACCES;
-         fskit_safe_free( fpath );
          fskit_entry_unlock( cur_ent );
 
          return NULL;
@@ -394,13 +522,14 @@ struct fskit_entry* fskit_entry_resolve_path_cls( struct fskit_core* core, char
 
             // not a directory
             *err = -ENOTDIR;
-            fskit_safe_free( fpath );
-            fskit_entry_unlock( prev_ent );
+               fskit_entry_unlock( prev_ent );
 
             return NULL;
          }
          else {
-            cur_ent = fskit_entry_set_find_name( prev_ent->children, name );
+            // hold the name's shard (if any) until cur_ent is locked, so a shard writer can't remove it under us
+            shard = fskit_entry_dir_shard_rlock( prev_ent, name );
+            cur_ent = fskit_dir_find_by_name( prev_ent, name );
          }
       }
       else {
@@ -409,31 +538,43 @@ struct fskit_entry* fskit_entry_resolve_path_cls( struct fskit_core* core, char
       }
 
       // NOTE: we can safely check deletion_in_progress, since it only gets written once (and while the parent is write-locked)
-      if( cur_ent == NULL || cur_ent->deletion_in_progress || cur_ent->type == FSKIT_ENTRY_TYPE_DEAD ) {
+      // NOTE: a reserved name does not exist until its create finishes
+      if( cur_ent == NULL || cur_ent->deletion_in_progress || cur_ent->creating || cur_ent->type == FSKIT_ENTRY_TYPE_DEAD ) {
          
          // not found
          *err = -ENOENT;
-         fskit_safe_free( fpath );
-         fskit_entry_unlock( prev_ent );
+         fskit_entry_dir_unlock( prev_ent, shard );
 
          return NULL;
       }
       else {
 
          // next path name
-         name = strtok_r( NULL, "/", &tmp );
-         while( name != NULL && strcmp(name, ".") == 0 ) {
-            name = strtok_r( NULL, "/", &tmp );
+         name = NULL;
+         if( fskit_path_cursor_next( &cur ) ) {
+
+            int copy_rc = fskit_path_name_copy( cur.name, cur.len, name_buf );
+            if( copy_rc != 0 ) {
+
+               fskit_entry_unlock( prev_ent );
+               *err = copy_rc;
+               return NULL;
+            }
+
+            name = name_buf;
          }
 
          // keep to the locking discipline
-         if( writelock ) {
+         if( fskit_entry_resolve_wants_wlock( cur_ent, writelock, parent_lookup, name == NULL ) ) {
             fskit_entry_wlock( cur_ent );
          }
          else {
             fskit_entry_rlock( cur_ent );
          }
 
+         fskit_entry_dir_shard_unlock( shard );
+         shard = NULL;
+
          // before unlocking the previous ent, run our evaluator (if we have one)
          if( ent_eval ) {
             
@@ -444,21 +585,19 @@ struct fskit_entry* fskit_entry_resolve_path_cls( struct fskit_core* core, char
                fskit_entry_unlock( prev_ent );
 
                *err = eval_rc;
-               fskit_safe_free( fpath );
-
+      
                return NULL;
             }
          }
 
-         if( cur_ent->link_count == 0 || cur_ent->type == FSKIT_ENTRY_TYPE_DEAD || cur_ent->deletion_in_progress ) {
+         if( fskit_entry_get_link_count( cur_ent ) == 0 || cur_ent->type == FSKIT_ENTRY_TYPE_DEAD || cur_ent->deletion_in_progress ) {
             
             // just got removed
             fskit_entry_unlock( cur_ent );
             fskit_entry_unlock( prev_ent );
 
             *err = -ENOENT;
-            fskit_safe_free( fpath );
-
+   
             return NULL;
          }
 
@@ -466,7 +605,6 @@ struct fskit_entry* fskit_entry_resolve_path_cls( struct fskit_core* core, char
       }
    } while( true );
 
-   fskit_safe_free( fpath );
    if( name == NULL ) {
       // ran out of path
       *err = 0;
@@ -494,12 +632,32 @@ struct fskit_entry* fskit_entry_resolve_path_cls( struct fskit_core* core, char
    }
 }
 
+// resolve an absolute path, running a given function on each entry as the path is walked
+// returns the locked fskit_entry at the end of the path on success
+struct fskit_entry* fskit_entry_resolve_path_cls( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, bool writelock, int* err, int (*ent_eval)( struct fskit_entry*, void* ), void* cls ) {
+   return fskit_entry_resolve_path_ex( core, path, strlen(path), user, group, writelock, false, err, ent_eval, cls );
+}
+
 // resolve an absolute path.
 // returns the locked fskit_entry at the end of the path on success
 struct fskit_entry* fskit_entry_resolve_path( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, bool writelock, int* err ) {
    return fskit_entry_resolve_path_cls( core, path, user, group, writelock, err, NULL, NULL );
 }
 
+// resolve the directory that holds path's basename, without copying out its dirname.
+// returns the locked fskit_entry for the directory on success
+struct fskit_entry* fskit_entry_resolve_dir( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, bool writelock, int* err ) {
+   return fskit_entry_resolve_path_ex( core, path, fskit_dirname_len( path ), user, group, writelock, false, err, NULL, NULL );
+}
+
+// resolve the directory in which path's basename will be added or removed.
+// the entries on the way are read-locked.  The directory itself is write-locked, unless it is sharded, in which case it
+// is read-locked and the caller must lock the name's shard (see fskit_entry_dir_shard_wlock); check dir->shards to tell.
+// returns the locked fskit_entry for the directory on success
+struct fskit_entry* fskit_entry_resolve_path_parent( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, int* err ) {
+   return fskit_entry_resolve_path_ex( core, path, fskit_dirname_len( path ), user, group, true, true, err, NULL, NULL );
+}
+
 
 // start iterating on a path 
 // return an iterator, or NULL if OOM
@@ -521,7 +679,7 @@ struct fskit_path_iterator* fskit_path_begin( struct fskit_core* core, char cons
    }
    
    // is root dead?
-   if( root->link_count == 0 || root->type == FSKIT_ENTRY_TYPE_DEAD ) {
+   if( fskit_entry_get_link_count( root ) == 0 || root->type == FSKIT_ENTRY_TYPE_DEAD ) {
       
       fskit_entry_unlock( root );
       ret->rc = -ENOENT;
@@ -576,7 +734,7 @@ bool fskit_path_end( struct fskit_path_iterator* itr ) {
 
 // advance the path iterator to the next entry in the path.
 // set itr->rc to -ENOTDIR if we encounter a file before running out of path
-// set itr->rc to -ENOMEM if we're OOM 
+// set itr->rc to -ENAMETOOLONG if a name in the path is too long
 // set itr->rc to -ENOENT if the named entry does not exist in the filesystem
 void fskit_path_next( struct fskit_path_iterator* itr ) {
    
@@ -585,7 +743,6 @@ void fskit_path_next( struct fskit_path_iterator* itr ) {
    
    size_t len = 0;
    size_t name_len = 0;
-   char* next_name = NULL;
    
    if( itr->end_of_path ) {
       return;
@@ -670,31 +827,24 @@ void fskit_path_next( struct fskit_path_iterator* itr ) {
       return;
    }
    
-   next_name = CALLOC_LIST( char, name_len + 1 );
-   if( next_name == NULL ) {
-      
-      // OOM!
-      itr->rc = -ENOMEM;
+   itr->rc = fskit_path_name_copy( name_candidate, name_len, itr->cur_name );
+   if( itr->rc != 0 ) {
       return;
    }
    
-   strncpy( next_name, name_candidate, name_len );
-   
    // advance name (and path length considered)
    itr->name = tmp;
    itr->name_i += len;
    
-   memset( itr->cur_name, 0, FSKIT_FILESYSTEM_NAMEMAX+1 );
-   strncpy( itr->cur_name, name_candidate, name_len );
-   
-   // look up the next entry in prev_ent 
-   itr->cur_ent = fskit_entry_set_find_name( itr->prev_ent->children, next_name );
-   
-   fskit_safe_free( next_name );
+   // look up the next entry in prev_ent, holding its shard (if any) until the entry is locked
+   struct fskit_dir_shard* shard = fskit_entry_dir_shard_rlock( itr->prev_ent, itr->cur_name );
+   itr->cur_ent = fskit_dir_find_by_name( itr->prev_ent, itr->cur_name );
    
-   if( itr->cur_ent == NULL ) {
+   if( itr->cur_ent == NULL || itr->cur_ent->creating ) {
       
-      // not found 
+      // not found (or not yet created)
+      itr->cur_ent = NULL;
+      fskit_entry_dir_shard_unlock( shard );
       itr->rc = -ENOENT;
       return;
    }
@@ -708,6 +858,8 @@ void fskit_path_next( struct fskit_path_iterator* itr ) {
       fskit_entry_rlock( itr->cur_ent );
    }
    
+   fskit_entry_dir_shard_unlock( shard );
+   
    // success!
    return;
 }
@@ -798,27 +950,218 @@ struct fskit_entry* fskit_entry_ref( struct fskit_core* core, char const* fs_pat
    
    struct fskit_entry* fent = NULL;
    
-   fent = fskit_entry_resolve_path( core, fs_path, 0, 0, true, rc );
+   fent = fskit_entry_resolve_path( core, fs_path, 0, 0, false, rc );
    if( fent == NULL ) {
       
       return NULL;
    }
    
-   fent->open_count++;
+   // a read lock suffices: it keeps fskit_entry_try_destroy out
+   fskit_entry_ref_entry( fent );
    fskit_entry_unlock( fent );
    
    return fent;
 }
 
-// reference a write-locked entry 
+// reference a locked entry (read- or write-locked)
 // always succeeds
 int fskit_entry_ref_entry( struct fskit_entry* fent ) {
-   fent->open_count++;
+   __atomic_add_fetch( &fent->open_count, 1, __ATOMIC_ACQ_REL );
+   return 0;
+}
+
+
+// one directory (or, at the end, one entry) on the chain walked by fskit_entry_ref_many
+struct fskit_ref_many_link {
+
+   struct fskit_entry* ent;
+   char const* name;            // the name it was reached by (in the caller's path that reached it)
+   size_t len;
+   bool locked;                 // false if it was reached by ".." and is already locked further up the chain
+};
+
+// pop and unlock the chain's entries until only depth remain
+static void fskit_ref_many_release( struct fskit_ref_many_link* chain, size_t* chain_depth, size_t depth ) {
+
+   while( *chain_depth > depth ) {
+
+      (*chain_depth)--;
+      if( chain[ *chain_depth ].locked ) {
+         fskit_entry_unlock( chain[ *chain_depth ].ent );
+      }
+   }
+}
+
+// walk from the end of the chain down the rest of cur's names, read-locking and pushing each entry met.
+// the chain has room for every name in the path.
+// return 0 if the whole path was walked
+// return the usual path resolution errors otherwise
+static int fskit_ref_many_descend( struct fskit_ref_many_link* chain, size_t* chain_depth, struct fskit_path_cursor* cur, bool have_name, uint64_t user, uint64_t group ) {
+
+   char name[FSKIT_FILESYSTEM_NAMEMAX+1];
+   struct fskit_entry* dir = NULL;
+   struct fskit_entry* child = NULL;
+   struct fskit_dir_shard* shard = NULL;
+   int rc = 0;
+
+   for( ; have_name; have_name = fskit_path_cursor_next( cur ) ) {
+
+      dir = chain[ *chain_depth - 1 ].ent;
+
+      if( dir->type != FSKIT_ENTRY_TYPE_DIR ) {
+         return dir->type == FSKIT_ENTRY_TYPE_DEAD ? -ENOENT : -ENOTDIR;
+      }
+
+      if( !FSKIT_ENTRY_IS_DIR_SEARCHABLE( dir->mode, dir->owner, dir->group, user, group ) ) {
+         return -EACCES;
+      }
+
+      rc = fskit_path_name_copy( cur->name, cur->len, name );
+      if( rc != 0 ) {
+         return rc;
+      }
+
+      if( strcmp( name, ".." ) == 0 ) {
+
+         // the parent is already locked, further up the chain (and the parent of / is /)
+         chain[ *chain_depth ].ent = chain[ *chain_depth > 1 ? *chain_depth - 2 : 0 ].ent;
+         chain[ *chain_depth ].locked = false;
+      }
+      else {
+
+         // hold the name's shard (if any) until the child is locked, so a shard writer can't remove it under us
+         shard = fskit_entry_dir_shard_rlock( dir, name );
+         child = fskit_dir_find_by_name( dir, name );
+
+         if( child == NULL || child->deletion_in_progress || child->creating || child->type == FSKIT_ENTRY_TYPE_DEAD ) {
+
+            fskit_entry_dir_shard_unlock( shard );
+            return -ENOENT;
+         }
+
+         fskit_entry_rlock( child );
+         fskit_entry_dir_shard_unlock( shard );
+
+         if( fskit_entry_get_link_count( child ) == 0 || child->type == FSKIT_ENTRY_TYPE_DEAD || child->deletion_in_progress ) {
+
+            // just got removed
+            fskit_entry_unlock( child );
+            return -ENOENT;
+         }
+
+         chain[ *chain_depth ].ent = child;
+         chain[ *chain_depth ].locked = true;
+      }
+
+      chain[ *chain_depth ].name = cur->name;
+      chain[ *chain_depth ].len = cur->len;
+      (*chain_depth)++;
+   }
+
+   // like fskit_entry_resolve_path, a directory at the end must be searchable too
+   dir = chain[ *chain_depth - 1 ].ent;
+   if( dir->type == FSKIT_ENTRY_TYPE_DIR && !FSKIT_ENTRY_IS_DIR_SEARCHABLE( dir->mode, dir->owner, dir->group, user, group ) ) {
+      return -EACCES;
+   }
+
+   return 0;
+}
+
+// reference the entries at many absolute paths at once, as by fskit_entry_ref.
+// The tree is walked once for the whole batch: the directories on the way to one path stay read-locked, and are
+// reused by the next path for as long as the two share a prefix.  So a batch sorted by path (e.g. a manifest)
+// looks up and locks each directory once, instead of once per path.  Any order is correct; sorted is fast.
+// Writers to those directories wait until the batch moves past them.
+// On return, fents[i] is referenced (release it with fskit_entry_unref) and rcs[i] is 0, or fents[i] is NULL
+// and rcs[i] is the error from resolving paths[i].
+// return 0 if the batch was walked (even if some paths did not resolve)
+// return -EINVAL if an argument is NULL
+// return -ENOMEM on OOM, in which case nothing is referenced
+int fskit_entry_ref_many( struct fskit_core* core, char const** paths, size_t num_paths, uint64_t user, uint64_t group, struct fskit_entry** fents, int* rcs ) {
+
+   struct fskit_ref_many_link* chain = NULL;
+   size_t chain_depth = 0;
+   size_t max_depth = 1;
+   size_t depth = 0;
+   size_t path_len = 0;
+   bool have_name = false;
+   struct fskit_path_cursor cur;
+   struct fskit_entry* root = NULL;
+
+   if( paths == NULL || fents == NULL || rcs == NULL ) {
+      return -EINVAL;
+   }
+
+   // room for the root plus the longest possible path
+   for( size_t i = 0; i < num_paths; i++ ) {
+
+      if( paths[i] != NULL ) {
+
+         path_len = strlen( paths[i] );
+         if( max_depth < path_len / 2 + 2 ) {
+            max_depth = path_len / 2 + 2;
+         }
+      }
+   }
+
+   chain = CALLOC_LIST( struct fskit_ref_many_link, max_depth );
+   if( chain == NULL ) {
+      return -ENOMEM;
+   }
+
+   root = fskit_core_resolve_root( core, false );
+
+   chain[0].ent = root;
+   chain[0].locked = true;
+   chain_depth = 1;
+
+   for( size_t i = 0; i < num_paths; i++ ) {
+
+      fents[i] = NULL;
+
+      if( paths[i] == NULL || paths[i][0] == '\0' ) {
+         rcs[i] = -EINVAL;
+         continue;
+      }
+
+      if( fskit_entry_get_link_count( root ) == 0 || root->type == FSKIT_ENTRY_TYPE_DEAD ) {
+
+         // filesystem was nuked
+         rcs[i] = -ENOENT;
+         continue;
+      }
+
+      fskit_path_cursor_init( &cur, paths[i], strlen( paths[i] ) );
+      have_name = fskit_path_cursor_next( &cur );
+
+      // keep the prefix this path shares with the chain...
+      depth = 1;
+      while( have_name && depth < chain_depth && chain[depth].len == cur.len && memcmp( chain[depth].name, cur.name, cur.len ) == 0 ) {
+         depth++;
+         have_name = fskit_path_cursor_next( &cur );
+      }
+
+      // ...and walk the rest
+      fskit_ref_many_release( chain, &chain_depth, depth );
+
+      rcs[i] = fskit_ref_many_descend( chain, &chain_depth, &cur, have_name, user, group );
+      if( rcs[i] == 0 ) {
+
+         // a read lock suffices: it keeps fskit_entry_try_destroy out
+         fents[i] = chain[ chain_depth - 1 ].ent;
+         fskit_entry_ref_entry( fents[i] );
+      }
+   }
+
+   fskit_ref_many_release( chain, &chain_depth, 0 );
+   fskit_safe_free( chain );
+
    return 0;
 }
 
 // unreference an fskit_entry 
 // decrement the open counter, and optionally delete it if it is fully unreferenced.
+// fs_path may be NULL, in which case the destroy route (if any) gets the path built from fent.
 // return 0 on success
 // return negative on error (from the user-given detach route)
 // NOTE: fent must *not* be locked!
@@ -826,11 +1169,16 @@ int fskit_entry_unref( struct fskit_core* core, char const* fs_path, struct fski
    
    int rc = 0;
    
+   // only the last reference needs the lock
+   if( fskit_entry_unref_nonlast( fent ) ) {
+      return 0;
+   }
+   
    fskit_entry_wlock( fent );
    
-   fent->open_count--;
+   __atomic_sub_fetch( &fent->open_count, 1, __ATOMIC_ACQ_REL );
    
-   if( fent->open_count <= 0 && fent->link_count <= 0 ) {
+   if( fskit_entry_get_open_count( fent ) <= 0 && fskit_entry_get_link_count( fent ) <= 0 ) {
       
       // blow it away 
       rc = fskit_entry_try_destroy_and_free( core, fs_path, NULL, fent );
@@ -861,3 +1209,392 @@ int fskit_entry_unref( struct fskit_core* core, char const* fs_path, struct fski
    
    return rc;
 }
+
+
+// every entry's parent, name, and links are guarded by its own name_lock, so attaching, detaching, and renaming
+// different entries never contend.  Anything that walks up from an entry (building its path, or carrying a change up
+// to its ancestors' totals) holds the name lock of the entry it is at while it locks the next one up, since an entry
+// that is still linked into a directory keeps that directory linked (and allocated) too.  Locks are only ever taken
+// child-first, so this can't deadlock.
+// an entry without a parent (the root, or a directory whose children are being detached) never changes its name
+// again, so the walk reads it without locking it; this keeps every walk off the root's lock.
+
+// read-lock an entry's name, parent, and links
+void fskit_entry_name_rlock( struct fskit_entry* fent ) {
+   pthread_rwlock_rdlock( &fent->name_lock );
+}
+
+// write-lock an entry's name, parent, and links
+static void fskit_entry_name_wlock( struct fskit_entry* fent ) {
+   pthread_rwlock_wrlock( &fent->name_lock );
+}
+
+void fskit_entry_name_unlock( struct fskit_entry* fent ) {
+   pthread_rwlock_unlock( &fent->name_lock );
+}
+
+// step from an entry to its parent, when walking up from an entry whose name lock the caller holds.
+// *locked is the ancestor this walk has name-locked so far (NULL if none); it is swapped for the parent, so the caller
+// must be done reading fent.
+// fent must be name-locked by the caller or be *locked, or have no parent.
+// return the parent, or NULL if fent has none
+struct fskit_entry* fskit_entry_name_walk_up( struct fskit_entry* fent, struct fskit_entry** locked ) {
+
+   struct fskit_entry* parent = __atomic_load_n( &fent->parent, __ATOMIC_ACQUIRE );
+
+   if( parent != NULL && __atomic_load_n( &parent->parent, __ATOMIC_ACQUIRE ) != NULL ) {
+
+      fskit_entry_name_rlock( parent );
+
+      if( *locked != NULL ) {
+         fskit_entry_name_unlock( *locked );
+      }
+
+      *locked = parent;
+   }
+   else if( *locked != NULL ) {
+
+      // parent has no parent of its own, so it is stable
+      fskit_entry_name_unlock( *locked );
+      *locked = NULL;
+   }
+
+   return parent;
+}
+
+// put len bytes of str in front of the path being built backwards in *path (starting at *start, out of *size bytes).
+// return 0 on success
+// return -ENOMEM on OOM
+static int fskit_entry_path_prepend( char** path, size_t* size, size_t* start, char const* str, size_t len ) {
+
+   if( *start < len ) {
+
+      size_t used = *size - *start;
+      size_t new_size = 2 * (*size) + len;
+
+      char* new_path = CALLOC_LIST( char, new_size );
+      if( new_path == NULL ) {
+         return -ENOMEM;
+      }
+
+      memcpy( new_path + new_size - used, *path + *start, used );
+      fskit_safe_free( *path );
+
+      *path = new_path;
+      *start = new_size - used;
+      *size = new_size;
+   }
+
+   *start -= len;
+   memcpy( *path + *start, str, len );
+
+   return 0;
+}
+
+// build an entry's absolute path from its name and its ancestors' names.
+// the walk stops at the first entry without a parent, whose name is its absolute path ("/" for the root).
+// each ancestor is locked only while its name is copied, so the path may reflect a rename that happens during the walk.
+// fent must be name-locked.
+// return the path on success
+// return NULL on error, and set *err to -ENOENT if the entry (or an ancestor) is unlinked, or -ENOMEM on OOM
+static char* fskit_entry_path_locked( struct fskit_entry* fent, int* err ) {
+
+   struct fskit_entry* cur = fent;
+   struct fskit_entry* locked = NULL;
+   size_t size = FSKIT_FILESYSTEM_NAMEMAX + 2;
+   size_t start = size - 1;
+   size_t prefix_len = 0;
+   char* path = NULL;
+   int rc = 0;
+
+   path = CALLOC_LIST( char, size );
+   if( path == NULL ) {
+      *err = -ENOMEM;
+      return NULL;
+   }
+
+   while( __atomic_load_n( &cur->parent, __ATOMIC_ACQUIRE ) != NULL ) {
+
+      if( cur->name == NULL ) {
+         // lost its name to OOM
+         rc = -ENOMEM;
+         break;
+      }
+
+      rc = fskit_entry_path_prepend( &path, &size, &start, cur->name, strlen( cur->name ) );
+      if( rc == 0 ) {
+         rc = fskit_entry_path_prepend( &path, &size, &start, "/", 1 );
+      }
+
+      if( rc != 0 ) {
+         break;
+      }
+
+      cur = fskit_entry_name_walk_up( cur, &locked );
+   }
+
+   if( rc == 0 && cur->name == NULL ) {
+      rc = -ENOENT;
+   }
+
+   if( rc == 0 ) {
+
+      if( cur == fent ) {
+
+         fskit_safe_free( path );
+
+         path = strdup( cur->name );
+         if( path == NULL ) {
+            rc = -ENOMEM;
+         }
+      }
+      else {
+
+         prefix_len = strlen( cur->name );
+         while( prefix_len > 0 && cur->name[ prefix_len - 1 ] == '/' ) {
+            prefix_len--;
+         }
+
+         rc = fskit_entry_path_prepend( &path, &size, &start, cur->name, prefix_len );
+         if( rc == 0 ) {
+            memmove( path, path + start, size - start );
+         }
+      }
+   }
+
+   if( locked != NULL ) {
+      fskit_entry_name_unlock( locked );
+   }
+
+   if( rc != 0 ) {
+
+      fskit_safe_free( path );
+      *err = rc;
+      return NULL;
+   }
+
+   return path;
+}
+
+
+// get the absolute path to an entry, built from its name and the names of the directories above it.
+// this is how fskit gets a path for an entry when the caller does not have one (e.g. for a file handle's routes).
+// an entry unlinked while open has the path it was last linked at; a file with several hard links has the path of one of them.
+// fent must be referenced or locked, so it won't get destroyed; nothing else needs to be locked.
+// return the path on success (the caller must free it)
+// return NULL on error, and set *err to -ENOENT if fent is no longer linked, or -ENOMEM on OOM
+char* fskit_entry_get_path( struct fskit_entry* fent, int* err ) {
+
+   char* path = NULL;
+
+   fskit_entry_name_rlock( fent );
+
+   path = fskit_entry_path_locked( fent, err );
+
+   fskit_entry_name_unlock( fent );
+
+   return path;
+}
+
+
+// copy an entry's name (i.e. the last component of fskit_entry_get_path) into name, which holds FSKIT_FILESYSTEM_NAMEMAX+1 bytes.
+// name will be empty if the entry's name is not known.
+// fent must be referenced or locked.
+void fskit_entry_copy_name( struct fskit_entry* fent, char* name ) {
+
+   memset( name, 0, FSKIT_FILESYSTEM_NAMEMAX+1 );
+
+   fskit_entry_name_rlock( fent );
+
+   if( fent->name != NULL ) {
+
+      if( fent->parent != NULL ) {
+         strncpy( name, fent->name, FSKIT_FILESYSTEM_NAMEMAX );
+      }
+      else if( fskit_basename_len( fent->name ) <= FSKIT_FILESYSTEM_NAMEMAX ) {
+         fskit_basename( fent->name, name );
+      }
+   }
+
+   fskit_entry_name_unlock( fent );
+}
+
+
+// does a link to an entry (link_parent, link_name) match (parent, name)?  A link whose name got lost to OOM matches any name.
+static bool fskit_entry_link_matches( struct fskit_entry* link_parent, char const* link_name, struct fskit_entry* parent, char const* name ) {
+   return link_parent == parent && (link_name == NULL || name == NULL || strcmp( link_name, name ) == 0);
+}
+
+
+// find fent's extra link (parent, name).
+// fent must be name-locked.
+// return a pointer to the pointer to it, so it can be unlinked from the list
+// return NULL if there is no such link
+static struct fskit_entry_link** fskit_entry_link_find( struct fskit_entry* fent, struct fskit_entry* parent, char const* name ) {
+
+   struct fskit_entry_link** linkp = NULL;
+
+   for( linkp = &fent->links; *linkp != NULL; linkp = &(*linkp)->next ) {
+
+      if( fskit_entry_link_matches( (*linkp)->parent, (*linkp)->name, parent, name ) ) {
+         return linkp;
+      }
+   }
+
+   return NULL;
+}
+
+
+// record that fent, linked into old_parent as old_name, is now linked into new_parent as new_name.
+// old_parent is NULL if this is a new link to fent.  fent records its first link in its parent and name, and any
+// further hard links in its links list, so it still has a path when the first one goes away.
+// takes ownership of new_name, which may be NULL on OOM (that link's path is then unknown until it is renamed).
+// both parents must be write-locked (or, if sharded, their names' shards).  Only fent's name lock is taken (besides
+// the read locks on the ancestors whose totals change), so attaches and detaches of different entries run in parallel.
+void fskit_entry_name_set( struct fskit_entry* fent, struct fskit_entry* old_parent, char const* old_name, struct fskit_entry* new_parent, char* new_name ) {
+
+   char* old = NULL;
+   struct fskit_entry_link* link = NULL;
+   struct fskit_entry_link** linkp = NULL;
+
+   fskit_entry_name_wlock( fent );
+
+   if( (old_parent == NULL && fent->parent == NULL) || (old_parent != NULL && fskit_entry_link_matches( fent->parent, fent->name, old_parent, old_name )) ) {
+
+      // the recorded link (or the first one)
+      if( old_parent != new_parent ) {
+         fskit_entry_aggregate_move_locked( fent, old_parent, new_parent );
+      }
+
+      old = fent->name;
+
+      fent->name = new_name;
+      __atomic_store_n( &fent->parent, new_parent, __ATOMIC_RELEASE );
+
+      new_name = NULL;
+   }
+   else if( old_parent == NULL ) {
+
+      // another hard link.  On OOM, fent's path just won't survive losing its recorded link.
+      link = CALLOC_LIST( struct fskit_entry_link, 1 );
+      if( link != NULL ) {
+
+         link->parent = new_parent;
+         link->name = new_name;
+         link->next = fent->links;
+         fent->links = link;
+
+         new_name = NULL;
+      }
+   }
+   else {
+
+      // one of the other hard links got renamed
+      linkp = fskit_entry_link_find( fent, old_parent, old_name );
+      if( linkp != NULL ) {
+
+         old = (*linkp)->name;
+
+         (*linkp)->name = new_name;
+         (*linkp)->parent = new_parent;
+
+         new_name = NULL;
+      }
+   }
+
+   fskit_entry_name_unlock( fent );
+
+   fskit_safe_free( old );
+   fskit_safe_free( new_name );
+}
+
+
+// record that fent is no longer linked into parent as name.
+// if that was its recorded link and it has others, one of them becomes the recorded one.
+// if that was its last link and it is still open, it keeps its path (last_path, or the one built from its names if
+// last_path is NULL), so the routes that run when it is finally closed have one.
+// parent must be write-locked (or, if sharded, name's shard).
+void fskit_entry_name_clear( struct fskit_entry* fent, struct fskit_entry* parent, char const* name, char const* last_path ) {
+
+   char* old = NULL;
+   char* path = NULL;
+   struct fskit_entry_link* link = NULL;
+   struct fskit_entry_link** linkp = NULL;
+   int err = 0;
+
+   fskit_entry_name_wlock( fent );
+
+   if( fent->parent != NULL && fskit_entry_link_matches( fent->parent, fent->name, parent, name ) ) {
+
+      if( fent->links != NULL ) {
+
+         // still linked elsewhere; record that link instead
+         link = fent->links;
+         fent->links = link->next;
+
+         if( link->parent != parent ) {
+            fskit_entry_aggregate_move_locked( fent, parent, link->parent );
+         }
+
+         old = fent->name;
+
+         fent->name = link->name;
+         __atomic_store_n( &fent->parent, link->parent, __ATOMIC_RELEASE );
+      }
+      else {
+
+         if( fskit_entry_get_open_count( fent ) > 0 ) {
+
+            if( last_path != NULL ) {
+               path = strdup( last_path );
+            }
+            else {
+               path = fskit_entry_path_locked( fent, &err );
+            }
+         }
+
+         fskit_entry_aggregate_move_locked( fent, parent, NULL );
+
+         old = fent->name;
+
+         fent->name = path;
+         __atomic_store_n( &fent->parent, NULL, __ATOMIC_RELEASE );
+      }
+   }
+   else {
+
+      linkp = fskit_entry_link_find( fent, parent, name );
+      if( linkp != NULL ) {
+
+         link = *linkp;
+         *linkp = link->next;
+
+         old = link->name;
+      }
+   }
+
+   fskit_entry_name_unlock( fent );
+
+   fskit_safe_free( link );
+   fskit_safe_free( old );
+}
+
+
+// forget all of fent's names (see fskit_entry_destroy).
+// nothing else may reference fent.
+void fskit_entry_name_free( struct fskit_entry* fent ) {
+
+   struct fskit_entry_link* link = NULL;
+
+   while( fent->links != NULL ) {
+
+      link = fent->links;
+      fent->links = link->next;
+
+      fskit_safe_free( link->name );
+      fskit_safe_free( link );
+   }
+
+   fskit_safe_free( fent->name );
+   fent->parent = NULL;
+}
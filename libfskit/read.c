@@ -27,7 +27,7 @@
 // run the user-given read route callback
 // return the number of bytes read on success
 // return negative on failure
-ssize_t fskit_run_user_read( struct fskit_core* core, char const* path, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+ssize_t fskit_run_user_read( struct fskit_core* core, char const* path, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data, struct fskit_file_handle* fh ) {
 
    int rc = 0;
    int cbrc = 0;
@@ -35,7 +35,7 @@ ssize_t fskit_run_user_read( struct fskit_core* core, char const* path, struct f
 
    fskit_route_io_args( &dargs, buf, buflen, offset, handle_data, NULL );
 
-   rc = fskit_route_call_read( core, path, fent, &dargs, &cbrc );
+   rc = fskit_route_call_pinned( core, fh, FSKIT_ROUTE_MATCH_READ, path, fent, &dargs, &cbrc );
 
    if( rc == -EPERM || rc == -ENOSYS ) {
       // no routes installed
@@ -51,16 +51,19 @@ ssize_t fskit_run_user_read( struct fskit_core* core, char const* path, struct f
 // return negative on failure.
 ssize_t fskit_read( struct fskit_core* core, struct fskit_file_handle* fh, char* buf, size_t buflen, off_t offset ) {
 
-   fskit_file_handle_rlock( fh );
+   // no handle lock needed
+   if( fskit_file_handle_io_begin( fh ) != 0 ) {
+      return -EBADF;
+   }
 
    // sanity check
    if( (fh->flags & O_WRONLY) != 0 ) {
 
-      fskit_file_handle_unlock( fh );
+      fskit_file_handle_io_end( fh );
       return -EBADF;
    }
 
-   ssize_t num_read = fskit_run_user_read( core, fh->path, fh->fent, buf, buflen, offset, fh->app_data );
+   ssize_t num_read = fskit_run_user_read( core, NULL, fh->fent, buf, buflen, offset, fh->app_data, fh );
 
    if( num_read >= 0 ) {
 
@@ -72,7 +75,7 @@ ssize_t fskit_read( struct fskit_core* core, struct fskit_file_handle* fh, char*
       fskit_entry_unlock( fh->fent );
    }
 
-   fskit_file_handle_unlock( fh );
+   fskit_file_handle_io_end( fh );
 
    return num_read;
 }
@@ -22,31 +22,40 @@
 #include <fskit/entry.h>
 #include <fskit/readdir.h>
 #include <fskit/route.h>
+#include <fskit/stat.h>
 #include <fskit/util.h>
 
 #include "fskit_private/private.h"
 
 
-// table entry for seekdir/telldir positions
-struct fskit_telldir_entry {
-    
-    char name[ FSKIT_FILESYSTEM_NAMEMAX+1 ];
-    off_t offset;
-    
-    struct fskit_telldir_entry* next;
-};
-
-#define FSKIT_TELLDIR_ENTRY_CMP( t1, t2 ) (strcmp((t1)->name, (t2)->name))
 
 // initialize a directory entry from an fskit_entry
+// if plus is true, allocate a struct fskit_dir_entry_plus and snapshot dent's attributes into it as well.
+// dent must be read-locked
 // return the new entry on success
 // return NULL if out-of-memory
-static struct fskit_dir_entry* fskit_make_dir_entry( struct fskit_entry* dent, char const* name ) {
+static struct fskit_dir_entry* fskit_make_dir_entry( struct fskit_entry* dent, char const* name, bool plus ) {
 
-   struct fskit_dir_entry* dir_ent = CALLOC_LIST( struct fskit_dir_entry, 1 );
-   if( dir_ent == NULL ) {
-      // out of memory
-      return NULL;
+   struct fskit_dir_entry* dir_ent = NULL;
+   
+   if( plus ) {
+      
+      struct fskit_dir_entry_plus* dir_ent_plus = CALLOC_LIST( struct fskit_dir_entry_plus, 1 );
+      if( dir_ent_plus == NULL ) {
+         // out of memory 
+         return NULL;
+      }
+      
+      fskit_entry_fstat( dent, &dir_ent_plus->sb );
+      dir_ent = &dir_ent_plus->dirent;
+   }
+   else {
+      
+      dir_ent = CALLOC_LIST( struct fskit_dir_entry, 1 );
+      if( dir_ent == NULL ) {
+         // out of memory
+         return NULL;
+      }
    }
 
    dir_ent->type = dent->type;
@@ -68,6 +77,13 @@ void fskit_dir_entry_free( struct fskit_dir_entry* dir_ent ) {
    fskit_safe_free( dir_ent );
 }
 
+// free a list of dir entries with attributes
+void fskit_dir_entry_plus_free_list( struct fskit_dir_entry_plus** dir_ents ) {
+   
+   // each one is a single allocation that starts with its fskit_dir_entry
+   fskit_dir_entry_free_list( (struct fskit_dir_entry**)dir_ents );
+}
+
 // free a list of dir entries
 void fskit_dir_entry_free_list( struct fskit_dir_entry** dir_ents ) {
 
@@ -93,8 +109,16 @@ int fskit_run_user_readdir( struct fskit_core* core, char const* path, struct fs
    struct fskit_route_dispatch_args dargs;
    char name[FSKIT_FILESYSTEM_NAMEMAX+1];
    
-   memset( name, 0, FSKIT_FILESYSTEM_NAMEMAX+1 );
-   fskit_basename( path, name );
+   if( path != NULL ) {
+      
+      memset( name, 0, FSKIT_FILESYSTEM_NAMEMAX+1 );
+      fskit_basename( path, name );
+   }
+   else {
+      
+      // called on behalf of a handle
+      fskit_entry_copy_name( fent, name );
+   }
 
    fskit_route_readdir_args( &dargs, name, dents, num_dents );
 
@@ -109,59 +133,12 @@ int fskit_run_user_readdir( struct fskit_core* core, char const* path, struct fs
 }
 
 
-// find the starting point where we can begin to read a directory, based on the last-read name
-// set *read_itr and *read_start
-static int fskit_readdir_find_start( struct fskit_dir_handle* dirh, fskit_entry_set_itr* read_itr, fskit_entry_set** read_start ) {
-
-    // find out where we can start reading
-    struct fskit_entry* dent = dirh->dent;
-    
-    fskit_entry_set* member = fskit_entry_set_find_itr( dent->children, dirh->curr_name );
-    if( member == NULL ) {
-        
-        // name is invalid--try to seek to the point where we left off 
-        fskit_entry_set* sought = NULL;
-        bool found = false;
-        
-        for( sought = fskit_entry_set_begin( read_itr, dent->children ); sought != NULL; sought = fskit_entry_set_next( read_itr ) ) {
-            
-            // if we reached the point where the names are lexicographically greater than where we left off last, then 
-            // that's the new read point 
-            char const* sought_name = fskit_entry_set_name_at( sought );
-            if( strcmp(dirh->curr_name, sought_name) < 0 ) {
-                
-                found = true;
-                break;
-            }
-        }
-        if( found ) {
-            
-            // scanned ahead!
-            *read_start = sought;
-        }
-        else {
-           
-            // end of directory!
-            *read_start = NULL;
-        }
-    }
-    else {
-        
-        *read_start = member;
-
-        // TODO: find out why sglib's init_on_equal method doesn't get us the right iterator
-        fskit_entry_set* tmp = NULL;
-        for( tmp = fskit_entry_set_begin( read_itr, dent->children ); tmp != NULL && tmp != member; tmp = fskit_entry_set_next( read_itr ) );
-    }
-    
-    return 0;
-}
-
-
-// iterate through dent->children and return a null-terminated list of fskit_dir_entry* pointers
+// iterate through dent's children and return a null-terminated list of fskit_dir_entry* pointers
+// if plus is true, each one is the head of a struct fskit_dir_entry_plus with the child's attributes.
+// ends read_itr.
 // On error, return NULL and:
 //    set *err to ENOMEM on OOM
-static struct fskit_dir_entry** fskit_readdir_itr( struct fskit_core* core, struct fskit_entry* dent, uint64_t num_children, uint64_t* num_read, fskit_entry_set* read_start, fskit_entry_set_itr* read_itr, int* err ) {
+static struct fskit_dir_entry** fskit_readdir_itr( struct fskit_core* core, struct fskit_entry* dent, uint64_t num_children, uint64_t* num_read, fskit_entry_set* read_start, struct fskit_dir_itr* read_itr, bool plus, int* err ) {
     
    int rc = 0;
    uint64_t read_count = 0;
@@ -171,11 +148,12 @@ static struct fskit_dir_entry** fskit_readdir_itr( struct fskit_core* core, stru
    struct fskit_dir_entry** dir_ents = CALLOC_LIST( struct fskit_dir_entry*, num_children + 1 );
    if( dir_ents == NULL ) {
       // out of memory
+      fskit_dir_itr_end( read_itr );
       *err = -ENOMEM;
       return NULL;
    }
 
-   for( entry = read_start; entry != NULL && read_count < num_children; entry = fskit_entry_set_next( read_itr ) ) {
+   for( entry = read_start; entry != NULL && read_count < num_children; entry = fskit_dir_itr_next( read_itr ) ) {
 
       // extract values from iterators
       struct fskit_entry* fent = fskit_entry_set_child_at( entry );
@@ -186,8 +164,8 @@ static struct fskit_dir_entry** fskit_readdir_itr( struct fskit_core* core, stru
          continue;
       }
       
-      // skip garbage-collectables
-      if( fent->deletion_in_progress || fent->type == FSKIT_ENTRY_TYPE_DEAD ) {
+      // skip garbage-collectables, and names reserved by unfinished creates
+      if( fent->deletion_in_progress || fent->creating || fent->type == FSKIT_ENTRY_TYPE_DEAD ) {
          
          continue;
       }
@@ -199,7 +177,7 @@ static struct fskit_dir_entry** fskit_readdir_itr( struct fskit_core* core, stru
       if( strcmp( fskit_name, "." ) == 0 ) { 
 
          // handle .
-         dir_ent = fskit_make_dir_entry( dent, "." );
+         dir_ent = fskit_make_dir_entry( dent, ".", plus );
       }
       else if( strcmp( fskit_name, ".." ) == 0 ) {
 
@@ -213,13 +191,14 @@ static struct fskit_dir_entry** fskit_readdir_itr( struct fskit_core* core, stru
                // shouldn't happen--indicates deadlock
                fskit_error("fskit_entry_rlock(%p) rc = %d\n", fent, rc );
                fskit_dir_entry_free_list( dir_ents );
+               fskit_dir_itr_end( read_itr );
 
                *err = rc;
                return NULL;
             }
          }
 
-         dir_ent = fskit_make_dir_entry( fent, ".." );
+         dir_ent = fskit_make_dir_entry( fent, "..", plus );
 
          if( dent != fent ) {
             fskit_entry_unlock( fent );
@@ -241,13 +220,14 @@ static struct fskit_dir_entry** fskit_readdir_itr( struct fskit_core* core, stru
             // shouldn't happen--indicates deadlock
             fskit_error("BUG: fskit_entry_rlock(%p) rc = %d\n", fent, rc );
             fskit_dir_entry_free_list( dir_ents );
+            fskit_dir_itr_end( read_itr );
 
             *err = rc;
             return NULL;
          }
          
          // snapshot this entry
-         dir_ent = fskit_make_dir_entry( fent, fskit_name );
+         dir_ent = fskit_make_dir_entry( fent, fskit_name, plus );
 
          fskit_entry_unlock( fent );
          
@@ -273,6 +253,8 @@ static struct fskit_dir_entry** fskit_readdir_itr( struct fskit_core* core, stru
       }
    }
    
+   fskit_dir_itr_end( read_itr );
+   
    if( *err != 0 ) {
        
        fskit_dir_entry_free_list( dir_ents );
@@ -298,11 +280,395 @@ struct fskit_dir_entry** fskit_listdir_locked( struct fskit_core* core, struct f
       return NULL;
    }
 
-   uint64_t num_children = fskit_entry_set_count( dent->children );
-   fskit_entry_set_itr read_itr;
-   fskit_entry_set* read_start = fskit_entry_set_begin( &read_itr, dent->children );
+   uint64_t num_children = fskit_entry_dir_count( dent );
+   struct fskit_dir_itr read_itr;
+   fskit_entry_set* read_start = fskit_dir_itr_seek( &read_itr, dent, FSKIT_DIR_COOKIE_START );
+
+   return fskit_readdir_itr(core, dent, num_children, num_read, read_start, &read_itr, false, err);
+}
+
+
+// pack dent's children after the given cookie into buf as struct fskit_dirent64 records (see fskit_getdents).
+// dent must be read-locked
+// return the number of bytes written, 0 at the end of the directory, or -EINVAL if the next record does not fit
+static ssize_t fskit_getdents_lowlevel( struct fskit_entry* dent, uint64_t cookie, char* buf, size_t buflen ) {
+
+   int rc = 0;
+   size_t off = 0;
+   struct fskit_dir_itr read_itr;
+
+   for( fskit_entry_set* entry = fskit_dir_itr_seek( &read_itr, dent, cookie ); entry != NULL; entry = fskit_dir_itr_next( &read_itr ) ) {
+
+      struct fskit_entry* fent = fskit_entry_set_child_at( entry );
+      char const* name = fskit_entry_set_name_at( entry );
+
+      // skip names reserved by unfinished creates before locking them, since their create routes may hold them
+      if( fent == NULL || fent->creating ) {
+         continue;
+      }
+
+      size_t namelen = strlen( name );
+      size_t reclen = FSKIT_DIRENT64_RECLEN( namelen );
+
+      if( off + reclen > buflen ) {
+
+         if( off == 0 ) {
+            rc = -EINVAL;
+         }
+         break;
+      }
+
+      // . is dent (already locked); everything else must be locked to snapshot it
+      if( fent != dent ) {
+         fskit_entry_rlock( fent );
+      }
+
+      // skip garbage-collectables
+      if( fent->deletion_in_progress || fent->type == FSKIT_ENTRY_TYPE_DEAD ) {
+
+         if( fent != dent ) {
+            fskit_entry_unlock( fent );
+         }
+         continue;
+      }
+
+      struct fskit_dirent64* rec = (struct fskit_dirent64*)(buf + off);
+
+      rec->file_id = fent->file_id;
+      rec->type = fent->type;
+
+      if( fent != dent ) {
+         fskit_entry_unlock( fent );
+      }
+
+      rec->cookie = fskit_entry_set_cookie_at( entry );
+      rec->reclen = reclen;
+
+      // name, then zero padding
+      memcpy( rec->name, name, namelen );
+      memset( rec->name + namelen, 0, reclen - offsetof( struct fskit_dirent64, name ) - namelen );
+
+      off += reclen;
+   }
+
+   fskit_dir_itr_end( &read_itr );
+
+   if( rc != 0 ) {
+      return rc;
+   }
+
+   return off;
+}
+
+
+// a directory's children, packed as by fskit_getdents, as of a given children_gen
+struct fskit_dir_listing {
+
+   uint64_t gen;        // dir->children_gen when this was built
+
+   char* buf;           // the records, in cookie order
+   size_t len;
+
+   uint64_t num_records;
+   uint64_t* cookies;   // cookie of each record
+   size_t* offsets;     // offset of each record in buf, plus len at the end
+};
+
+// a directory's cached listing.
+// the listing is only rebuilt while dir is read-locked, and only once dir->children_gen has moved past it,
+// so a listing can be freed as soon as it is replaced: every reader that could see it held dir's read lock before the
+// write-locked change that staled it.  lock only serializes readers that race to replace it.
+struct fskit_dir_listing_cache {
+
+   pthread_mutex_t lock;
+   struct fskit_dir_listing* listing;
+};
+
+
+// free a listing
+static void fskit_dir_listing_free( struct fskit_dir_listing* listing ) {
+
+   if( listing == NULL ) {
+      return;
+   }
+
+   fskit_safe_free( listing->buf );
+   fskit_safe_free( listing->cookies );
+   fskit_safe_free( listing->offsets );
+   fskit_safe_free( listing );
+}
+
+
+// snapshot dent's children into a new listing
+// dent must be read-locked
+// return the listing on success
+// return NULL on OOM
+static struct fskit_dir_listing* fskit_dir_listing_build( struct fskit_entry* dent ) {
+
+   struct fskit_dir_itr itr;
+   size_t maxlen = 0;
+   uint64_t max_records = 0;
+
+   // size for every child; some may turn out to be garbage-collectable and get skipped
+   for( fskit_entry_set* entry = fskit_dir_itr_seek( &itr, dent, FSKIT_DIR_COOKIE_START ); entry != NULL; entry = fskit_dir_itr_next( &itr ) ) {
+
+      maxlen += FSKIT_DIRENT64_RECLEN( strlen( fskit_entry_set_name_at( entry ) ) );
+      max_records++;
+   }
+
+   struct fskit_dir_listing* listing = CALLOC_LIST( struct fskit_dir_listing, 1 );
+   if( listing == NULL ) {
+      return NULL;
+   }
+
+   listing->gen = dent->children_gen;
+   listing->buf = CALLOC_LIST( char, maxlen + 1 );
+   listing->cookies = CALLOC_LIST( uint64_t, max_records + 1 );
+   listing->offsets = CALLOC_LIST( size_t, max_records + 1 );
+
+   if( listing->buf == NULL || listing->cookies == NULL || listing->offsets == NULL ) {
+
+      fskit_dir_listing_free( listing );
+      return NULL;
+   }
+
+   ssize_t len = fskit_getdents_lowlevel( dent, FSKIT_DIR_COOKIE_START, listing->buf, maxlen );
+   if( len < 0 ) {
+
+      // can't happen, since everything fits 
+      fskit_error("BUG: fskit_getdents_lowlevel rc = %zd\n", len );
+      fskit_dir_listing_free( listing );
+      return NULL;
+   }
+
+   listing->len = len;
+
+   // index the records, so reads can find their start by binary search
+   for( size_t off = 0; off < listing->len; ) {
+
+      struct fskit_dirent64* rec = (struct fskit_dirent64*)(listing->buf + off);
+
+      listing->cookies[ listing->num_records ] = rec->cookie;
+      listing->offsets[ listing->num_records ] = off;
+      listing->num_records++;
+
+      off += rec->reclen;
+   }
+
+   listing->offsets[ listing->num_records ] = listing->len;
+
+   return listing;
+}
+
+
+// get dent's cached listing, rebuilding it if dent's children changed since it was built.
+// dent must be read-locked, and must have listing caching enabled.
+// return the listing on success; it stays valid until dent is unlocked
+// return NULL on OOM
+static struct fskit_dir_listing* fskit_dir_listing_get( struct fskit_entry* dent ) {
+
+   struct fskit_dir_listing_cache* cache = dent->listing_cache;
+   struct fskit_dir_listing* listing = NULL;
+
+   pthread_mutex_lock( &cache->lock );
+
+   if( cache->listing != NULL && cache->listing->gen == dent->children_gen ) {
+
+      // fresh
+      listing = cache->listing;
+   }
+
+   pthread_mutex_unlock( &cache->lock );
+
+   if( listing != NULL ) {
+      return listing;
+   }
+
+   // stale or missing.  Build outside the cache lock; children can't change while dent is read-locked.
+   struct fskit_dir_listing* new_listing = fskit_dir_listing_build( dent );
+   if( new_listing == NULL ) {
+      return NULL;
+   }
+
+   pthread_mutex_lock( &cache->lock );
+
+   if( cache->listing != NULL && cache->listing->gen == dent->children_gen ) {
 
-   return fskit_readdir_itr(core, dent, num_children, num_read, read_start, &read_itr, err);
+      // someone else rebuilt it first
+      listing = cache->listing;
+      fskit_dir_listing_free( new_listing );
+   }
+   else {
+
+      fskit_dir_listing_free( cache->listing );
+
+      cache->listing = new_listing;
+      listing = new_listing;
+   }
+
+   pthread_mutex_unlock( &cache->lock );
+
+   return listing;
+}
+
+
+// find the index of the first record in listing after the given cookie (or num_records if there are none)
+static uint64_t fskit_dir_listing_seek( struct fskit_dir_listing* listing, uint64_t cookie ) {
+
+   uint64_t lo = 0;
+   uint64_t hi = listing->num_records;
+
+   while( lo < hi ) {
+
+      uint64_t mid = lo + (hi - lo) / 2;
+
+      if( listing->cookies[mid] <= cookie ) {
+         lo = mid + 1;
+      }
+      else {
+         hi = mid;
+      }
+   }
+
+   return lo;
+}
+
+
+// copy as many whole records after the given cookie as fit into buf, with one memcpy
+// return the number of bytes written, 0 at the end of the directory, or -EINVAL if the next record does not fit
+static ssize_t fskit_dir_listing_read( struct fskit_dir_listing* listing, uint64_t cookie, char* buf, size_t buflen ) {
+
+   uint64_t start = fskit_dir_listing_seek( listing, cookie );
+   if( start == listing->num_records ) {
+      return 0;
+   }
+
+   // find the last record boundary within buflen of the start
+   uint64_t lo = start;
+   uint64_t hi = listing->num_records;
+
+   while( lo < hi ) {
+
+      uint64_t mid = lo + (hi - lo + 1) / 2;
+
+      if( listing->offsets[mid] - listing->offsets[start] <= buflen ) {
+         lo = mid;
+      }
+      else {
+         hi = mid - 1;
+      }
+   }
+
+   if( lo == start ) {
+      return -EINVAL;
+   }
+
+   size_t len = listing->offsets[lo] - listing->offsets[start];
+   memcpy( buf, listing->buf + listing->offsets[start], len );
+
+   return len;
+}
+
+
+// read up to num_children entries after the given cookie from a cached listing, as fskit_dir_entry structures.
+// set *last_cookie to the cookie of the last one read.
+// return a null-terminated list on success, which may be empty at the end of the directory
+// return NULL on OOM
+static struct fskit_dir_entry** fskit_dir_listing_read_entries( struct fskit_dir_listing* listing, uint64_t cookie, uint64_t num_children, uint64_t* num_read, uint64_t* last_cookie ) {
+
+   uint64_t start = fskit_dir_listing_seek( listing, cookie );
+   uint64_t count = listing->num_records - start;
+
+   if( count > num_children ) {
+      count = num_children;
+   }
+
+   struct fskit_dir_entry** dir_ents = CALLOC_LIST( struct fskit_dir_entry*, count + 1 );
+   if( dir_ents == NULL ) {
+      return NULL;
+   }
+
+   for( uint64_t i = 0; i < count; i++ ) {
+
+      struct fskit_dirent64* rec = (struct fskit_dirent64*)(listing->buf + listing->offsets[ start + i ]);
+
+      dir_ents[i] = CALLOC_LIST( struct fskit_dir_entry, 1 );
+      if( dir_ents[i] == NULL ) {
+
+         fskit_dir_entry_free_list( dir_ents );
+         return NULL;
+      }
+
+      dir_ents[i]->type = rec->type;
+      dir_ents[i]->file_id = rec->file_id;
+      strncpy( dir_ents[i]->name, rec->name, FSKIT_FILESYSTEM_NAMEMAX );
+
+      *last_cookie = rec->cookie;
+   }
+
+   *num_read = count;
+   return dir_ents;
+}
+
+
+// turn on listing caching for a directory: fskit_getdents and fskit_readdir (but not fskit_readdirplus) will be served
+// from a packed copy of its listing, rebuilt only when its children change, without locking each child.
+// worthwhile for directories that are listed much more often than they change.
+// NOTE: dir must be write-locked
+// return 0 on success (including if it was already on)
+// return -ENOTDIR if dir is not a directory
+// return -EINVAL if dir is sharded
+// return -ENOMEM on OOM
+int fskit_entry_enable_listing_cache( struct fskit_entry* dir ) {
+
+   if( dir->type != FSKIT_ENTRY_TYPE_DIR ) {
+      return -ENOTDIR;
+   }
+
+   if( dir->shards != NULL ) {
+      return -EINVAL;
+   }
+
+   if( dir->listing_cache != NULL ) {
+      return 0;
+   }
+
+   struct fskit_dir_listing_cache* cache = CALLOC_LIST( struct fskit_dir_listing_cache, 1 );
+   if( cache == NULL ) {
+      return -ENOMEM;
+   }
+
+   pthread_mutex_init( &cache->lock, NULL );
+   dir->listing_cache = cache;
+
+   return 0;
+}
+
+
+// turn off listing caching for a directory, and free its cached listing
+// NOTE: dir must be write-locked
+// return 0 on success
+int fskit_entry_disable_listing_cache( struct fskit_entry* dir ) {
+
+   fskit_dir_listing_cache_free( dir );
+   return 0;
+}
+
+
+// free a directory's listing cache, if it has one
+// NOTE: dir must be write-locked
+void fskit_dir_listing_cache_free( struct fskit_entry* dir ) {
+
+   struct fskit_dir_listing_cache* cache = dir->listing_cache;
+   if( cache == NULL ) {
+      return;
+   }
+
+   dir->listing_cache = NULL;
+
+   fskit_dir_listing_free( cache->listing );
+   pthread_mutex_destroy( &cache->lock );
+   fskit_safe_free( cache );
 }
 
 
@@ -316,59 +682,64 @@ struct fskit_dir_entry** fskit_listdir_locked( struct fskit_core* core, struct f
 // * -EDEADLK if there was a deadlock (this is a bug, and should be reported)
 // * -ENOMEM if there was insuffucient memory
 // If there are no children left to read (i.e. child_offset is beyond the end of the directory), then this method sets *err to 0 and returns NULL to indicate EOD
-static struct fskit_dir_entry** fskit_readdir_lowlevel( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t num_children, uint64_t* num_read, int* err ) {
+static struct fskit_dir_entry** fskit_readdir_lowlevel( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t num_children, uint64_t* num_read, bool plus, int* err ) {
 
    int rc = 0;
    struct fskit_entry* dent = dirh->dent;
    
-   fskit_entry_set* read_start = NULL;
+   struct fskit_dir_itr read_itr;
    
-   fskit_entry_set_itr read_itr;
-   fskit_entry_set* entry = NULL;
-   
-   if( dirh->eof ) {
+   if( dirh->cookie == FSKIT_DIR_COOKIE_EOF ) {
        // EOF
        *num_read = 0;
        return NULL;
    }
 
-   if( strlen(dirh->curr_name) == 0 ) {
-       
-       // haven't begun reading yet 
-       read_start = fskit_entry_set_begin( &read_itr, dent->children );
-       strncpy( dirh->curr_name, fskit_entry_set_name_at( read_start ), FSKIT_FILESYSTEM_NAMEMAX );
+   // UINT64_MAX means 'all children'
+   if( num_children == UINT64_MAX ) {
+      num_children = fskit_entry_dir_count( dent );
    }
-   else {
 
-       fskit_entry_set_itr test_itr;
-       fskit_entry_set* test_entry;
-
-       fskit_readdir_find_start( dirh, &read_itr, &read_start );
-       if( read_start == NULL ) {
-           
-           // out of directory 
-           *num_read = 0;
-           return NULL;
-       }
+   // the first unread entry is the first one after the last one we read
+   fskit_entry_set* read_start = fskit_dir_itr_seek( &read_itr, dent, dirh->cookie );
+   if( read_start == NULL ) {
        
-       // advance to the next entry, since that's the first unread one 
-       read_start = fskit_entry_set_next( &read_itr );
-       if( read_start == NULL ) {
-           
-           // out of directory 
-           *num_read = 0;
-           return NULL;
-       }
+       // out of directory 
+       dirh->cookie = FSKIT_DIR_COOKIE_EOF;
+       *num_read = 0;
+       return NULL;
    }
-   
-   // UINT64_MAX means 'all children'
-   if( num_children == UINT64_MAX ) {
-      num_children = fskit_entry_set_count( dirh->dent->children );
+
+   struct fskit_dir_entry** dir_ents = NULL;
+
+   if( !plus && dent->listing_cache != NULL ) {
+
+      fskit_dir_itr_end( &read_itr );
+
+      // serve from the cached listing, without locking each child
+      struct fskit_dir_listing* listing = fskit_dir_listing_get( dent );
+      uint64_t last_cookie = 0;
+
+      if( listing != NULL ) {
+         dir_ents = fskit_dir_listing_read_entries( listing, dirh->cookie, num_children, num_read, &last_cookie );
+      }
+
+      if( dir_ents == NULL ) {
+         *err = -ENOMEM;
+         return NULL;
+      }
+
+      if( *num_read > 0 ) {
+         dirh->cookie = last_cookie;
+         return dir_ents;
+      }
    }
+   else {
 
-   struct fskit_dir_entry** dir_ents = fskit_readdir_itr(core, dent, num_children, num_read, read_start, &read_itr, err );
-   if( dir_ents == NULL ) {
-      return NULL;
+      dir_ents = fskit_readdir_itr(core, dent, num_children, num_read, read_start, &read_itr, plus, err );
+      if( dir_ents == NULL ) {
+         return NULL;
+      }
    }
       
    if( *num_read == 0 ) {
@@ -377,74 +748,37 @@ static struct fskit_dir_entry** fskit_readdir_lowlevel( struct fskit_core* core,
        dir_ents = NULL;
        
        // further attempts to read will EOF
-       dirh->eof = true;
+       dirh->cookie = FSKIT_DIR_COOKIE_EOF;
    }
    else {
        
-       // remember the last name, so we can resume there
-       memset( dirh->curr_name, 0, FSKIT_FILESYSTEM_NAMEMAX+1 );
-       strncpy( dirh->curr_name, dir_ents[*num_read-1]->name, FSKIT_FILESYSTEM_NAMEMAX );
+       // remember where we left off, so we can resume there
+       dirh->cookie = fskit_entry_name_cookie( dir_ents[*num_read-1]->name );
    }
    
    return dir_ents;
 }
 
 
-// seekdir(3)--revert to a point in the directory stream where we were reading from in the past
+// seekdir(3)--revert to a point in the directory stream where we were reading from in the past.
+// loc is a cookie from fskit_telldir (or fskit_getdents); entries added or removed since are accounted for.
 void fskit_seekdir( struct fskit_dir_handle* dirh, off_t loc ) {
     
     fskit_dir_handle_wlock( dirh );
     
-    // where did we leave off?
-    for( struct fskit_telldir_entry* tent = dirh->telldir_list; tent != NULL; tent = tent->next ) {
-        
-        if( tent->offset == loc ) {
-            
-            fskit_entry_set_itr read_itr;
-            fskit_entry_set* read_start = NULL;
-            
-            fskit_readdir_find_start( dirh, &read_itr, &read_start );
-            
-            if( read_start != NULL ) {
-                
-                // advance directory pointer 
-                strncpy( dirh->curr_name, fskit_entry_set_name_at( read_start ), FSKIT_FILESYSTEM_NAMEMAX );
-            }
-        }
-    }
+    dirh->cookie = (uint64_t)loc;
+    
     fskit_dir_handle_unlock( dirh );
 }
 
 
-// telldir(3)--store the current point in the directory stream where we are reading currently, so we can jump to it later.
+// telldir(3)--get the current point in the directory stream, so we can jump back to it later with fskit_seekdir.
+// this is the cookie of the last entry read, so it stays valid for as long as the directory exists.
 off_t fskit_telldir( struct fskit_dir_handle* dirh ) {
     
-    // random place...we just need it to be unique (w.h.p)
-    off_t offset = ((uint64_t)fskit_random32() << 32) | fskit_random32();
-    
-    struct fskit_telldir_entry* tent = CALLOC_LIST( struct fskit_telldir_entry, 1 );
-    if( tent == NULL ) {
-        
-        // emulate POSIX compliance
-        return -EBADF;
-    }
-    
-    // sanpshot read stream 
-    fskit_dir_handle_wlock( dirh );
+    fskit_dir_handle_rlock( dirh );
     
-    tent->offset = offset;
-    
-    if( strlen(dirh->curr_name) > 0 ) {
-        strcpy( tent->name, dirh->curr_name );
-    }
-    else {
-        memset( tent->name, 0, FSKIT_FILESYSTEM_NAMEMAX );
-    }
-    
-    // insert...
-    struct fskit_telldir_entry* tmp = dirh->telldir_list;
-    tent->next = tmp;
-    dirh->telldir_list = tent;
+    off_t offset = (off_t)dirh->cookie;
     
     fskit_dir_handle_unlock( dirh );
     return offset;
@@ -454,14 +788,7 @@ off_t fskit_telldir( struct fskit_dir_handle* dirh ) {
 // make the directory stream point to the beginning
 void fskit_rewinddir( struct fskit_dir_handle* dirh ) {
     
-    fskit_entry_set_itr read_itr;
-    
-    fskit_dir_handle_wlock( dirh );
-    
-    fskit_entry_set* start = fskit_entry_set_begin( &read_itr, dirh->dent->children );
-    strncpy( dirh->curr_name, fskit_entry_set_name_at( start ), FSKIT_FILESYSTEM_NAMEMAX );
-    
-    fskit_dir_handle_unlock( dirh );
+    fskit_seekdir( dirh, FSKIT_DIR_COOKIE_START );
 } 
 
 
@@ -520,19 +847,21 @@ int fskit_readdir_compactify_list( struct fskit_dir_entry*** ret_entries, uint64
 
 
 // read data from a directory, using the given directory handle.
+// if plus is true, snapshot each child's attributes too (see fskit_readdirplus)
 // returns a null-terminated list of directory entries
 // on failure, it sets *err to one of the following:
 // * -ENOMEM if no memory
 // * -EDEADLK if there would be deadlock (this is a bug if it happens)
 // * -EBADF if the directory hadndle is invalid
-struct fskit_dir_entry** fskit_readdir( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t num_children, uint64_t* num_read, int* err ) {
+static struct fskit_dir_entry** fskit_readdir_common( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t num_children, uint64_t* num_read, bool plus, int* err ) {
 
    int rc = 0;
 
-   rc = fskit_dir_handle_rlock( dirh );
+   // this moves the handle's stream position 
+   rc = fskit_dir_handle_wlock( dirh );
    if( rc != 0 ) {
       // shouldn't happen--indicates deadlock
-      fskit_error("fskit_dir_handle_rlock(%p) rc = %d\n", dirh, rc );
+      fskit_error("fskit_dir_handle_wlock(%p) rc = %d\n", dirh, rc );
       *err = rc;
       return NULL;
    }
@@ -556,14 +885,14 @@ struct fskit_dir_entry** fskit_readdir( struct fskit_core* core, struct fskit_di
       return NULL;
    }
    
-   struct fskit_dir_entry** dents = fskit_readdir_lowlevel( core, dirh, num_children, num_read, err );
+   struct fskit_dir_entry** dents = fskit_readdir_lowlevel( core, dirh, num_children, num_read, plus, err );
 
    fskit_entry_unlock( dirh->dent );
    
    if( dents != NULL ) {
       
       // run the user's readdir
-      rc = fskit_run_user_readdir( core, dirh->path, dirh->dent, dents, *num_read );
+      rc = fskit_run_user_readdir( core, NULL, dirh->dent, dents, *num_read );
       if( rc != 0 ) {
 
          fskit_dir_entry_free_list( dents );
@@ -595,9 +924,93 @@ struct fskit_dir_entry** fskit_readdir( struct fskit_core* core, struct fskit_di
    return dents;
 }
 
+// read data from a directory, using the given directory handle.
+// returns a null-terminated list of directory entries
+// on failure, it sets *err to one of the following:
+// * -ENOMEM if no memory
+// * -EDEADLK if there would be deadlock (this is a bug if it happens)
+// * -EBADF if the directory hadndle is invalid
+struct fskit_dir_entry** fskit_readdir( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t num_children, uint64_t* num_read, int* err ) {
+   return fskit_readdir_common( core, dirh, num_children, num_read, false, err );
+}
+
 // list a whole directory's data
 // returns a null-terminated list of entries, and set *num_read to the number actually consumed 
 // return NULL on error, and set *err
 struct fskit_dir_entry** fskit_listdir( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t* num_read, int* err ) {
    return fskit_readdir( core, dirh, UINT64_MAX, num_read, err );
 }
+
+// readdir, plus a stat snapshot of each entry, taken in the same locked pass over the directory.
+// this saves the caller a path resolution and fskit_stat() per entry (e.g. for ls -l).
+// the attributes are fskit_entry_fstat()'s; the user stat route is not called.
+// the readdir route still runs, and sees each entry as a plain fskit_dir_entry.
+// returns a null-terminated list, to be freed with fskit_dir_entry_plus_free_list
+// on failure, returns NULL and sets *err as fskit_readdir does
+struct fskit_dir_entry_plus** fskit_readdirplus( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t num_children, uint64_t* num_read, int* err ) {
+   return (struct fskit_dir_entry_plus**)fskit_readdir_common( core, dirh, num_children, num_read, true, err );
+}
+
+// read directory entries after the given cookie into buf, packed as struct fskit_dirent64 records (cf. getdents64(2)).
+// pass FSKIT_DIR_COOKIE_START to begin, and the last record's cookie to continue.
+// this allocates nothing and does not move dirh's own stream position.
+// unlike fskit_readdir, the readdir route is not run, so it cannot omit entries.
+// buf should be 8-byte aligned.
+// return the number of bytes written on success, or 0 at the end of the directory
+// return -EINVAL if buf cannot hold even the next record
+// return -EBADF if the directory handle is invalid
+ssize_t fskit_getdents( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t cookie, char* buf, size_t buflen ) {
+
+   int rc = 0;
+   ssize_t len = 0;
+
+   rc = fskit_dir_handle_rlock( dirh );
+   if( rc != 0 ) {
+      // shouldn't happen--indicates deadlock
+      fskit_error("fskit_dir_handle_rlock(%p) rc = %d\n", dirh, rc );
+      return rc;
+   }
+
+   struct fskit_entry* dent = dirh->dent;
+   if( dent == NULL ) {
+
+      // invalid
+      fskit_dir_handle_unlock( dirh );
+      return -EBADF;
+   }
+
+   rc = fskit_entry_rlock( dent );
+   if( rc != 0 ) {
+      // shouldn't happen--indicates deadlock
+      fskit_error("fskit_entry_rlock(%p) rc = %d\n", dent, rc );
+
+      fskit_dir_handle_unlock( dirh );
+      return rc;
+   }
+
+   if( dent->listing_cache != NULL ) {
+
+      // serve from the cached listing
+      struct fskit_dir_listing* listing = fskit_dir_listing_get( dent );
+      if( listing == NULL ) {
+         len = -ENOMEM;
+      }
+      else {
+         len = fskit_dir_listing_read( listing, cookie, buf, buflen );
+      }
+   }
+   else {
+
+      len = fskit_getdents_lowlevel( dent, cookie, buf, buflen );
+   }
+
+   fskit_entry_unlock( dent );
+   fskit_dir_handle_unlock( dirh );
+
+   return len;
+}
+
+// list a whole directory's data, with attributes (see fskit_readdirplus)
+struct fskit_dir_entry_plus** fskit_listdirplus( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t* num_read, int* err ) {
+   return fskit_readdirplus( core, dirh, UINT64_MAX, num_read, err );
+}
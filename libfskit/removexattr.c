@@ -22,6 +22,7 @@
 #include <fskit/removexattr.h>
 #include <fskit/path.h>
 #include <fskit/util.h>
+#include <fskit/cache.h>
 
 #include "fskit_private/private.h"
 
@@ -107,10 +108,14 @@ int fskit_fremovexattr( struct fskit_core* core, char const* path, struct fskit_
    
    if( rc == 0 ) {
       // removed 
+      fskit_entry_invalidate( core, fent );
       return 0;
    }
 
-   return fskit_xattr_fremovexattr( core, fent, name );
+   rc = fskit_xattr_fremovexattr( core, fent, name );
+   
+   fskit_entry_invalidate( core, fent );
+   return rc;
 }
 
 
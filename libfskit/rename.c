@@ -28,131 +28,23 @@
 #include "fskit_private/private.h"
 
 
-// set of entries 
-struct fskit_inode_set_entry_t {
-   
-   uint64_t file_id;
-   
-   struct fskit_inode_set_entry_t* left;
-   struct fskit_inode_set_entry_t* right;
-   char color;
-};
-
-typedef struct fskit_inode_set_entry_t fskit_inode_set;
-
-#define FSKIT_INODE_SET_CMP( i1, i2 ) ((i1)->file_id < (i2)->file_id ? -1 : (i1)->file_id == (i2)->file_id ? 0 : 1)
-
-SGLIB_DEFINE_RBTREE_PROTOTYPES( fskit_inode_set, left, right, color, FSKIT_INODE_SET_CMP );
-SGLIB_DEFINE_RBTREE_FUNCTIONS( fskit_inode_set, left, right, color, FSKIT_INODE_SET_CMP );
+// is dir the same as ancestor, or below it?  Walks dir's parent pointers up to the root, without locking or allocating.
+// dir must be a linked directory, and locked, so that it and its ancestors stay put (they can't be removed while not empty).
+// the core's rename_lock must be held, so that none of them is moved to another directory in the meantime.
+static bool fskit_entry_is_within( struct fskit_entry* dir, struct fskit_entry* ancestor ) {
 
+   struct fskit_entry* cur = dir;
 
-// see if an inode set contains an inode number 
-// return true if so; false if not 
-static bool fskit_inode_set_contains( fskit_inode_set* inode_set, uint64_t file_id ) {
-   
-   fskit_inode_set* member = NULL;
-   fskit_inode_set lookup;
-   memset( &lookup, 0, sizeof(fskit_inode_set) );
-   
-   member = sglib_fskit_inode_set_find_member( inode_set, &lookup );
-   if( member != NULL ) {
-      
-      return true;
-   }
-   else {
-      return false;
-   }
-}
-
+   while( cur != NULL ) {
 
-// callback to accumulate the set of inodes in a path.
-// return 0 on success 
-// return -EINVAL if a duplicate was detected (i.e. there's a path loop; indicates a bug in fskit)
-// return -ENOMEM on OOM
-static int fskit_entry_resolve_inodes_cb( struct fskit_entry* fent, void* cls ) {
-   
-   int rc = 0;
-   fskit_inode_set** inode_set = (fskit_inode_set**)cls;
-   bool new_inode_set = false;
-
-   if( *inode_set == NULL ) {
-      // empty 
-      *inode_set = CALLOC_LIST( fskit_inode_set, 1 );
-      if( *inode_set == NULL ) {
-         return -ENOMEM;
+      if( cur == ancestor ) {
+         return true;
       }
 
-      new_inode_set = true;
-   }
-   
-   fskit_inode_set* new_member = CALLOC_LIST( fskit_inode_set, 1 );
-   if( new_member == NULL ) {
-      return -ENOMEM;
-   }
-   
-   fskit_inode_set* member = NULL;
-   fskit_inode_set lookup;
-   
-   memset( &lookup, 0, sizeof(fskit_inode_set) );
-   
-   lookup.file_id = fent->file_id;
-  
-   if( !new_inode_set ) {
-       member = sglib_fskit_inode_set_find_member( *inode_set, &lookup );
-       if( member != NULL ) {
-      
-          // encountered this file ID before... 
-          fskit_debug("BUG: path loop: found %" PRIu64 " (%p) twice\n", fent->file_id, fent ); 
-          fskit_safe_free( new_member );
-          exit(1);
-
-          return -EINVAL;
-       }
+      cur = __atomic_load_n( &cur->parent, __ATOMIC_ACQUIRE );
    }
-   
-   // insert 
-   sglib_fskit_inode_set_add( inode_set, new_member );
-   return 0;
-}
-
 
-// free up an inode_set
-static int fskit_inode_set_free( fskit_inode_set* inode_set ) {
-   
-   if( inode_set != NULL ) {
-
-      struct sglib_fskit_inode_set_iterator itr;
-      fskit_inode_set* dp = NULL;
-      fskit_inode_set* old_dp = NULL;
-      
-      for( dp = sglib_fskit_inode_set_it_init_inorder( &itr, inode_set ); dp != NULL; ) {
-
-         old_dp = dp;
-         dp = sglib_fskit_inode_set_it_next( &itr );
-         fskit_safe_free( old_dp );
-      }
-   }
-   
-   return 0;
-}
-
-
-// look up an entry and accumulate the set of inodes, i.e. so the caller can use it to verify that a rename won't introduce a loop.
-// return a pointer to the write-locked entry on success, and sets *ret_inode_set to a malloc(3)'ed set of fskit_inode_set structures
-// return NULL on failure, and set *err to:
-// * -EINVAL if there was a loop 
-// * -ENOMEM on OOM
-// * path_resolution(7) error for things like e.g. permissions and access control
-static struct fskit_entry* fskit_entry_resolve_inodes( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, int* err, fskit_inode_set** ret_inode_set ) {
-   
-   fskit_inode_set* inode_set = NULL;
-   struct fskit_entry* dirent = NULL;
-   
-   dirent = fskit_entry_resolve_path_cls( core, path, user, group, true, err, fskit_entry_resolve_inodes_cb, &inode_set );
-   
-   *ret_inode_set = inode_set;
-   
-   return dirent;
+   return false;
 }
 
 
@@ -198,109 +90,110 @@ static int fskit_run_user_rename( struct fskit_core* core, char const* path, str
 }
 
 
-// rename an inode in a directory
+// rename an inode in a directory, in place: it keeps its links, its routes, and (if it is a directory) its .. entry.
+// the entry that new_name referred to, if any, is detached and its link count decremented; the caller must destroy it.
 // return 0 on success
-// NOTE: fent_common_parent must be write-locked, as must fent
+// NOTE: fent_parent must be write-locked, as must fent (and the entry at new_name, if there is one)
 // does NOT call the user route
 // return -ENOMEM on OOM 
 // return -ENOENT of fent is not present in fent_parent
 int fskit_entry_rename_in_directory( struct fskit_entry* fent_parent, struct fskit_entry* fent, char const* old_name, char const* new_name ) {
    
-   if( fskit_entry_set_find_name( fent_parent->children, old_name ) != fent ) {
+   struct fskit_entry* replaced = NULL;
+   int rc = 0;
+
+   if( fskit_dir_find_by_name( fent_parent, old_name ) != fent ) {
       return -ENOENT;
    }
    
-   fskit_entry_set_remove( &fent_parent->children, old_name );
+   replaced = fskit_dir_find_by_name( fent_parent, new_name );
+   if( replaced == fent ) {
+
+      // both names are links to fent already
+      return 0;
+   }
+
+   fskit_entry_dir_remove( fent_parent, old_name );
+   fskit_dir_versions_remove( fent_parent, old_name );
    
-   fskit_entry_set_remove( &fent_parent->children, new_name );
-   fskit_entry_set_insert( &fent_parent->children, new_name, fent );
+   if( replaced != NULL ) {
+
+      fskit_entry_name_clear( replaced, fent_parent, new_name, NULL );
+
+      fskit_entry_dir_remove( fent_parent, new_name );
+      fskit_dir_versions_remove( fent_parent, new_name );
+
+      __atomic_sub_fetch( &fent_parent->num_children, 1, __ATOMIC_RELAXED );
+
+      // should *never* happen
+      if( __atomic_sub_fetch( &replaced->link_count, 1, __ATOMIC_ACQ_REL ) < 0 ) {
+         fskit_error("BUG: negative link count on %" PRIX64 " ('%s')\n", replaced->file_id, new_name );
+         __atomic_store_n( &replaced->link_count, 0, __ATOMIC_RELEASE );
+      }
+
+      fskit_route_cache_stale( replaced );
+   }
+
+   rc = fskit_entry_dir_insert( fent_parent, new_name, fent );
+   if( rc == 0 ) {
+      fskit_dir_versions_insert( fent_parent, new_name, fent );
+      fskit_entry_name_set( fent, fent_parent, old_name, fent_parent, strdup_or_null( new_name ) );
+   }
    
-   return 0;
+   fskit_entry_children_changed( fent_parent );
+   fskit_entry_dir_touch( fent_parent );
+   
+   return rc;
 }
 
 
-// rename the inode at old_path to the one at new_path. This is an atomic operation.
+// do a rename, with the core's rename_lock held if the parents differ (see fskit_rename).
+// same_parent is set if old_path and new_path name the same directory.
 // return 0 on success
 // return negative on failure to resolve either old_path or new_path (see path_resolution(7))
-int fskit_rename( struct fskit_core* core, char const* old_path, char const* new_path, uint64_t user, uint64_t group ) {
+static int fskit_rename_lowlevel( struct fskit_core* core, char const* old_path, char const* new_path, bool same_parent, uint64_t user, uint64_t group ) {
 
    int err_old = 0, err_new = 0, err = 0;
 
    struct fskit_entry* fent_old_parent = NULL;
    struct fskit_entry* fent_new_parent = NULL;
    struct fskit_entry* fent_common_parent = NULL;
-   fskit_inode_set* new_path_inodes = NULL;
 
-   if( fskit_basename_len(old_path) > FSKIT_FILESYSTEM_NAMEMAX ) {
-      return -ENAMETOOLONG;
-   }
+   char old_path_basename[ FSKIT_FILESYSTEM_NAMEMAX+1 ];
+   char new_path_basename[ FSKIT_FILESYSTEM_NAMEMAX+1 ];
+   char const* base = NULL;
+   size_t base_len = 0;
 
-   if( fskit_basename_len(new_path) > FSKIT_FILESYSTEM_NAMEMAX ) {
-      return -ENAMETOOLONG;
-   }
+   if( same_parent ) {
 
-   // identify the parents of old_path and new_path
-   char* old_path_dirname = fskit_dirname( old_path, NULL );
-   char* new_path_dirname = fskit_dirname( new_path, NULL );
-   
-   if( old_path_dirname == NULL || new_path_dirname == NULL ) {
-      
-      fskit_safe_free( old_path_dirname );
-      fskit_safe_free( new_path_dirname );
-      return -ENOMEM;
+      // fast path: same parent, so only resolve and lock one path
+      fent_common_parent = fskit_entry_resolve_dir( core, old_path, user, group, true, &err_old );
    }
 
    // resolve the parent *lower* in the FS hierarchy first.  order matters due to locking!
-   if( fskit_depth( old_path ) > fskit_depth( new_path ) ) {
+   else if( fskit_depth( old_path ) > fskit_depth( new_path ) ) {
 
-      fent_old_parent = fskit_entry_resolve_path( core, old_path_dirname, user, group, true, &err_old );
+      fent_old_parent = fskit_entry_resolve_dir( core, old_path, user, group, true, &err_old );
       if( fent_old_parent != NULL ) {
 
-         fent_new_parent = fskit_entry_resolve_inodes( core, new_path_dirname, user, group, &err_new, &new_path_inodes );
+         fent_new_parent = fskit_entry_resolve_dir( core, new_path, user, group, true, &err_new );
       }
    }
-   else if( fskit_depth( old_path ) < fskit_depth( new_path ) ) {
-
-      fent_new_parent = fskit_entry_resolve_inodes( core, new_path_dirname, user, group, &err_new, &new_path_inodes );
-      fent_old_parent = fskit_entry_resolve_path( core, old_path_dirname, user, group, true, &err_old );
-   }
    else {
-      // do these paths have the same parent?
-      if( strcmp( old_path_dirname, new_path_dirname ) == 0 ) {
-         
-         // only resolve one path
-         fent_common_parent = fskit_entry_resolve_path( core, old_path_dirname, user, group, true, &err_old );
-      }
-      else {
-         
-         // parents are different; safe to lock both
-         fent_new_parent = fskit_entry_resolve_inodes( core, new_path_dirname, user, group, &err_new, &new_path_inodes );
-         fent_old_parent = fskit_entry_resolve_path( core, old_path_dirname, user, group, true, &err_old );
-      }
-   }
 
-   fskit_safe_free( old_path_dirname );
-   fskit_safe_free( new_path_dirname );
+      fent_new_parent = fskit_entry_resolve_dir( core, new_path, user, group, true, &err_new );
+      fent_old_parent = fskit_entry_resolve_dir( core, old_path, user, group, true, &err_old );
+   }
 
    if( err_new ) {
       
       fskit_entry_rename_unlock( fent_common_parent, fent_old_parent, fent_new_parent );
-      
-      if( new_path_inodes != NULL ) {
-         fskit_inode_set_free( new_path_inodes );
-      }
-      
       return err_new;
    }
 
    if( err_old ) {
       
       fskit_entry_rename_unlock( fent_common_parent, fent_old_parent, fent_new_parent );
-      
-      if( new_path_inodes != NULL ) {
-         fskit_inode_set_free( new_path_inodes );
-      }
-      
       return err_old;
    }
 
@@ -315,48 +208,56 @@ int fskit_rename( struct fskit_core* core, char const* old_path, char const* new
                                     || !FSKIT_ENTRY_IS_WRITEABLE( fent_common_parent->mode, fent_common_parent->owner, fent_common_parent->group, user, group ))) ) {
 
       fskit_entry_rename_unlock( fent_common_parent, fent_old_parent, fent_new_parent );
-      
-      if( new_path_inodes != NULL ) {
-         fskit_inode_set_free( new_path_inodes );
-      }
-      
       return -EACCES;
    }
 
    // now, look up the children
-   char* new_path_basename = fskit_basename( new_path, NULL );
-   char* old_path_basename = fskit_basename( old_path, NULL );
+   base = fskit_basename_view( old_path, &base_len );
+   fskit_path_name_copy( base, base_len, old_path_basename );
+
+   base = fskit_basename_view( new_path, &base_len );
+   fskit_path_name_copy( base, base_len, new_path_basename );
 
    struct fskit_entry* fent_old = NULL;
    struct fskit_entry* fent_new = NULL;
 
    if( fent_common_parent != NULL ) {
-      fent_new = fskit_entry_set_find_name( fent_common_parent->children, new_path_basename );
-      fent_old = fskit_entry_set_find_name( fent_common_parent->children, old_path_basename );
+      fent_new = fskit_dir_find_by_name( fent_common_parent, new_path_basename );
+      fent_old = fskit_dir_find_by_name( fent_common_parent, old_path_basename );
    }
    else {
-      fent_new = fskit_entry_set_find_name( fent_new_parent->children, new_path_basename );
-      fent_old = fskit_entry_set_find_name( fent_old_parent->children, old_path_basename );
+      fent_new = fskit_dir_find_by_name( fent_new_parent, new_path_basename );
+      fent_old = fskit_dir_find_by_name( fent_old_parent, old_path_basename );
    }
 
    // old must exist...
    err = 0;
-   if( fent_old == NULL ) {
+   if( fent_old == NULL || fent_old->creating ) {
       err = -ENOENT;
    }
 
+   // ...and new can't be in the middle of being created
+   else if( fent_new != NULL && fent_new->creating ) {
+      err = -EBUSY;
+   }
+
+   else if( fent_common_parent == NULL ) {
+
+      // a directory can't be moved below itself...
+      if( fent_old->type == FSKIT_ENTRY_TYPE_DIR && fskit_entry_is_within( fent_new_parent, fent_old ) ) {
+         err = -EINVAL;
+      }
+
+      // ...and can't be replaced by something inside it
+      else if( fent_new != NULL && fent_new->type == FSKIT_ENTRY_TYPE_DIR && fskit_entry_is_within( fent_old_parent, fent_new ) ) {
+         err = -ENOTEMPTY;
+      }
+   }
+
    // if we rename a file into itself, then it's okay (i.e. we're done)
    if( err != 0 || fent_old == fent_new ) {
       
       fskit_entry_rename_unlock( fent_common_parent, fent_old_parent, fent_new_parent );
-      
-      fskit_safe_free( new_path_basename );
-      fskit_safe_free( old_path_basename );
-      
-      if( new_path_inodes != NULL ) {
-         fskit_inode_set_free( new_path_inodes );
-      }
-      
       return err;
    }
 
@@ -384,19 +285,9 @@ int fskit_rename( struct fskit_core* core, char const* old_path, char const* new
       }
    }
    
-   if( err == 0 && fent_new != NULL ) {
-      
-      // verify no loops 
-      if( new_path_inodes != NULL && fskit_inode_set_contains( new_path_inodes, fent_new->file_id ) ) {
-         
-         // this rename would introduce a loop
-         err = -EINVAL;
-      }
-   }
-   
    if( err != 0 ) {
 
-      // directory mismatch, or loop 
+      // directory mismatch
       fskit_entry_rename_unlock( fent_common_parent, fent_old_parent, fent_new_parent );
       
       fskit_entry_unlock(fent_old);
@@ -404,21 +295,9 @@ int fskit_rename( struct fskit_core* core, char const* old_path, char const* new
          fskit_entry_unlock( fent_new );
       }
 
-      fskit_safe_free( new_path_basename );
-      fskit_safe_free( old_path_basename );
-      
-      if( new_path_inodes != NULL ) {
-         fskit_inode_set_free( new_path_inodes );
-      }
-
       return err;
    }
    
-   if( new_path_inodes != NULL ) {
-      fskit_inode_set_free( new_path_inodes );
-      new_path_inodes = NULL;
-   }
-   
    // user rename...
    // note that by construction, the consistency discipline will *not* be FSKIT_INODE_SEQUENTIAL.
    // this means it's safe to lock these entries.
@@ -443,51 +322,34 @@ int fskit_rename( struct fskit_core* core, char const* old_path, char const* new
       
       // user rename failure 
       fskit_entry_rename_unlock( fent_common_parent, fent_old_parent, fent_new_parent );
-      fskit_safe_free( new_path_basename );
-      fskit_safe_free( old_path_basename );
-      
       return err;
    }
 
    // perform the rename!
-   struct fskit_entry* dest_parent = NULL;
    err = 0;
 
    if( fent_common_parent != NULL ) {
 
-      // dealing with entries in the same directory
-      dest_parent = fent_common_parent;
-      
-      fskit_entry_detach_lowlevel( fent_common_parent, old_path_basename );
-      
-      // rename this fskit_entry
-      if( fent_new != NULL ) {
-         fskit_entry_detach_lowlevel( fent_common_parent, new_path_basename );
-      }
-
-      fskit_entry_attach_lowlevel( fent_common_parent, fent_old, new_path_basename );
+      // dealing with entries in the same directory: just swap the names
+      fskit_entry_rename_in_directory( fent_common_parent, fent_old, old_path_basename, new_path_basename );
    }
    else {
 
       // dealing with entries in different directories
-      dest_parent = fent_new_parent;
-
-      fskit_entry_detach_lowlevel( fent_old_parent, old_path_basename );
+      fskit_entry_detach_lowlevel_move( fent_old_parent, old_path_basename );
 
       // rename this fskit_entry
       if( fent_new != NULL ) {
          fskit_entry_detach_lowlevel( fent_new_parent, new_path_basename );
       }
 
-      fskit_entry_attach_lowlevel( fent_new_parent, fent_old, new_path_basename );
+      fskit_entry_attach_lowlevel_move( fent_new_parent, fent_old, new_path_basename );
+      fskit_entry_name_set( fent_old, fent_old_parent, old_path_basename, fent_new_parent, strdup_or_null( new_path_basename ) );
    }
    
    fskit_entry_unlock( fent_old );
-     
-   fskit_safe_free( old_path_basename );
-   fskit_safe_free( new_path_basename );
    
-   if( fent_new != NULL && err == 0 ) {
+   if( fent_new != NULL ) {
 
       fent_new->deletion_through_rename = true;
 
@@ -513,9 +375,45 @@ int fskit_rename( struct fskit_core* core, char const* old_path, char const* new
    // unlock everything
    fskit_entry_rename_unlock( fent_common_parent, fent_old_parent, fent_new_parent );
    
-   if( err != 0 ) {
-      // NOTE: passed into fent_old on success, so we need to consider the error code
-      fskit_safe_free( new_path_basename );
+   return err;
+}
+
+
+// rename the inode at old_path to the one at new_path. This is an atomic operation.
+// renames within one directory lock only that directory.  Renames across directories are serialized, so that
+// they can check for loops (moving a directory below itself) by walking parent pointers.
+// return 0 on success
+// return -EINVAL if old_path is a directory, and new_path is below it
+// return negative on failure to resolve either old_path or new_path (see path_resolution(7))
+int fskit_rename( struct fskit_core* core, char const* old_path, char const* new_path, uint64_t user, uint64_t group ) {
+
+   int err = 0;
+   bool same_parent = false;
+
+   size_t old_base_len = 0;
+   size_t new_base_len = 0;
+
+   fskit_basename_view( old_path, &old_base_len );
+   fskit_basename_view( new_path, &new_base_len );
+
+   if( old_base_len > FSKIT_FILESYSTEM_NAMEMAX || new_base_len > FSKIT_FILESYSTEM_NAMEMAX ) {
+      return -ENAMETOOLONG;
+   }
+
+   // do old_path and new_path have the same parent?
+   size_t old_dir_len = fskit_dirname_len( old_path );
+   size_t new_dir_len = fskit_dirname_len( new_path );
+
+   same_parent = ( old_dir_len == new_dir_len && memcmp( old_path, new_path, old_dir_len ) == 0 );
+
+   if( !same_parent ) {
+      pthread_mutex_lock( &core->rename_lock );
+   }
+
+   err = fskit_rename_lowlevel( core, old_path, new_path, same_parent, user, group );
+
+   if( !same_parent ) {
+      pthread_mutex_unlock( &core->rename_lock );
    }
 
    return err;
@@ -43,8 +43,13 @@ int fskit_rmdir( struct fskit_core* core, char const* _path, uint64_t user, uint
       return -ENAMETOOLONG;
    }
 
-   if( fskit_basename_len(_path) > FSKIT_FILESYSTEM_NAMEMAX ) {
-      return -ENAMETOOLONG;
+   char path_basename[FSKIT_FILESYSTEM_NAMEMAX+1];
+   size_t basename_len = 0;
+   char const* base = fskit_basename_view( _path, &basename_len );
+
+   rc = fskit_path_name_copy( base, basename_len, path_basename );
+   if( rc != 0 ) {
+      return rc;
    }
 
    // ensure path ends in /
@@ -55,19 +60,11 @@ int fskit_rmdir( struct fskit_core* core, char const* _path, uint64_t user, uint
    fskit_sanitize_path( path );
 
    // look up the parent and write-lock it
-   char* path_dirname = fskit_dirname( path, NULL );
-   char* path_basename = fskit_basename( path, NULL );
-
-   struct fskit_entry* parent = fskit_entry_resolve_path( core, path_dirname, user, group, true, &rc );
-
-   free( path_dirname );
+   struct fskit_entry* parent = fskit_entry_resolve_dir( core, path, user, group, true, &rc );
 
    if( !parent || rc ) {
 
       fskit_entry_unlock( parent );
-
-      free( path_basename );
-
       return rc;
    }
 
@@ -76,18 +73,16 @@ int fskit_rmdir( struct fskit_core* core, char const* _path, uint64_t user, uint
       // nope
       fskit_entry_unlock( parent );
 
-      free( path_basename );
-
       return -ENOTDIR;
    }
 
    // find the directory, and write-lock it
-   struct fskit_entry* dent = fskit_entry_set_find_name( parent->children, path_basename );
+   struct fskit_entry* dent = fskit_dir_find_by_name( parent, path_basename );
 
-   if( dent == NULL ) {
+   // (a reserved name does not exist until its create finishes)
+   if( dent == NULL || dent->creating ) {
 
       fskit_entry_unlock( parent );
-      fskit_safe_free( path_basename );
 
       return -ENOENT;
    }
@@ -99,25 +94,21 @@ int fskit_rmdir( struct fskit_core* core, char const* _path, uint64_t user, uint
       // nope
       fskit_entry_unlock( dent );
       fskit_entry_unlock( parent );
-      
-      fskit_safe_free( path_basename );
 
       return -ENOTDIR;
    }
 
    // IS THE PARENT EMPTY?
-   if( fskit_entry_set_count( dent->children ) > 2 ) {
+   if( fskit_entry_dir_count( dent ) > 2 ) {
       // nope
       fskit_entry_unlock( dent );
       fskit_entry_unlock( parent );
-      fskit_safe_free( path_basename );
       
       return -ENOTEMPTY;
    }
 
    // empty. Detach from the filesystem
    rc = fskit_entry_detach_lowlevel( parent, path_basename );
-   fskit_safe_free( path_basename );
    
    if( rc != 0 ) {
       fskit_error("fskit_entry_detach_lowlevel(%p) rc = %d\n", dent, rc );
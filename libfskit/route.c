@@ -437,8 +437,8 @@ static int fskit_match_regex( struct fskit_route_metadata* route_metadata, struc
 // is a route defined?
 static bool fskit_path_route_is_defined( struct fskit_path_route* route ) {
 
-   // a route is defined if it has a defined path regex
-   return route->path_regex_str != NULL;
+   // a route is defined if it has a defined path regex, or is bound to a subtree
+   return route->path_regex_str != NULL || route->scope != NULL;
 }
 
 // start running a route's callback.
@@ -453,8 +453,8 @@ static int fskit_route_enter( struct fskit_path_route* route, struct fskit_entry
    }
   
    // the fent must be ref'ed before the route is called 
-   if( fent != NULL && route->route_type != FSKIT_ROUTE_MATCH_DETACH && route->route_type != FSKIT_ROUTE_MATCH_DESTROY && fent->open_count <= 0 && fent->link_count <= 0 ) {
-      fskit_error("\n\nBUG: entry %p is not ref'ed (open = %d, link = %d)\n\n", fent, fent->open_count, fent->link_count);
+   if( fent != NULL && route->route_type != FSKIT_ROUTE_MATCH_DETACH && route->route_type != FSKIT_ROUTE_MATCH_DESTROY && fskit_entry_get_open_count( fent ) <= 0 && fskit_entry_get_link_count( fent ) <= 0 ) {
+      fskit_error("\n\nBUG: entry %p is not ref'ed (open = %d, link = %d)\n\n", fent, fskit_entry_get_open_count( fent ), fskit_entry_get_link_count( fent ));
       exit(1);
    }
 
@@ -628,6 +628,16 @@ static int fskit_route_dispatch( struct fskit_core* core, struct fskit_route_met
          rc = fskit_safe_dispatch( route->method.setmetadata_cb, core, route_metadata, fent, dargs->imd );
          break;
 
+      case FSKIT_ROUTE_MATCH_CREATE_MANY:
+
+         rc = fskit_safe_dispatch( route->method.create_many_cb, core, route_metadata, fent, dargs->batch_names, dargs->batch_fents, dargs->batch_len, dargs->batch_inode_data );
+         break;
+
+      case FSKIT_ROUTE_MATCH_DESTROY_MANY:
+
+         rc = fskit_safe_dispatch( route->method.destroy_many_cb, core, route_metadata, dargs->batch_paths, dargs->batch_file_ids, dargs->batch_inode_data, dargs->batch_len );
+         break;
+
       default:
 
          fskit_error("Invalid route dispatch code %d\n", route->route_type );
@@ -663,7 +673,8 @@ static struct fskit_path_route* fskit_route_match( fskit_route_table* route_tabl
       
       route = fskit_route_table_row_at_ref( row, i );
       
-      if( !fskit_path_route_is_defined( route ) ) {
+      if( !fskit_path_route_is_defined( route ) || route->path_regex_str == NULL ) {
+         // removed, or bound to a subtree
          continue;
       }
       
@@ -682,16 +693,35 @@ static struct fskit_path_route* fskit_route_match( fskit_route_table* route_tabl
 }
 
 
-// copy relevant route dispatch arguments to route metadata
-// return 0 on success
-static int fskit_route_metadata_populate( struct fskit_route_metadata* route_metadata, struct fskit_route_dispatch_args* dargs ) {
-   
-   if( dargs->name != NULL ) {
-      route_metadata->name = strdup( dargs->name );
-      if( route_metadata->name == NULL ) {
-         return -ENOMEM;
+// is there any route of this type that could apply to some entry?  Lets callers avoid building paths no route will look at.
+// return true if a route of this type has a regex, or if any route is bound to a subtree
+bool fskit_route_exists( struct fskit_core* core, int route_type ) {
+
+   bool found = fskit_route_scope_any_bound( core );
+   struct fskit_route_table_row* row = NULL;
+
+   fskit_core_route_rlock( core );
+
+   row = fskit_route_table_get_row( core->routes, route_type );
+
+   for( unsigned long i = 0; row != NULL && !found && i < fskit_route_table_row_len( row ); i++ ) {
+
+      struct fskit_path_route* route = fskit_route_table_row_at_ref( row, i );
+
+      if( fskit_path_route_is_defined( route ) && route->path_regex_str != NULL ) {
+         found = true;
       }
    }
+
+   fskit_core_route_unlock( core );
+
+   return found;
+}
+
+
+// copy relevant route dispatch arguments to route metadata
+// (everything except the name, which the caller owns)
+static void fskit_route_metadata_set_args( struct fskit_route_metadata* route_metadata, struct fskit_route_dispatch_args* dargs ) {
    
    route_metadata->parent = dargs->parent;
    route_metadata->new_parent = dargs->new_parent;
@@ -703,11 +733,466 @@ static int fskit_route_metadata_populate( struct fskit_route_metadata* route_met
    route_metadata->xattr_buf = dargs->xattr_buf;
    route_metadata->xattr_buf_len = dargs->xattr_buf_len;
    route_metadata->renamed = dargs->renamed;
+}
+
+
+// populate route metadata from the dispatch args 
+// return 0 on success
+// return -ENOMEM on OOM
+static int fskit_route_metadata_populate( struct fskit_route_metadata* route_metadata, struct fskit_route_dispatch_args* dargs ) {
+   
+   if( dargs->name != NULL ) {
+      route_metadata->name = strdup( dargs->name );
+      if( route_metadata->name == NULL ) {
+         return -ENOMEM;
+      }
+   }
+   
+   fskit_route_metadata_set_args( route_metadata, dargs );
+   return 0;
+}
+
+
+// nanoseconds elapsed since a given monotonic time 
+static uint64_t fskit_route_elapsed_ns( struct timespec* start ) {
+   
+   struct timespec now;
+   clock_gettime( CLOCK_MONOTONIC, &now );
+   
+   return (uint64_t)(now.tv_sec - start->tv_sec) * 1000000000ULL + (uint64_t)now.tv_nsec - (uint64_t)start->tv_nsec;
+}
+
+
+// wait for permission to run a route's callback.
+// callers are admitted in FIFO order, and at most route->max_concurrency callbacks run at once.
+// does nothing if the route has no concurrency limit.
+// return 0 on success 
+// return -EAGAIN if the route's queue is full
+static int fskit_route_admit( struct fskit_path_route* route ) {
+   
+   uint64_t ticket = 0;
+   uint64_t queue_depth = 0;
+   struct timespec start;
+   
+   if( route->max_concurrency <= 0 ) {
+      return 0;
+   }
+   
+   pthread_mutex_lock( &route->admit_lock );
+   
+   if( route->admit_head == route->admit_tail && route->stats.num_running < route->max_concurrency ) {
+      
+      // fast path: nobody is waiting, and there is capacity
+      route->stats.num_running++;
+      route->stats.num_calls++;
+      
+      pthread_mutex_unlock( &route->admit_lock );
+      return 0;
+   }
+   
+   queue_depth = route->admit_tail - route->admit_head;
+   if( route->max_queued > 0 && queue_depth >= (unsigned)route->max_queued ) {
+      
+      // shed load 
+      route->stats.num_rejected++;
+      
+      pthread_mutex_unlock( &route->admit_lock );
+      return -EAGAIN;
+   }
+   
+   // take a place in line 
+   ticket = route->admit_tail;
+   route->admit_tail++;
+   
+   route->stats.num_queued++;
+   route->stats.queue_depth = queue_depth + 1;
+   if( route->stats.queue_depth > route->stats.max_queue_depth ) {
+      route->stats.max_queue_depth = route->stats.queue_depth;
+   }
+   
+   clock_gettime( CLOCK_MONOTONIC, &start );
+   
+   while( route->admit_head != ticket || route->stats.num_running >= route->max_concurrency ) {
+      pthread_cond_wait( &route->admit_cond, &route->admit_lock );
+   }
+   
+   // our turn 
+   route->admit_head++;
+   route->stats.num_running++;
+   route->stats.num_calls++;
+   route->stats.queue_depth = route->admit_tail - route->admit_head;
+   
+   uint64_t wait_ns = fskit_route_elapsed_ns( &start );
+   route->stats.wait_time_ns += wait_ns;
+   if( wait_ns > route->stats.max_wait_time_ns ) {
+      route->stats.max_wait_time_ns = wait_ns;
+   }
+   
+   // the next caller in line may be admissible too
+   pthread_cond_broadcast( &route->admit_cond );
+   
+   pthread_mutex_unlock( &route->admit_lock );
    return 0;
 }
 
 
+// finish running a route's callback, and let the next caller in
+static void fskit_route_release( struct fskit_path_route* route ) {
+   
+   if( route->max_concurrency <= 0 ) {
+      return;
+   }
+   
+   pthread_mutex_lock( &route->admit_lock );
+   
+   route->stats.num_running--;
+   
+   if( route->admit_head != route->admit_tail ) {
+      pthread_cond_broadcast( &route->admit_cond );
+   }
+   
+   pthread_mutex_unlock( &route->admit_lock );
+}
+
+
+// a route dispatch, to be run on an executor 
+struct fskit_route_dispatch_job {
+   
+   struct fskit_core* core;
+   struct fskit_route_metadata* route_metadata;
+   struct fskit_path_route* route;
+   struct fskit_entry* fent;
+   struct fskit_route_dispatch_args* dargs;
+   
+   int rc;
+};
+
+// executor entry point for dispatching a route
+static void fskit_route_dispatch_job_main( void* arg ) {
+   
+   struct fskit_route_dispatch_job* job = (struct fskit_route_dispatch_job*)arg;
+   
+   job->rc = fskit_route_dispatch( job->core, job->route_metadata, job->route, job->fent, job->dargs );
+}
+
+
+// admit and dispatch a route, on the route's executor if it has one.
+// return the result of the callback
+// return -EAGAIN if the route's queue is full
+static int fskit_route_dispatch_admitted( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_path_route* route, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs ) {
+   
+   int rc = 0;
+   
+   rc = fskit_route_admit( route );
+   if( rc != 0 ) {
+      return rc;
+   }
+   
+   if( route->executor != NULL ) {
+      
+      struct fskit_route_dispatch_job job;
+      
+      job.core = core;
+      job.route_metadata = route_metadata;
+      job.route = route;
+      job.fent = fent;
+      job.dargs = dargs;
+      job.rc = 0;
+      
+      rc = fskit_executor_call( route->executor, fskit_route_dispatch_job_main, &job );
+      if( rc == 0 ) {
+         rc = job.rc;
+      }
+      else {
+         fskit_error("fskit_executor_call(route %s) rc = %d\n", route->path_regex_str, rc );
+      }
+   }
+   else {
+      
+      rc = fskit_route_dispatch( core, route_metadata, route, fent, dargs );
+   }
+   
+   fskit_route_release( route );
+   
+   return rc;
+}
+
+
+// can a call to this route be coalesced with identical concurrent calls?
+// only idempotent route types whose outputs we know how to copy qualify.
+static bool fskit_route_can_coalesce( struct fskit_path_route* route, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs ) {
+   
+   if( !route->coalesce || fent == NULL ) {
+      return false;
+   }
+   
+   switch( route->route_type ) {
+      
+      case FSKIT_ROUTE_MATCH_STAT:
+         return dargs->sb != NULL;
+         
+      case FSKIT_ROUTE_MATCH_READ:
+         return dargs->io_cont == NULL;
+         
+      case FSKIT_ROUTE_MATCH_GETXATTR:
+      case FSKIT_ROUTE_MATCH_LISTXATTR:
+      case FSKIT_ROUTE_MATCH_READDIR:
+         return true;
+         
+      default:
+         return false;
+   }
+}
+
+
+// hash the listing given to a readdir route, so we only coalesce readdirs over the same entries 
+static uint64_t fskit_route_dents_hash( struct fskit_dir_entry** dents, uint64_t num_dents ) {
+   
+   // FNV-1a 
+   uint64_t hash = 14695981039346656037ULL;
+   
+   for( uint64_t i = 0; i < num_dents; i++ ) {
+      
+      if( dents[i] == NULL ) {
+         continue;
+      }
+      
+      for( unsigned int j = 0; j < sizeof(uint64_t); j++ ) {
+         
+         hash ^= (dents[i]->file_id >> (8 * j)) & 0xff;
+         hash *= 1099511628211ULL;
+      }
+      
+      for( char const* c = dents[i]->name; *c != '\0'; c++ ) {
+         
+         hash ^= (unsigned char)(*c);
+         hash *= 1099511628211ULL;
+      }
+   }
+   
+   return hash;
+}
+
+
+// set up a flight's key from a call's arguments
+static void fskit_route_flight_init( struct fskit_route_flight* flight, struct fskit_path_route* route, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs ) {
+   
+   memset( flight, 0, sizeof(struct fskit_route_flight) );
+   
+   flight->fent = fent;
+   flight->dargs = dargs;
+   
+   switch( route->route_type ) {
+      
+      case FSKIT_ROUTE_MATCH_READ:
+         
+         flight->handle_data = dargs->handle_data;
+         flight->iooff = dargs->iooff;
+         flight->iolen = dargs->iolen;
+         break;
+         
+      case FSKIT_ROUTE_MATCH_GETXATTR:
+         
+         flight->xattr_name = dargs->xattr_name;
+         flight->xattr_buf_len = dargs->xattr_buf_len;
+         break;
+         
+      case FSKIT_ROUTE_MATCH_LISTXATTR:
+         
+         flight->xattr_buf_len = dargs->xattr_buf_len;
+         break;
+         
+      case FSKIT_ROUTE_MATCH_READDIR:
+         
+         flight->handle_data = dargs->handle_data;
+         flight->num_dents = dargs->num_dents;
+         flight->dents_hash = fskit_route_dents_hash( dargs->dents, dargs->num_dents );
+         break;
+         
+      default:
+         break;
+   }
+}
+
+
+// are two flights for the same call?
+static bool fskit_route_flight_eq( struct fskit_route_flight* f1, struct fskit_route_flight* f2 ) {
+   
+   if( f1->fent != f2->fent || f1->handle_data != f2->handle_data || f1->iooff != f2->iooff || f1->iolen != f2->iolen || f1->xattr_buf_len != f2->xattr_buf_len || f1->num_dents != f2->num_dents || f1->dents_hash != f2->dents_hash ) {
+      return false;
+   }
+   
+   if( (f1->xattr_name == NULL) != (f2->xattr_name == NULL) ) {
+      return false;
+   }
+   
+   if( f1->xattr_name != NULL && strcmp( f1->xattr_name, f2->xattr_name ) != 0 ) {
+      return false;
+   }
+   
+   return true;
+}
+
+
+// copy a finished flight's outputs into a follower's arguments 
+static void fskit_route_flight_copy_result( struct fskit_path_route* route, struct fskit_route_flight* leader, struct fskit_route_dispatch_args* dargs ) {
+   
+   struct fskit_route_dispatch_args* leader_dargs = leader->dargs;
+   
+   switch( route->route_type ) {
+      
+      case FSKIT_ROUTE_MATCH_STAT:
+         
+         if( leader->cbrc == 0 ) {
+            memcpy( dargs->sb, leader_dargs->sb, sizeof(struct stat) );
+         }
+         break;
+         
+      case FSKIT_ROUTE_MATCH_READ:
+         
+         if( leader->cbrc > 0 ) {
+            memcpy( dargs->iobuf, leader_dargs->iobuf, MIN( (size_t)leader->cbrc, dargs->iolen ) );
+         }
+         break;
+         
+      case FSKIT_ROUTE_MATCH_GETXATTR:
+      case FSKIT_ROUTE_MATCH_LISTXATTR:
+         
+         if( leader->cbrc > 0 && dargs->xattr_buf != NULL && leader_dargs->xattr_buf != NULL ) {
+            memcpy( dargs->xattr_buf, leader_dargs->xattr_buf, MIN( (size_t)leader->cbrc, dargs->xattr_buf_len ) );
+         }
+         break;
+         
+      case FSKIT_ROUTE_MATCH_READDIR:
+         
+         // replay the leader's omissions
+         for( uint64_t i = 0; i < dargs->num_dents; i++ ) {
+            
+            if( leader_dargs->dents[i] == NULL && dargs->dents[i] != NULL ) {
+               fskit_readdir_omit( dargs->dents, i );
+            }
+         }
+         break;
+         
+      default:
+         break;
+   }
+}
+
+
+// dispatch a route, sharing the result with identical concurrent calls.
+// the first caller (the leader) runs the callback; callers that arrive while it runs wait and copy its outputs.
+// return the result of the callback 
+static int fskit_route_dispatch_coalesced( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_path_route* route, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs ) {
+   
+   int rc = 0;
+   struct fskit_route_flight flight;
+   struct fskit_route_flight* leader = NULL;
+   
+   fskit_route_flight_init( &flight, route, fent, dargs );
+   
+   pthread_mutex_lock( &route->flight_lock );
+   
+   for( leader = route->flights; leader != NULL; leader = leader->next ) {
+      
+      if( fskit_route_flight_eq( leader, &flight ) ) {
+         break;
+      }
+   }
+   
+   if( leader != NULL ) {
+      
+      // someone's already asking.  wait for the answer 
+      leader->num_waiters++;
+      
+      while( !leader->done ) {
+         pthread_cond_wait( &leader->cond, &route->flight_lock );
+      }
+      
+      rc = leader->cbrc;
+      fskit_route_flight_copy_result( route, leader, dargs );
+      
+      leader->num_waiters--;
+      if( leader->num_waiters == 0 ) {
+         
+         // leader can go now
+         pthread_cond_broadcast( &leader->cond );
+      }
+      
+      pthread_mutex_unlock( &route->flight_lock );
+      
+      __atomic_fetch_add( &route->stats.num_coalesced, 1, __ATOMIC_RELAXED );
+      return rc;
+   }
+   
+   // we're the leader 
+   pthread_cond_init( &flight.cond, NULL );
+   flight.next = route->flights;
+   route->flights = &flight;
+   
+   pthread_mutex_unlock( &route->flight_lock );
+   
+   rc = fskit_route_dispatch_admitted( core, route_metadata, route, fent, dargs );
+   
+   pthread_mutex_lock( &route->flight_lock );
+   
+   // no new followers 
+   for( struct fskit_route_flight** itr = &route->flights; *itr != NULL; itr = &(*itr)->next ) {
+      
+      if( *itr == &flight ) {
+         *itr = flight.next;
+         break;
+      }
+   }
+   
+   flight.cbrc = rc;
+   flight.done = true;
+   pthread_cond_broadcast( &flight.cond );
+   
+   // our outputs must remain valid until every follower has copied them 
+   while( flight.num_waiters > 0 ) {
+      pthread_cond_wait( &flight.cond, &route->flight_lock );
+   }
+   
+   pthread_mutex_unlock( &route->flight_lock );
+   
+   pthread_cond_destroy( &flight.cond );
+   
+   return rc;
+}
+
+
+// call a route for an entry whose path the caller does not have (e.g. on behalf of a file handle).
+// the path is built from the entry's names, but only if some route of this type might want it.
+// return 0 on success, -EPERM if no route found
+// place the callback status in *cbrc, if called.  If the path can't be built, no route runs and *cbrc is
+// set to the error (-ENOENT or -ENOMEM), so the caller fails instead of carrying on as if there were no route.
+static int fskit_route_call_unnamed( struct fskit_core* core, int route_type, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc ) {
+
+   int rc = 0;
+   char* path = NULL;
+
+   if( fent == NULL || !fskit_route_exists( core, route_type ) ) {
+      return -EPERM;
+   }
+
+   path = fskit_entry_get_path( fent, &rc );
+   if( path == NULL ) {
+
+      fskit_error("fskit_entry_get_path(%" PRIX64 ") rc = %d\n", fent->file_id, rc );
+      *cbrc = rc;
+      return 0;
+   }
+
+   rc = fskit_route_call( core, route_type, path, fent, dargs, cbrc );
+
+   fskit_safe_free( path );
+   return rc;
+}
+
+
 // call a route
+// path may be NULL, in which case it is built from fent's names if a route needs it.
 // return 0 on success, -EPERM if no route found
 // place the callback status in *cbrc, if called.
 // NOTE: fent *cannot* be locked--its lock status will be set through the route consistency discipline
@@ -716,40 +1201,353 @@ int fskit_route_call( struct fskit_core* core, int route_type, char const* path,
    int rc = 0;   
    struct fskit_route_metadata route_metadata;   
    struct fskit_path_route* route = NULL;
+   uint64_t cache_gen = 0;
+
+   if( path == NULL ) {
+      return fskit_route_call_unnamed( core, route_type, fent, dargs, cbrc );
+   }
+
+   memset( &route_metadata, 0, sizeof(struct fskit_route_metadata) );
+
+   // stop routes from getting changed out from under us
+   fskit_core_route_rlock( core );
+
+   // routes bound to the entry's subtree take precedence, and need no matching
+   route = fskit_route_scope_find( core, route_type, fent, dargs );
+   if( route != NULL ) {
+      
+      route_metadata.path = strdup( path );
+      if( route_metadata.path == NULL ) {
+         
+         fskit_core_route_unlock( core );
+         return -EPERM;
+      }
+   }
+   else {
+      
+      route = fskit_route_match( core->routes, route_type, path, &route_metadata );
+   }
+
+   if( route == NULL ) {
+      // no route found
+      fskit_core_route_unlock( core );
+      return -EPERM;
+   }
+   
+   // cached result?
+   if( fskit_route_cache_lookup( core, route, fent, dargs, cbrc, &cache_gen ) == 0 ) {
+      
+      // served from cache
+      fskit_core_route_unlock( core );
+      return fskit_route_metadata_free( &route_metadata );
+   }
+   
+   // found. propagate arguments 
+   rc = fskit_route_metadata_populate( &route_metadata, dargs );
+   if( rc != 0 ) {
+      
+      // failed for some reason
+      fskit_core_route_unlock( core );
+      fskit_route_metadata_free( &route_metadata );
+      return -EPERM;
+   }
+   
+   
+   fskit_debug("Call route type %d (%d)\n", route->route_type, route_type );
+               
+   // dispatch
+   if( fskit_route_can_coalesce( route, fent, dargs ) ) {
+      *cbrc = fskit_route_dispatch_coalesced( core, &route_metadata, route, fent, dargs );
+   }
+   else {
+      *cbrc = fskit_route_dispatch_admitted( core, &route_metadata, route, fent, dargs );
+   }
+   
+   fskit_route_cache_insert( core, route, fent, dargs, *cbrc, cache_gen );
+
+   fskit_core_route_unlock( core );
 
+   rc = fskit_route_metadata_free( &route_metadata );
+   return rc;
+}
+
+
+// which of a file handle's pins holds a given route type?
+// return the FSKIT_FILE_HANDLE_PIN_* index, or -1 if the route type is not pinned
+static int fskit_route_pin_index( int route_type ) {
+   
+   switch( route_type ) {
+      
+      case FSKIT_ROUTE_MATCH_READ:
+         return FSKIT_FILE_HANDLE_PIN_READ;
+         
+      case FSKIT_ROUTE_MATCH_WRITE:
+         return FSKIT_FILE_HANDLE_PIN_WRITE;
+         
+      case FSKIT_ROUTE_MATCH_TRUNC:
+         return FSKIT_FILE_HANDLE_PIN_TRUNC;
+         
+      case FSKIT_ROUTE_MATCH_SYNC:
+         return FSKIT_FILE_HANDLE_PIN_SYNC;
+         
+      case FSKIT_ROUTE_MATCH_CLOSE:
+         return FSKIT_FILE_HANDLE_PIN_CLOSE;
+         
+      default:
+         return -1;
+   }
+}
+
+
+// free a route pin 
+static void fskit_route_pin_free( struct fskit_route_pin* pin ) {
+   
+   struct fskit_route_metadata route_metadata;
+   
+   // the pin owns its match groups, just as route metadata would
+   memset( &route_metadata, 0, sizeof(struct fskit_route_metadata) );
+   route_metadata.path = pin->path;
+   route_metadata.argc = pin->argc;
+   route_metadata.argv = pin->argv;
+   
+   fskit_route_metadata_free( &route_metadata );
+   fskit_safe_free( pin );
+}
+
+
+// resolve a route for a path, and remember the match so it can be reused.
+// the core's route table must be read-locked.
+// return the new pin on success (whose route is NULL if nothing matched)
+// return NULL on OOM
+static struct fskit_route_pin* fskit_route_pin_new( struct fskit_core* core, int route_type, char const* path ) {
+   
+   struct fskit_route_metadata route_metadata;
+   struct fskit_route_pin* pin = CALLOC_LIST( struct fskit_route_pin, 1 );
+   
+   if( pin == NULL ) {
+      return NULL;
+   }
+   
+   memset( &route_metadata, 0, sizeof(struct fskit_route_metadata) );
+   
+   pin->route_gen = core->route_gen;
+   pin->route = fskit_route_match( core->routes, route_type, path, &route_metadata );
+   
+   pin->path = route_metadata.path;
+   pin->argc = route_metadata.argc;
+   pin->argv = route_metadata.argv;
+   
+   return pin;
+}
+
+
+// get a file handle's pinned route for a route type, re-resolving it if the route table has changed since it was pinned.
+// path is the handle's path; if NULL, it is built from the handle's entry's names (only if the pin needs re-resolving).
+// the core's route table must be read-locked.
+// return the pin on success 
+// return NULL on OOM, or if the entry has no path
+static struct fskit_route_pin* fskit_route_pin_get( struct fskit_core* core, struct fskit_file_handle* fh, int pin_idx, int route_type, char const* path ) {
+   
+   struct fskit_route_pin* pin = __atomic_load_n( &fh->route_pins[pin_idx], __ATOMIC_ACQUIRE );
+   struct fskit_route_pin* new_pin = NULL;
+   char* entry_path = NULL;
+   int rc = 0;
+   
+   if( pin != NULL && pin->route_gen == core->route_gen ) {
+      // fast path
+      return pin;
+   }
+   
+   if( path == NULL ) {
+      
+      entry_path = fskit_entry_get_path( fh->fent, &rc );
+      if( entry_path == NULL ) {
+         return NULL;
+      }
+      
+      path = entry_path;
+   }
+   
+   new_pin = fskit_route_pin_new( core, route_type, path );
+   fskit_safe_free( entry_path );
+   
+   if( new_pin == NULL ) {
+      return NULL;
+   }
+   
+   if( __atomic_compare_exchange_n( &fh->route_pins[pin_idx], &pin, new_pin, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) ) {
+      
+      // other threads may still be using the old pin
+      if( pin != NULL ) {
+         
+         pthread_mutex_lock( &fh->pin_lock );
+         
+         pin->next = fh->retired_pins;
+         fh->retired_pins = pin;
+         
+         pthread_mutex_unlock( &fh->pin_lock );
+      }
+      
+      return new_pin;
+   }
+   
+   // someone else refreshed it first.  Since we hold the route table read lock, theirs is current too.
+   fskit_route_pin_free( new_pin );
+   return pin;
+}
+
+
+// resolve and pin the routes a file handle will use for I/O, so we don't have to match them against its path on every call.
+// path is the path the handle was opened with.
+// return 0 on success
+// return -ENOMEM on OOM
+int fskit_file_handle_pin_routes( struct fskit_core* core, struct fskit_file_handle* fh, char const* path ) {
+   
+   static int const pinned_types[ FSKIT_FILE_HANDLE_NUM_PINS ] = {
+      FSKIT_ROUTE_MATCH_READ,
+      FSKIT_ROUTE_MATCH_WRITE,
+      FSKIT_ROUTE_MATCH_TRUNC,
+      FSKIT_ROUTE_MATCH_SYNC,
+      FSKIT_ROUTE_MATCH_CLOSE
+   };
+   
+   int rc = 0;
+   
+   pthread_mutex_init( &fh->pin_lock, NULL );
+   
+   fskit_core_route_rlock( core );
+   
+   for( int i = 0; i < FSKIT_FILE_HANDLE_NUM_PINS; i++ ) {
+      
+      if( fskit_route_pin_get( core, fh, fskit_route_pin_index( pinned_types[i] ), pinned_types[i], path ) == NULL ) {
+         
+         rc = -ENOMEM;
+         break;
+      }
+   }
+   
+   fskit_core_route_unlock( core );
+   
+   return rc;
+}
+
+
+// free a file handle's pinned routes 
+// return 0 on success
+int fskit_file_handle_unpin_routes( struct fskit_file_handle* fh ) {
+   
+   struct fskit_route_pin* pin = NULL;
+   
+   for( int i = 0; i < FSKIT_FILE_HANDLE_NUM_PINS; i++ ) {
+      
+      if( fh->route_pins[i] != NULL ) {
+         
+         fskit_route_pin_free( fh->route_pins[i] );
+         fh->route_pins[i] = NULL;
+      }
+   }
+   
+   pin = fh->retired_pins;
+   while( pin != NULL ) {
+      
+      struct fskit_route_pin* next = pin->next;
+      fskit_route_pin_free( pin );
+      pin = next;
+   }
+   
+   fh->retired_pins = NULL;
+   
+   pthread_mutex_destroy( &fh->pin_lock );
+   return 0;
+}
+
+
+// call a route on behalf of a file handle, using the route pinned when it was opened.
+// this skips regex matching unless the route table has changed since.
+// path may be NULL, in which case it is built from fent's names only if a route needs it (i.e. one that is not pinned).
+// if fh is NULL, or the route type is not pinned, this is the same as fskit_route_call.
+// return 0 on success, -EPERM if no route found
+// place the callback status in *cbrc, if called.
+// NOTE: fent *cannot* be locked--its lock status will be set through the route consistency discipline
+int fskit_route_call_pinned( struct fskit_core* core, struct fskit_file_handle* fh, int route_type, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc ) {
+   
+   int pin_idx = fskit_route_pin_index( route_type );
+   struct fskit_route_pin* pin = NULL;
+   struct fskit_path_route* route = NULL;
+   struct fskit_route_metadata route_metadata;
+   char* entry_path = NULL;
+   int rc = 0;
+   
+   if( fh == NULL || pin_idx < 0 ) {
+      return fskit_route_call( core, route_type, path, fent, dargs, cbrc );
+   }
+   
+   // borrow the pinned match groups and the caller's arguments; nothing here is allocated or freed (besides fent's path, if needed)
    memset( &route_metadata, 0, sizeof(struct fskit_route_metadata) );
-
+   
    // stop routes from getting changed out from under us
    fskit_core_route_rlock( core );
-
-   route = fskit_route_match( core->routes, route_type, path, &route_metadata );
-
-   if( route == NULL ) {
-      // no route found
-      fskit_core_route_unlock( core );
-      return -EPERM;
-   }
    
-   // found. propagate arguments 
-   rc = fskit_route_metadata_populate( &route_metadata, dargs );
-   if( rc != 0 ) {
+   // subtree-bound routes follow the entry, not the path, so they are never pinned
+   route = fskit_route_scope_find( core, route_type, fent, dargs );
+   if( route != NULL ) {
       
-      // failed for some reason
-      fskit_core_route_unlock( core );
-      fskit_route_metadata_free( &route_metadata );
-      return -EPERM;
+      if( path == NULL ) {
+         
+         entry_path = fskit_entry_get_path( fent, &rc );
+         if( entry_path == NULL ) {
+            
+            // unlinked, or OOM.  There is a route, so this is its failure (see fskit_route_call_unnamed)
+            fskit_core_route_unlock( core );
+            
+            fskit_error("fskit_entry_get_path(%" PRIX64 ") rc = %d\n", fent->file_id, rc );
+            *cbrc = rc;
+            return 0;
+         }
+         
+         path = entry_path;
+      }
+      
+      route_metadata.path = (char*)path;
+   }
+   else {
+      
+      pin = fskit_route_pin_get( core, fh, pin_idx, route_type, path );
+      if( pin == NULL ) {
+         
+         // OOM, or no path; do it the slow way, which reports the latter
+         fskit_core_route_unlock( core );
+         return fskit_route_call( core, route_type, path, fent, dargs, cbrc );
+      }
+      
+      if( pin->route == NULL ) {
+         
+         // no route 
+         fskit_core_route_unlock( core );
+         return -EPERM;
+      }
+      
+      route = pin->route;
+      route_metadata.path = pin->path;
+      route_metadata.argc = pin->argc;
+      route_metadata.argv = pin->argv;
    }
    
+   route_metadata.name = (char*)dargs->name;
+   
+   fskit_route_metadata_set_args( &route_metadata, dargs );
+   
+   if( fskit_route_can_coalesce( route, fent, dargs ) ) {
+      *cbrc = fskit_route_dispatch_coalesced( core, &route_metadata, route, fent, dargs );
+   }
+   else {
+      *cbrc = fskit_route_dispatch_admitted( core, &route_metadata, route, fent, dargs );
+   }
    
-   fskit_debug("Call route type %d (%d)\n", route->route_type, route_type );
-               
-   // dispatch
-   *cbrc = fskit_route_dispatch( core, &route_metadata, route, fent, dargs );
-
    fskit_core_route_unlock( core );
-
-   rc = fskit_route_metadata_free( &route_metadata );
-   return rc;
+   
+   fskit_safe_free( entry_path );
+   return 0;
 }
 
 
@@ -932,34 +1730,80 @@ int fskit_route_call_setmetadata( struct fskit_core* core, char const* path, str
 }
 
 
+// call the route to create a batch of children in a directory (fent).  The children's inode data will be set in dargs on success.
+// return 0 if a route was called, or -EPERM if there are no routes.
+// set the route callback return code in *cbrc
+// NOTE: fent *cannot* be locked--its lock status will be set through the route consistency discipline
+int fskit_route_call_create_many( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc ) {
+   return fskit_route_call( core, FSKIT_ROUTE_MATCH_CREATE_MANY, path, fent, dargs, cbrc );
+}
+
+
+// call the route to destroy a batch of entries removed from the directory at path.
+// there is no entry to enforce an inode consistency discipline on; the entries are unreachable by now anyway.
+// return 0 if a route was called, or -EPERM if there are no routes.
+// set the route callback return code in *cbrc
+int fskit_route_call_destroy_many( struct fskit_core* core, char const* path, struct fskit_route_dispatch_args* dargs, int* cbrc ) {
+   return fskit_route_call( core, FSKIT_ROUTE_MATCH_DESTROY_MANY, path, NULL, dargs, cbrc );
+}
+
+
 // initialize a path route
+// opts may be NULL, in which case the defaults are used
 // return 0 on success, negative on error
-static int fskit_path_route_init( struct fskit_path_route* route, char const* regex_str, int consistency_discipline, int route_type, union fskit_route_method method ) {
+static int fskit_path_route_init( struct fskit_path_route* route, char const* regex_str, int consistency_discipline, int route_type, union fskit_route_method method, struct fskit_route_opts const* opts ) {
 
    int rc = 0;
    memset( route, 0, sizeof(struct fskit_path_route) );
    
-   rc = regcomp( &route->path_regex, regex_str, REG_EXTENDED | REG_NEWLINE );
-   if( rc != 0 ) {
-
-      fskit_error("regcomp('%s') rc = %d\n", regex_str, rc );
+   if( opts != NULL && opts->subtree != NULL ) {
+      
+      // bound to a directory, not a regex 
+      rc = fskit_route_scope_ref_dir( opts->subtree, &route->scope );
+      if( rc != 0 ) {
+         return rc;
+      }
+   }
+   else if( regex_str == NULL ) {
+      
       return -EINVAL;
    }
+   else {
+      
+      rc = regcomp( &route->path_regex, regex_str, REG_EXTENDED | REG_NEWLINE );
+      if( rc != 0 ) {
 
-   route->path_regex_str = strdup( regex_str );
-   if( route->path_regex_str == NULL ) {
+         fskit_error("regcomp('%s') rc = %d\n", regex_str, rc );
+         return -EINVAL;
+      }
 
-      regfree( &route->path_regex );
-      return -ENOMEM;
-   }
+      route->path_regex_str = strdup( regex_str );
+      if( route->path_regex_str == NULL ) {
+
+         regfree( &route->path_regex );
+         return -ENOMEM;
+      }
 
-   route->num_expected_matches = fskit_num_expected_matches( regex_str );
+      route->num_expected_matches = fskit_num_expected_matches( regex_str );
+   }
 
    route->consistency_discipline = consistency_discipline;
    route->route_type = route_type;
    route->method = method;
 
+   if( opts != NULL ) {
+      
+      route->max_concurrency = opts->max_concurrency;
+      route->max_queued = opts->max_queued;
+      route->executor = opts->executor;
+      route->coalesce = opts->coalesce;
+      route->cache_ttl_ns = opts->cache_ttl_ms * 1000000ULL;
+   }
+
    pthread_rwlock_init( &route->lock, NULL );
+   pthread_mutex_init( &route->admit_lock, NULL );
+   pthread_cond_init( &route->admit_cond, NULL );
+   pthread_mutex_init( &route->flight_lock, NULL );
 
    return 0;
 }
@@ -967,14 +1811,28 @@ static int fskit_path_route_init( struct fskit_path_route* route, char const* re
 // free a path route
 int fskit_path_route_free( struct fskit_path_route* route ) {
 
-   if( route->path_regex_str != NULL ) {
-      fskit_safe_free( route->path_regex_str );
-      route->path_regex_str = NULL;
+   if( fskit_path_route_is_defined( route ) ) {
+      
+      if( route->path_regex_str != NULL ) {
+         
+         fskit_safe_free( route->path_regex_str );
+         route->path_regex_str = NULL;
 
-      // NOTE: the regex is only set if the string is set
-      regfree( &route->path_regex );
+         // NOTE: the regex is only set if the string is set
+         regfree( &route->path_regex );
+      }
+      
+      if( route->scope != NULL ) {
+         
+         fskit_route_scope_unbind( route );
+         fskit_route_scope_put( route->scope );
+         route->scope = NULL;
+      }
 
       pthread_rwlock_destroy( &route->lock );
+      pthread_mutex_destroy( &route->admit_lock );
+      pthread_cond_destroy( &route->admit_cond );
+      pthread_mutex_destroy( &route->flight_lock );
    }
 
    memset( route, 0, sizeof(struct fskit_path_route) );
@@ -1002,18 +1860,26 @@ static int fskit_path_route_erase_all( fskit_route_table** route_table, int rout
 }
 
 // declare a route
+// opts may be NULL 
 // return >= 0 on success (this is the "route handle")
-// return -EINVAL if we couldn't compile the regex
+// return -EINVAL if we couldn't compile the regex, or if opts are invalid
 // return -ENOMEM if out of memory
-static int fskit_path_route_decl( struct fskit_core* core, char const* route_regex, int route_type, union fskit_route_method method, int consistency_discipline ) {
+// return -ENOTDIR if opts->subtree is not a directory 
+// return -EEXIST if opts->subtree already has a route of this type bound to it
+static int fskit_path_route_decl( struct fskit_core* core, char const* route_regex, int route_type, union fskit_route_method method, int consistency_discipline, struct fskit_route_opts const* opts ) {
 
    int rc = 0;
+   
+   if( opts != NULL && (opts->max_concurrency < 0 || opts->max_queued < 0 || (opts->max_queued > 0 && opts->max_concurrency == 0)) ) {
+      return -EINVAL;
+   }
+   
    struct fskit_path_route* route = CALLOC_LIST( struct fskit_path_route, 1 );
    if( route == NULL ) {
       return -ENOMEM;
    }
 
-   rc = fskit_path_route_init( route, route_regex, consistency_discipline, route_type, method );
+   rc = fskit_path_route_init( route, route_regex, consistency_discipline, route_type, method, opts );
    if( rc != 0 ) {
    
       fskit_safe_free( route );
@@ -1023,7 +1889,29 @@ static int fskit_path_route_decl( struct fskit_core* core, char const* route_reg
    // atomically update route table
    fskit_core_route_wlock( core );
 
+   if( route->scope != NULL ) {
+      
+      rc = fskit_route_scope_bind( route );
+      if( rc != 0 ) {
+         
+         // already bound 
+         fskit_core_route_unlock( core );
+         
+         fskit_path_route_free( route );
+         fskit_safe_free( route );
+         return rc;
+      }
+   }
+   
    rc = fskit_route_table_insert( &core->routes, route_type, route );
+   if( rc < 0 && route->scope != NULL ) {
+      
+      // unbind while no one can be dispatching to it
+      fskit_path_route_free( route );
+      fskit_safe_free( route );
+   }
+   
+   core->route_gen++;
 
    fskit_core_route_unlock( core );
 
@@ -1043,6 +1931,13 @@ static int fskit_path_route_undecl( struct fskit_core* core, int route_type, int
    fskit_core_route_wlock( core );
 
    route = fskit_route_table_remove( &core->routes, route_type, route_handle );
+   core->route_gen++;
+   
+   if( route != NULL && route->scope != NULL ) {
+      
+      // stop dispatching to it before we release the route table 
+      fskit_route_scope_unbind( route );
+   }
 
    fskit_core_route_unlock( core );
    
@@ -1065,10 +1960,19 @@ static int fskit_path_route_undecl( struct fskit_core* core, int route_type, int
 // return -ENOMEM if out of memory
 int fskit_route_create( struct fskit_core* core, char const* route_regex, fskit_entry_route_create_callback_t create_cb, int consistency_discipline ) {
 
+   return fskit_route_create_ex( core, route_regex, create_cb, consistency_discipline, NULL );
+}
+
+// declare a route for creating a file, with execution options (opts may be NULL)
+// return >= 0 on success (the route handle)
+// return -EINVAL if we couldn't compile the regex, or if opts are invalid
+// return -ENOMEM if out of memory
+int fskit_route_create_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_create_callback_t create_cb, int consistency_discipline, struct fskit_route_opts const* opts ) {
+
    union fskit_route_method method;
    method.create_cb = create_cb;
 
-   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_CREATE, method, consistency_discipline );
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_CREATE, method, consistency_discipline, opts );
 }
 
 // undeclare an existing route for creating a file
@@ -1085,10 +1989,19 @@ int fskit_unroute_create( struct fskit_core* core, int route_handle ) {
 // return -ENOMEM if out of memory
 int fskit_route_mknod( struct fskit_core* core, char const* route_regex, fskit_entry_route_mknod_callback_t mknod_cb, int consistency_discipline ) {
 
+   return fskit_route_mknod_ex( core, route_regex, mknod_cb, consistency_discipline, NULL );
+}
+
+// declare a route for creating a node, with execution options (opts may be NULL)
+// return >= 0 on success (the route handle)
+// return -EINVAL if we couldn't compile the regex, or if opts are invalid
+// return -ENOMEM if out of memory
+int fskit_route_mknod_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_mknod_callback_t mknod_cb, int consistency_discipline, struct fskit_route_opts const* opts ) {
+
    union fskit_route_method method;
    method.mknod_cb = mknod_cb;
 
-   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_MKNOD, method, consistency_discipline );
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_MKNOD, method, consistency_discipline, opts );
 }
 
 // undeclare an existing route for creating a node
@@ -1105,10 +2018,19 @@ int fskit_unroute_mknod( struct fskit_core* core, int route_handle ) {
 // return -ENOMEM if out of memory
 int fskit_route_mkdir( struct fskit_core* core, char const* route_regex, fskit_entry_route_mkdir_callback_t mkdir_cb, int consistency_discipline ) {
 
+   return fskit_route_mkdir_ex( core, route_regex, mkdir_cb, consistency_discipline, NULL );
+}
+
+// declare a route for making a directory, with execution options (opts may be NULL)
+// return >= 0 on success (the route handle)
+// return -EINVAL if we couldn't compile the regex, or if opts are invalid
+// return -ENOMEM if out of memory
+int fskit_route_mkdir_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_mkdir_callback_t mkdir_cb, int consistency_discipline, struct fskit_route_opts const* opts ) {
+
    union fskit_route_method method;
    method.mkdir_cb = mkdir_cb;
 
-   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_MKDIR, method, consistency_discipline );
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_MKDIR, method, consistency_discipline, opts );
 }
 
 // undeclare an existing route for making a directory
@@ -1125,10 +2047,19 @@ int fskit_unroute_mkdir( struct fskit_core* core, int route_handle ) {
 // return -ENOMEM if out of memory
 int fskit_route_open( struct fskit_core* core, char const* route_regex, fskit_entry_route_open_callback_t open_cb, int consistency_discipline ) {
 
+   return fskit_route_open_ex( core, route_regex, open_cb, consistency_discipline, NULL );
+}
+
+// declare a route for opening a file or directory, with execution options (opts may be NULL)
+// return >= 0 on success (the route handle)
+// return -EINVAL if we couldn't compile the regex, or if opts are invalid
+// return -ENOMEM if out of memory
+int fskit_route_open_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_open_callback_t open_cb, int consistency_discipline, struct fskit_route_opts const* opts ) {
+
    union fskit_route_method method;
    method.open_cb = open_cb;
 
-   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_OPEN, method, consistency_discipline );
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_OPEN, method, consistency_discipline, opts );
 }
 
 // undeclare an existing route for opening a file
@@ -1145,10 +2076,19 @@ int fskit_unroute_open( struct fskit_core* core, int route_handle ) {
 // return -ENOMEM if out of memory
 int fskit_route_close( struct fskit_core* core, char const* route_regex, fskit_entry_route_close_callback_t close_cb, int consistency_discipline ) {
 
+   return fskit_route_close_ex( core, route_regex, close_cb, consistency_discipline, NULL );
+}
+
+// declare a route for closing a file or directory, with execution options (opts may be NULL)
+// return >= 0 on success (the route handle)
+// return -EINVAL if we couldn't compile the regex, or if opts are invalid
+// return -ENOMEM if out of memory
+int fskit_route_close_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_close_callback_t close_cb, int consistency_discipline, struct fskit_route_opts const* opts ) {
+
    union fskit_route_method method;
    method.close_cb = close_cb;
 
-   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_CLOSE, method, consistency_discipline );
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_CLOSE, method, consistency_discipline, opts );
 }
 
 // undeclare an existing route for closing a file
@@ -1165,10 +2105,19 @@ int fskit_unroute_close( struct fskit_core* core, int route_handle ) {
 // return -ENOMEM if out of memory
 int fskit_route_readdir( struct fskit_core* core, char const* route_regex, fskit_entry_route_readdir_callback_t readdir_cb, int consistency_discipline ) {
 
+   return fskit_route_readdir_ex( core, route_regex, readdir_cb, consistency_discipline, NULL );
+}
+
+// declare a route for readdir'ing a directory, with execution options (opts may be NULL)
+// return >= 0 on success (the route handle)
+// return -EINVAL if we couldn't compile the regex, or if opts are invalid
+// return -ENOMEM if out of memory
+int fskit_route_readdir_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_readdir_callback_t readdir_cb, int consistency_discipline, struct fskit_route_opts const* opts ) {
+
    union fskit_route_method method;
    method.readdir_cb = readdir_cb;
 
-   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_READDIR, method, consistency_discipline );
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_READDIR, method, consistency_discipline, opts );
 }
 
 // undeclare an existing route for reading a directory
@@ -1185,10 +2134,19 @@ int fskit_unroute_readdir( struct fskit_core* core, int route_handle ) {
 // return -ENOMEM if out of memory
 int fskit_route_read( struct fskit_core* core, char const* route_regex, fskit_entry_route_io_callback_t io_cb, int consistency_discipline ) {
 
+   return fskit_route_read_ex( core, route_regex, io_cb, consistency_discipline, NULL );
+}
+
+// declare a route for reading a file, with execution options (opts may be NULL)
+// return >= 0 on success (the route handle)
+// return -EINVAL if we couldn't compile the regex, or if opts are invalid
+// return -ENOMEM if out of memory
+int fskit_route_read_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_io_callback_t io_cb, int consistency_discipline, struct fskit_route_opts const* opts ) {
+
    union fskit_route_method method;
    method.io_cb = io_cb;
 
-   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_READ, method, consistency_discipline );
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_READ, method, consistency_discipline, opts );
 }
 
 // undeclare an existing route for reading a file
@@ -1205,10 +2163,19 @@ int fskit_unroute_read( struct fskit_core* core, int route_handle ) {
 // return -ENOMEM if out of memory
 int fskit_route_write( struct fskit_core* core, char const* route_regex, fskit_entry_route_io_callback_t io_cb, int consistency_discipline ) {
 
+   return fskit_route_write_ex( core, route_regex, io_cb, consistency_discipline, NULL );
+}
+
+// declare a route for writing a file, with execution options (opts may be NULL)
+// return >= 0 on success (the route handle)
+// return -EINVAL if we couldn't compile the regex, or if opts are invalid
+// return -ENOMEM if out of memory
+int fskit_route_write_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_io_callback_t io_cb, int consistency_discipline, struct fskit_route_opts const* opts ) {
+
    union fskit_route_method method;
    method.io_cb = io_cb;
 
-   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_WRITE, method, consistency_discipline );
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_WRITE, method, consistency_discipline, opts );
 }
 
 // undeclare an existing route for writing a file
@@ -1225,10 +2192,19 @@ int fskit_unroute_write( struct fskit_core* core, int route_handle ) {
 // return -ENOMEM if out of memory
 int fskit_route_trunc( struct fskit_core* core, char const* route_regex, fskit_entry_route_trunc_callback_t trunc_cb, int consistency_discipline ) {
 
+   return fskit_route_trunc_ex( core, route_regex, trunc_cb, consistency_discipline, NULL );
+}
+
+// declare a route for truncating a file, with execution options (opts may be NULL)
+// return >= 0 on success (the route handle)
+// return -EINVAL if we couldn't compile the regex, or if opts are invalid
+// return -ENOMEM if out of memory
+int fskit_route_trunc_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_trunc_callback_t trunc_cb, int consistency_discipline, struct fskit_route_opts const* opts ) {
+
    union fskit_route_method method;
    method.trunc_cb = trunc_cb;
 
-   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_TRUNC, method, consistency_discipline );
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_TRUNC, method, consistency_discipline, opts );
 }
 
 // undeclare an existing route for truncating a file
@@ -1248,7 +2224,7 @@ int fskit_route_detach( struct fskit_core* core, char const* route_regex, fskit_
    union fskit_route_method method;
    method.detach_cb = detach_cb;
 
-   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_DETACH, method, consistency_discipline );
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_DETACH, method, consistency_discipline, NULL );
 }
 
 // undeclare an existing route for detaching a file or directory
@@ -1268,7 +2244,7 @@ int fskit_route_destroy( struct fskit_core* core, char const* route_regex, fskit
    union fskit_route_method method;
    method.destroy_cb = destroy_cb;
 
-   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_DESTROY, method, consistency_discipline );
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_DESTROY, method, consistency_discipline, NULL );
 }
 
 // undeclare an existing route for detaching a file or directory
@@ -1285,10 +2261,19 @@ int fskit_unroute_destroy( struct fskit_core* core, int route_handle ) {
 // return -ENOMEM if out of memory
 int fskit_route_stat( struct fskit_core* core, char const* route_regex, fskit_entry_route_stat_callback_t stat_cb, int consistency_discipline ) {
 
+   return fskit_route_stat_ex( core, route_regex, stat_cb, consistency_discipline, NULL );
+}
+
+// declare a route for stating a file or directory, with execution options (opts may be NULL)
+// return >= 0 on success (the route handle)
+// return -EINVAL if we couldn't compile the regex, or if opts are invalid
+// return -ENOMEM if out of memory
+int fskit_route_stat_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_stat_callback_t stat_cb, int consistency_discipline, struct fskit_route_opts const* opts ) {
+
    union fskit_route_method method;
    method.stat_cb = stat_cb;
 
-   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_STAT, method, consistency_discipline );
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_STAT, method, consistency_discipline, opts );
 }
 
 // undeclare an existing route for stating a file or directory
@@ -1305,10 +2290,19 @@ int fskit_unroute_stat( struct fskit_core* core, int route_handle ) {
 // return -ENOMEM if out of memory
 int fskit_route_sync( struct fskit_core* core, char const* route_regex, fskit_entry_route_sync_callback_t sync_cb, int consistency_discipline ) {
 
+   return fskit_route_sync_ex( core, route_regex, sync_cb, consistency_discipline, NULL );
+}
+
+// declare a route for syncing a file or directory, with execution options (opts may be NULL)
+// return >= 0 on success (the route handle)
+// return -EINVAL if we couldn't compile the regex, or if opts are invalid
+// return -ENOMEM if out of memory
+int fskit_route_sync_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_sync_callback_t sync_cb, int consistency_discipline, struct fskit_route_opts const* opts ) {
+
    union fskit_route_method method;
    method.sync_cb = sync_cb;
 
-   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_SYNC, method, consistency_discipline );
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_SYNC, method, consistency_discipline, opts );
 }
 
 // undeclare an existing route for syncing a file or directory
@@ -1335,7 +2329,7 @@ int fskit_route_rename( struct fskit_core* core, char const* route_regex, fskit_
       return -EINVAL;
    }
    
-   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_RENAME, method, consistency_discipline );
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_RENAME, method, consistency_discipline, NULL );
 }
 
 
@@ -1357,7 +2351,7 @@ int fskit_route_link( struct fskit_core* core, char const* route_regex, fskit_en
    union fskit_route_method method;
    method.link_cb = link_cb;
    
-   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_LINK, method, consistency_discipline );
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_LINK, method, consistency_discipline, NULL );
 }
 
 
@@ -1376,10 +2370,19 @@ int fskit_unroute_link( struct fskit_core* core, int route_handle ) {
 // return -ENOMEM if out of memory 
 int fskit_route_getxattr( struct fskit_core* core, char const* route_regex, fskit_entry_route_getxattr_callback_t getxattr_cb, int consistency_discipline ) {
 
+   return fskit_route_getxattr_ex( core, route_regex, getxattr_cb, consistency_discipline, NULL );
+}
+
+// declare a route for getting an xattr , with execution options (opts may be NULL)
+// return >=0 on success (the route handle)
+// return -EINVAL if consistency discipline is not supported
+// return -ENOMEM if out of memory 
+int fskit_route_getxattr_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_getxattr_callback_t getxattr_cb, int consistency_discipline, struct fskit_route_opts const* opts ) {
+
    union fskit_route_method method;
    method.getxattr_cb = getxattr_cb;
 
-   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_GETXATTR, method, consistency_discipline );
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_GETXATTR, method, consistency_discipline, opts );
 }
 
 // undeclare a route for getting an xattr
@@ -1396,10 +2399,19 @@ int fskit_unroute_getxattr( struct fskit_core* core, int route_handle ) {
 // return -ENOMEM if out of memory 
 int fskit_route_listxattr( struct fskit_core* core, char const* route_regex, fskit_entry_route_listxattr_callback_t listxattr_cb, int consistency_discipline ) {
 
+   return fskit_route_listxattr_ex( core, route_regex, listxattr_cb, consistency_discipline, NULL );
+}
+
+// declare a route for listing an xattr , with execution options (opts may be NULL)
+// return >=0 on success (the route handle)
+// return -EINVAL if consistency discipline is not supported
+// return -ENOMEM if out of memory 
+int fskit_route_listxattr_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_listxattr_callback_t listxattr_cb, int consistency_discipline, struct fskit_route_opts const* opts ) {
+
    union fskit_route_method method;
    method.listxattr_cb = listxattr_cb;
 
-   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_LISTXATTR, method, consistency_discipline );
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_LISTXATTR, method, consistency_discipline, opts );
 }
 
 // undeclare a route for listing xattrs
@@ -1417,10 +2429,19 @@ int fskit_unroute_listxattr( struct fskit_core* core, int route_handle ) {
 // return -ENOMEM if out of memory 
 int fskit_route_setxattr( struct fskit_core* core, char const* route_regex, fskit_entry_route_setxattr_callback_t setxattr_cb, int consistency_discipline ) {
 
+   return fskit_route_setxattr_ex( core, route_regex, setxattr_cb, consistency_discipline, NULL );
+}
+
+// declare a route for setting an xattr, with execution options (opts may be NULL)
+// return >=0 on success (the route handle)
+// return -EINVAL if consistency discipline is not supported
+// return -ENOMEM if out of memory 
+int fskit_route_setxattr_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_setxattr_callback_t setxattr_cb, int consistency_discipline, struct fskit_route_opts const* opts ) {
+
    union fskit_route_method method;
    method.setxattr_cb = setxattr_cb;
 
-   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_SETXATTR, method, consistency_discipline );
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_SETXATTR, method, consistency_discipline, opts );
 }
 
 // undeclare a route for setting an xattr
@@ -1438,10 +2459,19 @@ int fskit_unroute_setxattr( struct fskit_core* core, int route_handle ) {
 // return -ENOMEM if out of memory 
 int fskit_route_removexattr( struct fskit_core* core, char const* route_regex, fskit_entry_route_removexattr_callback_t removexattr_cb, int consistency_discipline ) {
 
+   return fskit_route_removexattr_ex( core, route_regex, removexattr_cb, consistency_discipline, NULL );
+}
+
+// declare a route for removing an xattr , with execution options (opts may be NULL)
+// return >=0 on success (the route handle)
+// return -EINVAL if consistency discipline is not supported
+// return -ENOMEM if out of memory 
+int fskit_route_removexattr_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_removexattr_callback_t removexattr_cb, int consistency_discipline, struct fskit_route_opts const* opts ) {
+
    union fskit_route_method method;
    method.removexattr_cb = removexattr_cb;
 
-   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_REMOVEXATTR, method, consistency_discipline );
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_REMOVEXATTR, method, consistency_discipline, opts );
 }
 
 // undeclare a route for listing xattrs
@@ -1468,7 +2498,7 @@ int fskit_route_setmetadata( struct fskit_core* core, char const* route_regex, f
       return -EINVAL;
    }
 
-   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_SETMETADATA, method, consistency_discipline );
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_SETMETADATA, method, consistency_discipline, NULL );
 }
 
 // undeclare a route for setting inode metadata
@@ -1480,6 +2510,69 @@ int fskit_unroute_setmetadata( struct fskit_core* core, int route_handle ) {
 }
 
 
+// declare a route for creating a batch of children in a directory at once (see fskit_create_many and fskit_mkdir_many).
+// the regex matches the directory's path.  Without such a route, each child's create or mkdir route is called instead.
+// return >= 0 on success (the route handle)
+// return -EINVAL if we couldn't compile the regex
+// return -ENOMEM if out of memory
+int fskit_route_create_many( struct fskit_core* core, char const* route_regex, fskit_entry_route_create_many_callback_t create_many_cb, int consistency_discipline ) {
+
+   return fskit_route_create_many_ex( core, route_regex, create_many_cb, consistency_discipline, NULL );
+}
+
+// declare a route for creating a batch of children, with execution options (opts may be NULL)
+// return >= 0 on success (the route handle)
+// return -EINVAL if we couldn't compile the regex, or if opts are invalid
+// return -ENOMEM if out of memory
+int fskit_route_create_many_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_create_many_callback_t create_many_cb, int consistency_discipline, struct fskit_route_opts const* opts ) {
+
+   union fskit_route_method method;
+   method.create_many_cb = create_many_cb;
+
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_CREATE_MANY, method, consistency_discipline, opts );
+}
+
+// undeclare a route for creating a batch of children
+// return 0 on success
+// return -EINVAL if the route can't possibly exist
+int fskit_unroute_create_many( struct fskit_core* core, int route_handle ) {
+
+   return fskit_path_route_undecl( core, FSKIT_ROUTE_MATCH_CREATE_MANY, route_handle );
+}
+
+
+// declare a route for destroying a batch of entries at once (see fskit_detach_all).
+// the regex matches the path of the directory the entries were removed from (for fskit_detach_all, the directory being cleared).
+// Where one matches, it is called instead of the entries' destroy routes.
+// return >= 0 on success (the route handle)
+// return -EINVAL if we couldn't compile the regex
+// return -ENOMEM if out of memory
+int fskit_route_destroy_many( struct fskit_core* core, char const* route_regex, fskit_entry_route_destroy_many_callback_t destroy_many_cb, int consistency_discipline ) {
+
+   return fskit_route_destroy_many_ex( core, route_regex, destroy_many_cb, consistency_discipline, NULL );
+}
+
+// declare a route for destroying a batch of entries, with execution options (opts may be NULL)
+// return >= 0 on success (the route handle)
+// return -EINVAL if we couldn't compile the regex, or if opts are invalid
+// return -ENOMEM if out of memory
+int fskit_route_destroy_many_ex( struct fskit_core* core, char const* route_regex, fskit_entry_route_destroy_many_callback_t destroy_many_cb, int consistency_discipline, struct fskit_route_opts const* opts ) {
+
+   union fskit_route_method method;
+   method.destroy_many_cb = destroy_many_cb;
+
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_DESTROY_MANY, method, consistency_discipline, opts );
+}
+
+// undeclare a route for destroying a batch of entries
+// return 0 on success
+// return -EINVAL if the route can't possibly exist
+int fskit_unroute_destroy_many( struct fskit_core* core, int route_handle ) {
+
+   return fskit_path_route_undecl( core, FSKIT_ROUTE_MATCH_DESTROY_MANY, route_handle );
+}
+
+
 // undeclare all routes 
 // return 0 on success
 int fskit_unroute_all( struct fskit_core* core ) {
@@ -1494,11 +2587,47 @@ int fskit_unroute_all( struct fskit_core* core ) {
       fskit_path_route_erase_all( &core->routes, i );
    }
    
+   core->route_gen++;
+   
    fskit_core_route_unlock( core );
 
    return rc;
 }
 
+// initialize route options to their defaults:
+// no concurrency limit, no queue limit, and callbacks run in the calling thread
+// return 0 on success
+int fskit_route_opts_init( struct fskit_route_opts* opts ) {
+   
+   memset( opts, 0, sizeof(struct fskit_route_opts) );
+   return 0;
+}
+
+
+// get a snapshot of a route's admission counters 
+// return 0 on success 
+// return -EINVAL if there is no such route
+int fskit_route_get_stats( struct fskit_core* core, int route_type, int route_handle, struct fskit_route_stats* stats ) {
+   
+   struct fskit_path_route* route = NULL;
+   
+   fskit_core_route_rlock( core );
+   
+   route = fskit_route_table_find( core->routes, route_type, route_handle );
+   if( route == NULL || !fskit_path_route_is_defined( route ) ) {
+      
+      fskit_core_route_unlock( core );
+      return -EINVAL;
+   }
+   
+   pthread_mutex_lock( &route->admit_lock );
+   memcpy( stats, &route->stats, sizeof(struct fskit_route_stats) );
+   pthread_mutex_unlock( &route->admit_lock );
+   
+   fskit_core_route_unlock( core );
+   return 0;
+}
+
 // set up dargs for create()
 int fskit_route_create_args( struct fskit_route_dispatch_args* dargs, struct fskit_entry* parent, char const* name, mode_t mode, void* cls ) {
 
@@ -1720,6 +2849,34 @@ int fskit_route_setmetadata_args( struct fskit_route_dispatch_args* dargs, struc
    return 0;
 }
 
+// set up dargs for create_many()
+int fskit_route_create_many_args( struct fskit_route_dispatch_args* dargs, char const** names, struct fskit_entry** fents, size_t num_fents, void** inode_data, void* cls ) {
+
+   memset( dargs, 0, sizeof(struct fskit_route_dispatch_args) );
+
+   dargs->batch_names = names;
+   dargs->batch_fents = fents;
+   dargs->batch_len = num_fents;
+   dargs->batch_inode_data = inode_data;
+   dargs->cls = cls;
+
+   return 0;
+}
+
+// set up dargs for destroy_many()
+int fskit_route_destroy_many_args( struct fskit_route_dispatch_args* dargs, char const** paths, uint64_t const* file_ids, void** inode_data, size_t num_entries ) {
+
+   memset( dargs, 0, sizeof(struct fskit_route_dispatch_args) );
+
+   dargs->batch_paths = paths;
+   dargs->batch_file_ids = file_ids;
+   dargs->batch_inode_data = inode_data;
+   dargs->batch_len = num_entries;
+   dargs->fent_absent = true;
+
+   return 0;
+}
+
 // get the route metadata path 
 char* fskit_route_metadata_get_path( struct fskit_route_metadata* route_metadata ) {
    return route_metadata->path;
@@ -0,0 +1,323 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include <fskit/entry.h>
+#include <fskit/route.h>
+#include <fskit/util.h>
+
+#include "fskit_private/private.h"
+
+// scopes are changed under their core's scope_lock, but read without it: dispatch walks from an entry's scope up
+// through its parents with atomic loads, holding only the core's route table read lock (see fskit_route_scope_find).
+// so a scope whose last reference goes away may still be in some dispatcher's hands; it is retired instead of freed,
+// and retired scopes are freed once the route table can be write-locked (i.e. no dispatch is looking at them).
+
+
+// free the core's retired scopes, if nothing can be dispatching through them.
+// the core's scope lock must be held.
+static void fskit_route_scope_reclaim( struct fskit_core* core ) {
+   
+   struct fskit_route_scope* scope = NULL;
+   
+   if( core->scope_retired == NULL ) {
+      return;
+   }
+   
+   // never waits, so it can't deadlock with a dispatcher (or with our own caller's route table lock, if any)
+   if( pthread_rwlock_trywrlock( &core->route_lock ) != 0 ) {
+      return;
+   }
+   
+   scope = core->scope_retired;
+   core->scope_retired = NULL;
+   
+   pthread_rwlock_unlock( &core->route_lock );
+   
+   while( scope != NULL ) {
+      
+      struct fskit_route_scope* next = scope->retired_next;
+      
+      memset( scope, 0, sizeof(struct fskit_route_scope) );
+      fskit_safe_free( scope );
+      
+      scope = next;
+   }
+}
+
+
+// add a reference to a scope 
+// the core's scope lock must be held
+static void fskit_route_scope_ref( struct fskit_route_scope* scope ) {
+   
+   if( scope != NULL ) {
+      scope->refcount++;
+   }
+}
+
+
+// remove a reference to a scope, retiring it (and unreferencing its parent) if it was the last one
+// the core's scope lock must be held
+static void fskit_route_scope_unref( struct fskit_core* core, struct fskit_route_scope* scope ) {
+   
+   while( scope != NULL ) {
+      
+      struct fskit_route_scope* parent = scope->parent;
+      
+      scope->refcount--;
+      if( scope->refcount > 0 ) {
+         break;
+      }
+      
+      // dispatch may still be walking through it, so keep its parent pointer intact until it is freed;
+      // the retired list is threaded through a separate field
+      scope->retired_next = core->scope_retired;
+      core->scope_retired = scope;
+      
+      scope = parent;
+   }
+}
+
+
+// give a newly-initialized directory its own scope.
+// it inherits its parent's routes once it is attached.  It belongs to its parent's core (the root's scope is
+// given its core by fskit_core_init).
+// return 0 on success 
+// return -ENOMEM on OOM
+int fskit_route_scope_init_dir( struct fskit_entry* dir, struct fskit_entry* parent ) {
+   
+   struct fskit_route_scope* scope = CALLOC_LIST( struct fskit_route_scope, 1 );
+   if( scope == NULL ) {
+      return -ENOMEM;
+   }
+   
+   if( parent != NULL && parent != dir && parent->scope != NULL ) {
+      scope->core = parent->scope->core;
+   }
+   
+   scope->refcount = 1;
+   dir->scope = scope;
+   
+   return 0;
+}
+
+
+// point an entry at the scope of the directory it is being attached to.
+// a directory keeps its own scope, but now nests inside the parent's.
+// this is how a newly-created entry inherits routes, and how a renamed entry picks up its new parent's routes.
+// return 0 on success
+int fskit_route_scope_attach( struct fskit_entry* parent, struct fskit_entry* fent ) {
+   
+   struct fskit_route_scope* old_scope = NULL;
+   struct fskit_core* core = parent->scope->core;
+   
+   if( parent == fent ) {
+      return 0;
+   }
+   
+   pthread_mutex_lock( &core->scope_lock );
+   
+   fskit_route_scope_ref( parent->scope );
+   
+   if( fent->type == FSKIT_ENTRY_TYPE_DIR ) {
+      
+      if( fent->scope != NULL ) {
+         
+         old_scope = fent->scope->parent;
+         __atomic_store_n( &fent->scope->parent, parent->scope, __ATOMIC_RELEASE );
+      }
+   }
+   else {
+      
+      old_scope = fent->scope;
+      __atomic_store_n( &fent->scope, parent->scope, __ATOMIC_RELEASE );
+   }
+   
+   fskit_route_scope_unref( core, old_scope );
+   fskit_route_scope_reclaim( core );
+   
+   pthread_mutex_unlock( &core->scope_lock );
+   
+   return 0;
+}
+
+
+// release an entry's scope, when the entry is destroyed 
+// return 0 on success
+int fskit_route_scope_release( struct fskit_entry* fent ) {
+   
+   struct fskit_core* core = NULL;
+   
+   if( fent->scope == NULL ) {
+      return 0;
+   }
+   
+   core = fent->scope->core;
+   
+   pthread_mutex_lock( &core->scope_lock );
+   
+   fskit_route_scope_unref( core, fent->scope );
+   __atomic_store_n( &fent->scope, NULL, __ATOMIC_RELEASE );
+   
+   fskit_route_scope_reclaim( core );
+   
+   pthread_mutex_unlock( &core->scope_lock );
+   
+   return 0;
+}
+
+
+// get a reference to a directory's scope, so a route can be bound to it.
+// dir must not be locked, and must not be destroyed during this call.
+// return 0 on success, and set *scope
+// return -ENOTDIR if dir is not a directory
+int fskit_route_scope_ref_dir( struct fskit_entry* dir, struct fskit_route_scope** scope ) {
+   
+   struct fskit_core* core = NULL;
+   
+   if( dir->type != FSKIT_ENTRY_TYPE_DIR || dir->scope == NULL ) {
+      return -ENOTDIR;
+   }
+   
+   // a directory's own scope never changes, only its parent does
+   core = dir->scope->core;
+   
+   pthread_mutex_lock( &core->scope_lock );
+   
+   fskit_route_scope_ref( dir->scope );
+   *scope = dir->scope;
+   
+   pthread_mutex_unlock( &core->scope_lock );
+   
+   return 0;
+}
+
+
+// drop a reference obtained with fskit_route_scope_ref_dir 
+// return 0 on success
+int fskit_route_scope_put( struct fskit_route_scope* scope ) {
+   
+   struct fskit_core* core = scope->core;
+   
+   pthread_mutex_lock( &core->scope_lock );
+   
+   fskit_route_scope_unref( core, scope );
+   fskit_route_scope_reclaim( core );
+   
+   pthread_mutex_unlock( &core->scope_lock );
+   
+   return 0;
+}
+
+
+// make a route visible to dispatch, in the scope it refers to.
+// the core's route table must be write-locked, so no dispatch is looking at the scope's routes.
+// return 0 on success
+// return -EEXIST if there is already a route of this type bound to the directory
+int fskit_route_scope_bind( struct fskit_path_route* route ) {
+   
+   struct fskit_core* core = route->scope->core;
+   
+   if( route->scope->routes[ route->route_type ] != NULL ) {
+      return -EEXIST;
+   }
+   
+   route->scope->routes[ route->route_type ] = route;
+   __atomic_fetch_add( &core->scope_num_bound, 1, __ATOMIC_RELEASE );
+   
+   return 0;
+}
+
+
+// hide a route from dispatch.  The route keeps its reference to the scope until it is freed.
+// the core's route table must be write-locked.
+// return 0 on success
+int fskit_route_scope_unbind( struct fskit_path_route* route ) {
+   
+   struct fskit_core* core = route->scope->core;
+   
+   if( route->scope->routes[ route->route_type ] == route ) {
+      
+      route->scope->routes[ route->route_type ] = NULL;
+      __atomic_fetch_sub( &core->scope_num_bound, 1, __ATOMIC_RELEASE );
+   }
+   
+   return 0;
+}
+
+
+// are any routes bound to subtrees in this core?
+bool fskit_route_scope_any_bound( struct fskit_core* core ) {
+   return __atomic_load_n( &core->scope_num_bound, __ATOMIC_ACQUIRE ) > 0;
+}
+
+
+// find the subtree-bound route for an operation, by walking up from the entry's scope to the nearest one with a route of this type.
+// creat(), mknod() and mkdir() are routed by the directory they create in.
+// takes no locks: scopes and their parent pointers are read atomically, and none is freed while the route table is read-locked.
+// the core's route table must be read-locked.
+// return the route on success 
+// return NULL if no subtree-bound route applies
+struct fskit_path_route* fskit_route_scope_find( struct fskit_core* core, int route_type, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs ) {
+   
+   struct fskit_path_route* route = NULL;
+   struct fskit_route_scope* scope = NULL;
+   
+   if( __atomic_load_n( &core->scope_num_bound, __ATOMIC_ACQUIRE ) == 0 ) {
+      return NULL;
+   }
+   
+   if( route_type == FSKIT_ROUTE_MATCH_CREATE || route_type == FSKIT_ROUTE_MATCH_MKNOD || route_type == FSKIT_ROUTE_MATCH_MKDIR ) {
+      fent = dargs->parent;
+   }
+   
+   if( fent == NULL ) {
+      return NULL;
+   }
+   
+   for( scope = __atomic_load_n( &fent->scope, __ATOMIC_ACQUIRE ); scope != NULL; scope = __atomic_load_n( &scope->parent, __ATOMIC_ACQUIRE ) ) {
+      
+      route = scope->routes[ route_type ];
+      if( route != NULL ) {
+         break;
+      }
+   }
+   
+   return route;
+}
+
+
+// free a core's retired scopes, when it is destroyed.  Nothing may be dispatching.
+void fskit_route_scope_free_retired( struct fskit_core* core ) {
+   
+   struct fskit_route_scope* scope = core->scope_retired;
+   
+   core->scope_retired = NULL;
+   
+   while( scope != NULL ) {
+      
+      struct fskit_route_scope* next = scope->retired_next;
+      
+      memset( scope, 0, sizeof(struct fskit_route_scope) );
+      fskit_safe_free( scope );
+      
+      scope = next;
+   }
+}
@@ -21,6 +21,7 @@
 
 #include <fskit/setxattr.h>
 #include <fskit/path.h>
+#include <fskit/cache.h>
 
 #include "fskit_private/private.h"
 
@@ -117,11 +118,13 @@ int fskit_fsetxattr( struct fskit_core* core, char const* path, struct fskit_ent
 
    if( rc == 0 ) {
       // take no further action 
+      fskit_entry_invalidate( core, fent );
       return 0;
    }
 
    // callback forwards to fskit
    rc = fskit_xattr_fsetxattr( core, fent, name, value, value_len, flags );
    
+   fskit_entry_invalidate( core, fent );
    return rc;
 }
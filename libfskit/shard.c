@@ -0,0 +1,451 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include <fskit/entry.h>
+#include <fskit/util.h>
+
+#include "fskit_private/private.h"
+
+// Sharded directories.
+// A sharded directory keeps . and .. in its children set, and splits the rest of its children across shards by name cookie.
+// Each shard covers a contiguous range of cookies and has its own lock, so the directory's entries are still in cookie order
+// when read shard by shard, and creates and unlinks of different names need only read-lock the directory:
+//
+// * a shard's children may be changed by a thread that write-locks the directory, or read-locks it and write-locks the shard.
+// * a shard's children may be read by a thread that write-locks the directory, or read-locks it and locks the shard.
+//
+// Locks are taken in the order directory, shard, child.
+
+
+// which shard holds a (non-. and non-..) cookie
+static int fskit_dir_shard_index( struct fskit_dir_shards* shards, uint64_t cookie ) {
+
+   if( cookie < FSKIT_DIR_COOKIE_FIRST ) {
+      return 0;
+   }
+
+   return (cookie - FSKIT_DIR_COOKIE_FIRST) / shards->width;
+}
+
+// get the shard that holds a name, if dir is sharded
+// return NULL if dir is not sharded, or if name is . or .. (which live in dir->children)
+struct fskit_dir_shard* fskit_entry_dir_shard( struct fskit_entry* dir, char const* name ) {
+
+   struct fskit_dir_shards* shards = __atomic_load_n( &dir->shards, __ATOMIC_ACQUIRE );
+   if( shards == NULL ) {
+      return NULL;
+   }
+
+   uint64_t cookie = fskit_entry_name_cookie( name );
+   if( cookie < FSKIT_DIR_COOKIE_FIRST ) {
+      return NULL;
+   }
+
+   return &shards->shards[ fskit_dir_shard_index( shards, cookie ) ];
+}
+
+// read-lock the shard that holds a name, if dir is sharded 
+// dir must be at least read-locked
+// return the locked shard, or NULL if there is no shard to lock
+struct fskit_dir_shard* fskit_entry_dir_shard_rlock( struct fskit_entry* dir, char const* name ) {
+
+   struct fskit_dir_shard* shard = fskit_entry_dir_shard( dir, name );
+   if( shard != NULL ) {
+      pthread_rwlock_rdlock( &shard->lock );
+   }
+
+   return shard;
+}
+
+// write-lock the shard that holds a name, if dir is sharded 
+// dir must be at least read-locked
+// return the locked shard, or NULL if there is no shard to lock
+struct fskit_dir_shard* fskit_entry_dir_shard_wlock( struct fskit_entry* dir, char const* name ) {
+
+   struct fskit_dir_shard* shard = fskit_entry_dir_shard( dir, name );
+   if( shard != NULL ) {
+      pthread_rwlock_wrlock( &shard->lock );
+   }
+
+   return shard;
+}
+
+// unlock a shard (which may be NULL)
+void fskit_entry_dir_shard_unlock( struct fskit_dir_shard* shard ) {
+
+   if( shard != NULL ) {
+      pthread_rwlock_unlock( &shard->lock );
+   }
+}
+
+// unlock a directory, and the shard (which may be NULL) locked in it
+void fskit_entry_dir_unlock( struct fskit_entry* dir, struct fskit_dir_shard* shard ) {
+
+   fskit_entry_dir_shard_unlock( shard );
+   fskit_entry_unlock( dir );
+}
+
+// re-lock a directory for changing the name that shard (which may be NULL) holds, after fskit_entry_dir_unlock.
+// i.e. write-lock it, or read-lock it and write-lock the shard.
+void fskit_entry_dir_relock( struct fskit_entry* dir, struct fskit_dir_shard* shard ) {
+
+   if( shard != NULL ) {
+      fskit_entry_rlock( dir );
+      pthread_rwlock_wrlock( &shard->lock );
+   }
+   else {
+      fskit_entry_wlock( dir );
+   }
+}
+
+
+// get the set that holds (or would hold) a name: dir->children, or one of its shards' children.
+static fskit_entry_set** fskit_entry_dir_set( struct fskit_entry* dir, char const* name ) {
+
+   struct fskit_dir_shard* shard = fskit_entry_dir_shard( dir, name );
+   if( shard != NULL ) {
+      return &shard->children;
+   }
+
+   return &dir->children;
+}
+
+// insert a child into a directory's children, or its shard's
+// NOTE: dir must be write-locked, or read-locked with name's shard write-locked
+// return 0 on success
+// return -ENOMEM on OOM
+int fskit_entry_dir_insert( struct fskit_entry* dir, char const* name, struct fskit_entry* child ) {
+
+   return fskit_entry_set_insert( fskit_entry_dir_set( dir, name ), name, child );
+}
+
+// remove a child from a directory's children, or its shard's
+// NOTE: dir must be write-locked, or read-locked with name's shard write-locked
+// return true if it was there
+bool fskit_entry_dir_remove( struct fskit_entry* dir, char const* name ) {
+
+   return fskit_entry_set_remove( fskit_entry_dir_set( dir, name ), name );
+}
+
+// count a directory's entries, including . and ..
+// NOTE: dir must be at least read-locked.  Its shards (if any) must not be locked by the caller.
+uint64_t fskit_entry_dir_count( struct fskit_entry* dir ) {
+
+   uint64_t count = fskit_entry_set_count( dir->children );
+   struct fskit_dir_shards* shards = dir->shards;
+
+   if( shards != NULL ) {
+
+      for( int i = 0; i < shards->num_shards; i++ ) {
+
+         pthread_rwlock_rdlock( &shards->shards[i].lock );
+         count += fskit_entry_set_count( shards->shards[i].children );
+         pthread_rwlock_unlock( &shards->shards[i].lock );
+      }
+   }
+
+   return count;
+}
+
+// set a directory's modification time to now, after adding or removing a child.
+// its cached stat results are stale from here on, since its mtime (and maybe link count) changed.
+// shard writers only read-lock the directory, so they take turns here.
+// NOTE: dir must be write-locked, or read-locked with a shard write-locked
+void fskit_entry_dir_touch( struct fskit_entry* dir ) {
+
+   struct timespec ts;
+   struct fskit_dir_shards* shards = dir->shards;
+
+   clock_gettime( CLOCK_REALTIME, &ts );
+
+   if( shards != NULL ) {
+      pthread_mutex_lock( &shards->meta_lock );
+   }
+
+   fskit_entry_meta_write_begin( dir );
+   dir->mtime_sec = ts.tv_sec;
+   dir->mtime_nsec = ts.tv_nsec;
+   fskit_entry_meta_write_end( dir );
+
+   if( shards != NULL ) {
+      pthread_mutex_unlock( &shards->meta_lock );
+   }
+
+   fskit_route_cache_stale( dir );
+}
+
+
+// release the shard an iterator is in, if it holds its lock 
+static void fskit_dir_itr_release( struct fskit_dir_itr* itr ) {
+
+   if( itr->locked ) {
+
+      pthread_rwlock_unlock( &itr->dir->shards->shards[ itr->shard ].lock );
+      itr->locked = false;
+   }
+}
+
+// move an iterator into the given shard (or dir->children, for -1), and seek to the first entry after cookie
+static fskit_entry_set* fskit_dir_itr_enter( struct fskit_dir_itr* itr, int shard, uint64_t cookie ) {
+
+   fskit_dir_itr_release( itr );
+   itr->shard = shard;
+
+   if( shard < 0 ) {
+      return fskit_entry_set_seek( &itr->itr, itr->dir->children, cookie );
+   }
+
+   struct fskit_dir_shard* s = &itr->dir->shards->shards[ shard ];
+
+   pthread_rwlock_rdlock( &s->lock );
+   itr->locked = true;
+
+   return fskit_entry_set_seek( &itr->itr, s->children, cookie );
+}
+
+// start iterating over all of a directory's children (including those in its shards) in cookie order,
+// from the first one after the given cookie.
+// while the iterator is in a shard, it holds that shard's read lock.  Call fskit_dir_itr_end when done, unless
+// this or fskit_dir_itr_next returned NULL.
+// NOTE: dir must be at least read-locked, and none of its shards may be locked by the caller
+// return the first entry, or NULL if there are none
+fskit_entry_set* fskit_dir_itr_seek( struct fskit_dir_itr* itr, struct fskit_entry* dir, uint64_t cookie ) {
+
+   struct fskit_dir_shards* shards = dir->shards;
+   fskit_entry_set* entry = NULL;
+
+   memset( itr, 0, sizeof(struct fskit_dir_itr) );
+   itr->dir = dir;
+   itr->shard = -1;
+
+   // . and .. are only in dir->children; past them, skip the shards whose cookies are all behind us
+   int shard = -1;
+   if( shards != NULL && cookie >= FSKIT_DIR_COOKIE_FIRST - 1 ) {
+      shard = fskit_dir_shard_index( shards, cookie );
+   }
+
+   entry = fskit_dir_itr_enter( itr, shard, cookie );
+
+   while( entry == NULL && shards != NULL && itr->shard + 1 < shards->num_shards ) {
+      entry = fskit_dir_itr_enter( itr, itr->shard + 1, cookie );
+   }
+
+   if( entry == NULL ) {
+      fskit_dir_itr_release( itr );
+   }
+
+   return entry;
+}
+
+// get the next of a directory's children
+// return NULL once they've all been returned
+fskit_entry_set* fskit_dir_itr_next( struct fskit_dir_itr* itr ) {
+
+   struct fskit_dir_shards* shards = itr->dir->shards;
+   fskit_entry_set* entry = fskit_entry_set_next( &itr->itr );
+
+   while( entry == NULL && shards != NULL && itr->shard + 1 < shards->num_shards ) {
+      entry = fskit_dir_itr_enter( itr, itr->shard + 1, FSKIT_DIR_COOKIE_START );
+   }
+
+   if( entry == NULL ) {
+      fskit_dir_itr_release( itr );
+   }
+
+   return entry;
+}
+
+// stop iterating early
+void fskit_dir_itr_end( struct fskit_dir_itr* itr ) {
+   fskit_dir_itr_release( itr );
+}
+
+
+// copy every entry of one set into another 
+// return 0 on success
+// return -ENOMEM on OOM
+static int fskit_entry_set_copy_into( fskit_entry_set** dest, fskit_entry_set* src ) {
+
+   int rc = 0;
+   fskit_entry_set_itr itr;
+
+   for( fskit_entry_set* entry = fskit_entry_set_begin( &itr, src ); entry != NULL; entry = fskit_entry_set_next( &itr ) ) {
+
+      rc = fskit_entry_set_insert( dest, fskit_entry_set_name_at( entry ), fskit_entry_set_child_at( entry ) );
+      if( rc != 0 ) {
+         return rc;
+      }
+   }
+
+   return 0;
+}
+
+// split a directory's children across shards.
+// creates and unlinks of different names in it then only contend on their shards' locks, instead of all
+// serializing on the directory's write lock (see fskit_entry_resolve_path_parent).  Readers see the shards merged.
+// Sharding can't be undone, and can't be combined with listing caching or snapshots, which assume that
+// the directory's children only change while it is write-locked.
+// NOTE: dir must be write-locked
+// return 0 on success (including if dir is already sharded)
+// return -ENOTDIR if dir is not a directory
+// return -EINVAL if num_shards is out of range, or dir has listing caching or snapshots on
+// return -ENOMEM on OOM
+int fskit_entry_enable_shards( struct fskit_entry* dir, int num_shards ) {
+
+   int rc = 0;
+   fskit_entry_set_itr itr;
+   fskit_entry_set* children = NULL;
+
+   if( dir->type != FSKIT_ENTRY_TYPE_DIR ) {
+      return -ENOTDIR;
+   }
+
+   if( num_shards < 1 || num_shards > FSKIT_DIR_MAX_SHARDS ) {
+      return -EINVAL;
+   }
+
+   if( dir->listing_cache != NULL || dir->versions != NULL ) {
+      return -EINVAL;
+   }
+
+   if( dir->shards != NULL ) {
+      return 0;
+   }
+
+   struct fskit_dir_shards* shards = CALLOC_LIST( struct fskit_dir_shards, 1 );
+   if( shards == NULL ) {
+      return -ENOMEM;
+   }
+
+   shards->shards = CALLOC_LIST( struct fskit_dir_shard, num_shards );
+   if( shards->shards == NULL ) {
+
+      fskit_safe_free( shards );
+      return -ENOMEM;
+   }
+
+   shards->num_shards = num_shards;
+   shards->width = (FSKIT_DIR_COOKIE_EOF - FSKIT_DIR_COOKIE_FIRST) / num_shards + 1;
+
+   // redistribute the children 
+   for( fskit_entry_set* entry = fskit_entry_set_begin( &itr, dir->children ); entry != NULL; entry = fskit_entry_set_next( &itr ) ) {
+
+      uint64_t cookie = fskit_entry_set_cookie_at( entry );
+      fskit_entry_set** dest = &children;
+
+      if( cookie >= FSKIT_DIR_COOKIE_FIRST ) {
+         dest = &shards->shards[ fskit_dir_shard_index( shards, cookie ) ].children;
+      }
+
+      rc = fskit_entry_set_insert( dest, fskit_entry_set_name_at( entry ), fskit_entry_set_child_at( entry ) );
+      if( rc != 0 ) {
+         break;
+      }
+   }
+
+   if( rc != 0 ) {
+
+      fskit_entry_set_free( children );
+
+      for( int i = 0; i < num_shards; i++ ) {
+         fskit_entry_set_free( shards->shards[i].children );
+      }
+
+      fskit_safe_free( shards->shards );
+      fskit_safe_free( shards );
+      return rc;
+   }
+
+   for( int i = 0; i < num_shards; i++ ) {
+      pthread_rwlock_init( &shards->shards[i].lock, NULL );
+   }
+
+   pthread_mutex_init( &shards->meta_lock, NULL );
+
+   fskit_entry_set_free( dir->children );
+   dir->children = children;
+
+   __atomic_store_n( &dir->shards, shards, __ATOMIC_RELEASE );
+
+   return 0;
+}
+
+// move all of a sharded directory's children back into dir->children, leaving its shards empty,
+// so it can be torn down like any other directory.
+// NOTE: dir must be write-locked
+// return 0 on success
+// return -ENOMEM on OOM, in which case nothing is moved
+int fskit_entry_dir_gather_shards( struct fskit_entry* dir ) {
+
+   int rc = 0;
+   fskit_entry_set* children = NULL;
+   struct fskit_dir_shards* shards = dir->shards;
+
+   if( shards == NULL ) {
+      return 0;
+   }
+
+   rc = fskit_entry_set_copy_into( &children, dir->children );
+
+   for( int i = 0; rc == 0 && i < shards->num_shards; i++ ) {
+      rc = fskit_entry_set_copy_into( &children, shards->shards[i].children );
+   }
+
+   if( rc != 0 ) {
+
+      fskit_entry_set_free( children );
+      return rc;
+   }
+
+   for( int i = 0; i < shards->num_shards; i++ ) {
+
+      fskit_entry_set_free( shards->shards[i].children );
+      shards->shards[i].children = NULL;
+   }
+
+   fskit_entry_set_free( dir->children );
+   dir->children = children;
+
+   return 0;
+}
+
+// free a directory's shards, if it has any 
+// NOTE: dir must be write-locked, and no longer reachable
+void fskit_dir_shards_free( struct fskit_entry* dir ) {
+
+   struct fskit_dir_shards* shards = dir->shards;
+   if( shards == NULL ) {
+      return;
+   }
+
+   dir->shards = NULL;
+
+   for( int i = 0; i < shards->num_shards; i++ ) {
+
+      fskit_entry_set_free( shards->shards[i].children );
+      pthread_rwlock_destroy( &shards->shards[i].lock );
+   }
+
+   pthread_mutex_destroy( &shards->meta_lock );
+
+   fskit_safe_free( shards->shards );
+   fskit_safe_free( shards );
+}
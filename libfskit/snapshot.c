@@ -0,0 +1,660 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include <fskit/entry.h>
+#include <fskit/readdir.h>
+#include <fskit/util.h>
+
+#include "fskit_private/private.h"
+
+// a node in a directory's persistent children tree: a treap ordered like fskit_entry_set (by cookie, then name).
+// writers never change a node another version can see; they copy the path to the change instead, so each
+// version shares every untouched subtree with the one before it.
+struct fskit_dir_version_node {
+
+   uint64_t cookie;
+   uint32_t priority;
+   char* name;
+
+   uint64_t file_id;
+   uint8_t type;
+
+   int32_t refcount;    // parent nodes and snapshots that point here (atomic)
+
+   struct fskit_dir_version_node* left;
+   struct fskit_dir_version_node* right;
+};
+
+// an immutable version of a directory's children
+struct fskit_dir_snapshot {
+
+   int32_t refcount;    // the directory's current pointer, plus each reader holding it (atomic)
+   uint64_t count;
+   struct fskit_dir_version_node* root;
+};
+
+// a directory's published version.
+// writers (which hold the directory's write lock) replace current; readers take a reference to it.
+// if current is NULL, the next reader rebuilds it from the directory's children under the directory's read lock.
+struct fskit_dir_versions {
+
+   pthread_mutex_t lock;        // held only to swap current, or to take a reference to it
+   struct fskit_dir_snapshot* current;
+};
+
+
+// order a node against a key 
+static int fskit_dir_version_cmp( struct fskit_dir_version_node* n, uint64_t cookie, char const* name ) {
+
+   if( n->cookie != cookie ) {
+      return n->cookie < cookie ? -1 : 1;
+   }
+
+   return strcmp( n->name, name );
+}
+
+// make a new, unshared node
+// return NULL on OOM
+static struct fskit_dir_version_node* fskit_dir_version_node_new( char const* name, uint64_t file_id, uint8_t type ) {
+
+   struct fskit_dir_version_node* n = CALLOC_LIST( struct fskit_dir_version_node, 1 );
+   if( n == NULL ) {
+      return NULL;
+   }
+
+   n->name = strdup( name );
+   if( n->name == NULL ) {
+      fskit_safe_free( n );
+      return NULL;
+   }
+
+   n->cookie = fskit_entry_name_cookie( name );
+
+   // treap priority: a mix of the cookie, so a given set of names always has the same shape
+   uint64_t z = n->cookie + 0x9E3779B97F4A7C15ULL;
+   z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+   z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+   n->priority = (uint32_t)(z ^ (z >> 31));
+
+   n->file_id = file_id;
+   n->type = type;
+   n->refcount = 1;
+
+   return n;
+}
+
+// add a reference to a node (which may be NULL)
+static struct fskit_dir_version_node* fskit_dir_version_node_ref( struct fskit_dir_version_node* n ) {
+
+   if( n != NULL ) {
+      __atomic_add_fetch( &n->refcount, 1, __ATOMIC_RELAXED );
+   }
+
+   return n;
+}
+
+// drop a reference to a node (which may be NULL), freeing it and unreferencing its children if it was the last one
+static void fskit_dir_version_node_unref( struct fskit_dir_version_node* n ) {
+
+   if( n == NULL ) {
+      return;
+   }
+
+   if( __atomic_sub_fetch( &n->refcount, 1, __ATOMIC_ACQ_REL ) > 0 ) {
+      return;
+   }
+
+   fskit_dir_version_node_unref( n->left );
+   fskit_dir_version_node_unref( n->right );
+
+   fskit_safe_free( n->name );
+   fskit_safe_free( n );
+}
+
+// copy a node, sharing its children 
+// return NULL on OOM
+static struct fskit_dir_version_node* fskit_dir_version_node_copy( struct fskit_dir_version_node* n ) {
+
+   struct fskit_dir_version_node* c = fskit_dir_version_node_new( n->name, n->file_id, n->type );
+   if( c == NULL ) {
+      return NULL;
+   }
+
+   c->left = fskit_dir_version_node_ref( n->left );
+   c->right = fskit_dir_version_node_ref( n->right );
+
+   return c;
+}
+
+// get a node we own that we can change in place: n itself if nothing else refers to it, or else a copy of it.
+// consumes our reference to n, unless it fails.
+// return NULL on OOM
+static struct fskit_dir_version_node* fskit_dir_version_node_unshare( struct fskit_dir_version_node* n ) {
+
+   // nothing can gain a reference to a node we hold the only one to
+   if( __atomic_load_n( &n->refcount, __ATOMIC_ACQUIRE ) == 1 ) {
+      return n;
+   }
+
+   struct fskit_dir_version_node* c = fskit_dir_version_node_copy( n );
+   if( c == NULL ) {
+      return NULL;
+   }
+
+   fskit_dir_version_node_unref( n );
+   return c;
+}
+
+// split a tree into the nodes before a key and the rest, copying the path to the key.
+// if inclusive, the node equal to the key goes into *l as well.
+// t is borrowed; *l and *r are new references.
+// return 0 on success
+// return -ENOMEM on OOM
+static int fskit_dir_version_split( struct fskit_dir_version_node* t, uint64_t cookie, char const* name, bool inclusive, struct fskit_dir_version_node** l, struct fskit_dir_version_node** r ) {
+
+   int rc = 0;
+
+   if( t == NULL ) {
+      *l = NULL;
+      *r = NULL;
+      return 0;
+   }
+
+   struct fskit_dir_version_node* c = fskit_dir_version_node_copy( t );
+   if( c == NULL ) {
+      return -ENOMEM;
+   }
+
+   int cmp = fskit_dir_version_cmp( t, cookie, name );
+
+   if( cmp < 0 || (inclusive && cmp == 0) ) {
+
+      // t and its left subtree go left; split the right subtree 
+      struct fskit_dir_version_node* a = NULL;
+
+      rc = fskit_dir_version_split( t->right, cookie, name, inclusive, &a, r );
+      if( rc != 0 ) {
+         fskit_dir_version_node_unref( c );
+         return rc;
+      }
+
+      fskit_dir_version_node_unref( c->right );
+      c->right = a;
+      *l = c;
+   }
+   else {
+
+      // t and its right subtree go right; split the left subtree 
+      struct fskit_dir_version_node* b = NULL;
+
+      rc = fskit_dir_version_split( t->left, cookie, name, inclusive, l, &b );
+      if( rc != 0 ) {
+         fskit_dir_version_node_unref( c );
+         return rc;
+      }
+
+      fskit_dir_version_node_unref( c->left );
+      c->left = b;
+      *r = c;
+   }
+
+   return 0;
+}
+
+// join two trees, where every node in a comes before every node in b.
+// consumes the references to a and b, even on failure.
+// return 0 on success, and set *out to a new reference to the joined tree
+// return -ENOMEM on OOM
+static int fskit_dir_version_merge( struct fskit_dir_version_node* a, struct fskit_dir_version_node* b, struct fskit_dir_version_node** out ) {
+
+   int rc = 0;
+   struct fskit_dir_version_node* c = NULL;
+
+   if( a == NULL ) {
+      *out = b;
+      return 0;
+   }
+
+   if( b == NULL ) {
+      *out = a;
+      return 0;
+   }
+
+   if( a->priority > b->priority ) {
+
+      // a stays on top; b goes into its right subtree 
+      c = fskit_dir_version_node_unshare( a );
+      if( c == NULL ) {
+         fskit_dir_version_node_unref( a );
+         fskit_dir_version_node_unref( b );
+         return -ENOMEM;
+      }
+
+      struct fskit_dir_version_node* right = c->right;
+      c->right = NULL;
+
+      rc = fskit_dir_version_merge( right, b, &c->right );
+   }
+   else {
+
+      // b stays on top; a goes into its left subtree 
+      c = fskit_dir_version_node_unshare( b );
+      if( c == NULL ) {
+         fskit_dir_version_node_unref( a );
+         fskit_dir_version_node_unref( b );
+         return -ENOMEM;
+      }
+
+      struct fskit_dir_version_node* left = c->left;
+      c->left = NULL;
+
+      rc = fskit_dir_version_merge( a, left, &c->left );
+   }
+
+   if( rc != 0 ) {
+      fskit_dir_version_node_unref( c );
+      return rc;
+   }
+
+   *out = c;
+   return 0;
+}
+
+// make a new tree from t with name removed, and (if n is not NULL) n put in its place.
+// t is borrowed; n is consumed.
+// return 0 on success, set *out to a new reference to the new tree, and set *existed if name was in t
+// return -ENOMEM on OOM
+static int fskit_dir_version_replace( struct fskit_dir_version_node* t, char const* name, struct fskit_dir_version_node* n, struct fskit_dir_version_node** out, bool* existed ) {
+
+   int rc = 0;
+   uint64_t cookie = fskit_entry_name_cookie( name );
+   struct fskit_dir_version_node* l = NULL;
+   struct fskit_dir_version_node* r = NULL;
+   struct fskit_dir_version_node* eq = NULL;
+   struct fskit_dir_version_node* rest = NULL;
+
+   // l < name <= r, and then eq == name < rest 
+   rc = fskit_dir_version_split( t, cookie, name, false, &l, &r );
+   if( rc != 0 ) {
+      fskit_dir_version_node_unref( n );
+      return rc;
+   }
+
+   rc = fskit_dir_version_split( r, cookie, name, true, &eq, &rest );
+   fskit_dir_version_node_unref( r );
+
+   if( rc != 0 ) {
+      fskit_dir_version_node_unref( l );
+      fskit_dir_version_node_unref( n );
+      return rc;
+   }
+
+   *existed = (eq != NULL);
+   fskit_dir_version_node_unref( eq );
+
+   rc = fskit_dir_version_merge( l, n, &l );
+   if( rc != 0 ) {
+      fskit_dir_version_node_unref( rest );
+      return rc;
+   }
+
+   return fskit_dir_version_merge( l, rest, out );
+}
+
+
+// add a reference to a snapshot
+static struct fskit_dir_snapshot* fskit_dir_snapshot_ref( struct fskit_dir_snapshot* snap ) {
+
+   if( snap != NULL ) {
+      __atomic_add_fetch( &snap->refcount, 1, __ATOMIC_RELAXED );
+   }
+
+   return snap;
+}
+
+// release a snapshot obtained from fskit_dir_snapshot_get.
+// frees it (and whatever of its tree no other version shares) once nothing refers to it
+void fskit_dir_snapshot_put( struct fskit_dir_snapshot* snap ) {
+
+   if( snap == NULL ) {
+      return;
+   }
+
+   if( __atomic_sub_fetch( &snap->refcount, 1, __ATOMIC_ACQ_REL ) > 0 ) {
+      return;
+   }
+
+   fskit_dir_version_node_unref( snap->root );
+   fskit_safe_free( snap );
+}
+
+// make the given snapshot (which may be NULL) a directory's current version, and drop the old one 
+static void fskit_dir_versions_publish( struct fskit_dir_versions* versions, struct fskit_dir_snapshot* snap ) {
+
+   pthread_mutex_lock( &versions->lock );
+
+   struct fskit_dir_snapshot* old = versions->current;
+   versions->current = snap;
+
+   pthread_mutex_unlock( &versions->lock );
+
+   fskit_dir_snapshot_put( old );
+}
+
+// snapshot a directory's children
+// dir must be read-locked
+// return a new snapshot on success
+// return NULL on OOM
+static struct fskit_dir_snapshot* fskit_dir_snapshot_build( struct fskit_entry* dir ) {
+
+   int rc = 0;
+   struct fskit_dir_itr itr;
+   struct fskit_dir_version_node* root = NULL;
+   uint64_t count = 0;
+
+   // children come in order, so each one is appended on the right
+   for( fskit_entry_set* entry = fskit_dir_itr_seek( &itr, dir, FSKIT_DIR_COOKIE_START ); entry != NULL; entry = fskit_dir_itr_next( &itr ) ) {
+
+      struct fskit_entry* child = fskit_entry_set_child_at( entry );
+      if( child == NULL || child->creating ) {
+         continue;
+      }
+
+      struct fskit_dir_version_node* n = fskit_dir_version_node_new( fskit_entry_set_name_at( entry ), child->file_id, child->type );
+      if( n == NULL ) {
+         fskit_dir_itr_end( &itr );
+         fskit_dir_version_node_unref( root );
+         return NULL;
+      }
+
+      rc = fskit_dir_version_merge( root, n, &root );
+      if( rc != 0 ) {
+         fskit_dir_itr_end( &itr );
+         return NULL;
+      }
+
+      count++;
+   }
+
+   struct fskit_dir_snapshot* snap = CALLOC_LIST( struct fskit_dir_snapshot, 1 );
+   if( snap == NULL ) {
+      fskit_dir_version_node_unref( root );
+      return NULL;
+   }
+
+   snap->refcount = 1;
+   snap->count = count;
+   snap->root = root;
+
+   return snap;
+}
+
+// publish a new version of a directory with one name removed, and (if child is not NULL) that name pointing to child.
+// if that fails, the directory's version is dropped, and the next reader rebuilds it.
+// NOTE: dir must be write-locked
+static void fskit_dir_versions_update( struct fskit_entry* dir, char const* name, struct fskit_entry* child ) {
+
+   int rc = 0;
+   struct fskit_dir_versions* versions = dir->versions;
+   struct fskit_dir_version_node* n = NULL;
+   struct fskit_dir_version_node* root = NULL;
+   bool existed = false;
+
+   if( versions == NULL || versions->current == NULL ) {
+      // nothing to update
+      return;
+   }
+
+   // only writers change current, and we hold the directory's write lock
+   struct fskit_dir_snapshot* cur = versions->current;
+
+   if( child != NULL ) {
+
+      n = fskit_dir_version_node_new( name, child->file_id, child->type );
+      if( n == NULL ) {
+         fskit_dir_versions_publish( versions, NULL );
+         return;
+      }
+   }
+
+   rc = fskit_dir_version_replace( cur->root, name, n, &root, &existed );
+   if( rc != 0 ) {
+      fskit_dir_versions_publish( versions, NULL );
+      return;
+   }
+
+   struct fskit_dir_snapshot* snap = CALLOC_LIST( struct fskit_dir_snapshot, 1 );
+   if( snap == NULL ) {
+      fskit_dir_version_node_unref( root );
+      fskit_dir_versions_publish( versions, NULL );
+      return;
+   }
+
+   snap->refcount = 1;
+   snap->root = root;
+   snap->count = cur->count - (existed ? 1 : 0) + (child != NULL ? 1 : 0);
+
+   fskit_dir_versions_publish( versions, snap );
+}
+
+// a name in dir was added, or now refers to child
+// NOTE: dir must be write-locked
+void fskit_dir_versions_insert( struct fskit_entry* dir, char const* name, struct fskit_entry* child ) {
+   fskit_dir_versions_update( dir, name, child );
+}
+
+// a name in dir was removed
+// NOTE: dir must be write-locked
+void fskit_dir_versions_remove( struct fskit_entry* dir, char const* name ) {
+   fskit_dir_versions_update( dir, name, NULL );
+}
+
+// dir's children were replaced wholesale; the next reader rebuilds its version
+// NOTE: dir must be write-locked
+void fskit_dir_versions_reset( struct fskit_entry* dir ) {
+
+   if( dir->versions != NULL ) {
+      fskit_dir_versions_publish( dir->versions, NULL );
+   }
+}
+
+// free a directory's versions, if it keeps them 
+// NOTE: dir must be write-locked, and no longer reachable
+void fskit_dir_versions_free( struct fskit_entry* dir ) {
+
+   struct fskit_dir_versions* versions = dir->versions;
+   if( versions == NULL ) {
+      return;
+   }
+
+   dir->versions = NULL;
+
+   fskit_dir_versions_publish( versions, NULL );
+   pthread_mutex_destroy( &versions->lock );
+   fskit_safe_free( versions );
+}
+
+
+// make a directory keep multi-version snapshots of its children.
+// creates, unlinks, and renames in it then publish a new immutable version (copying only the O(log n) nodes they touch),
+// and fskit_dir_snapshot_get hands out the current one without taking the directory's lock, so long listings
+// never hold up writers.  Snapshots can't be turned off again.
+// NOTE: dir must be write-locked
+// return 0 on success (including if they were already on)
+// return -ENOTDIR if dir is not a directory
+// return -EINVAL if dir is sharded
+// return -ENOMEM on OOM
+int fskit_entry_enable_snapshots( struct fskit_entry* dir ) {
+
+   if( dir->type != FSKIT_ENTRY_TYPE_DIR ) {
+      return -ENOTDIR;
+   }
+
+   if( dir->shards != NULL ) {
+      return -EINVAL;
+   }
+
+   if( dir->versions != NULL ) {
+      return 0;
+   }
+
+   struct fskit_dir_versions* versions = CALLOC_LIST( struct fskit_dir_versions, 1 );
+   if( versions == NULL ) {
+      return -ENOMEM;
+   }
+
+   pthread_mutex_init( &versions->lock, NULL );
+
+   // the first reader builds the first version
+   __atomic_store_n( &dir->versions, versions, __ATOMIC_RELEASE );
+
+   return 0;
+}
+
+
+// get an immutable snapshot of a directory's children, to read with fskit_dir_snapshot_getdents
+// and release with fskit_dir_snapshot_put.  Nothing is locked while the snapshot is held.
+// if snapshots are on for the directory, this is its current version, and usually takes no directory lock;
+// otherwise, a private snapshot is built under the directory's read lock.
+// return the snapshot on success
+// return NULL on error, and set *err to:
+// * -EBADF if the directory handle is invalid
+// * -ENOMEM on OOM
+struct fskit_dir_snapshot* fskit_dir_snapshot_get( struct fskit_core* core, struct fskit_dir_handle* dirh, int* err ) {
+
+   struct fskit_dir_snapshot* snap = NULL;
+
+   fskit_dir_handle_rlock( dirh );
+
+   struct fskit_entry* dent = dirh->dent;
+   if( dent == NULL ) {
+
+      fskit_dir_handle_unlock( dirh );
+      *err = -EBADF;
+      return NULL;
+   }
+
+   // dirh holds a reference to dent, so its versions stay put
+   struct fskit_dir_versions* versions = __atomic_load_n( &dent->versions, __ATOMIC_ACQUIRE );
+
+   if( versions != NULL ) {
+
+      pthread_mutex_lock( &versions->lock );
+      snap = fskit_dir_snapshot_ref( versions->current );
+      pthread_mutex_unlock( &versions->lock );
+
+      if( snap != NULL ) {
+         fskit_dir_handle_unlock( dirh );
+         return snap;
+      }
+   }
+
+   // no current version.  Build one while writers are held off.
+   fskit_entry_rlock( dent );
+
+   snap = fskit_dir_snapshot_build( dent );
+
+   if( snap != NULL && versions != NULL ) {
+
+      // publish it, unless another reader beat us to it
+      pthread_mutex_lock( &versions->lock );
+
+      if( versions->current == NULL ) {
+         versions->current = fskit_dir_snapshot_ref( snap );
+      }
+      else {
+         fskit_dir_snapshot_put( snap );
+         snap = fskit_dir_snapshot_ref( versions->current );
+      }
+
+      pthread_mutex_unlock( &versions->lock );
+   }
+
+   fskit_entry_unlock( dent );
+   fskit_dir_handle_unlock( dirh );
+
+   if( snap == NULL ) {
+      *err = -ENOMEM;
+   }
+
+   return snap;
+}
+
+
+// number of entries in a snapshot, including . and ..
+uint64_t fskit_dir_snapshot_count( struct fskit_dir_snapshot* snap ) {
+   return snap->count;
+}
+
+
+// pack the nodes in t after the given cookie into buf, in order, from *off.
+// return true if buf filled up
+static bool fskit_dir_snapshot_fill( struct fskit_dir_version_node* t, uint64_t cookie, char* buf, size_t buflen, size_t* off ) {
+
+   if( t == NULL ) {
+      return false;
+   }
+
+   if( t->cookie > cookie ) {
+
+      // some of the left subtree comes after the cookie too 
+      if( fskit_dir_snapshot_fill( t->left, cookie, buf, buflen, off ) ) {
+         return true;
+      }
+
+      size_t namelen = strlen( t->name );
+      size_t reclen = FSKIT_DIRENT64_RECLEN( namelen );
+
+      if( *off + reclen > buflen ) {
+         return true;
+      }
+
+      struct fskit_dirent64* rec = (struct fskit_dirent64*)(buf + *off);
+
+      rec->file_id = t->file_id;
+      rec->cookie = t->cookie;
+      rec->reclen = reclen;
+      rec->type = t->type;
+
+      memcpy( rec->name, t->name, namelen );
+      memset( rec->name + namelen, 0, reclen - offsetof( struct fskit_dirent64, name ) - namelen );
+
+      *off += reclen;
+   }
+
+   return fskit_dir_snapshot_fill( t->right, cookie, buf, buflen, off );
+}
+
+
+// read a snapshot's entries after the given cookie into buf, packed as by fskit_getdents.
+// takes no locks.
+// return the number of bytes written, 0 at the end of the snapshot, or -EINVAL if the next record does not fit
+ssize_t fskit_dir_snapshot_getdents( struct fskit_dir_snapshot* snap, uint64_t cookie, char* buf, size_t buflen ) {
+
+   size_t off = 0;
+   bool full = fskit_dir_snapshot_fill( snap->root, cookie, buf, buflen, &off );
+
+   if( full && off == 0 ) {
+      return -EINVAL;
+   }
+
+   return off;
+}
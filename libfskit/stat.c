@@ -33,8 +33,16 @@ int fskit_do_user_stat( struct fskit_core* core, char const* fs_path, struct fsk
    
    struct fskit_route_dispatch_args dargs;
 
-   memset( name, 0, FSKIT_FILESYSTEM_NAMEMAX+1 );
-   fskit_basename( fs_path, name );
+   if( fs_path != NULL ) {
+      
+      memset( name, 0, FSKIT_FILESYSTEM_NAMEMAX+1 );
+      fskit_basename( fs_path, name );
+   }
+   else {
+      
+      // called on behalf of a handle
+      fskit_entry_copy_name( fent, name );
+   }
    
    fskit_route_stat_args( &dargs, name, sb, true );
 
@@ -118,14 +126,14 @@ mode_t fskit_fullmode( int fskit_type, mode_t mode ) {
 // stat an inode directly
 // fill in the stat buffer, but do NOT call the user route
 // always succeeds
-// NOTE: fent must be read-locked
+// NOTE: fent must be read-locked, or read between fskit_entry_meta_read_begin and fskit_entry_meta_read_retry
 int fskit_entry_fstat( struct fskit_entry* fent, struct stat* sb ) {
    
    // fill in defaults
    sb->st_dev = 0;
    sb->st_ino = fent->file_id;
    sb->st_mode = fskit_fullmode( fent->type, fent->mode );
-   sb->st_nlink = fent->link_count;
+   sb->st_nlink = fskit_entry_get_link_count( fent );
    sb->st_uid = fent->owner;
    sb->st_gid = fent->group;
    sb->st_rdev = fent->dev;
@@ -151,10 +159,12 @@ int fskit_entry_fstat( struct fskit_entry* fent, struct stat* sb ) {
 // NOTE: fent must NOT be locked, but it must be ref'ed
 int fskit_fstat( struct fskit_core* core, char const* fs_path, struct fskit_entry* fent, struct stat* sb ) {
    
-   // fill in defaults
-   fskit_entry_rlock( fent );
-   fskit_entry_fstat( fent, sb );
-   fskit_entry_unlock( fent );
+   // fill in defaults from a consistent snapshot, without locking (see fskit_entry_meta_write_begin)
+   uint64_t seq = 0;
+   do {
+      seq = fskit_entry_meta_read_begin( fent );
+      fskit_entry_fstat( fent, sb );
+   } while( fskit_entry_meta_read_retry( fent, seq ) );
    
    // route to user callback
    int rc = fskit_do_user_stat( core, fs_path, fent, sb );
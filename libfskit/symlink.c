@@ -70,7 +70,7 @@ int fskit_symlink( struct fskit_core* core, char const* target, char const* link
    }
 
    // verify the child doesn't exist
-   child = fskit_entry_set_find_name( parent->children, child_name );
+   child = fskit_dir_find_by_name( parent, child_name );
 
    if( child != NULL ) {
       // exists
@@ -25,7 +25,7 @@
 
 #include "fskit_private/private.h"
 
-static int fskit_do_user_sync( struct fskit_core* core, char const* path, struct fskit_entry* fent ) {
+static int fskit_do_user_sync( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_file_handle* fh ) {
 
    int rc = 0;
    int cbrc = 0;
@@ -34,7 +34,7 @@ static int fskit_do_user_sync( struct fskit_core* core, char const* path, struct
 
    fskit_route_sync_args( &dargs );
 
-   rc = fskit_route_call_sync( core, path, fent, &dargs, &cbrc );
+   rc = fskit_route_call_pinned( core, fh, FSKIT_ROUTE_MATCH_SYNC, path, fent, &dargs, &cbrc );
 
    if( rc == -EPERM || rc == -ENOSYS ) {
       // no stat defined
@@ -49,11 +49,14 @@ static int fskit_do_user_sync( struct fskit_core* core, char const* path, struct
 // basically, just call the user route
 int fskit_fsync( struct fskit_core* core, struct fskit_file_handle* fh ) {
 
-   fskit_file_handle_rlock( fh );
+   // no handle lock needed
+   if( fskit_file_handle_io_begin( fh ) != 0 ) {
+      return -EBADF;
+   }
    
-   int rc = fskit_do_user_sync( core, fh->path, fh->fent );
+   int rc = fskit_do_user_sync( core, NULL, fh->fent, fh );
    
-   fskit_file_handle_unlock( fh );
+   fskit_file_handle_io_end( fh );
 
    return rc;
 }
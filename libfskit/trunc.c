@@ -22,6 +22,7 @@
 #include <fskit/trunc.h>
 #include <fskit/route.h>
 #include <fskit/util.h>
+#include <fskit/cache.h>
 
 #include "fskit_private/private.h"
 
@@ -32,10 +33,14 @@ static int fskit_trunc_cont( struct fskit_core* core, struct fskit_entry* fent,
    if( trunc_rc == 0 ) {
 
       // update metadata
+      fskit_entry_meta_write_begin( fent );
+
       fskit_entry_set_mtime( fent, NULL );
       fskit_entry_set_atime( fent, NULL );
 
-      fent->size = new_size;
+      fskit_entry_resize( fent, new_size );
+
+      fskit_entry_meta_write_end( fent );
    }
 
    return 0;
@@ -45,19 +50,30 @@ static int fskit_trunc_cont( struct fskit_core* core, struct fskit_entry* fent,
 // fent should be referenced, but it should NOT be locked in any way
 // return 0 on success
 // return negative on failure
-int fskit_run_user_trunc( struct fskit_core* core, char const* path, struct fskit_entry* fent, off_t new_size, void* handle_data ) {
+int fskit_run_user_trunc( struct fskit_core* core, char const* path, struct fskit_entry* fent, off_t new_size, void* handle_data, struct fskit_file_handle* fh ) {
 
    int rc = 0;
    int cbrc = 0;
    struct fskit_route_dispatch_args dargs;
    char name[FSKIT_FILESYSTEM_NAMEMAX+1];
    
-   memset( name, 0, FSKIT_FILESYSTEM_NAMEMAX+1 );
-   fskit_basename( path, name );
+   if( path != NULL ) {
+      
+      memset( name, 0, FSKIT_FILESYSTEM_NAMEMAX+1 );
+      fskit_basename( path, name );
+   }
+   else {
+      
+      // called on behalf of a handle
+      fskit_entry_copy_name( fent, name );
+   }
 
    fskit_route_trunc_args( &dargs, name, new_size, handle_data, fskit_trunc_cont );
 
-   rc = fskit_route_call_trunc( core, path, fent, &dargs, &cbrc );
+   rc = fskit_route_call_pinned( core, fh, FSKIT_ROUTE_MATCH_TRUNC, path, fent, &dargs, &cbrc );
+
+   // cached attributes are stale
+   fskit_entry_invalidate( core, fent );
 
    if( rc == -EPERM || rc == -ENOSYS ) {
       // no routes installed.
@@ -74,7 +90,9 @@ int fskit_run_user_trunc( struct fskit_core* core, char const* path, struct fski
 // NOTE; fent must be write-locked
 int fskit_entry_set_size( struct fskit_entry* fent, off_t size ) {
    
-   fent->size = size;
+   fskit_entry_meta_write_begin( fent );
+   fskit_entry_resize( fent, size );
+   fskit_entry_meta_write_end( fent );
    return 0;
 }
 
@@ -83,18 +101,21 @@ int fskit_entry_set_size( struct fskit_entry* fent, off_t size ) {
 // return negative on failure.
 int fskit_ftrunc( struct fskit_core* core, struct fskit_file_handle* fh, off_t new_size ) {
 
-   fskit_file_handle_rlock( fh );
+   // no handle lock needed
+   if( fskit_file_handle_io_begin( fh ) != 0 ) {
+      return -EBADF;
+   }
 
    // sanity check
    if( (fh->flags & (O_RDWR | O_WRONLY)) == 0 ) {
 
-      fskit_file_handle_unlock( fh );
+      fskit_file_handle_io_end( fh );
       return -EBADF;
    }
 
-   int rc = fskit_run_user_trunc( core, fh->path, fh->fent, new_size, fh->app_data );
+   int rc = fskit_run_user_trunc( core, NULL, fh->fent, new_size, fh->app_data, fh );
 
-   fskit_file_handle_unlock( fh );
+   fskit_file_handle_io_end( fh );
 
    return rc;
 }
@@ -113,43 +134,25 @@ int fskit_trunc( struct fskit_core* core, char const* path, uint64_t user, uint6
    }
 
    // get the fent
-   struct fskit_entry* fent = fskit_entry_resolve_path( core, path, user, group, true, &err );
+   struct fskit_entry* fent = fskit_entry_resolve_path( core, path, user, group, false, &err );
    if( fent == NULL || err != 0 ) {
       return err;
    }
 
    // reference the fent, so it won't go anywhere
-   fent->open_count++;
+   fskit_entry_ref_entry( fent );
 
    fskit_entry_unlock( fent );
 
-   rc = fskit_run_user_trunc( core, path, fent, new_size, NULL );
+   rc = fskit_run_user_trunc( core, path, fent, new_size, NULL, NULL );
 
    // unreference
-   fskit_entry_wlock( fent );
-
-   fent->open_count--;
-
-   // need to free?  note that this may unlock and re-lock fent, but only if it cannot be resolved by any path
-   // NOTE: this may unlock and destroy the fent
-   rc = fskit_entry_try_destroy_and_free( core, path, NULL, fent );
-   if( rc > 0 ) {
-
-      // fent was unlocked and destroyed
-      rc = 0;
-   }
-   else if( rc < 0 ) {
+   // NOTE: this may destroy the fent, if it got unlinked in the meantime
+   rc = fskit_entry_unref( core, path, fent );
+   if( rc < 0 ) {
 
       // some error occurred
-      fskit_error("fskit_entry_try_destroy_and_free(%p) rc = %d\n", fent, rc );
-      fskit_entry_unlock( fent );
-
-      return rc;
-   }
-   else {
-
-      // done with this entry
-      fskit_entry_unlock( fent );
+      fskit_error("fskit_entry_unref(%p) rc = %d\n", fent, rc );
    }
 
    return rc;
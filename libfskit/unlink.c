@@ -35,35 +35,21 @@ int fskit_unlink( struct fskit_core* core, char const* path, uint64_t owner, uin
    int rc = 0;
    int err = 0;
 
-   // look up the parent and write-lock it
-   char* path_dirname = fskit_dirname( path, NULL );
-   char* path_basename = fskit_basename( path, NULL );
-   
-   if( path_basename == NULL || path_dirname == NULL ) {
-      
-      fskit_safe_free( path_basename );
-      fskit_safe_free( path_dirname );
-      
-      return -ENOMEM;
-   }
-
-   if( strlen(path_basename) > FSKIT_FILESYSTEM_NAMEMAX ) {
+   // look up the parent and write-lock it (or just the child's shard, if it is sharded)
+   char path_basename[FSKIT_FILESYSTEM_NAMEMAX+1];
+   size_t basename_len = 0;
+   char const* base = fskit_basename_view( path, &basename_len );
 
-      fskit_safe_free( path_basename );
-      fskit_safe_free( path_dirname );
-      return -ENAMETOOLONG;
+   rc = fskit_path_name_copy( base, basename_len, path_basename );
+   if( rc != 0 ) {
+      return rc;
    }
 
-   struct fskit_entry* parent = fskit_entry_resolve_path( core, path_dirname, owner, group, true, &err );
-
-   free( path_dirname );
+   struct fskit_entry* parent = fskit_entry_resolve_path_parent( core, path, owner, group, &err );
 
    if( !parent || err ) {
 
       fskit_entry_unlock( parent );
-
-      free( path_basename );
-
       return err;
    }
 
@@ -72,30 +58,29 @@ int fskit_unlink( struct fskit_core* core, char const* path, uint64_t owner, uin
       // nope
       fskit_entry_unlock( parent );
 
-      free( path_basename );
-
       return -ENOTDIR;
    }
 
+   struct fskit_dir_shard* shard = fskit_entry_dir_shard_wlock( parent, path_basename );
+
    // find the fent, and write-lock it
-   struct fskit_entry* fent = fskit_entry_set_find_name( parent->children, path_basename );
+   struct fskit_entry* fent = fskit_dir_find_by_name( parent, path_basename );
 
-   if( fent == NULL ) {
+   // (a reserved name does not exist until its create finishes)
+   if( fent == NULL || fent->creating ) {
 
-      fskit_entry_unlock( parent );
-      free( path_basename );
+      fskit_entry_dir_unlock( parent, shard );
       return -ENOENT;
    }
    
    // detach fent from parent
    rc = fskit_entry_detach_lowlevel( parent, path_basename );
-   free( path_basename );
    
    if( rc != 0 && rc != -ENOENT ) {
 
       fskit_error("fskit_entry_detach_lowlevel(%p) rc = %d\n", fent, rc );
 
-      fskit_entry_unlock( parent );
+      fskit_entry_dir_unlock( parent, shard );
       return rc;
    }
 
@@ -130,7 +115,7 @@ int fskit_unlink( struct fskit_core* core, char const* path, uint64_t owner, uin
       fskit_entry_unlock( fent );
    }
 
-   fskit_entry_unlock( parent );
+   fskit_entry_dir_unlock( parent, shard );
 
    return rc;
 }
@@ -22,6 +22,7 @@
 #include <fskit/utime.h>
 #include <fskit/path.h>
 #include <fskit/entry.h>
+#include <fskit/cache.h>
 
 #include "fskit_private/private.h"
 
@@ -44,8 +45,10 @@ int fskit_entry_set_ctime( struct fskit_entry* fent, struct timespec* now ) {
       memcpy( &new_time, now, sizeof(struct timespec) );
    }
 
+   fskit_entry_meta_write_begin( fent );
    fent->ctime_sec = new_time.tv_sec;
    fent->ctime_nsec = new_time.tv_nsec;
+   fskit_entry_meta_write_end( fent );
 
    return 0;
 }
@@ -69,8 +72,10 @@ int fskit_entry_set_mtime( struct fskit_entry* fent, struct timespec* now ) {
       memcpy( &new_time, now, sizeof(struct timespec) );
    }
 
+   fskit_entry_meta_write_begin( fent );
    fent->mtime_sec = new_time.tv_sec;
    fent->mtime_nsec = new_time.tv_nsec;
+   fskit_entry_meta_write_end( fent );
 
    return 0;
 }
@@ -95,8 +100,10 @@ int fskit_entry_set_atime( struct fskit_entry* fent, struct timespec* now ) {
       memcpy( &new_time, now, sizeof(struct timespec) );
    }
 
+   fskit_entry_meta_write_begin( fent );
    fent->atime_sec = new_time.tv_sec;
    fent->atime_nsec = new_time.tv_nsec;
+   fskit_entry_meta_write_end( fent );
 
    return 0;
 }
@@ -166,12 +173,17 @@ int fskit_utimes( struct fskit_core* core, char const* path, uint64_t user, uint
       mtime = times[1];
    }
 
+   fskit_entry_meta_write_begin( fent );
+
    fent->atime_sec = atime.tv_sec;
    fent->atime_nsec = atime.tv_usec * 1000;
 
    fent->mtime_sec = mtime.tv_sec;
    fent->mtime_nsec = mtime.tv_usec * 1000;
 
+   fskit_entry_meta_write_end( fent );
+
+   fskit_entry_invalidate( core, fent );
    fskit_entry_unlock( fent );
    return 0;
 }
@@ -0,0 +1,447 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include <fskit/walk.h>
+#include <fskit/executor.h>
+#include <fskit/path.h>
+#include <fskit/stat.h>
+#include <fskit/util.h>
+
+#include "fskit_private/private.h"
+
+// a walk in progress
+struct fskit_walk {
+
+   struct fskit_core* core;
+   uint64_t user;
+   uint64_t group;
+
+   fskit_walk_visitor_t visitor;
+   void* cls;
+
+   // directories are walked as jobs on exec, or, if exec is NULL, popped off of stack by the calling thread
+   struct fskit_executor* exec;
+   struct fskit_walk_job* stack;
+
+   bool stop;                   // set once the walk should end (atomic)
+
+   // guarded by lock
+   int64_t outstanding;         // directory jobs not yet finished
+   int rc;                      // first error
+   pthread_mutex_t lock;
+   pthread_cond_t cond;
+};
+
+// a directory to walk
+struct fskit_walk_job {
+
+   struct fskit_walk* walk;
+
+   struct fskit_entry* dir;     // referenced, so it can't be freed while the job waits
+   char* path;
+   int depth;
+
+   struct fskit_walk_job* next;
+};
+
+// a snapshot of a child, taken while its directory was read-locked
+struct fskit_walk_child {
+
+   char name[FSKIT_FILESYSTEM_NAMEMAX+1];
+   struct stat sb;
+   struct fskit_entry* dir;     // referenced, if the child is a directory
+};
+
+static void fskit_walk_dir( struct fskit_walk_job* job );
+
+
+// record an error (the first one wins), and end the walk
+static void fskit_walk_fail( struct fskit_walk* walk, int rc ) {
+
+   pthread_mutex_lock( &walk->lock );
+
+   if( walk->rc == 0 ) {
+      walk->rc = rc;
+   }
+
+   pthread_mutex_unlock( &walk->lock );
+
+   __atomic_store_n( &walk->stop, true, __ATOMIC_RELEASE );
+}
+
+// executor entry point for walking a directory
+static void fskit_walk_dir_main( void* arg ) {
+
+   fskit_walk_dir( (struct fskit_walk_job*)arg );
+}
+
+// queue up a directory to be walked.
+// takes ownership of path, and of the reference on dir.
+static void fskit_walk_push( struct fskit_walk* walk, struct fskit_entry* dir, char* path, int depth ) {
+
+   int rc = 0;
+   struct fskit_walk_job* job = CALLOC_LIST( struct fskit_walk_job, 1 );
+
+   if( job == NULL ) {
+
+      fskit_walk_fail( walk, -ENOMEM );
+      fskit_entry_unref( walk->core, path, dir );
+      fskit_safe_free( path );
+      return;
+   }
+
+   job->walk = walk;
+   job->dir = dir;
+   job->path = path;
+   job->depth = depth;
+
+   pthread_mutex_lock( &walk->lock );
+   walk->outstanding++;
+
+   if( walk->exec == NULL ) {
+
+      job->next = walk->stack;
+      walk->stack = job;
+   }
+
+   pthread_mutex_unlock( &walk->lock );
+
+   if( walk->exec != NULL ) {
+
+      rc = fskit_executor_submit( walk->exec, fskit_walk_dir_main, job );
+      if( rc != 0 ) {
+
+         // walk it here instead
+         fskit_walk_dir( job );
+      }
+   }
+}
+
+// snapshot the visible children of a directory, referencing the ones that are directories.
+// dir must be read-locked
+// return the number of children snapshotted on success, and set *ret_children to them
+// return -ENOMEM on OOM
+static int64_t fskit_walk_snapshot_children( struct fskit_entry* dir, struct fskit_walk_child** ret_children ) {
+
+   struct fskit_dir_itr itr;
+   struct fskit_walk_child* children = NULL;
+   uint64_t max_children = fskit_entry_dir_count( dir );
+   int64_t num_children = 0;
+
+   children = CALLOC_LIST( struct fskit_walk_child, max_children + 1 );
+   if( children == NULL ) {
+      return -ENOMEM;
+   }
+
+   for( fskit_entry_set* entry = fskit_dir_itr_seek( &itr, dir, FSKIT_DIR_COOKIE_START ); entry != NULL && (uint64_t)num_children < max_children; entry = fskit_dir_itr_next( &itr ) ) {
+
+      struct fskit_entry* child = fskit_entry_set_child_at( entry );
+      char const* name = fskit_entry_set_name_at( entry );
+
+      // skip . and .., and names reserved by unfinished creates (whose routes may hold them locked)
+      if( child == NULL || child->creating || strcmp( name, "." ) == 0 || strcmp( name, ".." ) == 0 ) {
+         continue;
+      }
+
+      fskit_entry_rlock( child );
+
+      // skip garbage-collectables
+      if( child->deletion_in_progress || child->type == FSKIT_ENTRY_TYPE_DEAD ) {
+
+         fskit_entry_unlock( child );
+         continue;
+      }
+
+      strncpy( children[num_children].name, name, FSKIT_FILESYSTEM_NAMEMAX );
+      fskit_entry_fstat( child, &children[num_children].sb );
+
+      if( child->type == FSKIT_ENTRY_TYPE_DIR ) {
+
+         fskit_entry_ref_entry( child );
+         children[num_children].dir = child;
+      }
+
+      fskit_entry_unlock( child );
+      num_children++;
+   }
+
+   fskit_dir_itr_end( &itr );
+
+   *ret_children = children;
+   return num_children;
+}
+
+// visit one entry
+// return the visitor's answer, or FSKIT_WALK_STOP if the walk has ended
+static int fskit_walk_visit( struct fskit_walk* walk, char const* path, char const* name, int depth, struct stat const* sb ) {
+
+   int rc = 0;
+   struct fskit_walk_entry went;
+
+   if( __atomic_load_n( &walk->stop, __ATOMIC_ACQUIRE ) ) {
+      return FSKIT_WALK_STOP;
+   }
+
+   went.path = path;
+   went.name = name;
+   went.depth = depth;
+   went.sb = *sb;
+
+   rc = (*walk->visitor)( walk->core, &went, walk->cls );
+
+   if( rc < 0 ) {
+
+      fskit_walk_fail( walk, rc );
+      return FSKIT_WALK_STOP;
+   }
+
+   if( rc == FSKIT_WALK_STOP ) {
+      __atomic_store_n( &walk->stop, true, __ATOMIC_RELEASE );
+   }
+
+   return rc;
+}
+
+// walk one directory: snapshot its children, visit them, and queue up the subdirectories that aren't pruned.
+// consumes the job.
+static void fskit_walk_dir( struct fskit_walk_job* job ) {
+
+   struct fskit_walk* walk = job->walk;
+   struct fskit_entry* dir = job->dir;
+   struct fskit_walk_child* children = NULL;
+   int64_t num_children = 0;
+   char* child_path = NULL;
+   size_t dir_path_len = strlen( job->path );
+   int rc = 0;
+
+   if( __atomic_load_n( &walk->stop, __ATOMIC_ACQUIRE ) ) {
+      goto fskit_walk_dir_out;
+   }
+
+   fskit_entry_rlock( dir );
+
+   // skip directories that were removed since they were queued, or that we can't look into
+   if( dir->deletion_in_progress || dir->type != FSKIT_ENTRY_TYPE_DIR || fskit_entry_get_link_count( dir ) == 0 ||
+       !FSKIT_ENTRY_IS_DIR_SEARCHABLE( dir->mode, dir->owner, dir->group, walk->user, walk->group ) ) {
+
+      fskit_entry_unlock( dir );
+      goto fskit_walk_dir_out;
+   }
+
+   num_children = fskit_walk_snapshot_children( dir, &children );
+
+   fskit_entry_unlock( dir );
+
+   if( num_children < 0 ) {
+
+      fskit_walk_fail( walk, (int)num_children );
+      goto fskit_walk_dir_out;
+   }
+
+   // children's paths are built in one buffer: the directory's path, a '/', and the name
+   while( dir_path_len > 0 && job->path[ dir_path_len - 1 ] == '/' ) {
+      dir_path_len--;
+   }
+
+   child_path = CALLOC_LIST( char, dir_path_len + FSKIT_FILESYSTEM_NAMEMAX + 2 );
+   if( child_path == NULL ) {
+
+      fskit_walk_fail( walk, -ENOMEM );
+   }
+   else {
+
+      memcpy( child_path, job->path, dir_path_len );
+      child_path[ dir_path_len ] = '/';
+   }
+
+   for( int64_t i = 0; i < num_children; i++ ) {
+
+      rc = FSKIT_WALK_STOP;
+
+      if( child_path != NULL ) {
+
+         strcpy( child_path + dir_path_len + 1, children[i].name );
+         rc = fskit_walk_visit( walk, child_path, child_path + dir_path_len + 1, job->depth + 1, &children[i].sb );
+      }
+
+      if( children[i].dir == NULL ) {
+         continue;
+      }
+
+      if( rc == FSKIT_WALK_CONTINUE ) {
+
+         char* subdir_path = strdup( child_path );
+         if( subdir_path != NULL ) {
+
+            fskit_walk_push( walk, children[i].dir, subdir_path, job->depth + 1 );
+            continue;
+         }
+
+         fskit_walk_fail( walk, -ENOMEM );
+      }
+
+      // not going into it.  child_path is its path, unless it was lost to OOM
+      fskit_entry_unref( walk->core, child_path, children[i].dir );
+   }
+
+   fskit_safe_free( child_path );
+   fskit_safe_free( children );
+
+fskit_walk_dir_out:
+
+   fskit_entry_unref( walk->core, job->path, dir );
+
+   fskit_safe_free( job->path );
+   fskit_safe_free( job );
+
+   pthread_mutex_lock( &walk->lock );
+
+   walk->outstanding--;
+   if( walk->outstanding == 0 ) {
+      pthread_cond_broadcast( &walk->cond );
+   }
+
+   pthread_mutex_unlock( &walk->lock );
+}
+
+
+// walk the tree below path, calling visitor on path and then on every entry below it.
+// num_threads directories are walked at once (on a private executor, which steals work between its workers); if it
+// is 1 or less, the walk happens on the calling thread.  So the visitor may be called from several threads at once,
+// but a directory is always visited before anything in it.  Entries are snapshotted while their directory is
+// read-locked, and visited with nothing locked; directories that can't be searched by user and group are visited, but
+// not gone into.  The visitor returns FSKIT_WALK_CONTINUE, FSKIT_WALK_PRUNE to skip a directory's contents, or
+// FSKIT_WALK_STOP (or a negative errno) to end the walk.
+// return 0 if the walk finished, or was stopped by FSKIT_WALK_STOP
+// return the visitor's error, if it returned one
+// return the usual path resolution errors for path
+// return -ENOMEM on OOM
+int fskit_walk( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, int num_threads, fskit_walk_visitor_t visitor, void* cls ) {
+
+   int rc = 0;
+   struct fskit_walk walk;
+   struct fskit_entry* root = NULL;
+   struct fskit_walk_job* job = NULL;
+   struct stat sb;
+   bool is_dir = false;
+   size_t name_len = 0;
+   char name[FSKIT_FILESYSTEM_NAMEMAX+1];
+   char* root_path = NULL;
+
+   memset( &walk, 0, sizeof(struct fskit_walk) );
+
+   walk.core = core;
+   walk.user = user;
+   walk.group = group;
+   walk.visitor = visitor;
+   walk.cls = cls;
+
+   root = fskit_entry_resolve_path( core, path, user, group, false, &rc );
+   if( root == NULL ) {
+      return rc;
+   }
+
+   fskit_entry_fstat( root, &sb );
+
+   is_dir = ( root->type == FSKIT_ENTRY_TYPE_DIR );
+   if( is_dir ) {
+      fskit_entry_ref_entry( root );
+   }
+
+   fskit_entry_unlock( root );
+
+   char const* base = fskit_basename_view( path, &name_len );
+   fskit_path_name_copy( base, name_len, name );
+
+   root_path = strdup( path );
+   if( root_path == NULL ) {
+
+      if( is_dir ) {
+         fskit_entry_unref( core, path, root );
+      }
+
+      return -ENOMEM;
+   }
+
+   // visit it as /foo, even if asked for /foo/
+   for( size_t len = strlen( root_path ); len > 1 && root_path[len - 1] == '/'; len-- ) {
+      root_path[len - 1] = '\0';
+   }
+
+   pthread_mutex_init( &walk.lock, NULL );
+   pthread_cond_init( &walk.cond, NULL );
+
+   rc = fskit_walk_visit( &walk, root_path, name, 0, &sb );
+
+   if( !is_dir || rc != FSKIT_WALK_CONTINUE ) {
+
+      if( is_dir ) {
+         fskit_entry_unref( core, root_path, root );
+      }
+
+      fskit_safe_free( root_path );
+   }
+   else {
+
+      if( num_threads > 1 ) {
+
+         walk.exec = fskit_executor_new();
+         if( walk.exec == NULL || fskit_executor_init( walk.exec, num_threads ) != 0 ) {
+
+            // walk it here instead
+            fskit_safe_free( walk.exec );
+         }
+      }
+
+      fskit_walk_push( &walk, root, root_path, 0 );
+
+      if( walk.exec == NULL ) {
+
+         // walk depth-first on this thread
+         while( walk.stack != NULL ) {
+
+            job = walk.stack;
+            walk.stack = job->next;
+
+            fskit_walk_dir( job );
+         }
+      }
+      else {
+
+         // wait for the workers to run out of directories
+         pthread_mutex_lock( &walk.lock );
+
+         while( walk.outstanding > 0 ) {
+            pthread_cond_wait( &walk.cond, &walk.lock );
+         }
+
+         pthread_mutex_unlock( &walk.lock );
+
+         fskit_executor_destroy( walk.exec );
+         fskit_safe_free( walk.exec );
+      }
+   }
+
+   pthread_mutex_destroy( &walk.lock );
+   pthread_cond_destroy( &walk.cond );
+
+   return walk.rc;
+}
@@ -22,23 +22,25 @@
 #include <fskit/write.h>
 #include <fskit/utime.h>
 #include <fskit/route.h>
+#include <fskit/cache.h>
 
 #include "fskit_private/private.h"
 
-// continuation for successful write
-// fent must be write-locked
+// continuation for successful write, called with the same locks held as the write.
+// under FSKIT_CONCURRENT or FSKIT_INODE_CONCURRENT, other writes may be running this concurrently (see fskit_entry_meta_write_begin)
 int fskit_write_cont( struct fskit_core* core, struct fskit_entry* fent, off_t offset, ssize_t num_written ) {
 
    if( num_written >= 0 ) {
+      fskit_entry_meta_write_begin( fent );
+
       fskit_entry_set_mtime( fent, NULL );
       fskit_entry_set_atime( fent, NULL );
 
-      off_t size_delta = 0;
       if( offset + num_written > fent->size ) {
-         size_delta = (offset + num_written) - fent->size;
+         fskit_entry_resize( fent, offset + num_written );
       }
 
-      fent->size += size_delta;
+      fskit_entry_meta_write_end( fent );
    }
 
    return 0;
@@ -47,7 +49,7 @@ int fskit_write_cont( struct fskit_core* core, struct fskit_entry* fent, off_t o
 // run the user-given write route callback
 // return the number of bytes written on success
 // return negative on failure
-ssize_t fskit_run_user_write( struct fskit_core* core, char const* path, struct fskit_entry* fent, char const* buf, size_t buflen, off_t offset, void* handle_data ) {
+ssize_t fskit_run_user_write( struct fskit_core* core, char const* path, struct fskit_entry* fent, char const* buf, size_t buflen, off_t offset, void* handle_data, struct fskit_file_handle* fh ) {
 
    int rc = 0;
    int cbrc = 0;
@@ -55,7 +57,7 @@ ssize_t fskit_run_user_write( struct fskit_core* core, char const* path, struct
 
    fskit_route_io_args( &dargs, (char*)buf, buflen, offset, handle_data, fskit_write_cont );
 
-   rc = fskit_route_call_write( core, path, fent, &dargs, &cbrc );
+   rc = fskit_route_call_pinned( core, fh, FSKIT_ROUTE_MATCH_WRITE, path, fent, &dargs, &cbrc );
 
    if( rc == -EPERM || rc == -ENOSYS ) {
       // no routes installed
@@ -70,31 +72,40 @@ ssize_t fskit_run_user_write( struct fskit_core* core, char const* path, struct
 // return negative on failure.
 ssize_t fskit_write( struct fskit_core* core, struct fskit_file_handle* fh, char const* buf, size_t buflen, off_t offset ) {
 
-   fskit_file_handle_rlock( fh );
+   // no handle lock needed
+   if( fskit_file_handle_io_begin( fh ) != 0 ) {
+      return -EBADF;
+   }
 
    // sanity check
    if( (fh->flags & (O_RDWR | O_WRONLY)) == 0 ) {
 
-      fskit_file_handle_unlock( fh );
+      fskit_file_handle_io_end( fh );
       return -EBADF;
    }
 
-   ssize_t num_written = fskit_run_user_write( core, fh->path, fh->fent, buf, buflen, offset, fh->app_data );
+   ssize_t num_written = fskit_run_user_write( core, NULL, fh->fent, buf, buflen, offset, fh->app_data, fh );
 
    if( num_written >= 0 ) {
 
       // update metadata
       fskit_entry_wlock( fh->fent );
+      fskit_entry_meta_write_begin( fh->fent );
 
       fskit_entry_set_mtime( fh->fent, NULL );
       fskit_entry_set_atime( fh->fent, NULL );
 
-      fh->fent->size = ((unsigned)(offset + buflen) > fh->fent->size ? offset + buflen : fh->fent->size);
+      if( (unsigned)(offset + buflen) > fh->fent->size ) {
+         fskit_entry_resize( fh->fent, offset + buflen );
+      }
+
+      fskit_entry_meta_write_end( fh->fent );
 
+      fskit_entry_invalidate( core, fh->fent );
       fskit_entry_unlock( fh->fent );
    }
 
-   fskit_file_handle_unlock( fh );
+   fskit_file_handle_io_end( fh );
 
    return num_written;
 }
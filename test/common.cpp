@@ -244,3 +244,12 @@ int fskit_test_mkdir_LR_recursive( struct fskit_core* core, char const* path, in
 
    return 0;
 }
+
+// exit the test if a call did not return what was expected
+void check_rc( char const* what, int rc, int expected ) {
+
+   if( rc != expected ) {
+      fskit_error("%s rc = %d, expected %d\n", what, rc, expected );
+      exit(1);
+   }
+}
@@ -33,4 +33,6 @@ int fskit_test_end( struct fskit_core* core, void** test_data );
 
 int fskit_test_mkdir_LR_recursive( struct fskit_core* core, char const* path, int depth );
 
+void check_rc( char const* what, int rc, int expected );
+
 #endif
@@ -0,0 +1,318 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+
+
+#include "test-aggregate.h"
+
+#define NUM_WRITERS 4
+#define NUM_WRITES 200
+#define NUM_MOVES 200
+
+static struct fskit_core* g_core = NULL;
+
+int write_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+   return buflen;
+}
+
+int trunc_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, off_t new_size, void* handle_data ) {
+   return 0;
+}
+
+// count a subtree the slow way
+int recount_visitor( struct fskit_core* core, struct fskit_walk_entry const* went, void* cls ) {
+
+   struct fskit_aggregate* aggr = (struct fskit_aggregate*)cls;
+
+   if( S_ISDIR( went->sb.st_mode ) ) {
+      aggr->dirs++;
+   }
+   else {
+      aggr->files++;
+      aggr->bytes += went->sb.st_size;
+   }
+
+   return FSKIT_WALK_CONTINUE;
+}
+
+// the totals of path must be the ones a full walk of it finds
+void check_totals( char const* path ) {
+
+   struct fskit_aggregate aggr;
+   struct fskit_aggregate expected;
+
+   memset( &expected, 0, sizeof(expected) );
+
+   check_rc( "fskit_stat_aggregate", fskit_stat_aggregate( g_core, path, 0, 0, &aggr ), 0 );
+   check_rc( "fskit_walk", fskit_walk( g_core, path, 0, 0, 1, recount_visitor, &expected ), 0 );
+
+   if( aggr.bytes != expected.bytes || aggr.files != expected.files || aggr.dirs != expected.dirs ) {
+
+      fskit_error("'%s': %" PRIu64 " bytes, %" PRIu64 " files, %" PRIu64 " dirs; expected %" PRIu64 ", %" PRIu64 ", %" PRIu64 "\n",
+                  path, aggr.bytes, aggr.files, aggr.dirs, expected.bytes, expected.files, expected.dirs );
+      exit(1);
+   }
+}
+
+void check_aggregate( char const* path, uint64_t bytes, uint64_t files, uint64_t dirs ) {
+
+   struct fskit_aggregate aggr;
+
+   check_rc( "fskit_stat_aggregate", fskit_stat_aggregate( g_core, path, 0, 0, &aggr ), 0 );
+
+   if( aggr.bytes != bytes || aggr.files != files || aggr.dirs != dirs ) {
+
+      fskit_error("'%s': %" PRIu64 " bytes, %" PRIu64 " files, %" PRIu64 " dirs; expected %" PRIu64 ", %" PRIu64 ", %" PRIu64 "\n",
+                  path, aggr.bytes, aggr.files, aggr.dirs, bytes, files, dirs );
+      exit(1);
+   }
+}
+
+// write a file with the given number of bytes
+void make_file( char const* path, size_t size ) {
+
+   int rc = 0;
+   char buf[256];
+
+   struct fskit_file_handle* fh = fskit_create( g_core, path, 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   memset( buf, 'a', sizeof(buf) );
+   if( size > 0 ) {
+      check_rc( "fskit_write", fskit_write( g_core, fh, buf, size, 0 ), (int)size );
+   }
+
+   fskit_close( g_core, fh );
+}
+
+// grow a file one byte at a time
+void* writer_main( void* arg ) {
+
+   struct fskit_file_handle* fh = (struct fskit_file_handle*)arg;
+
+   for( int i = 0; i < NUM_WRITES; i++ ) {
+      check_rc( "fskit_write", fskit_write( g_core, fh, "a", 1, i ), 1 );
+   }
+
+   return NULL;
+}
+
+// grow and shrink a file that other threads are resizing too
+void* resizer_main( void* arg ) {
+
+   struct fskit_file_handle* fh = (struct fskit_file_handle*)arg;
+
+   for( int i = 0; i < NUM_WRITES; i++ ) {
+
+      check_rc( "fskit_write", fskit_write( g_core, fh, "a", 1, i ), 1 );
+
+      if( i % 3 == 0 ) {
+         check_rc( "fskit_ftrunc", fskit_ftrunc( g_core, fh, i / 2 ), 0 );
+      }
+   }
+
+   return NULL;
+}
+
+// move the writers' directory back and forth between /x and /y
+void* mover_main( void* arg ) {
+
+   for( int i = 0; i < NUM_MOVES; i++ ) {
+
+      check_rc( "fskit_rename", fskit_rename( g_core, "/x/m", "/y/m", 0, 0 ), 0 );
+      check_rc( "fskit_rename", fskit_rename( g_core, "/y/m", "/x/m", 0, 0 ), 0 );
+   }
+
+   return NULL;
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_aggregate aggr;
+   struct fskit_file_handle* fh = NULL;
+   struct fskit_file_handle* writer_fhs[NUM_WRITERS];
+   pthread_t writers[NUM_WRITERS];
+   pthread_t mover;
+   char path[PATH_MAX];
+   int rc = 0;
+
+   rc = fskit_test_begin( &g_core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   if( fskit_route_write( g_core, "/.*", write_cb, FSKIT_CONCURRENT ) < 0 || fskit_route_trunc( g_core, "/.*", trunc_cb, FSKIT_CONCURRENT ) < 0 ) {
+      fskit_error("%s", "failed to install routes\n" );
+      exit(1);
+   }
+
+   // off until turned on, which has to happen before anything is made
+   check_rc( "fskit_stat_aggregate", fskit_stat_aggregate( g_core, "/", 0, 0, &aggr ), -ENOTSUP );
+   check_rc( "fskit_core_enable_aggregates", fskit_core_enable_aggregates( g_core ), 0 );
+   check_rc( "fskit_core_enable_aggregates", fskit_core_enable_aggregates( g_core ), 0 );
+   check_aggregate( "/", 0, 0, 1 );
+
+   // /t/a/f0..f9, /t/b/c/g0..g3
+   check_rc( "fskit_mkdir_p", fskit_mkdir_p( g_core, "/t/a", 0755, 0, 0 ), 0 );
+   check_rc( "fskit_mkdir_p", fskit_mkdir_p( g_core, "/t/b/c", 0755, 0, 0 ), 0 );
+
+   for( int i = 0; i < 10; i++ ) {
+      snprintf( path, PATH_MAX, "/t/a/f%d", i );
+      make_file( path, i + 1 );
+   }
+
+   for( int i = 0; i < 4; i++ ) {
+      snprintf( path, PATH_MAX, "/t/b/c/g%d", i );
+      make_file( path, 100 );
+   }
+
+   check_aggregate( "/t/a", 55, 10, 1 );
+   check_aggregate( "/t/b", 400, 4, 2 );
+   check_aggregate( "/", 455, 14, 5 );
+   check_aggregate( "/t/a/f4", 5, 1, 0 );
+   check_totals( "/" );
+
+   // resizes
+   check_rc( "fskit_trunc", fskit_trunc( g_core, "/t/a/f0", 0, 0, 1000 ), 0 );
+   check_rc( "fskit_trunc", fskit_trunc( g_core, "/t/b/c/g0", 0, 0, 0 ), 0 );
+   check_aggregate( "/t/a", 1054, 10, 1 );
+   check_aggregate( "/", 1354, 14, 5 );
+
+   // a directory moved into another one takes its totals along
+   check_rc( "fskit_rename", fskit_rename( g_core, "/t/a", "/t/b/c/a", 0, 0 ), 0 );
+   check_aggregate( "/t/b/c", 1354, 14, 2 );
+   check_aggregate( "/t", 1354, 14, 4 );
+
+   // renaming within a directory changes nothing; renaming over a file drops it
+   check_rc( "fskit_rename", fskit_rename( g_core, "/t/b/c/g1", "/t/b/c/h1", 0, 0 ), 0 );
+   check_aggregate( "/t/b/c", 1354, 14, 2 );
+   check_rc( "fskit_rename", fskit_rename( g_core, "/t/b/c/h1", "/t/b/c/g2", 0, 0 ), 0 );
+   check_aggregate( "/t/b/c", 1254, 13, 2 );
+
+   // ...and so does moving a file over one in another directory
+   check_rc( "fskit_rename", fskit_rename( g_core, "/t/b/c/g3", "/t/b/c/a/f9", 0, 0 ), 0 );
+   check_aggregate( "/t/b/c/a", 1144, 10, 1 );
+   check_aggregate( "/", 1244, 12, 5 );
+   check_totals( "/" );
+
+   // a hard link counts once (a walk meets it twice)
+   check_rc( "fskit_link", fskit_link( g_core, "/t/b/c/a/f8", "/t/f8", 0, 0 ), 0 );
+   check_aggregate( "/", 1244, 12, 5 );
+   check_rc( "fskit_unlink", fskit_unlink( g_core, "/t/f8", 0, 0 ), 0 );
+   check_aggregate( "/", 1244, 12, 5 );
+
+   // ...in whichever directory still links to it
+   check_rc( "fskit_stat_aggregate", fskit_stat_aggregate( g_core, "/t/b/c/a/f8", 0, 0, &aggr ), 0 );
+   check_rc( "fskit_link", fskit_link( g_core, "/t/b/c/a/f8", "/t/f8", 0, 0 ), 0 );
+   check_rc( "fskit_unlink", fskit_unlink( g_core, "/t/b/c/a/f8", 0, 0 ), 0 );
+   check_aggregate( "/t/b/c/a", 1144 - aggr.bytes, 9, 1 );
+   check_aggregate( "/t", 1244, 12, 4 );
+   check_totals( "/" );
+   check_rc( "fskit_rename", fskit_rename( g_core, "/t/f8", "/t/b/c/a/f8", 0, 0 ), 0 );
+   check_aggregate( "/t/b/c/a", 1144, 10, 1 );
+
+   // symlinks count their targets' lengths
+   check_rc( "fskit_symlink", fskit_symlink( g_core, "/t/b/c/a/f8", "/t/l", 0, 0 ), 0 );
+   check_aggregate( "/", 1244 + strlen( "/t/b/c/a/f8" ), 13, 5 );
+   check_totals( "/" );
+   check_rc( "fskit_unlink", fskit_unlink( g_core, "/t/l", 0, 0 ), 0 );
+
+   // unlinked files drop out, even if still open and written to
+   fh = fskit_open( g_core, "/t/b/c/a/f7", 0, 0, O_WRONLY, 0, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_open rc = %d\n", rc );
+      exit(1);
+   }
+
+   check_rc( "fskit_unlink", fskit_unlink( g_core, "/t/b/c/a/f7", 0, 0 ), 0 );
+   check_rc( "fskit_write", fskit_write( g_core, fh, "abc", 3, 100 ), 3 );
+   fskit_close( g_core, fh );
+
+   check_aggregate( "/", 1236, 11, 5 );
+   check_totals( "/" );
+
+   check_rc( "fskit_mkdir", fskit_mkdir( g_core, "/t/e", 0755, 0, 0 ), 0 );
+   check_aggregate( "/", 1236, 11, 6 );
+   check_rc( "fskit_rmdir", fskit_rmdir( g_core, "/t/e", 0, 0 ), 0 );
+   check_aggregate( "/", 1236, 11, 5 );
+
+   // writes race with moves of the directory they're in
+   check_rc( "fskit_mkdir_p", fskit_mkdir_p( g_core, "/x/m", 0755, 0, 0 ), 0 );
+   check_rc( "fskit_mkdir", fskit_mkdir( g_core, "/y", 0755, 0, 0 ), 0 );
+
+   for( int i = 0; i < NUM_WRITERS; i++ ) {
+      snprintf( path, PATH_MAX, "/x/m/w%d", i );
+      make_file( path, 0 );
+
+      writer_fhs[i] = fskit_open( g_core, path, 0, 0, O_WRONLY, 0, &rc );
+      if( writer_fhs[i] == NULL ) {
+         fskit_error("fskit_open('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+   }
+
+   pthread_create( &mover, NULL, mover_main, NULL );
+   for( int i = 0; i < NUM_WRITERS; i++ ) {
+      pthread_create( &writers[i], NULL, writer_main, writer_fhs[i] );
+   }
+
+   for( int i = 0; i < NUM_WRITERS; i++ ) {
+      pthread_join( writers[i], NULL );
+      fskit_close( g_core, writer_fhs[i] );
+   }
+   pthread_join( mover, NULL );
+
+   check_aggregate( "/x", NUM_WRITERS * NUM_WRITES, NUM_WRITERS, 2 );
+   check_aggregate( "/y", 0, 0, 1 );
+   check_aggregate( "/", 1236 + NUM_WRITERS * NUM_WRITES, 11 + NUM_WRITERS, 8 );
+   check_totals( "/" );
+
+   // resizes of one file from several threads at once each carry exactly their own change
+   make_file( "/y/r", 0 );
+
+   fh = fskit_open( g_core, "/y/r", 0, 0, O_WRONLY, 0, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_open('/y/r') rc = %d\n", rc );
+      exit(1);
+   }
+
+   for( int i = 0; i < NUM_WRITERS; i++ ) {
+      pthread_create( &writers[i], NULL, resizer_main, fh );
+   }
+
+   for( int i = 0; i < NUM_WRITERS; i++ ) {
+      pthread_join( writers[i], NULL );
+   }
+
+   fskit_close( g_core, fh );
+   check_totals( "/y" );
+   check_totals( "/" );
+
+   rc = fskit_test_end( g_core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   return 0;
+}
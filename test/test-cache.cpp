@@ -0,0 +1,245 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-cache.h"
+
+static int num_stat_calls = 0;
+static int num_getxattr_calls = 0;
+
+int stat_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, struct stat* sb ) {
+
+   num_stat_calls++;
+   sb->st_blksize = 4096 + num_stat_calls;
+   return 0;
+}
+
+int getxattr_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char const* xattr_name, char* xattr_buf, size_t xattr_buf_len ) {
+
+   num_getxattr_calls++;
+
+   if( xattr_buf == NULL || xattr_buf_len == 0 ) {
+      return 4;
+   }
+
+   if( xattr_buf_len < 4 ) {
+      return -ERANGE;
+   }
+
+   memcpy( xattr_buf, "bar", 4 );
+   return 4;
+}
+
+// stat a path, and check how many times the stat route has been called 
+void test_stat( struct fskit_core* core, char const* path, int expected_calls ) {
+
+   struct stat sb;
+   int rc = fskit_stat( core, path, 0, 0, &sb );
+   if( rc != 0 ) {
+      fskit_error("fskit_stat('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   if( num_stat_calls != expected_calls || sb.st_blksize != 4096 + num_stat_calls ) {
+      fskit_error("stat('%s'): %d calls (expected %d), blksize = %d\n", path, num_stat_calls, expected_calls, (int)sb.st_blksize );
+      exit(1);
+   }
+}
+
+// stat a path, and check its link count as well
+void test_stat_nlink( struct fskit_core* core, char const* path, int expected_calls, nlink_t expected_nlink ) {
+
+   struct stat sb;
+
+   test_stat( core, path, expected_calls );
+
+   check_rc( "fskit_stat", fskit_stat( core, path, 0, 0, &sb ), 0 );
+   if( sb.st_nlink != expected_nlink ) {
+      fskit_error("stat('%s'): nlink = %d, expected %d\n", path, (int)sb.st_nlink, (int)expected_nlink );
+      exit(1);
+   }
+}
+
+// get an xattr, and check how many times the getxattr route has been called 
+void test_getxattr( struct fskit_core* core, char const* path, int expected_calls ) {
+
+   char buf[10];
+   memset( buf, 0, 10 );
+
+   int rc = fskit_getxattr( core, path, 0, 0, "foo", buf, 10 );
+   if( rc != 4 || strcmp( buf, "bar" ) != 0 ) {
+      fskit_error("fskit_getxattr('%s') rc = %d, buf = '%s'\n", path, rc, buf );
+      exit(1);
+   }
+
+   if( num_getxattr_calls != expected_calls ) {
+      fskit_error("getxattr('%s'): %d calls (expected %d)\n", path, num_getxattr_calls, expected_calls );
+      exit(1);
+   }
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   struct fskit_entry* fent = NULL;
+   struct fskit_route_opts opts;
+   int rc = 0;
+   char buf[10];
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   fskit_route_opts_init( &opts );
+   opts.cache_ttl_ms = 60000;
+
+   rc = fskit_route_stat_ex( core, "/test-file", stat_cb, FSKIT_CONCURRENT, &opts );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_stat_ex rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_route_getxattr_ex( core, "/test-file", getxattr_cb, FSKIT_CONCURRENT, &opts );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_getxattr_ex rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_route_stat_ex( core, "^/test-dir$", stat_cb, FSKIT_CONCURRENT, &opts );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_stat_ex rc = %d\n", rc );
+      exit(1);
+   }
+
+   // short-lived cache 
+   opts.cache_ttl_ms = 50;
+   rc = fskit_route_stat_ex( core, "/test-file-short", stat_cb, FSKIT_CONCURRENT, &opts );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_stat_ex rc = %d\n", rc );
+      exit(1);
+   }
+
+   check_rc( "fskit_mkdir", fskit_mkdir( core, "/test-dir", 0755, 0, 0 ), 0 );
+
+   fh = fskit_create( core, "/test-file", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create rc = %d\n", rc );
+      exit(1);
+   }
+
+   // stats are cached
+   test_stat( core, "/test-file", 1 );
+   test_stat( core, "/test-file", 1 );
+
+   // fskit's own mutations invalidate
+   rc = fskit_chmod( core, "/test-file", 0, 0, 0600 );
+   if( rc != 0 ) {
+      fskit_error("fskit_chmod rc = %d\n", rc );
+      exit(1);
+   }
+
+   test_stat( core, "/test-file", 2 );
+   test_stat( core, "/test-file", 2 );
+
+   memset( buf, 0, 10 );
+   rc = fskit_write( core, fh, buf, 10, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_write rc = %d\n", rc );
+      exit(1);
+   }
+
+   test_stat( core, "/test-file", 3 );
+
+   // explicit invalidation
+   fent = fskit_entry_ref( core, "/test-file", &rc );
+   if( fent == NULL ) {
+      fskit_error("fskit_entry_ref rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_entry_invalidate( core, fent );
+   fskit_entry_unref( core, "/test-file", fent );
+
+   test_stat( core, "/test-file", 4 );
+   test_stat( core, "/test-file", 4 );
+
+   // xattrs are cached, per name
+   test_getxattr( core, "/test-file", 1 );
+   test_getxattr( core, "/test-file", 1 );
+
+   rc = fskit_setxattr( core, "/test-file", 0, 0, "baz", "goo", 4, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_setxattr rc = %d\n", rc );
+      exit(1);
+   }
+
+   test_getxattr( core, "/test-file", 2 );
+   test_stat( core, "/test-file", 5 );
+
+   rc = fskit_close( core, fh );
+   if( rc != 0 ) {
+      fskit_error("fskit_close rc = %d\n", rc );
+      exit(1);
+   }
+
+   // results expire
+   rc = fskit_mknod( core, "/test-file-short", S_IFREG | 0644, 0, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mknod rc = %d\n", rc );
+      exit(1);
+   }
+
+   test_stat( core, "/test-file-short", 6 );
+   test_stat( core, "/test-file-short", 6 );
+
+   usleep( 100000 );
+
+   test_stat( core, "/test-file-short", 7 );
+
+   // linking and unlinking change what stat reports for the file and for its directory
+   check_rc( "fskit_link", fskit_link( core, "/test-file", "/test-dir/test-file", 0, 0 ), 0 );
+   test_stat_nlink( core, "/test-file", 8, 2 );
+
+   check_rc( "fskit_unlink", fskit_unlink( core, "/test-dir/test-file", 0, 0 ), 0 );
+   test_stat_nlink( core, "/test-file", 9, 1 );
+
+   test_stat( core, "/test-dir", 10 );
+   test_stat( core, "/test-dir", 10 );
+
+   check_rc( "fskit_mkdir", fskit_mkdir( core, "/test-dir/sub", 0755, 0, 0 ), 0 );
+   test_stat( core, "/test-dir", 11 );
+
+   check_rc( "fskit_rename", fskit_rename( core, "/test-dir/sub", "/test-dir/sub2", 0, 0 ), 0 );
+   test_stat( core, "/test-dir", 12 );
+
+   check_rc( "fskit_rmdir", fskit_rmdir( core, "/test-dir/sub2", 0, 0 ), 0 );
+   test_stat( core, "/test-dir", 13 );
+
+   fskit_print_tree( stdout, fskit_core_get_root( core ) );
+
+   rc = fskit_test_end( core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   return 0;
+}
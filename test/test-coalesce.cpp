@@ -0,0 +1,247 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-coalesce.h"
+
+#define TEST_NUM_THREADS 16
+
+static int num_stat_calls = 0;
+static int num_read_calls = 0;
+static int num_opens = 0;
+
+struct test_thread_args {
+   struct fskit_core* core;
+   struct fskit_file_handle* fh;
+   struct stat sb;
+   char buf[16];
+   int rc;
+};
+
+// slow stat callback
+int stat_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, struct stat* sb ) {
+
+   __atomic_add_fetch( &num_stat_calls, 1, __ATOMIC_SEQ_CST );
+   usleep( 50000 );
+
+   sb->st_size = 12345;
+   return 0;
+}
+
+// each open gets its own backend state: the letter its reads are shifted by
+int open_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, int flags, void** handle_data ) {
+
+   *handle_data = (void*)(uintptr_t)__atomic_fetch_add( &num_opens, 1, __ATOMIC_SEQ_CST );
+   return 0;
+}
+
+// slow read callback
+int read_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   __atomic_add_fetch( &num_read_calls, 1, __ATOMIC_SEQ_CST );
+   usleep( 50000 );
+
+   memset( buf, 'a' + ((offset + (uintptr_t)handle_data) % 26), buflen );
+   return buflen;
+}
+
+void* stat_thread( void* arg ) {
+
+   struct test_thread_args* args = (struct test_thread_args*)arg;
+
+   args->rc = fskit_stat( args->core, "/test-file", 0, 0, &args->sb );
+   return NULL;
+}
+
+void* read_thread( void* arg ) {
+
+   struct test_thread_args* args = (struct test_thread_args*)arg;
+
+   args->rc = fskit_read( args->core, args->fh, args->buf, 16, 1 );
+   return NULL;
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   struct fskit_file_handle* fh2 = NULL;
+   struct fskit_route_opts opts;
+   struct fskit_route_stats stats;
+   pthread_t threads[TEST_NUM_THREADS];
+   struct test_thread_args args[TEST_NUM_THREADS];
+   int stat_rh = 0;
+   int read_rh = 0;
+   int rc = 0;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   fskit_route_opts_init( &opts );
+   opts.coalesce = true;
+
+   stat_rh = fskit_route_stat_ex( core, "/test-file", stat_cb, FSKIT_CONCURRENT, &opts );
+   if( stat_rh < 0 ) {
+      fskit_error("fskit_route_stat_ex rc = %d\n", stat_rh );
+      exit(1);
+   }
+
+   read_rh = fskit_route_read_ex( core, "/test-file", read_cb, FSKIT_CONCURRENT, &opts );
+   if( read_rh < 0 ) {
+      fskit_error("fskit_route_read_ex rc = %d\n", read_rh );
+      exit(1);
+   }
+
+   if( fskit_route_open( core, "/test-file", open_cb, FSKIT_CONCURRENT ) < 0 ) {
+      fskit_error("%s", "fskit_route_open failed\n" );
+      exit(1);
+   }
+
+   fh = fskit_create( core, "/test-file", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_close( core, fh );
+   if( rc != 0 ) {
+      fskit_error("fskit_close rc = %d\n", rc );
+      exit(1);
+   }
+
+   fh = fskit_open( core, "/test-file", 0, 0, O_RDONLY, 0, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_open rc = %d\n", rc );
+      exit(1);
+   }
+
+   // burst of identical stats
+   for( int i = 0; i < TEST_NUM_THREADS; i++ ) {
+
+      memset( &args[i], 0, sizeof(struct test_thread_args) );
+      args[i].core = core;
+      args[i].fh = fh;
+      pthread_create( &threads[i], NULL, stat_thread, &args[i] );
+   }
+
+   for( int i = 0; i < TEST_NUM_THREADS; i++ ) {
+
+      pthread_join( threads[i], NULL );
+      if( args[i].rc != 0 || args[i].sb.st_size != 12345 ) {
+         fskit_error("fskit_stat rc = %d, size = %jd\n", args[i].rc, (intmax_t)args[i].sb.st_size );
+         exit(1);
+      }
+   }
+
+   fskit_route_get_stats( core, FSKIT_ROUTE_MATCH_STAT, stat_rh, &stats );
+   printf("stat: callbacks=%d coalesced=%" PRIu64 "\n", num_stat_calls, stats.num_coalesced );
+
+   if( num_stat_calls >= TEST_NUM_THREADS || num_stat_calls + stats.num_coalesced != TEST_NUM_THREADS ) {
+      fskit_error("%s", "stat calls were not coalesced\n");
+      exit(1);
+   }
+
+   // burst of identical reads
+   for( int i = 0; i < TEST_NUM_THREADS; i++ ) {
+
+      memset( &args[i], 0, sizeof(struct test_thread_args) );
+      args[i].core = core;
+      args[i].fh = fh;
+      pthread_create( &threads[i], NULL, read_thread, &args[i] );
+   }
+
+   for( int i = 0; i < TEST_NUM_THREADS; i++ ) {
+
+      pthread_join( threads[i], NULL );
+      if( args[i].rc != 16 ) {
+         fskit_error("fskit_read rc = %d\n", args[i].rc );
+         exit(1);
+      }
+
+      for( int j = 0; j < 16; j++ ) {
+         if( args[i].buf[j] != 'b' ) {
+            fskit_error("bad read result in thread %d: '%c'\n", i, args[i].buf[j] );
+            exit(1);
+         }
+      }
+   }
+
+   fskit_route_get_stats( core, FSKIT_ROUTE_MATCH_READ, read_rh, &stats );
+   printf("read: callbacks=%d coalesced=%" PRIu64 "\n", num_read_calls, stats.num_coalesced );
+
+   if( num_read_calls >= TEST_NUM_THREADS || num_read_calls + stats.num_coalesced != TEST_NUM_THREADS ) {
+      fskit_error("%s", "read calls were not coalesced\n");
+      exit(1);
+   }
+
+   // reads through handles with different backend state are not the same read
+   fh2 = fskit_open( core, "/test-file", 0, 0, O_RDONLY, 0, &rc );
+   if( fh2 == NULL ) {
+      fskit_error("fskit_open rc = %d\n", rc );
+      exit(1);
+   }
+
+   for( int i = 0; i < TEST_NUM_THREADS; i++ ) {
+
+      memset( &args[i], 0, sizeof(struct test_thread_args) );
+      args[i].core = core;
+      args[i].fh = (i % 2 == 0 ? fh : fh2);
+      pthread_create( &threads[i], NULL, read_thread, &args[i] );
+   }
+
+   for( int i = 0; i < TEST_NUM_THREADS; i++ ) {
+
+      pthread_join( threads[i], NULL );
+      if( args[i].rc != 16 ) {
+         fskit_error("fskit_read rc = %d\n", args[i].rc );
+         exit(1);
+      }
+
+      for( int j = 0; j < 16; j++ ) {
+         if( args[i].buf[j] != (i % 2 == 0 ? 'b' : 'c') ) {
+            fskit_error("thread %d read '%c' through another handle's state\n", i, args[i].buf[j] );
+            exit(1);
+         }
+      }
+   }
+
+   rc = fskit_close( core, fh2 );
+   if( rc != 0 ) {
+      fskit_error("fskit_close rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_close( core, fh );
+   if( rc != 0 ) {
+      fskit_error("fskit_close rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_print_tree( stdout, fskit_core_get_root( core ) );
+
+   rc = fskit_test_end( core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   return 0;
+}
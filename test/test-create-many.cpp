@@ -0,0 +1,269 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+
+#include "test-create-many.h"
+
+static int num_create_calls = 0;
+static int num_mkdir_calls = 0;
+static int num_batch_calls = 0;
+static int num_batch_children = 0;
+
+int create_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, mode_t mode, void** inode_data, void** handle_data ) {
+   __atomic_add_fetch( &num_create_calls, 1, __ATOMIC_SEQ_CST );
+   return 0;
+}
+
+int mkdir_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* dent, mode_t mode, void** inode_data ) {
+   __atomic_add_fetch( &num_mkdir_calls, 1, __ATOMIC_SEQ_CST );
+   return 0;
+}
+
+// vectored route: tag each child with its position in the batch
+int create_many_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* parent, char const** names, struct fskit_entry** fents, size_t num_fents, void** inode_data ) {
+
+   num_batch_calls++;
+   num_batch_children += num_fents;
+
+   for( size_t i = 0; i < num_fents; i++ ) {
+
+      if( fskit_entry_get_file_id( fents[i] ) == 0 ) {
+         fskit_error("'%s' has no inode number\n", names[i] );
+         exit(1);
+      }
+
+      inode_data[i] = (void*)(uintptr_t)(i + 1);
+   }
+
+   return 0;
+}
+
+int fail_many_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* parent, char const** names, struct fskit_entry** fents, size_t num_fents, void** inode_data ) {
+   return -EIO;
+}
+
+// look up path, and check its type.  return its inode data.
+void* check_exists( struct fskit_core* core, char const* path, int type ) {
+
+   int rc = 0;
+   struct fskit_entry* fent = fskit_entry_resolve_path( core, path, 0, 0, false, &rc );
+   if( fent == NULL ) {
+      fskit_error("fskit_entry_resolve_path('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   if( fskit_entry_get_type( fent ) != type ) {
+      fskit_error("'%s' has type %d, expected %d\n", path, fskit_entry_get_type( fent ), type );
+      exit(1);
+   }
+
+   void* app_data = fskit_entry_get_user_data( fent );
+   fskit_entry_unlock( fent );
+
+   return app_data;
+}
+
+void check_absent( struct fskit_core* core, char const* path ) {
+
+   int rc = 0;
+   struct fskit_entry* fent = fskit_entry_resolve_path( core, path, 0, 0, false, &rc );
+   if( fent != NULL || rc != -ENOENT ) {
+      fskit_error("fskit_entry_resolve_path('%s') rc = %d, expected %d\n", path, rc, -ENOENT );
+      exit(1);
+   }
+}
+
+void check_rcs( int const* rcs, int const* expected, size_t n ) {
+
+   for( size_t i = 0; i < n; i++ ) {
+      if( rcs[i] != expected[i] ) {
+         fskit_error("rcs[%zu] = %d, expected %d\n", i, rcs[i], expected[i] );
+         exit(1);
+      }
+   }
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   char long_name[FSKIT_FILESYSTEM_NAMEMAX + 2];
+   int rcs[8];
+   int rc = 0;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   memset( long_name, 'x', FSKIT_FILESYSTEM_NAMEMAX + 1 );
+   long_name[ FSKIT_FILESYSTEM_NAMEMAX + 1 ] = '\0';
+
+   if( fskit_route_create( core, "^/test-dir/[^/]+$", create_cb, FSKIT_CONCURRENT ) < 0 ||
+       fskit_route_create( core, "^/vec-dir/[^/]+$", create_cb, FSKIT_CONCURRENT ) < 0 ||
+       fskit_route_mkdir( core, "^/test-dir/[^/]+$", mkdir_cb, FSKIT_CONCURRENT ) < 0 ||
+       fskit_route_create_many( core, "^/vec-dir$", create_many_cb, FSKIT_SEQUENTIAL ) < 0 ||
+       fskit_route_create_many( core, "^/fail-dir$", fail_many_cb, FSKIT_SEQUENTIAL ) < 0 ) {
+
+      fskit_error("%s", "failed to install routes\n" );
+      exit(1);
+   }
+
+   rc = fskit_mkdir( core, "/test-dir", 0755, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir rc = %d\n", rc );
+      exit(1);
+   }
+
+   fh = fskit_create( core, "/test-dir/existing", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+   num_create_calls = 0;
+
+   // files, with per-file routes.  Bad, taken, and repeated names fail on their own.
+   struct fskit_create_spec files[] = {
+      { "a", 0644 },
+      { "b", 0600 },
+      { "existing", 0644 },
+      { "c", 0644 },
+      { "a", 0644 },
+      { "x/y", 0644 },
+      { long_name, 0644 }
+   };
+   int files_expected[] = { 0, 0, -EEXIST, 0, -EEXIST, -EINVAL, -ENAMETOOLONG };
+
+   rc = fskit_create_many( core, "/test-dir", 0, 0, files, 7, rcs );
+   if( rc != 3 ) {
+      fskit_error("fskit_create_many rc = %d, expected 3\n", rc );
+      exit(1);
+   }
+
+   check_rcs( rcs, files_expected, 7 );
+
+   if( num_create_calls != 3 ) {
+      fskit_error("%d create routes called, expected 3\n", num_create_calls );
+      exit(1);
+   }
+
+   check_exists( core, "/test-dir/a", FSKIT_ENTRY_TYPE_FILE );
+   check_exists( core, "/test-dir/b", FSKIT_ENTRY_TYPE_FILE );
+   check_exists( core, "/test-dir/c", FSKIT_ENTRY_TYPE_FILE );
+
+   // directories, with per-directory routes
+   struct fskit_create_spec dirs[] = {
+      { "d1", 0755 },
+      { "d2", 0700 }
+   };
+
+   rc = fskit_mkdir_many( core, "/test-dir", 0, 0, dirs, 2, NULL );
+   if( rc != 2 || num_mkdir_calls != 2 ) {
+      fskit_error("fskit_mkdir_many rc = %d, %d mkdir routes called\n", rc, num_mkdir_calls );
+      exit(1);
+   }
+
+   check_exists( core, "/test-dir/d1", FSKIT_ENTRY_TYPE_DIR );
+   check_exists( core, "/test-dir/d2", FSKIT_ENTRY_TYPE_DIR );
+
+   fh = fskit_create( core, "/test-dir/d1/inner", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('/test-dir/d1/inner') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   // the vectored route handles a whole batch in one call
+   rc = fskit_mkdir( core, "/vec-dir", 0755, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir rc = %d\n", rc );
+      exit(1);
+   }
+
+   num_create_calls = 0;
+
+   struct fskit_create_spec vec[] = {
+      { "v1", 0644 },
+      { "v2", 0644 },
+      { "v3", 0644 }
+   };
+
+   rc = fskit_create_many( core, "/vec-dir", 0, 0, vec, 3, rcs );
+   if( rc != 3 || num_batch_calls != 1 || num_batch_children != 3 || num_create_calls != 0 ) {
+      fskit_error("fskit_create_many rc = %d, %d batch calls for %d children, %d create calls\n", rc, num_batch_calls, num_batch_children, num_create_calls );
+      exit(1);
+   }
+
+   if( check_exists( core, "/vec-dir/v1", FSKIT_ENTRY_TYPE_FILE ) != (void*)1 ||
+       check_exists( core, "/vec-dir/v3", FSKIT_ENTRY_TYPE_FILE ) != (void*)3 ) {
+      fskit_error("%s", "vectored route's inode data not set\n" );
+      exit(1);
+   }
+
+   // if the vectored route fails, the whole batch is withdrawn
+   rc = fskit_mkdir( core, "/fail-dir", 0755, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir rc = %d\n", rc );
+      exit(1);
+   }
+
+   int fail_expected[] = { -EIO, -EIO, -EIO };
+
+   rc = fskit_mkdir_many( core, "/fail-dir", 0, 0, vec, 3, rcs );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir_many rc = %d, expected 0\n", rc );
+      exit(1);
+   }
+
+   check_rcs( rcs, fail_expected, 3 );
+   check_absent( core, "/fail-dir/v1" );
+
+   rc = fskit_rmdir( core, "/fail-dir", 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_rmdir('/fail-dir') rc = %d\n", rc );
+      exit(1);
+   }
+
+   // the directory itself must be usable
+   rc = fskit_create_many( core, "/test-dir/a", 0, 0, vec, 3, NULL );
+   if( rc != -ENOTDIR ) {
+      fskit_error("fskit_create_many('/test-dir/a') rc = %d, expected %d\n", rc, -ENOTDIR );
+      exit(1);
+   }
+
+   rc = fskit_create_many( core, "/nonexistent", 0, 0, vec, 3, NULL );
+   if( rc != -ENOENT ) {
+      fskit_error("fskit_create_many('/nonexistent') rc = %d, expected %d\n", rc, -ENOENT );
+      exit(1);
+   }
+
+   fskit_print_tree( stdout, fskit_core_get_root( core ) );
+
+   rc = fskit_test_end( core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   return 0;
+}
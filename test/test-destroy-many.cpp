@@ -0,0 +1,197 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-destroy-many.h"
+
+#define NUM_DIRS 30
+#define NUM_FILES 100
+
+static int num_destroy_calls = 0;
+static int num_batch_calls = 0;
+static int num_batch_entries = 0;
+static int num_bad_entries = 0;
+static char last_batch_path[PATH_MAX];
+
+// tag every new inode, so the batch route can check that it gets the inode data
+int create_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, mode_t mode, void** inode_data, void** handle_data ) {
+   *inode_data = (void*)(uintptr_t)fskit_entry_get_file_id( fent );
+   return 0;
+}
+
+int mkdir_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* dent, mode_t mode, void** inode_data ) {
+   *inode_data = (void*)(uintptr_t)fskit_entry_get_file_id( dent );
+   return 0;
+}
+
+int destroy_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, void* inode_data ) {
+   __atomic_add_fetch( &num_destroy_calls, 1, __ATOMIC_SEQ_CST );
+   return 0;
+}
+
+int destroy_many_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, char const** paths, uint64_t const* file_ids, void** inode_data, size_t num_entries ) {
+
+   num_batch_calls++;
+   num_batch_entries += num_entries;
+
+   for( size_t i = 0; i < num_entries; i++ ) {
+
+      if( (uint64_t)(uintptr_t)inode_data[i] != file_ids[i] || file_ids[i] == 0 ) {
+         fskit_error("'%s': inode data %p, file ID %" PRIX64 "\n", paths[i], inode_data[i], file_ids[i] );
+         num_bad_entries++;
+      }
+   }
+
+   snprintf( last_batch_path, PATH_MAX, "%s", paths[ num_entries - 1 ] );
+   return 0;
+}
+
+void check_count( char const* what, int count, int expected ) {
+
+   if( count != expected ) {
+      fskit_error("%s = %d, expected %d\n", what, count, expected );
+      exit(1);
+   }
+}
+
+// make a directory with NUM_DIRS subdirectories of NUM_FILES files each
+void make_tree( struct fskit_core* core, char const* root ) {
+
+   char path[PATH_MAX];
+   int rc = 0;
+
+   rc = fskit_mkdir( core, root, 0755, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir('%s') rc = %d\n", root, rc );
+      exit(1);
+   }
+
+   for( int i = 0; i < NUM_DIRS; i++ ) {
+
+      snprintf( path, PATH_MAX, "%s/d%d", root, i );
+      rc = fskit_mkdir( core, path, 0755, 0, 0 );
+      if( rc != 0 ) {
+         fskit_error("fskit_mkdir('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+
+      for( int j = 0; j < NUM_FILES; j++ ) {
+
+         snprintf( path, PATH_MAX, "%s/d%d/f%d", root, i, j );
+         struct fskit_file_handle* fh = fskit_create( core, path, 0, 0, 0644, &rc );
+         if( fh == NULL ) {
+            fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+            exit(1);
+         }
+
+         fskit_close( core, fh );
+      }
+   }
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   int num_entries = NUM_DIRS + NUM_DIRS * NUM_FILES;
+   int rc = 0;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   if( fskit_route_create( core, FSKIT_ROUTE_ANY, create_cb, FSKIT_CONCURRENT ) < 0 ||
+       fskit_route_mkdir( core, FSKIT_ROUTE_ANY, mkdir_cb, FSKIT_CONCURRENT ) < 0 ||
+       fskit_route_destroy( core, "^/(tenant|other)/.*$", destroy_cb, FSKIT_CONCURRENT ) < 0 ||
+       fskit_route_destroy_many( core, "^/tenant$", destroy_many_cb, FSKIT_SEQUENTIAL ) < 0 ||
+       fskit_route_destroy_many( core, "^/solo$", destroy_many_cb, FSKIT_SEQUENTIAL ) < 0 ) {
+
+      fskit_error("%s", "failed to install routes\n" );
+      exit(1);
+   }
+
+   make_tree( core, "/tenant" );
+   make_tree( core, "/other" );
+
+   // keep one file open through the teardown
+   fh = fskit_open( core, "/tenant/d0/f0", 0, 0, O_RDONLY, 0, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_open rc = %d\n", rc );
+      exit(1);
+   }
+
+   // the batch route replaces the per-entry route, and gets everything in a few large batches
+   rc = fskit_detach_all( core, "/tenant" );
+   check_count( "fskit_detach_all('/tenant') rc", rc, 0 );
+
+   check_count( "destroy routes", num_destroy_calls, 0 );
+   check_count( "batched entries", num_batch_entries, num_entries - 1 );
+   check_count( "batch routes", num_batch_calls, (num_entries - 1 + 1023) / 1024 );
+   check_count( "bad entries", num_bad_entries, 0 );
+
+   // the open file outlives the teardown, and is destroyed by its own route when closed
+   rc = fskit_close( core, fh );
+   check_count( "fskit_close rc", rc, 0 );
+   check_count( "destroy routes", num_destroy_calls, 1 );
+
+   // without a batch route for the directory, each entry's route runs
+   num_batch_calls = 0;
+   num_destroy_calls = 0;
+
+   rc = fskit_detach_all( core, "/other" );
+   check_count( "fskit_detach_all('/other') rc", rc, 0 );
+   check_count( "destroy routes", num_destroy_calls, num_entries );
+   check_count( "batch routes", num_batch_calls, 0 );
+
+   // a single unlink without a per-entry route goes to its directory's batch route
+   rc = fskit_mkdir( core, "/solo", 0755, 0, 0 );
+   check_count( "fskit_mkdir('/solo') rc", rc, 0 );
+
+   fh = fskit_create( core, "/solo/file", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('/solo/file') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   num_batch_entries = 0;
+
+   rc = fskit_unlink( core, "/solo/file", 0, 0 );
+   check_count( "fskit_unlink('/solo/file') rc", rc, 0 );
+   check_count( "batch routes", num_batch_calls, 1 );
+   check_count( "batched entries", num_batch_entries, 1 );
+   check_count( "bad entries", num_bad_entries, 0 );
+
+   if( strcmp( last_batch_path, "/solo/file" ) != 0 ) {
+      fskit_error("batch route got '%s', expected '/solo/file'\n", last_batch_path );
+      exit(1);
+   }
+
+   fskit_print_tree( stdout, fskit_core_get_root( core ) );
+
+   rc = fskit_test_end( core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   return 0;
+}
@@ -0,0 +1,348 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+
+#include "test-entry-path.h"
+
+#define NUM_READERS 4
+#define NUM_RENAMES 2000
+#define NUM_CHURNERS 4
+
+static char destroyed_path[PATH_MAX];
+
+struct path_reader_args {
+   struct fskit_core* core;
+   struct fskit_entry* fent;
+   bool* done;
+   int id;
+   int rc;
+};
+
+int read_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+   strncpy( buf, fskit_route_metadata_get_path( route_metadata ), buflen );
+   return (int)buflen;
+}
+
+int destroy_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, void* inode_data ) {
+   strncpy( destroyed_path, fskit_route_metadata_get_path( route_metadata ), PATH_MAX - 1 );
+   return 0;
+}
+
+void check_path( struct fskit_entry* fent, char const* expected ) {
+
+   int rc = 0;
+   char* path = fskit_entry_get_path( fent, &rc );
+
+   if( path == NULL || strcmp( path, expected ) != 0 ) {
+      fskit_error("fskit_entry_get_path(%" PRIX64 ") = '%s' (rc = %d), expected '%s'\n", fskit_entry_get_file_id( fent ), path, rc, expected );
+      exit(1);
+   }
+
+   free( path );
+}
+
+struct fskit_entry* ref_entry( struct fskit_core* core, char const* path ) {
+
+   int rc = 0;
+   struct fskit_entry* fent = fskit_entry_ref( core, path, &rc );
+
+   if( fent == NULL ) {
+      fskit_error("fskit_entry_ref('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   return fent;
+}
+
+struct fskit_file_handle* create_file( struct fskit_core* core, char const* path ) {
+
+   int rc = 0;
+   struct fskit_file_handle* fh = fskit_create( core, path, 0, 0, 0644, &rc );
+
+   if( fh == NULL ) {
+      fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   return fh;
+}
+
+// build a path over and over while its directory gets renamed back and forth
+void* path_reader_thread( void* arg ) {
+
+   struct path_reader_args* args = (struct path_reader_args*)arg;
+
+   while( !__atomic_load_n( args->done, __ATOMIC_ACQUIRE ) ) {
+
+      char* path = fskit_entry_get_path( args->fent, &args->rc );
+      if( path == NULL ) {
+         break;
+      }
+
+      if( strcmp( path, "/r/d0/f" ) != 0 && strcmp( path, "/r/d1/f" ) != 0 ) {
+
+         fskit_error("Torn path '%s'\n", path );
+         args->rc = -EINVAL;
+         free( path );
+         break;
+      }
+
+      free( path );
+   }
+
+   return NULL;
+}
+
+// create, name, and unlink files in a directory of its own while other threads do the same next door
+void* churn_thread( void* arg ) {
+
+   struct path_reader_args* args = (struct path_reader_args*)arg;
+   char path[PATH_MAX];
+
+   snprintf( path, PATH_MAX, "/r/c%d/f", args->id );
+
+   while( !__atomic_load_n( args->done, __ATOMIC_ACQUIRE ) ) {
+
+      struct fskit_file_handle* fh = fskit_create( args->core, path, 0, 0, 0644, &args->rc );
+      if( fh == NULL ) {
+         break;
+      }
+
+      char* fent_path = fskit_entry_get_path( fskit_file_handle_get_entry( fh ), &args->rc );
+      if( fent_path == NULL || strcmp( fent_path, path ) != 0 ) {
+
+         fskit_error("Path of '%s' is '%s'\n", path, fent_path );
+         args->rc = -EINVAL;
+      }
+
+      free( fent_path );
+      fskit_close( args->core, fh );
+
+      if( args->rc == 0 ) {
+         args->rc = fskit_unlink( args->core, path, 0, 0 );
+      }
+
+      if( args->rc != 0 ) {
+         break;
+      }
+   }
+
+   return NULL;
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   struct fskit_file_handle* fh2 = NULL;
+   struct fskit_dir_handle* dh = NULL;
+   struct fskit_entry* fent = NULL;
+   struct path_reader_args args[NUM_READERS];
+   pthread_t threads[NUM_READERS];
+   struct path_reader_args churn_args[NUM_CHURNERS];
+   pthread_t churn_threads[NUM_CHURNERS];
+   char dir_path[PATH_MAX];
+   bool done = false;
+   int rc = 0;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   if( fskit_route_destroy( core, "^(/x/b/open|/m/c)$", destroy_cb, FSKIT_CONCURRENT ) < 0 ) {
+      fskit_error("%s", "failed to install routes\n" );
+      exit(1);
+   }
+
+   check_rc( "fskit_mkdir_p('/a/b')", fskit_mkdir_p( core, "/a/b", 0755, 0, 0 ), 0 );
+
+   fent = fskit_core_get_root( core );
+   check_path( fent, "/" );
+
+   fh = create_file( core, "/a/b/f" );
+   check_path( fskit_file_handle_get_entry( fh ), "/a/b/f" );
+
+   // handles build their paths on demand, so they see renames made before they are asked
+   dh = fskit_opendir( core, "/a/b", 0, 0, &rc );
+   if( dh == NULL ) {
+      fskit_error("fskit_opendir('/a/b') rc = %d\n", rc );
+      exit(1);
+   }
+
+   check_rc( "fskit_rename('/a/b/f','/a/b/g')", fskit_rename( core, "/a/b/f", "/a/b/g", 0, 0 ), 0 );
+   check_rc( "fskit_rename('/a','/x')", fskit_rename( core, "/a", "/x", 0, 0 ), 0 );
+
+   if( strcmp( fskit_file_handle_get_path( fh ), "/x/b/g" ) != 0 || strcmp( fskit_dir_handle_get_path( dh ), "/x/b" ) != 0 ) {
+      fskit_error("handle paths are '%s' and '%s'\n", fskit_file_handle_get_path( fh ), fskit_dir_handle_get_path( dh ) );
+      exit(1);
+   }
+
+   fskit_closedir( core, dh );
+
+   // moving a directory into another renames everything below it
+   check_rc( "fskit_mkdir('/y')", fskit_mkdir( core, "/y", 0755, 0, 0 ), 0 );
+   check_rc( "fskit_rename('/x/b','/y/c')", fskit_rename( core, "/x/b", "/y/c", 0, 0 ), 0 );
+   check_path( fskit_file_handle_get_entry( fh ), "/y/c/g" );
+
+   fskit_close( core, fh );
+
+   // a hard link does not change the path, and neither does removing it
+   check_rc( "fskit_link('/y/c/g','/y/h')", fskit_link( core, "/y/c/g", "/y/h", 0, 0 ), 0 );
+
+   fent = ref_entry( core, "/y/h" );
+   check_path( fent, "/y/c/g" );
+
+   check_rc( "fskit_unlink('/y/h')", fskit_unlink( core, "/y/h", 0, 0 ), 0 );
+   check_path( fent, "/y/c/g" );
+
+   fskit_entry_unref( core, "/y/c/g", fent );
+
+   // removing the recorded link moves the path over to a surviving one, so the file's routes still run
+   check_rc( "fskit_mkdir('/m')", fskit_mkdir( core, "/m", 0755, 0, 0 ), 0 );
+   fh = create_file( core, "/y/c/k" );
+   fskit_close( core, fh );
+
+   check_rc( "fskit_link('/y/c/k','/m/b')", fskit_link( core, "/y/c/k", "/m/b", 0, 0 ), 0 );
+   check_rc( "fskit_rename('/m/b','/m/c')", fskit_rename( core, "/m/b", "/m/c", 0, 0 ), 0 );
+
+   fh = fskit_open( core, "/m/c", 0, 0, O_RDONLY, 0, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_open('/m/c') rc = %d\n", rc );
+      exit(1);
+   }
+
+   check_rc( "fskit_unlink('/y/c/k')", fskit_unlink( core, "/y/c/k", 0, 0 ), 0 );
+   check_path( fskit_file_handle_get_entry( fh ), "/m/c" );
+
+   // a new route makes the handle look its route up again, by path
+   if( fskit_route_read( core, "^/m/c$", read_cb, FSKIT_CONCURRENT ) < 0 ) {
+      fskit_error("%s", "failed to install routes\n" );
+      exit(1);
+   }
+
+   char buf[PATH_MAX];
+   memset( buf, 0, PATH_MAX );
+
+   check_rc( "fskit_read('/m/c')", (int)fskit_read( core, fh, buf, 5, 0 ), 5 );
+   if( strcmp( buf, "/m/c" ) != 0 ) {
+      fskit_error("read route got '%s'\n", buf );
+      exit(1);
+   }
+
+   check_rc( "fskit_unlink('/m/c')", fskit_unlink( core, "/m/c", 0, 0 ), 0 );
+   fskit_close( core, fh );
+
+   if( strcmp( destroyed_path, "/m/c" ) != 0 ) {
+      fskit_error("destroy route got '%s'\n", destroyed_path );
+      exit(1);
+   }
+
+   // a file unlinked while open keeps the path it had, for the routes that run when it's closed
+   check_rc( "fskit_mkdir_p('/x/b')", fskit_mkdir_p( core, "/x/b", 0755, 0, 0 ), 0 );
+   fh = create_file( core, "/x/b/open" );
+
+   check_rc( "fskit_unlink('/x/b/open')", fskit_unlink( core, "/x/b/open", 0, 0 ), 0 );
+   check_path( fskit_file_handle_get_entry( fh ), "/x/b/open" );
+
+   fskit_close( core, fh );
+
+   if( strcmp( destroyed_path, "/x/b/open" ) != 0 ) {
+      fskit_error("destroy route got '%s'\n", destroyed_path );
+      exit(1);
+   }
+
+   // so does one whose directory gets torn down, or that gets renamed over
+   fh = create_file( core, "/x/b/torn" );
+   fh2 = create_file( core, "/y/c/over" );
+
+   check_rc( "fskit_detach_all('/x')", fskit_detach_all( core, "/x" ), 0 );
+   check_rc( "fskit_rename('/y/c/g','/y/c/over')", fskit_rename( core, "/y/c/g", "/y/c/over", 0, 0 ), 0 );
+
+   check_path( fskit_file_handle_get_entry( fh ), "/x/b/torn" );
+   check_path( fskit_file_handle_get_entry( fh2 ), "/y/c/over" );
+
+   fskit_close( core, fh );
+   fskit_close( core, fh2 );
+
+   // paths never come out torn while directories above them move
+   check_rc( "fskit_mkdir_p('/r/d0')", fskit_mkdir_p( core, "/r/d0", 0755, 0, 0 ), 0 );
+   fh = create_file( core, "/r/d0/f" );
+
+   for( int i = 0; i < NUM_READERS; i++ ) {
+
+      args[i].core = core;
+      args[i].fent = fskit_file_handle_get_entry( fh );
+      args[i].done = &done;
+      args[i].rc = 0;
+
+      pthread_create( &threads[i], NULL, path_reader_thread, &args[i] );
+   }
+
+   // renaming one entry doesn't hold up attaching or detaching others
+   for( int i = 0; i < NUM_CHURNERS; i++ ) {
+
+      snprintf( dir_path, PATH_MAX, "/r/c%d", i );
+      check_rc( "fskit_mkdir", fskit_mkdir( core, dir_path, 0755, 0, 0 ), 0 );
+
+      churn_args[i].core = core;
+      churn_args[i].fent = NULL;
+      churn_args[i].done = &done;
+      churn_args[i].id = i;
+      churn_args[i].rc = 0;
+
+      pthread_create( &churn_threads[i], NULL, churn_thread, &churn_args[i] );
+   }
+
+   for( int i = 0; i < NUM_RENAMES; i++ ) {
+
+      rc = fskit_rename( core, (i % 2 == 0 ? "/r/d0" : "/r/d1"), (i % 2 == 0 ? "/r/d1" : "/r/d0"), 0, 0 );
+      if( rc != 0 ) {
+         fskit_error("fskit_rename rc = %d\n", rc );
+         exit(1);
+      }
+   }
+
+   __atomic_store_n( &done, true, __ATOMIC_RELEASE );
+
+   for( int i = 0; i < NUM_READERS; i++ ) {
+
+      pthread_join( threads[i], NULL );
+      check_rc( "path reader", args[i].rc, 0 );
+   }
+
+   for( int i = 0; i < NUM_CHURNERS; i++ ) {
+
+      pthread_join( churn_threads[i], NULL );
+      check_rc( "churn", churn_args[i].rc, 0 );
+   }
+
+   fskit_close( core, fh );
+
+   fskit_print_tree( stdout, fskit_core_get_root( core ) );
+
+   rc = fskit_test_end( core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   return 0;
+}
@@ -0,0 +1,250 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-executor.h"
+
+#define TEST_NUM_THREADS 16
+
+static int running = 0;
+static int max_running = 0;
+
+struct test_thread_args {
+   struct fskit_core* core;
+   struct fskit_file_handle* fh;
+   int rc;
+};
+
+// slow read callback that tracks how many instances run at once
+int read_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   int now = __atomic_add_fetch( &running, 1, __ATOMIC_SEQ_CST );
+   int prev = __atomic_load_n( &max_running, __ATOMIC_SEQ_CST );
+
+   while( now > prev && !__atomic_compare_exchange_n( &max_running, &prev, now, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ) );
+
+   usleep( 10000 );
+
+   __atomic_sub_fetch( &running, 1, __ATOMIC_SEQ_CST );
+   return buflen;
+}
+
+// slow write callback
+int write_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   usleep( 50000 );
+   return buflen;
+}
+
+void* read_thread( void* arg ) {
+
+   struct test_thread_args* args = (struct test_thread_args*)arg;
+   char buf[10];
+
+   args->rc = fskit_read( args->core, args->fh, buf, 10, 0 );
+   return NULL;
+}
+
+void* write_thread( void* arg ) {
+
+   struct test_thread_args* args = (struct test_thread_args*)arg;
+   char buf[10];
+
+   memset( buf, 0, 10 );
+   args->rc = fskit_write( args->core, args->fh, buf, 10, 0 );
+   return NULL;
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_executor* exec = NULL;
+   struct fskit_file_handle* fh = NULL;
+   struct fskit_route_opts opts;
+   struct fskit_route_stats stats;
+   struct fskit_executor_stats exec_stats;
+   pthread_t threads[TEST_NUM_THREADS];
+   struct test_thread_args args[TEST_NUM_THREADS];
+   int read_rh = 0;
+   int write_rh = 0;
+   int rc = 0;
+   int num_rejected = 0;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   exec = fskit_executor_new();
+   if( exec == NULL ) {
+      exit(1);
+   }
+
+   rc = fskit_executor_init( exec, 4 );
+   if( rc != 0 ) {
+      fskit_error("fskit_executor_init rc = %d\n", rc );
+      exit(1);
+   }
+
+   // reads: at most 2 at once, run on the executor
+   fskit_route_opts_init( &opts );
+   opts.max_concurrency = 2;
+   opts.executor = exec;
+
+   read_rh = fskit_route_read_ex( core, "/test-file", read_cb, FSKIT_CONCURRENT, &opts );
+   if( read_rh < 0 ) {
+      fskit_error("fskit_route_read_ex rc = %d\n", read_rh );
+      exit(1);
+   }
+
+   // writes: one at a time, with room for one waiter
+   fskit_route_opts_init( &opts );
+   opts.max_concurrency = 1;
+   opts.max_queued = 1;
+
+   write_rh = fskit_route_write_ex( core, "/test-file", write_cb, FSKIT_CONCURRENT, &opts );
+   if( write_rh < 0 ) {
+      fskit_error("fskit_route_write_ex rc = %d\n", write_rh );
+      exit(1);
+   }
+
+   // queue limit requires a concurrency limit
+   opts.max_concurrency = 0;
+   rc = fskit_route_write_ex( core, "/test-file", write_cb, FSKIT_CONCURRENT, &opts );
+   if( rc != -EINVAL ) {
+      fskit_error("fskit_route_write_ex with invalid opts rc = %d\n", rc );
+      exit(1);
+   }
+
+   fh = fskit_create( core, "/test-file", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_close( core, fh );
+   if( rc != 0 ) {
+      fskit_error("fskit_close rc = %d\n", rc );
+      exit(1);
+   }
+
+   fh = fskit_open( core, "/test-file", 0, 0, O_RDWR, 0, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_open rc = %d\n", rc );
+      exit(1);
+   }
+
+   // burst of reads
+   for( int i = 0; i < TEST_NUM_THREADS; i++ ) {
+
+      args[i].core = core;
+      args[i].fh = fh;
+      args[i].rc = 0;
+      pthread_create( &threads[i], NULL, read_thread, &args[i] );
+   }
+
+   for( int i = 0; i < TEST_NUM_THREADS; i++ ) {
+
+      pthread_join( threads[i], NULL );
+      if( args[i].rc != 10 ) {
+         fskit_error("fskit_read rc = %d\n", args[i].rc );
+         exit(1);
+      }
+   }
+
+   if( max_running > 2 ) {
+      fskit_error("%d reads ran at once; expected at most 2\n", max_running );
+      exit(1);
+   }
+
+   rc = fskit_route_get_stats( core, FSKIT_ROUTE_MATCH_READ, read_rh, &stats );
+   if( rc != 0 ) {
+      fskit_error("fskit_route_get_stats rc = %d\n", rc );
+      exit(1);
+   }
+
+   printf("read route: calls=%" PRIu64 " queued=%" PRIu64 " max_queue_depth=%" PRIu64 " wait_ns=%" PRIu64 " max_wait_ns=%" PRIu64 "\n",
+          stats.num_calls, stats.num_queued, stats.max_queue_depth, stats.wait_time_ns, stats.max_wait_time_ns );
+
+   if( stats.num_calls != TEST_NUM_THREADS || stats.num_queued == 0 || stats.num_running != 0 || stats.queue_depth != 0 ) {
+      fskit_error("%s", "bad read route stats\n");
+      exit(1);
+   }
+
+   fskit_executor_get_stats( exec, &exec_stats );
+   printf("executor: submitted=%" PRIu64 " completed=%" PRIu64 " stolen=%" PRIu64 "\n", exec_stats.num_submitted, exec_stats.num_completed, exec_stats.num_stolen );
+
+   if( exec_stats.num_submitted != TEST_NUM_THREADS ) {
+      fskit_error("executor ran %" PRIu64 " jobs; expected %d\n", exec_stats.num_submitted, TEST_NUM_THREADS );
+      exit(1);
+   }
+
+   // burst of writes: some must be shed
+   for( int i = 0; i < TEST_NUM_THREADS; i++ ) {
+
+      args[i].core = core;
+      args[i].fh = fh;
+      args[i].rc = 0;
+      pthread_create( &threads[i], NULL, write_thread, &args[i] );
+   }
+
+   for( int i = 0; i < TEST_NUM_THREADS; i++ ) {
+
+      pthread_join( threads[i], NULL );
+      if( args[i].rc == -EAGAIN ) {
+         num_rejected++;
+      }
+      else if( args[i].rc != 10 ) {
+         fskit_error("fskit_write rc = %d\n", args[i].rc );
+         exit(1);
+      }
+   }
+
+   rc = fskit_route_get_stats( core, FSKIT_ROUTE_MATCH_WRITE, write_rh, &stats );
+   if( rc != 0 ) {
+      fskit_error("fskit_route_get_stats rc = %d\n", rc );
+      exit(1);
+   }
+
+   printf("write route: calls=%" PRIu64 " queued=%" PRIu64 " rejected=%" PRIu64 "\n", stats.num_calls, stats.num_queued, stats.num_rejected );
+
+   if( num_rejected == 0 || stats.num_rejected != (unsigned)num_rejected || stats.num_calls + stats.num_rejected != TEST_NUM_THREADS || stats.max_queue_depth > 1 ) {
+      fskit_error("%s", "bad write route stats\n");
+      exit(1);
+   }
+
+   rc = fskit_close( core, fh );
+   if( rc != 0 ) {
+      fskit_error("fskit_close rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_print_tree( stdout, fskit_core_get_root( core ) );
+
+   rc = fskit_test_end( core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   fskit_executor_destroy( exec );
+   free( exec );
+
+   return 0;
+}
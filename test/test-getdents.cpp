@@ -0,0 +1,159 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-getdents.h"
+
+#define TEST_NUM_FILES 200
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   struct fskit_dir_handle* dh = NULL;
+   char path[PATH_MAX+1];
+   uint64_t buf[32];                            // 256 bytes, aligned
+   bool seen[TEST_NUM_FILES];
+   int num_seen = 0;
+   bool seen_dot = false;
+   bool seen_dotdot = false;
+   uint64_t cookie = FSKIT_DIR_COOKIE_START;
+   ssize_t len = 0;
+   int rc = 0;
+
+   memset( seen, 0, sizeof(seen) );
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = fskit_mkdir( core, "/test-dir", 0755, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir rc = %d\n", rc );
+      exit(1);
+   }
+
+   for( int i = 0; i < TEST_NUM_FILES; i++ ) {
+
+      snprintf( path, PATH_MAX, "/test-dir/%d", i );
+
+      fh = fskit_create( core, path, 0, 0, 0644, &rc );
+      if( fh == NULL ) {
+         fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+
+      fskit_close( core, fh );
+   }
+
+   dh = fskit_opendir( core, "/test-dir", 0, 0, &rc );
+   if( dh == NULL ) {
+      fskit_error("fskit_opendir rc = %d\n", rc );
+      exit(1);
+   }
+
+   // too small for any record
+   len = fskit_getdents( core, dh, FSKIT_DIR_COOKIE_START, (char*)buf, 8 );
+   if( len != -EINVAL ) {
+      fskit_error("fskit_getdents with 8 bytes rc = %zd\n", len );
+      exit(1);
+   }
+
+   // read the whole directory a buffer at a time, resuming from the last cookie
+   while( true ) {
+
+      len = fskit_getdents( core, dh, cookie, (char*)buf, sizeof(buf) );
+      if( len < 0 ) {
+         fskit_error("fskit_getdents rc = %zd\n", len );
+         exit(1);
+      }
+
+      if( len == 0 ) {
+         break;
+      }
+
+      for( ssize_t off = 0; off < len; ) {
+
+         struct fskit_dirent64* rec = (struct fskit_dirent64*)((char*)buf + off);
+
+         // positions only move forward
+         if( rec->cookie <= cookie || rec->reclen != FSKIT_DIRENT64_RECLEN( strlen(rec->name) ) ) {
+            fskit_error("'%s': cookie %" PRIu64 " after %" PRIu64 ", reclen %u\n", rec->name, rec->cookie, cookie, rec->reclen );
+            exit(1);
+         }
+
+         cookie = rec->cookie;
+         off += rec->reclen;
+
+         if( strcmp( rec->name, "." ) == 0 ) {
+            seen_dot = true;
+            continue;
+         }
+
+         if( strcmp( rec->name, ".." ) == 0 ) {
+            seen_dotdot = true;
+            continue;
+         }
+
+         int i = atoi( rec->name );
+         if( i < 0 || i >= TEST_NUM_FILES || seen[i] || rec->type != FSKIT_ENTRY_TYPE_FILE ) {
+            fskit_error("unexpected entry '%s' (type %d)\n", rec->name, rec->type );
+            exit(1);
+         }
+
+         seen[i] = true;
+         num_seen++;
+      }
+   }
+
+   if( num_seen != TEST_NUM_FILES || !seen_dot || !seen_dotdot ) {
+      fskit_error("saw %d files (expected %d), . = %d, .. = %d\n", num_seen, TEST_NUM_FILES, seen_dot, seen_dotdot );
+      exit(1);
+   }
+
+   // resuming past a removed entry still works
+   rc = fskit_unlink( core, "/test-dir/0", 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_unlink rc = %d\n", rc );
+      exit(1);
+   }
+
+   len = fskit_getdents( core, dh, fskit_entry_name_cookie( "0" ), (char*)buf, sizeof(buf) );
+   if( len < 0 ) {
+      fskit_error("fskit_getdents after unlink rc = %zd\n", len );
+      exit(1);
+   }
+
+   rc = fskit_closedir( core, dh );
+   if( rc != 0 ) {
+      fskit_error("fskit_closedir rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_print_tree( stdout, fskit_core_get_root( core ) );
+
+   rc = fskit_test_end( core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   return 0;
+}
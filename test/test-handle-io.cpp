@@ -0,0 +1,196 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-handle-io.h"
+
+#define NUM_ROUNDS 200
+#define NUM_READERS 8
+
+static int read_entered = 0;
+static int num_reads_entered = 0;
+static int read_release = 0;
+static int close_done = 0;
+
+struct test_args {
+   struct fskit_core* core;
+   struct fskit_file_handle* fh;
+   int rc;
+};
+
+// block until told to finish 
+int read_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   __atomic_store_n( &read_entered, 1, __ATOMIC_SEQ_CST );
+   __atomic_add_fetch( &num_reads_entered, 1, __ATOMIC_SEQ_CST );
+
+   while( __atomic_load_n( &read_release, __ATOMIC_SEQ_CST ) == 0 ) {
+      usleep( 1000 );
+   }
+
+   memset( buf, 'x', buflen );
+   return (int)buflen;
+}
+
+void* read_thread( void* arg ) {
+
+   struct test_args* args = (struct test_args*)arg;
+   char buf[10];
+
+   args->rc = fskit_read( args->core, args->fh, buf, 10, 0 );
+   return NULL;
+}
+
+void* close_thread( void* arg ) {
+
+   struct test_args* args = (struct test_args*)arg;
+
+   args->rc = fskit_close( args->core, args->fh );
+   __atomic_store_n( &close_done, 1, __ATOMIC_SEQ_CST );
+   return NULL;
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   struct test_args reader;
+   struct test_args closer;
+   struct test_args readers[NUM_READERS];
+   pthread_t reader_threads[NUM_READERS];
+   pthread_t reader_thread;
+   pthread_t closer_thread;
+   char buf[10];
+   int rc = 0;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = fskit_route_read( core, FSKIT_ROUTE_ANY, read_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_read rc = %d\n", rc );
+      exit(1);
+   }
+
+   fh = fskit_create( core, "/test-file", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   fh = fskit_open( core, "/test-file", 0, 0, O_RDONLY, 0, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_open rc = %d\n", rc );
+      exit(1);
+   }
+
+   reader.core = core;
+   reader.fh = fh;
+   closer.core = core;
+   closer.fh = fh;
+
+   // start a read, and hold it in the callback
+   pthread_create( &reader_thread, NULL, read_thread, &reader );
+
+   while( __atomic_load_n( &read_entered, __ATOMIC_SEQ_CST ) == 0 ) {
+      usleep( 1000 );
+   }
+
+   // close must wait for it 
+   pthread_create( &closer_thread, NULL, close_thread, &closer );
+   usleep( 100000 );
+
+   if( __atomic_load_n( &close_done, __ATOMIC_SEQ_CST ) != 0 ) {
+      fskit_error("%s", "close did not wait for in-flight read\n");
+      exit(1);
+   }
+
+   // new I/O is turned away while the handle is closing
+   rc = fskit_read( core, fh, buf, 10, 0 );
+   if( rc != -EBADF ) {
+      fskit_error("fskit_read on closing handle rc = %d\n", rc );
+      exit(1);
+   }
+
+   __atomic_store_n( &read_release, 1, __ATOMIC_SEQ_CST );
+
+   pthread_join( reader_thread, NULL );
+   pthread_join( closer_thread, NULL );
+
+   if( reader.rc != 10 || closer.rc != 0 ) {
+      fskit_error("read rc = %d, close rc = %d\n", reader.rc, closer.rc );
+      exit(1);
+   }
+
+   // close while reads are still on their way out, so their last touches of the handle race with its destruction
+   for( int i = 0; i < NUM_ROUNDS; i++ ) {
+
+      fh = fskit_open( core, "/test-file", 0, 0, O_RDONLY, 0, &rc );
+      if( fh == NULL ) {
+         fskit_error("fskit_open rc = %d\n", rc );
+         exit(1);
+      }
+
+      __atomic_store_n( &num_reads_entered, 0, __ATOMIC_SEQ_CST );
+
+      for( int j = 0; j < NUM_READERS; j++ ) {
+
+         readers[j].core = core;
+         readers[j].fh = fh;
+         readers[j].rc = 0;
+
+         pthread_create( &reader_threads[j], NULL, read_thread, &readers[j] );
+      }
+
+      // every read is in flight before the handle can go away
+      while( __atomic_load_n( &num_reads_entered, __ATOMIC_SEQ_CST ) < NUM_READERS ) {
+         sched_yield();
+      }
+
+      rc = fskit_close( core, fh );
+      if( rc != 0 ) {
+         fskit_error("fskit_close rc = %d\n", rc );
+         exit(1);
+      }
+
+      for( int j = 0; j < NUM_READERS; j++ ) {
+
+         pthread_join( reader_threads[j], NULL );
+
+         if( readers[j].rc != 10 ) {
+            fskit_error("read rc = %d\n", readers[j].rc );
+            exit(1);
+         }
+      }
+   }
+
+   fskit_print_tree( stdout, fskit_core_get_root( core ) );
+
+   rc = fskit_test_end( core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   return 0;
+}
@@ -0,0 +1,204 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-listing-cache.h"
+
+#define TEST_NUM_FILES 50
+
+// list /test-dir with fskit_getdents.
+// return the number of entries, and set *found if name is among them
+int list_dir( struct fskit_core* core, char const* name, bool* found ) {
+
+   uint64_t buf[64];
+   uint64_t cookie = FSKIT_DIR_COOKIE_START;
+   int count = 0;
+   int rc = 0;
+
+   *found = false;
+
+   struct fskit_dir_handle* dh = fskit_opendir( core, "/test-dir", 0, 0, &rc );
+   if( dh == NULL ) {
+      fskit_error("fskit_opendir rc = %d\n", rc );
+      exit(1);
+   }
+
+   while( true ) {
+
+      ssize_t len = fskit_getdents( core, dh, cookie, (char*)buf, sizeof(buf) );
+      if( len < 0 ) {
+         fskit_error("fskit_getdents rc = %zd\n", len );
+         exit(1);
+      }
+
+      if( len == 0 ) {
+         break;
+      }
+
+      for( ssize_t off = 0; off < len; ) {
+
+         struct fskit_dirent64* rec = (struct fskit_dirent64*)((char*)buf + off);
+
+         if( strcmp( rec->name, name ) == 0 ) {
+            *found = true;
+         }
+
+         cookie = rec->cookie;
+         off += rec->reclen;
+         count++;
+      }
+   }
+
+   fskit_closedir( core, dh );
+   return count;
+}
+
+// make sure a listing has the given size, and does or does not have the given name
+void check_listing( struct fskit_core* core, int expected_count, char const* name, bool expected_found ) {
+
+   bool found = false;
+   int count = list_dir( core, name, &found );
+
+   if( count != expected_count || found != expected_found ) {
+      fskit_error("listed %d entries (expected %d), '%s' found = %d (expected %d)\n", count, expected_count, name, found, expected_found );
+      exit(1);
+   }
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   struct fskit_entry* dir = NULL;
+   struct fskit_dir_handle* dh = NULL;
+   struct fskit_dir_entry** dents = NULL;
+   char path[PATH_MAX+1];
+   uint64_t num_read = 0;
+   int rc = 0;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = fskit_mkdir( core, "/test-dir", 0755, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir rc = %d\n", rc );
+      exit(1);
+   }
+
+   for( int i = 0; i < TEST_NUM_FILES; i++ ) {
+
+      snprintf( path, PATH_MAX, "/test-dir/file-%d", i );
+
+      fh = fskit_create( core, path, 0, 0, 0644, &rc );
+      if( fh == NULL ) {
+         fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+
+      fskit_close( core, fh );
+   }
+
+   dir = fskit_entry_resolve_path( core, "/test-dir", 0, 0, true, &rc );
+   if( dir == NULL ) {
+      fskit_error("fskit_entry_resolve_path rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_entry_enable_listing_cache( dir );
+   fskit_entry_unlock( dir );
+
+   if( rc != 0 ) {
+      fskit_error("fskit_entry_enable_listing_cache rc = %d\n", rc );
+      exit(1);
+   }
+
+   // first listing builds the cache, second is served from it
+   check_listing( core, TEST_NUM_FILES + 2, "file-0", true );
+   check_listing( core, TEST_NUM_FILES + 2, "file-0", true );
+
+   // creating, unlinking, and renaming each invalidate it
+   fh = fskit_create( core, "/test-dir/new-file", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+   check_listing( core, TEST_NUM_FILES + 3, "new-file", true );
+
+   rc = fskit_unlink( core, "/test-dir/file-0", 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_unlink rc = %d\n", rc );
+      exit(1);
+   }
+
+   check_listing( core, TEST_NUM_FILES + 2, "file-0", false );
+
+   rc = fskit_rename( core, "/test-dir/new-file", "/test-dir/renamed-file", 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_rename rc = %d\n", rc );
+      exit(1);
+   }
+
+   check_listing( core, TEST_NUM_FILES + 2, "new-file", false );
+   check_listing( core, TEST_NUM_FILES + 2, "renamed-file", true );
+
+   // fskit_readdir is served from it too
+   dh = fskit_opendir( core, "/test-dir", 0, 0, &rc );
+   if( dh == NULL ) {
+      fskit_error("fskit_opendir rc = %d\n", rc );
+      exit(1);
+   }
+
+   uint64_t total = 0;
+   while( true ) {
+
+      dents = fskit_readdir( core, dh, 7, &num_read, &rc );
+      if( rc != 0 ) {
+         fskit_error("fskit_readdir rc = %d\n", rc );
+         exit(1);
+      }
+
+      if( dents == NULL ) {
+         break;
+      }
+
+      total += num_read;
+      fskit_dir_entry_free_list( dents );
+   }
+
+   fskit_closedir( core, dh );
+
+   if( total != TEST_NUM_FILES + 2 ) {
+      fskit_error("fskit_readdir read %" PRIu64 " entries, expected %d\n", total, TEST_NUM_FILES + 2 );
+      exit(1);
+   }
+
+   fskit_print_tree( stdout, fskit_core_get_root( core ) );
+
+   rc = fskit_test_end( core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   return 0;
+}
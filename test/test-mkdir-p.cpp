@@ -0,0 +1,208 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-mkdir-p.h"
+
+#define NUM_THREADS 8
+
+static int num_mkdir_calls = 0;
+
+struct mkdir_p_thread_args {
+   struct fskit_core* core;
+   int id;
+   int rc;
+};
+
+int mkdir_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* dent, mode_t mode, void** inode_data ) {
+   __atomic_add_fetch( &num_mkdir_calls, 1, __ATOMIC_SEQ_CST );
+   return 0;
+}
+
+int fail_mkdir_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* dent, mode_t mode, void** inode_data ) {
+   return -EIO;
+}
+
+// look up path, and check its type and permission bits
+void check_exists( struct fskit_core* core, char const* path, int type, mode_t mode ) {
+
+   int rc = 0;
+   struct fskit_entry* fent = fskit_entry_resolve_path( core, path, 0, 0, false, &rc );
+   if( fent == NULL ) {
+      fskit_error("fskit_entry_resolve_path('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   if( fskit_entry_get_type( fent ) != type || (fskit_entry_get_mode( fent ) & 0777) != mode ) {
+      fskit_error("'%s' has type %d mode %o, expected %d and %o\n", path, fskit_entry_get_type( fent ), fskit_entry_get_mode( fent ) & 0777, type, mode );
+      exit(1);
+   }
+
+   fskit_entry_unlock( fent );
+}
+
+void check_absent( struct fskit_core* core, char const* path ) {
+
+   int rc = 0;
+   struct fskit_entry* fent = fskit_entry_resolve_path( core, path, 0, 0, false, &rc );
+   if( fent != NULL || rc != -ENOENT ) {
+      fskit_error("fskit_entry_resolve_path('%s') rc = %d, expected %d\n", path, rc, -ENOENT );
+      exit(1);
+   }
+}
+
+// every thread makes paths that share their first levels with every other thread's
+void* mkdir_p_thread( void* arg ) {
+
+   struct mkdir_p_thread_args* args = (struct mkdir_p_thread_args*)arg;
+   char path[PATH_MAX];
+
+   for( int i = 0; i < NUM_THREADS; i++ ) {
+
+      snprintf( path, PATH_MAX, "/shared/%d/deep/%d", (args->id + i) % NUM_THREADS, i );
+
+      args->rc = fskit_mkdir_p( args->core, path, 0755, 0, 0 );
+      if( args->rc != 0 ) {
+         fskit_error("fskit_mkdir_p('%s') rc = %d\n", path, args->rc );
+         break;
+      }
+   }
+
+   return NULL;
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   struct mkdir_p_thread_args args[NUM_THREADS];
+   pthread_t threads[NUM_THREADS];
+   int rc = 0;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   if( fskit_route_mkdir( core, "^/fail/bad$", fail_mkdir_cb, FSKIT_CONCURRENT ) < 0 ||
+       fskit_route_mkdir( core, "^/.*$", mkdir_cb, FSKIT_CONCURRENT ) < 0 ) {
+
+      fskit_error("%s", "failed to install routes\n" );
+      exit(1);
+   }
+
+   // parents get u+wx, the directory itself gets the given mode
+   check_rc( "fskit_mkdir_p('/a/b/c')", fskit_mkdir_p( core, "/a/b/c", 0500, 0, 0 ), 0 );
+   check_rc( "mkdir routes", num_mkdir_calls, 3 );
+
+   check_exists( core, "/a", FSKIT_ENTRY_TYPE_DIR, 0700 );
+   check_exists( core, "/a/b", FSKIT_ENTRY_TYPE_DIR, 0700 );
+   check_exists( core, "/a/b/c", FSKIT_ENTRY_TYPE_DIR, 0500 );
+
+   // already there
+   num_mkdir_calls = 0;
+   check_rc( "fskit_mkdir_p('/a/b')", fskit_mkdir_p( core, "/a/b", 0755, 0, 0 ), 0 );
+   check_rc( "fskit_mkdir_p('/')", fskit_mkdir_p( core, "/", 0755, 0, 0 ), 0 );
+   check_rc( "mkdir routes", num_mkdir_calls, 0 );
+
+   // '.' and extra slashes are skipped
+   check_rc( "fskit_mkdir_p('/a/./b//d/')", fskit_mkdir_p( core, "/a/./b//d/", 0755, 0, 0 ), 0 );
+   check_rc( "mkdir routes", num_mkdir_calls, 1 );
+   check_exists( core, "/a/b/d", FSKIT_ENTRY_TYPE_DIR, 0755 );
+
+   // files in the way
+   fh = fskit_create( core, "/a/f", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('/a/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   check_rc( "fskit_mkdir_p('/a/f')", fskit_mkdir_p( core, "/a/f", 0755, 0, 0 ), -EEXIST );
+   check_rc( "fskit_mkdir_p('/a/f/g')", fskit_mkdir_p( core, "/a/f/g", 0755, 0, 0 ), -ENOTDIR );
+
+   // a failed mkdir route leaves the parents that were made before it
+   check_rc( "fskit_mkdir_p('/fail/bad/x')", fskit_mkdir_p( core, "/fail/bad/x", 0755, 0, 0 ), -EIO );
+   check_exists( core, "/fail", FSKIT_ENTRY_TYPE_DIR, 0755 );
+   check_absent( core, "/fail/bad" );
+
+   // not writable by another user
+   check_rc( "fskit_mkdir_p('/a/b/c/e')", fskit_mkdir_p( core, "/a/b/c/e", 0755, 1, 1 ), -EACCES );
+   check_absent( core, "/a/b/c/e" );
+
+   // open with parents
+   fh = fskit_open( core, "/x/y/z/file", 0, 0, O_CREAT | O_WRONLY | FSKIT_O_MKPARENTS, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_open('/x/y/z/file') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   check_exists( core, "/x", FSKIT_ENTRY_TYPE_DIR, 0755 );
+   check_exists( core, "/x/y/z", FSKIT_ENTRY_TYPE_DIR, 0755 );
+   check_exists( core, "/x/y/z/file", FSKIT_ENTRY_TYPE_FILE, 0644 );
+
+   fh = fskit_open( core, "/a/f/file", 0, 0, O_CREAT | O_WRONLY | FSKIT_O_MKPARENTS, 0644, &rc );
+   if( fh != NULL || rc != -ENOTDIR ) {
+      fskit_error("fskit_open('/a/f/file') rc = %d, expected %d\n", rc, -ENOTDIR );
+      exit(1);
+   }
+
+   // without the flag, parents must exist
+   fh = fskit_open( core, "/q/r/file", 0, 0, O_CREAT | O_WRONLY, 0644, &rc );
+   if( fh != NULL || rc != -ENOENT ) {
+      fskit_error("fskit_open('/q/r/file') rc = %d, expected %d\n", rc, -ENOENT );
+      exit(1);
+   }
+
+   check_absent( core, "/q" );
+
+   // many threads making overlapping trees make each directory once
+   num_mkdir_calls = 0;
+
+   for( int i = 0; i < NUM_THREADS; i++ ) {
+
+      args[i].core = core;
+      args[i].id = i;
+      args[i].rc = 0;
+
+      pthread_create( &threads[i], NULL, mkdir_p_thread, &args[i] );
+   }
+
+   for( int i = 0; i < NUM_THREADS; i++ ) {
+
+      pthread_join( threads[i], NULL );
+      check_rc( "mkdir_p_thread", args[i].rc, 0 );
+   }
+
+   // /shared, /shared/N, /shared/N/deep, and /shared/N/deep/M
+   check_rc( "mkdir routes", num_mkdir_calls, 1 + NUM_THREADS * 2 + NUM_THREADS * NUM_THREADS );
+
+   fskit_print_tree( stdout, fskit_core_get_root( core ) );
+
+   rc = fskit_test_end( core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   return 0;
+}
@@ -0,0 +1,166 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+
+#include "test-path-view.h"
+
+void check_dirname( char const* path, char const* expected ) {
+
+   size_t len = fskit_dirname_len( path );
+
+   if( len != strlen(expected) || strncmp( path, expected, len ) != 0 ) {
+      fskit_error("fskit_dirname_len('%s') = %zu, expected '%s'\n", path, len, expected );
+      exit(1);
+   }
+}
+
+void check_basename( char const* path, char const* expected ) {
+
+   size_t len = 0;
+   char const* base = fskit_basename_view( path, &len );
+
+   if( len != strlen(expected) || strncmp( base, expected, len ) != 0 ) {
+      fskit_error("fskit_basename_view('%s') = '%.*s', expected '%s'\n", path, (int)len, base, expected );
+      exit(1);
+   }
+}
+
+// expected is the names in path, separated by spaces
+void check_names( char const* path, char const* expected ) {
+
+   struct fskit_path_cursor cur;
+   char names[PATH_MAX];
+   size_t off = 0;
+
+   memset( names, 0, PATH_MAX );
+   fskit_path_cursor_init( &cur, path, strlen(path) );
+
+   while( fskit_path_cursor_next( &cur ) ) {
+
+      off += snprintf( names + off, PATH_MAX - off, "%s%.*s", (off > 0 ? " " : ""), (int)cur.len, cur.name );
+
+      if( fskit_path_cursor_last( &cur ) && fskit_path_cursor_offset( &cur ) + strspn( path + fskit_path_cursor_offset( &cur ), "/." ) != strlen(path) ) {
+         fskit_error("'%s': '%.*s' is not the last name\n", path, (int)cur.len, cur.name );
+         exit(1);
+      }
+   }
+
+   if( strcmp( names, expected ) != 0 ) {
+      fskit_error("names of '%s' are '%s', expected '%s'\n", path, names, expected );
+      exit(1);
+   }
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   struct fskit_entry* fent = NULL;
+   struct stat sb;
+   char long_path[FSKIT_FILESYSTEM_NAMEMAX + 16];
+   int rc = 0;
+
+   check_dirname( "/", "/" );
+   check_dirname( "/a", "/" );
+   check_dirname( "/a/", "/" );
+   check_dirname( "/a/b", "/a" );
+   check_dirname( "/a/b//", "/a" );
+   check_dirname( "/a//b", "/a" );
+   check_dirname( "a", "" );
+
+   check_basename( "/", "/" );
+   check_basename( "/a", "a" );
+   check_basename( "/a/bc/", "bc" );
+   check_basename( "/a/bc//", "bc" );
+   check_basename( "a", "a" );
+
+   check_names( "/", "" );
+   check_names( "/a/b/c", "a b c" );
+   check_names( "//a/./b//c/.", "a b c" );
+   check_names( "/a/..b/.c/", "a ..b .c" );
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   // resolution walks the caller's path in place, so '.' names and extra '/''s are skipped
+   check_rc( "fskit_mkdir_p('/a/b')", fskit_mkdir_p( core, "/a/b", 0755, 0, 0 ), 0 );
+
+   fh = fskit_create( core, "//a/./b//f", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('//a/./b//f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   fent = fskit_entry_resolve_path( core, "/a/b/./f", 0, 0, false, &rc );
+   if( fent == NULL ) {
+      fskit_error("fskit_entry_resolve_path('/a/b/./f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_entry_unlock( fent );
+
+   check_rc( "fskit_stat('/a/b/')", fskit_stat( core, "/a/b/", 0, 0, &sb ), 0 );
+   check_rc( "fskit_rename('/a/b/f','/a/b/g')", fskit_rename( core, "/a/b/f", "/a/b/g", 0, 0 ), 0 );
+   check_rc( "fskit_rename('/a/b/','/a/c/')", fskit_rename( core, "/a/b/", "/a/c/", 0, 0 ), 0 );
+   check_rc( "fskit_stat('/a/c/g')", fskit_stat( core, "/a/c/g", 0, 0, &sb ), 0 );
+
+   // a name that is too long is rejected without being copied out
+   memset( long_path, 0, sizeof(long_path) );
+   long_path[0] = '/';
+   memset( long_path + 1, 'x', FSKIT_FILESYSTEM_NAMEMAX + 1 );
+
+   check_rc( "fskit_mkdir(long)", fskit_mkdir( core, long_path, 0755, 0, 0 ), -ENAMETOOLONG );
+   check_rc( "fskit_unlink(long)", fskit_unlink( core, long_path, 0, 0 ), -ENAMETOOLONG );
+
+   strcat( long_path, "/y" );
+
+   fent = fskit_entry_resolve_path( core, long_path, 0, 0, false, &rc );
+   if( fent != NULL ) {
+      fskit_error("%s", "resolved a path with a name that is too long\n" );
+      exit(1);
+   }
+
+   check_rc( "fskit_entry_resolve_path(long/y)", rc, -ENAMETOOLONG );
+
+   check_rc( "fskit_unlink('/a/c/g')", fskit_unlink( core, "/a/c/g", 0, 0 ), 0 );
+   check_rc( "fskit_rmdir('/a/c/')", fskit_rmdir( core, "/a/c/", 0, 0 ), 0 );
+
+   fent = fskit_entry_resolve_path( core, "/a/c", 0, 0, false, &rc );
+   if( fent != NULL ) {
+      fskit_error("%s", "/a/c still exists\n" );
+      exit(1);
+   }
+
+   check_rc( "fskit_entry_resolve_path('/a/c')", rc, -ENOENT );
+
+   fskit_print_tree( stdout, fskit_core_get_root( core ) );
+
+   rc = fskit_test_end( core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   return 0;
+}
@@ -0,0 +1,131 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-pin.h"
+
+// fill the buffer with the first character of the matched file name, so we know which route (and match groups) handled the read
+int read_cb_a( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   char** match_groups = fskit_route_metadata_get_match_groups( route_metadata );
+   memset( buf, match_groups[0][0], buflen );
+   return (int)buflen;
+}
+
+int read_cb_b( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   memset( buf, 'B', buflen );
+   return (int)buflen;
+}
+
+// read from a handle, and check what we got back 
+void test_read( struct fskit_core* core, struct fskit_file_handle* fh, int expected_rc, char expected_fill ) {
+
+   char buf[10];
+   memset( buf, 0, 10 );
+
+   int rc = fskit_read( core, fh, buf, 10, 0 );
+   if( rc != expected_rc ) {
+      fskit_error("fskit_read rc = %d (expected %d)\n", rc, expected_rc );
+      exit(1);
+   }
+
+   for( int i = 0; i < rc; i++ ) {
+      if( buf[i] != expected_fill ) {
+         fskit_error("fskit_read: buf[%d] = '%c' (expected '%c')\n", i, buf[i], expected_fill );
+         exit(1);
+      }
+   }
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   int rc = 0;
+   int route_a = 0;
+   int route_b = 0;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   route_a = fskit_route_read( core, "/test-([^/]+)", read_cb_a, FSKIT_CONCURRENT );
+   if( route_a < 0 ) {
+      fskit_error("fskit_route_read rc = %d\n", route_a );
+      exit(1);
+   }
+
+   fh = fskit_create( core, "/test-xyz", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_close( core, fh );
+   if( rc != 0 ) {
+      fskit_error("fskit_close rc = %d\n", rc );
+      exit(1);
+   }
+
+   fh = fskit_open( core, "/test-xyz", 0, 0, O_RDONLY, 0, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_open rc = %d\n", rc );
+      exit(1);
+   }
+
+   // pinned route, with its match groups
+   test_read( core, fh, 10, 'x' );
+   test_read( core, fh, 10, 'x' );
+
+   // changing the route table re-resolves the pin
+   rc = fskit_unroute_read( core, route_a );
+   if( rc != 0 ) {
+      fskit_error("fskit_unroute_read rc = %d\n", rc );
+      exit(1);
+   }
+
+   test_read( core, fh, 0, 0 );
+
+   route_b = fskit_route_read( core, "/test-xyz", read_cb_b, FSKIT_CONCURRENT );
+   if( route_b < 0 ) {
+      fskit_error("fskit_route_read rc = %d\n", route_b );
+      exit(1);
+   }
+
+   test_read( core, fh, 10, 'B' );
+   test_read( core, fh, 10, 'B' );
+
+   rc = fskit_close( core, fh );
+   if( rc != 0 ) {
+      fskit_error("fskit_close rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_print_tree( stdout, fskit_core_get_root( core ) );
+
+   rc = fskit_test_end( core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   return 0;
+}
@@ -35,6 +35,7 @@ int fskit_test_readdir( struct fskit_core* core, char const* path ) {
    int offset = 0;
    uint64_t num_read = 0;
    int count = 0;
+   uint64_t total = 0;
    char type_str[10];
    struct fskit_dir_entry** dents;
 
@@ -68,12 +69,57 @@ int fskit_test_readdir( struct fskit_core* core, char const* path ) {
       dents = NULL;
 
       offset += num_read;
+      total += num_read;
       num_to_read ++;
       count++;
    }
 
    fskit_debug("Read %d entries\n", count );
 
+   // rewinding starts over from the first entry
+   fskit_rewinddir( dh );
+
+   dents = fskit_listdir( core, dh, &num_read, &rc );
+   if( rc != 0 || dents == NULL || num_read != total ) {
+      fskit_error("fskit_listdir('%s') after rewind rc = %d, num_read = %" PRIu64 " (expected %" PRIu64 ")\n", path, rc, num_read, total );
+      return -EIO;
+   }
+
+   fskit_dir_entry_free_list( dents );
+
+   // seeking to a telldir position replays the same entries
+   fskit_rewinddir( dh );
+
+   dents = fskit_readdir( core, dh, 1, &num_read, &rc );
+   if( rc != 0 || dents == NULL ) {
+      fskit_error("fskit_readdir('%s') rc = %d\n", path, rc );
+      return -EIO;
+   }
+
+   fskit_dir_entry_free_list( dents );
+
+   off_t pos = fskit_telldir( dh );
+   struct fskit_dir_entry** after = fskit_listdir( core, dh, &num_read, &rc );
+   uint64_t num_after = num_read;
+
+   fskit_seekdir( dh, pos );
+   dents = fskit_listdir( core, dh, &num_read, &rc );
+
+   if( num_after != total - 1 || num_read != num_after ) {
+      fskit_error("'%s': %" PRIu64 " entries after telldir, %" PRIu64 " after seekdir, expected %" PRIu64 "\n", path, num_after, num_read, total - 1 );
+      return -EIO;
+   }
+
+   for( uint64_t i = 0; i < num_read; i++ ) {
+      if( strcmp( dents[i]->name, after[i]->name ) != 0 ) {
+         fskit_error("'%s': entry %" PRIu64 " is '%s' after seekdir, '%s' after telldir\n", path, i, dents[i]->name, after[i]->name );
+         return -EIO;
+      }
+   }
+
+   fskit_dir_entry_free_list( after );
+   fskit_dir_entry_free_list( dents );
+
    rc = fskit_closedir( core, dh );
    if( rc != 0 ) {
       fskit_error("fskit_closedir('%s') rc = %d\n", path, rc );
@@ -0,0 +1,157 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-readdirplus.h"
+
+#define TEST_NUM_FILES 10
+
+// hide "file-0" from listings
+int readdir_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* dir, struct fskit_dir_entry** dents, size_t num_dents ) {
+
+   for( size_t i = 0; i < num_dents; i++ ) {
+
+      if( strcmp( dents[i]->name, "file-0" ) == 0 ) {
+         fskit_readdir_omit( dents, i );
+      }
+   }
+
+   return 0;
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   struct fskit_dir_handle* dh = NULL;
+   struct fskit_dir_entry_plus** dents = NULL;
+   struct stat sb;
+   char path[PATH_MAX+1];
+   uint64_t num_read = 0;
+   int num_files = 0;
+   int rc = 0;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = fskit_mkdir( core, "/test-dir", 0755, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir rc = %d\n", rc );
+      exit(1);
+   }
+
+   // files with distinct modes and sizes
+   for( int i = 0; i < TEST_NUM_FILES; i++ ) {
+
+      snprintf( path, PATH_MAX, "/test-dir/file-%d", i );
+
+      fh = fskit_create( core, path, 0, 0, 0600 + i, &rc );
+      if( fh == NULL ) {
+         fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+
+      rc = fskit_close( core, fh );
+      if( rc != 0 ) {
+         fskit_error("fskit_close('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+
+      rc = fskit_trunc( core, path, 0, 0, i * 100 );
+      if( rc != 0 ) {
+         fskit_error("fskit_trunc('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+   }
+
+   rc = fskit_route_readdir( core, "/test-dir", readdir_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_readdir rc = %d\n", rc );
+      exit(1);
+   }
+
+   dh = fskit_opendir( core, "/test-dir", 0, 0, &rc );
+   if( dh == NULL ) {
+      fskit_error("fskit_opendir rc = %d\n", rc );
+      exit(1);
+   }
+
+   dents = fskit_listdirplus( core, dh, &num_read, &rc );
+   if( dents == NULL || rc != 0 ) {
+      fskit_error("fskit_listdirplus rc = %d\n", rc );
+      exit(1);
+   }
+
+   // each entry's attributes match what stat reports
+   for( uint64_t i = 0; i < num_read; i++ ) {
+
+      if( strcmp( dents[i]->dirent.name, "file-0" ) == 0 ) {
+         fskit_error("%s", "file-0 was not omitted\n");
+         exit(1);
+      }
+
+      if( strcmp( dents[i]->dirent.name, "." ) == 0 ) {
+         snprintf( path, PATH_MAX, "/test-dir" );
+      }
+      else if( strcmp( dents[i]->dirent.name, ".." ) == 0 ) {
+         snprintf( path, PATH_MAX, "/" );
+      }
+      else {
+         snprintf( path, PATH_MAX, "/test-dir/%s", dents[i]->dirent.name );
+         num_files++;
+      }
+
+      rc = fskit_stat( core, path, 0, 0, &sb );
+      if( rc != 0 ) {
+         fskit_error("fskit_stat('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+
+      if( sb.st_ino != dents[i]->sb.st_ino || sb.st_mode != dents[i]->sb.st_mode || sb.st_size != dents[i]->sb.st_size || sb.st_nlink != dents[i]->sb.st_nlink || dents[i]->dirent.file_id != (uint64_t)sb.st_ino ) {
+         fskit_error("'%s': ino %" PRIX64 " mode %o size %jd from listing, ino %" PRIX64 " mode %o size %jd from stat\n",
+                     path, (uint64_t)dents[i]->sb.st_ino, dents[i]->sb.st_mode, (intmax_t)dents[i]->sb.st_size, (uint64_t)sb.st_ino, sb.st_mode, (intmax_t)sb.st_size );
+         exit(1);
+      }
+   }
+
+   if( num_files != TEST_NUM_FILES - 1 ) {
+      fskit_error("listed %d files, expected %d\n", num_files, TEST_NUM_FILES - 1 );
+      exit(1);
+   }
+
+   fskit_dir_entry_plus_free_list( dents );
+
+   rc = fskit_closedir( core, dh );
+   if( rc != 0 ) {
+      fskit_error("fskit_closedir rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_print_tree( stdout, fskit_core_get_root( core ) );
+
+   rc = fskit_test_end( core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   return 0;
+}
@@ -0,0 +1,221 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+
+#include "test-ref-many.h"
+
+#define NUM_DIRS 10
+#define NUM_FILES 100
+#define NUM_ROUNDS 50
+
+struct churn_args {
+   struct fskit_core* core;
+   bool* done;
+   int rc;
+};
+
+// reference paths in a batch, and check each result against fskit_entry_ref's
+void check_batch( struct fskit_core* core, char const** paths, size_t num_paths, uint64_t user, int const* expected ) {
+
+   struct fskit_entry** fents = (struct fskit_entry**)calloc( num_paths, sizeof(struct fskit_entry*) );
+   int* rcs = (int*)calloc( num_paths, sizeof(int) );
+   int rc = 0;
+
+   check_rc( "fskit_entry_ref_many", fskit_entry_ref_many( core, paths, num_paths, user, user, fents, rcs ), 0 );
+
+   for( size_t i = 0; i < num_paths; i++ ) {
+
+      if( rcs[i] != expected[i] || (rcs[i] == 0) != (fents[i] != NULL) ) {
+         fskit_error("'%s': rc = %d, fent = %p, expected rc = %d\n", paths[i], rcs[i], fents[i], expected[i] );
+         exit(1);
+      }
+
+      if( fents[i] == NULL ) {
+         continue;
+      }
+
+      struct fskit_entry* fent = fskit_entry_ref( core, paths[i], &rc );
+      if( fent != fents[i] ) {
+         fskit_error("'%s': batch got %p, fskit_entry_ref got %p (rc = %d)\n", paths[i], fents[i], fent, rc );
+         exit(1);
+      }
+
+      fskit_entry_unref( core, paths[i], fent );
+      fskit_entry_unref( core, paths[i], fents[i] );
+   }
+
+   free( fents );
+   free( rcs );
+}
+
+// create and unlink files in the directories being resolved
+void* churn_thread( void* arg ) {
+
+   struct churn_args* args = (struct churn_args*)arg;
+   char path[PATH_MAX];
+   int i = 0;
+
+   while( !__atomic_load_n( args->done, __ATOMIC_ACQUIRE ) ) {
+
+      snprintf( path, PATH_MAX, "/m/d%d/churn", i % NUM_DIRS );
+
+      struct fskit_file_handle* fh = fskit_create( args->core, path, 0, 0, 0644, &args->rc );
+      if( fh == NULL ) {
+         break;
+      }
+
+      fskit_close( args->core, fh );
+
+      args->rc = fskit_unlink( args->core, path, 0, 0 );
+      if( args->rc != 0 ) {
+         break;
+      }
+
+      i++;
+   }
+
+   return NULL;
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   struct churn_args args;
+   pthread_t churner;
+   bool done = false;
+   char** all_paths = NULL;
+   int* all_expected = NULL;
+   size_t num_all = NUM_DIRS * NUM_FILES;
+   char long_path[FSKIT_FILESYSTEM_NAMEMAX + 16];
+   int rc = 0;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   // a manifest's worth of files, listed in order
+   all_paths = (char**)calloc( num_all, sizeof(char*) );
+   all_expected = (int*)calloc( num_all, sizeof(int) );
+
+   for( int i = 0; i < NUM_DIRS; i++ ) {
+
+      char dir_path[PATH_MAX];
+      snprintf( dir_path, PATH_MAX, "/m/d%d", i );
+
+      check_rc( "fskit_mkdir_p", fskit_mkdir_p( core, dir_path, 0755, 0, 0 ), 0 );
+
+      for( int j = 0; j < NUM_FILES; j++ ) {
+
+         all_paths[ i * NUM_FILES + j ] = (char*)malloc( PATH_MAX );
+         snprintf( all_paths[ i * NUM_FILES + j ], PATH_MAX, "/m/d%d/f%02d", i, j );
+
+         fh = fskit_create( core, all_paths[ i * NUM_FILES + j ], 0, 0, 0644, &rc );
+         if( fh == NULL ) {
+            fskit_error("fskit_create('%s') rc = %d\n", all_paths[ i * NUM_FILES + j ], rc );
+            exit(1);
+         }
+
+         fskit_close( core, fh );
+      }
+   }
+
+   fh = fskit_create( core, "/m/file", 0, 0, 0644, &rc );
+   fskit_close( core, fh );
+
+   check_rc( "fskit_mkdir('/m/private')", fskit_mkdir( core, "/m/private", 0700, 0, 0 ), 0 );
+   check_rc( "fskit_mkdir('/m/private/x')", fskit_mkdir( core, "/m/private/x", 0755, 0, 0 ), 0 );
+
+   check_batch( core, (char const**)all_paths, num_all, 0, all_expected );
+
+   // errors are per-path, and don't stop the paths after them
+   memset( long_path, 0, sizeof(long_path) );
+   strcpy( long_path, "/m/" );
+   memset( long_path + 3, 'x', FSKIT_FILESYSTEM_NAMEMAX + 1 );
+
+   char const* mixed_paths[] = {
+      "/",
+      "/m",
+      "/m/",
+      "",
+      "/m/d1/../d2/f05",
+      "/m/d2/f05",
+      "/m/d2/nope",
+      "/m/d2/nope/f05",
+      "/m/d2/f06",
+      "/m/file",
+      "/m/file/x",
+      long_path,
+      "/m/private/x",
+      "/m/private",
+      "/m/d9/./f99",
+      "/../m/d0/f00"
+   };
+
+   int mixed_expected_root[] = { 0, 0, 0, -EINVAL, 0, 0, -ENOENT, -ENOENT, 0, 0, -ENOTDIR, -ENAMETOOLONG, 0, 0, 0, 0 };
+   int mixed_expected_user[] = { 0, 0, 0, -EINVAL, 0, 0, -ENOENT, -ENOENT, 0, 0, -ENOTDIR, -ENAMETOOLONG, -EACCES, -EACCES, 0, 0 };
+   size_t num_mixed = sizeof(mixed_paths) / sizeof(mixed_paths[0]);
+
+   check_batch( core, mixed_paths, num_mixed, 0, mixed_expected_root );
+   check_batch( core, mixed_paths, num_mixed, 1, mixed_expected_user );
+
+   // any order works
+   for( size_t i = 0; i < num_all; i++ ) {
+
+      size_t j = (i * 7919) % num_all;
+      char* tmp = all_paths[i];
+      all_paths[i] = all_paths[j];
+      all_paths[j] = tmp;
+   }
+
+   check_batch( core, (char const**)all_paths, num_all, 0, all_expected );
+
+   // batches don't hold up (or get confused by) writers in the same directories
+   args.core = core;
+   args.done = &done;
+   args.rc = 0;
+
+   pthread_create( &churner, NULL, churn_thread, &args );
+
+   for( int i = 0; i < NUM_ROUNDS; i++ ) {
+      check_batch( core, (char const**)all_paths, num_all, 0, all_expected );
+   }
+
+   __atomic_store_n( &done, true, __ATOMIC_RELEASE );
+   pthread_join( churner, NULL );
+
+   check_rc( "churn thread", args.rc, 0 );
+
+   for( size_t i = 0; i < num_all; i++ ) {
+      free( all_paths[i] );
+   }
+
+   free( all_paths );
+   free( all_expected );
+
+   rc = fskit_test_end( core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   return 0;
+}
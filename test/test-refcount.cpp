@@ -0,0 +1,154 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-refcount.h"
+
+#define TEST_NUM_THREADS 8
+#define TEST_NUM_OPENS 1000
+
+static int num_destroyed = 0;
+
+int destroy_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, void* inode_data ) {
+   __atomic_add_fetch( &num_destroyed, 1, __ATOMIC_SEQ_CST );
+   return 0;
+}
+
+// open and close the same file over and over
+void* open_close_thread( void* arg ) {
+
+   struct fskit_core* core = (struct fskit_core*)arg;
+   struct fskit_file_handle* fh = NULL;
+   int rc = 0;
+
+   for( int i = 0; i < TEST_NUM_OPENS; i++ ) {
+
+      fh = fskit_open( core, "/test-file", 0, 0, O_RDONLY, 0, &rc );
+      if( fh == NULL ) {
+         fskit_error("fskit_open rc = %d\n", rc );
+         exit(1);
+      }
+
+      rc = fskit_close( core, fh );
+      if( rc != 0 ) {
+         fskit_error("fskit_close rc = %d\n", rc );
+         exit(1);
+      }
+   }
+
+   return NULL;
+}
+
+// check an entry's reference counts
+void test_counts( struct fskit_entry* fent, int32_t expected_open, int32_t expected_link ) {
+
+   if( fskit_entry_get_open_count( fent ) != expected_open || fskit_entry_get_link_count( fent ) != expected_link ) {
+      fskit_error("open count = %d (expected %d), link count = %d (expected %d)\n", fskit_entry_get_open_count( fent ), expected_open, fskit_entry_get_link_count( fent ), expected_link );
+      exit(1);
+   }
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   struct fskit_file_handle* fh2 = NULL;
+   struct fskit_entry* fent = NULL;
+   pthread_t threads[TEST_NUM_THREADS];
+   int rc = 0;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = fskit_route_destroy( core, FSKIT_ROUTE_ANY, destroy_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_destroy rc = %d\n", rc );
+      exit(1);
+   }
+
+   fh = fskit_create( core, "/test-file", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create rc = %d\n", rc );
+      exit(1);
+   }
+
+   fent = fskit_file_handle_get_entry( fh );
+   test_counts( fent, 1, 1 );
+
+   // concurrent opens and closes must not lose references
+   for( int i = 0; i < TEST_NUM_THREADS; i++ ) {
+      pthread_create( &threads[i], NULL, open_close_thread, core );
+   }
+
+   for( int i = 0; i < TEST_NUM_THREADS; i++ ) {
+      pthread_join( threads[i], NULL );
+   }
+
+   test_counts( fent, 1, 1 );
+
+   fh2 = fskit_open( core, "/test-file", 0, 0, O_RDONLY, 0, &rc );
+   if( fh2 == NULL ) {
+      fskit_error("fskit_open rc = %d\n", rc );
+      exit(1);
+   }
+
+   test_counts( fent, 2, 1 );
+
+   // unlinked, but still open
+   rc = fskit_unlink( core, "/test-file", 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_unlink rc = %d\n", rc );
+      exit(1);
+   }
+
+   if( fskit_entry_resolve_path( core, "/test-file", 0, 0, false, &rc ) != NULL || rc != -ENOENT ) {
+      fskit_error("fskit_entry_resolve_path rc = %d\n", rc );
+      exit(1);
+   }
+
+   test_counts( fent, 2, 0 );
+
+   // not the last reference
+   rc = fskit_close( core, fh );
+   if( rc != 0 || num_destroyed != 0 ) {
+      fskit_error("fskit_close rc = %d, num_destroyed = %d\n", rc, num_destroyed );
+      exit(1);
+   }
+
+   test_counts( fent, 1, 0 );
+
+   // the last reference destroys it
+   rc = fskit_close( core, fh2 );
+   if( rc != 0 || num_destroyed != 1 ) {
+      fskit_error("fskit_close rc = %d, num_destroyed = %d\n", rc, num_destroyed );
+      exit(1);
+   }
+
+   fskit_print_tree( stdout, fskit_core_get_root( core ) );
+
+   rc = fskit_test_end( core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   return 0;
+}
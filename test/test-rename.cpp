@@ -21,6 +21,30 @@
 
 #include "test-rename.h"
 
+void check_rename( struct fskit_core* core, char const* old_path, char const* new_path, int expected ) {
+
+   int rc = fskit_rename( core, old_path, new_path, 0, 0 );
+   if( rc != expected ) {
+      fskit_error("fskit_rename('%s', '%s') rc = %d, expected %d\n", old_path, new_path, rc, expected );
+      exit(1);
+   }
+}
+
+// check that path resolves (expected == 0) or doesn't (expected < 0)
+void check_resolve( struct fskit_core* core, char const* path, int expected ) {
+
+   int rc = 0;
+   struct fskit_entry* fent = fskit_entry_resolve_path( core, path, 0, 0, false, &rc );
+   if( fent != NULL ) {
+      fskit_entry_unlock( fent );
+   }
+
+   if( rc != expected ) {
+      fskit_error("fskit_entry_resolve_path('%s') rc = %d, expected %d\n", path, rc, expected );
+      exit(1);
+   }
+}
+
 int main( int argc, char** argv ) {
 
    struct fskit_core* core = NULL;
@@ -129,6 +153,49 @@ int main( int argc, char** argv ) {
    printf("Rename /d/a$i to /a$i\n");
    fskit_print_tree( stdout, fskit_core_get_root( core ) );
 
+   // replace a file in the same directory
+   check_rename( core, "/a0", "/a1", 0 );
+   check_resolve( core, "/a0", -ENOENT );
+   check_resolve( core, "/a1", 0 );
+
+   // replace an empty directory in the same directory
+   check_rename( core, "/d0", "/d1", 0 );
+   check_resolve( core, "/d0", -ENOENT );
+   check_resolve( core, "/d1", 0 );
+
+   // a directory can't be moved below itself
+   if( fskit_mkdir( core, "/p", 0755, 0, 0 ) != 0 || fskit_mkdir( core, "/p/q", 0755, 0, 0 ) != 0 || fskit_mkdir( core, "/p/q/r", 0755, 0, 0 ) != 0 ) {
+      fskit_error("%s", "failed to make /p/q/r\n");
+      exit(1);
+   }
+
+   check_rename( core, "/p", "/p/x", -EINVAL );
+   check_rename( core, "/p", "/p/q/r/x", -EINVAL );
+   check_rename( core, "/p/q", "/p/q/r/x", -EINVAL );
+
+   // ...or replace one of its ancestors
+   check_rename( core, "/p/q/r", "/p", -ENOTEMPTY );
+
+   // moving a directory across directories updates its ancestry
+   check_rename( core, "/d2", "/p/q/d2", 0 );
+   check_resolve( core, "/p/q/d2/../r", 0 );
+
+   if( fskit_mkdir( core, "/p/q/s", 0755, 0, 0 ) != 0 ) {
+      fskit_error("%s", "failed to make /p/q/s\n");
+      exit(1);
+   }
+
+   check_rename( core, "/p/q", "/d3/q", 0 );
+   check_resolve( core, "/d3/q/r", 0 );
+   check_resolve( core, "/p/q", -ENOENT );
+
+   check_rename( core, "/d3", "/d3/q/d2/x", -EINVAL );
+   check_rename( core, "/p", "/d3/q/p", 0 );
+   check_rename( core, "/d3/q", "/d3/q/p/q", -EINVAL );
+
+   printf("Loop checks\n");
+   fskit_print_tree( stdout, fskit_core_get_root( core ) );
+
    fskit_test_end( core, &output );
 
    return 0;
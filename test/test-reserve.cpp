@@ -0,0 +1,258 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+
+#include "test-reserve.h"
+
+#define TEST_NUM_THREADS 8
+
+static struct fskit_core* core = NULL;
+
+static int in_flight = 0;
+static int max_in_flight = 0;
+
+// is name listed in /test-dir?
+bool is_listed( char const* name ) {
+
+   uint64_t num_read = 0;
+   bool found = false;
+   int rc = 0;
+
+   struct fskit_dir_handle* dh = fskit_opendir( core, "/test-dir", 0, 0, &rc );
+   if( dh == NULL ) {
+      fskit_error("fskit_opendir rc = %d\n", rc );
+      exit(1);
+   }
+
+   struct fskit_dir_entry** dents = fskit_listdir( core, dh, &num_read, &rc );
+   if( dents == NULL ) {
+      fskit_error("fskit_listdir rc = %d\n", rc );
+      exit(1);
+   }
+
+   for( uint64_t i = 0; i < num_read; i++ ) {
+      if( strcmp( dents[i]->name, name ) == 0 ) {
+         found = true;
+      }
+   }
+
+   fskit_dir_entry_free_list( dents );
+   fskit_closedir( core, dh );
+
+   return found;
+}
+
+// make sure path does not resolve
+void check_absent( char const* path ) {
+
+   int rc = 0;
+
+   struct fskit_entry* fent = fskit_entry_resolve_path( core, path, 0, 0, false, &rc );
+   if( fent != NULL || rc != -ENOENT ) {
+      fskit_error("fskit_entry_resolve_path('%s') rc = %d, expected %d\n", path, rc, -ENOENT );
+      exit(1);
+   }
+}
+
+// the entry being created must not be visible yet
+void check_reserved( char const* path ) {
+
+   check_absent( path );
+
+   char* name = fskit_basename( path, NULL );
+   if( is_listed( name ) ) {
+      fskit_error("'%s' listed during create\n", path );
+      exit(1);
+   }
+
+   free( name );
+}
+
+// slow backend: count how many of these overlap
+int slow_create_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, mode_t mode, void** inode_data, void** handle_data ) {
+
+   int cur = __atomic_add_fetch( &in_flight, 1, __ATOMIC_SEQ_CST );
+   int max = __atomic_load_n( &max_in_flight, __ATOMIC_SEQ_CST );
+
+   while( cur > max && !__atomic_compare_exchange_n( &max_in_flight, &max, cur, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ) );
+
+   usleep( 20000 );
+
+   __atomic_sub_fetch( &in_flight, 1, __ATOMIC_SEQ_CST );
+   return 0;
+}
+
+// failing backend
+int fail_create_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, mode_t mode, void** inode_data, void** handle_data ) {
+   return -EIO;
+}
+
+// backend that uses the directory it's creating in.  This would deadlock if the parent were still locked.
+int nested_create_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, mode_t mode, void** inode_data, void** handle_data ) {
+
+   int rc = 0;
+
+   check_reserved( fskit_route_metadata_get_path( route_metadata ) );
+
+   struct fskit_file_handle* fh = fskit_create( core, "/test-dir/inner-file", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('/test-dir/inner-file') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+   return 0;
+}
+
+int nested_mkdir_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* dent, mode_t mode, void** inode_data ) {
+
+   check_reserved( fskit_route_metadata_get_path( route_metadata ) );
+
+   int rc = fskit_mknod( core, "/test-dir/inner-node", S_IFIFO | 0644, 0, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mknod('/test-dir/inner-node') rc = %d\n", rc );
+      exit(1);
+   }
+
+   return 0;
+}
+
+// create one slow file
+void* slow_create_thread( void* arg ) {
+
+   long id = (long)arg;
+   char path[PATH_MAX+1];
+   int rc = 0;
+
+   snprintf( path, PATH_MAX, "/test-dir/slow-%ld", id );
+
+   struct fskit_file_handle* fh = fskit_create( core, path, 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+   return NULL;
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_file_handle* fh = NULL;
+   pthread_t threads[TEST_NUM_THREADS];
+   struct stat sb;
+   char path[PATH_MAX+1];
+   int rc = 0;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = fskit_mkdir( core, "/test-dir", 0755, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir rc = %d\n", rc );
+      exit(1);
+   }
+
+   if( fskit_route_create( core, "^/test-dir/slow-[0-9]+$", slow_create_cb, FSKIT_CONCURRENT ) < 0 ||
+       fskit_route_create( core, "^/test-dir/fail-file$", fail_create_cb, FSKIT_CONCURRENT ) < 0 ||
+       fskit_route_create( core, "^/test-dir/nested-file$", nested_create_cb, FSKIT_CONCURRENT ) < 0 ||
+       fskit_route_mkdir( core, "^/test-dir/nested-dir$", nested_mkdir_cb, FSKIT_CONCURRENT ) < 0 ) {
+
+      fskit_error("%s", "failed to install routes\n" );
+      exit(1);
+   }
+
+   // creates of different names in one directory overlap
+   for( long i = 0; i < TEST_NUM_THREADS; i++ ) {
+      pthread_create( &threads[i], NULL, slow_create_thread, (void*)i );
+   }
+
+   for( int i = 0; i < TEST_NUM_THREADS; i++ ) {
+      pthread_join( threads[i], NULL );
+   }
+
+   if( max_in_flight < 2 ) {
+      fskit_error("create routes did not overlap (max in flight = %d)\n", max_in_flight );
+      exit(1);
+   }
+
+   for( int i = 0; i < TEST_NUM_THREADS; i++ ) {
+
+      snprintf( path, PATH_MAX, "/test-dir/slow-%d", i );
+
+      rc = fskit_stat( core, path, 0, 0, &sb );
+      if( rc != 0 ) {
+         fskit_error("fskit_stat('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+   }
+
+   // routes can use the directory they create in, and don't see their own entries yet
+   fh = fskit_create( core, "/test-dir/nested-file", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('/test-dir/nested-file') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   rc = fskit_mkdir( core, "/test-dir/nested-dir", 0755, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir('/test-dir/nested-dir') rc = %d\n", rc );
+      exit(1);
+   }
+
+   if( !is_listed( "nested-file" ) || !is_listed( "inner-file" ) || !is_listed( "nested-dir" ) || !is_listed( "inner-node" ) ) {
+      fskit_error("%s", "missing nested entries\n" );
+      exit(1);
+   }
+
+   // a failed create leaves nothing behind, and the name can be used again
+   fh = fskit_create( core, "/test-dir/fail-file", 0, 0, 0644, &rc );
+   if( fh != NULL || rc != -EIO ) {
+      fskit_error("fskit_create('/test-dir/fail-file') rc = %d, expected %d\n", rc, -EIO );
+      exit(1);
+   }
+
+   check_absent( "/test-dir/fail-file" );
+
+   if( is_listed( "fail-file" ) ) {
+      fskit_error("%s", "'fail-file' listed after failed create\n" );
+      exit(1);
+   }
+
+   rc = fskit_mkdir( core, "/test-dir/fail-file", 0755, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir('/test-dir/fail-file') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_print_tree( stdout, fskit_core_get_root( core ) );
+
+   rc = fskit_test_end( core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   return 0;
+}
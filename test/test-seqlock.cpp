@@ -0,0 +1,200 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-seqlock.h"
+
+#define TEST_NUM_READERS 4
+#define TEST_NUM_UPDATES 20000
+#define TEST_NUM_WRITERS 8
+#define TEST_NUM_WRITES 20000
+
+static int done = 0;
+static bool check_times = true;        // whether stats must see atime == mtime
+static struct fskit_core* g_core = NULL;
+
+// set atime and mtime to the same value over and over, so a consistent stat always sees them equal
+void* utimes_thread( void* arg ) {
+
+   struct fskit_core* core = (struct fskit_core*)arg;
+   struct timeval times[2];
+   int rc = 0;
+
+   for( int i = 1; i <= TEST_NUM_UPDATES; i++ ) {
+
+      times[0].tv_sec = i;
+      times[0].tv_usec = i % 1000000;
+      times[1] = times[0];
+
+      rc = fskit_utimes( core, "/test-file", 0, 0, times );
+      if( rc != 0 ) {
+         fskit_error("fskit_utimes rc = %d\n", rc );
+         exit(1);
+      }
+   }
+
+   __atomic_store_n( &done, 1, __ATOMIC_SEQ_CST );
+   return NULL;
+}
+
+int write_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+   return buflen;
+}
+
+// write through a shared handle.  The write route is FSKIT_CONCURRENT, so the writes' continuations update the
+// file's attributes at the same time, without the entry locked.
+void* write_thread( void* arg ) {
+
+   struct fskit_file_handle* fh = (struct fskit_file_handle*)arg;
+   ssize_t rc = 0;
+
+   for( int i = 0; i < TEST_NUM_WRITES; i++ ) {
+
+      rc = fskit_write( g_core, fh, "a", 1, i );
+      if( rc != 1 ) {
+         fskit_error("fskit_write rc = %zd\n", rc );
+         exit(1);
+      }
+   }
+
+   return NULL;
+}
+
+// stat the file while it changes, and make sure no update is seen half-done
+void* stat_thread( void* arg ) {
+
+   struct fskit_core* core = (struct fskit_core*)arg;
+   struct stat sb;
+   int rc = 0;
+
+   while( !__atomic_load_n( &done, __ATOMIC_SEQ_CST ) ) {
+
+      rc = fskit_stat( core, "/test-file", 0, 0, &sb );
+      if( rc != 0 ) {
+         fskit_error("fskit_stat rc = %d\n", rc );
+         exit(1);
+      }
+
+      if( check_times && (sb.st_atim.tv_sec != sb.st_mtim.tv_sec || sb.st_atim.tv_nsec != sb.st_mtim.tv_nsec) ) {
+         fskit_error("torn stat: atime = %ld.%09ld, mtime = %ld.%09ld\n", (long)sb.st_atim.tv_sec, (long)sb.st_atim.tv_nsec, (long)sb.st_mtim.tv_sec, (long)sb.st_mtim.tv_nsec );
+         exit(1);
+      }
+   }
+
+   return NULL;
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   pthread_t writer;
+   pthread_t writers[TEST_NUM_WRITERS];
+   pthread_t readers[TEST_NUM_READERS];
+   struct stat sb;
+   int rc = 0;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   fh = fskit_create( core, "/test-file", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create rc = %d\n", rc );
+      exit(1);
+   }
+
+   // start with atime == mtime
+   rc = fskit_utimes( core, "/test-file", 0, 0, NULL );
+   if( rc != 0 ) {
+      fskit_error("fskit_utimes rc = %d\n", rc );
+      exit(1);
+   }
+
+   for( int i = 0; i < TEST_NUM_READERS; i++ ) {
+      pthread_create( &readers[i], NULL, stat_thread, core );
+   }
+
+   pthread_create( &writer, NULL, utimes_thread, core );
+
+   pthread_join( writer, NULL );
+   for( int i = 0; i < TEST_NUM_READERS; i++ ) {
+      pthread_join( readers[i], NULL );
+   }
+
+   // the last update is visible
+   rc = fskit_fstat( core, "/test-file", fskit_file_handle_get_entry( fh ), &sb );
+   if( rc != 0 || sb.st_mtim.tv_sec != TEST_NUM_UPDATES || sb.st_mtim.tv_nsec != (TEST_NUM_UPDATES % 1000000) * 1000 ) {
+      fskit_error("fskit_fstat rc = %d, mtime = %ld.%09ld\n", rc, (long)sb.st_mtim.tv_sec, (long)sb.st_mtim.tv_nsec );
+      exit(1);
+   }
+
+   g_core = core;
+
+   // concurrent writers must leave the attributes consistent, or stat would wait on them forever
+   rc = fskit_route_write( core, "/.*", write_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_write rc = %d\n", rc );
+      exit(1);
+   }
+
+   // (writes take the time for each of atime and mtime separately)
+   check_times = false;
+   __atomic_store_n( &done, 0, __ATOMIC_SEQ_CST );
+
+   for( int i = 0; i < TEST_NUM_READERS; i++ ) {
+      pthread_create( &readers[i], NULL, stat_thread, core );
+   }
+
+   for( int i = 0; i < TEST_NUM_WRITERS; i++ ) {
+      pthread_create( &writers[i], NULL, write_thread, fh );
+   }
+
+   for( int i = 0; i < TEST_NUM_WRITERS; i++ ) {
+      pthread_join( writers[i], NULL );
+   }
+
+   __atomic_store_n( &done, 1, __ATOMIC_SEQ_CST );
+   for( int i = 0; i < TEST_NUM_READERS; i++ ) {
+      pthread_join( readers[i], NULL );
+   }
+
+   rc = fskit_stat( core, "/test-file", 0, 0, &sb );
+   if( rc != 0 || sb.st_size != TEST_NUM_WRITES ) {
+      fskit_error("fskit_stat rc = %d, size = %jd\n", rc, (intmax_t)sb.st_size );
+      exit(1);
+   }
+
+   rc = fskit_close( core, fh );
+   if( rc != 0 ) {
+      fskit_error("fskit_close rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_print_tree( stdout, fskit_core_get_root( core ) );
+
+   rc = fskit_test_end( core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   return 0;
+}
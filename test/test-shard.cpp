@@ -0,0 +1,266 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+
+#include "test-shard.h"
+
+#define TEST_NUM_SHARDS 8
+#define TEST_NUM_THREADS 8
+#define TEST_FILES_PER_THREAD 200
+#define TEST_NUM_FILES (TEST_NUM_THREADS * TEST_FILES_PER_THREAD)
+
+static struct fskit_core* core = NULL;
+
+// create this thread's files in /test-dir, and unlink every other one
+void* create_unlink_thread( void* arg ) {
+
+   long id = (long)arg;
+   char path[PATH_MAX+1];
+   int rc = 0;
+
+   for( int i = 0; i < TEST_FILES_PER_THREAD; i++ ) {
+
+      snprintf( path, PATH_MAX, "/test-dir/file-%ld-%d", id, i );
+
+      struct fskit_file_handle* fh = fskit_create( core, path, 0, 0, 0644, &rc );
+      if( fh == NULL ) {
+         fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+
+      fskit_close( core, fh );
+   }
+
+   for( int i = 0; i < TEST_FILES_PER_THREAD; i += 2 ) {
+
+      snprintf( path, PATH_MAX, "/test-dir/file-%ld-%d", id, i );
+
+      rc = fskit_unlink( core, path, 0, 0 );
+      if( rc != 0 ) {
+         fskit_error("fskit_unlink('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+   }
+
+   return NULL;
+}
+
+// list /test-dir with fskit_getdents, checking that entries come in cookie order.
+// return the number of entries, and set *found if name is among them
+int list_dir( char const* name, bool* found ) {
+
+   uint64_t buf[64];
+   uint64_t cookie = FSKIT_DIR_COOKIE_START;
+   int count = 0;
+   int rc = 0;
+
+   *found = false;
+
+   struct fskit_dir_handle* dh = fskit_opendir( core, "/test-dir", 0, 0, &rc );
+   if( dh == NULL ) {
+      fskit_error("fskit_opendir rc = %d\n", rc );
+      exit(1);
+   }
+
+   while( true ) {
+
+      ssize_t len = fskit_getdents( core, dh, cookie, (char*)buf, sizeof(buf) );
+      if( len < 0 ) {
+         fskit_error("fskit_getdents rc = %zd\n", len );
+         exit(1);
+      }
+
+      if( len == 0 ) {
+         break;
+      }
+
+      for( ssize_t off = 0; off < len; ) {
+
+         struct fskit_dirent64* rec = (struct fskit_dirent64*)((char*)buf + off);
+
+         if( rec->cookie <= cookie ) {
+            fskit_error("'%s' out of order: cookie %" PRIu64 " after %" PRIu64 "\n", rec->name, rec->cookie, cookie );
+            exit(1);
+         }
+
+         if( strcmp( rec->name, name ) == 0 ) {
+            *found = true;
+         }
+
+         cookie = rec->cookie;
+         off += rec->reclen;
+         count++;
+      }
+   }
+
+   fskit_closedir( core, dh );
+   return count;
+}
+
+// make sure a listing has the given size, and does or does not have the given name
+void check_listing( int expected_count, char const* name, bool expected_found ) {
+
+   bool found = false;
+   int count = list_dir( name, &found );
+
+   if( count != expected_count || found != expected_found ) {
+      fskit_error("listed %d entries (expected %d), '%s' found = %d (expected %d)\n", count, expected_count, name, found, expected_found );
+      exit(1);
+   }
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_file_handle* fh = NULL;
+   struct fskit_entry* dir = NULL;
+   struct fskit_dir_handle* dh = NULL;
+   struct fskit_dir_entry** dents = NULL;
+   pthread_t threads[TEST_NUM_THREADS];
+   struct stat sb;
+   char path[PATH_MAX+1];
+   uint64_t num_read = 0;
+   int rc = 0;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = fskit_mkdir( core, "/test-dir", 0755, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir rc = %d\n", rc );
+      exit(1);
+   }
+
+   // an existing child gets moved into its shard
+   fh = fskit_create( core, "/test-dir/existing-file", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   dir = fskit_entry_resolve_path( core, "/test-dir", 0, 0, true, &rc );
+   if( dir == NULL ) {
+      fskit_error("fskit_entry_resolve_path rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_entry_enable_shards( dir, TEST_NUM_SHARDS );
+   fskit_entry_unlock( dir );
+
+   if( rc != 0 ) {
+      fskit_error("fskit_entry_enable_shards rc = %d\n", rc );
+      exit(1);
+   }
+
+   check_listing( 3, "existing-file", true );
+
+   rc = fskit_stat( core, "/test-dir/existing-file", 0, 0, &sb );
+   if( rc != 0 ) {
+      fskit_error("fskit_stat rc = %d\n", rc );
+      exit(1);
+   }
+
+   // create and unlink from many threads at once
+   for( long i = 0; i < TEST_NUM_THREADS; i++ ) {
+      pthread_create( &threads[i], NULL, create_unlink_thread, (void*)i );
+   }
+
+   for( int i = 0; i < TEST_NUM_THREADS; i++ ) {
+      pthread_join( threads[i], NULL );
+   }
+
+   // every other file is left, plus existing-file, ., and ..
+   check_listing( TEST_NUM_FILES / 2 + 3, "file-0-1", true );
+   check_listing( TEST_NUM_FILES / 2 + 3, "file-0-0", false );
+
+   // lookups go through the shards
+   for( int i = 0; i < TEST_NUM_THREADS; i++ ) {
+
+      snprintf( path, PATH_MAX, "/test-dir/file-%d-%d", i, TEST_FILES_PER_THREAD - 1 );
+
+      rc = fskit_stat( core, path, 0, 0, &sb );
+      if( rc != 0 ) {
+         fskit_error("fskit_stat('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+   }
+
+   // fskit_readdir merges the shards too
+   dh = fskit_opendir( core, "/test-dir", 0, 0, &rc );
+   if( dh == NULL ) {
+      fskit_error("fskit_opendir rc = %d\n", rc );
+      exit(1);
+   }
+
+   uint64_t total = 0;
+   while( true ) {
+
+      dents = fskit_readdir( core, dh, 37, &num_read, &rc );
+      if( rc != 0 ) {
+         fskit_error("fskit_readdir rc = %d\n", rc );
+         exit(1);
+      }
+
+      if( dents == NULL ) {
+         break;
+      }
+
+      total += num_read;
+      fskit_dir_entry_free_list( dents );
+   }
+
+   fskit_closedir( core, dh );
+
+   if( total != TEST_NUM_FILES / 2 + 3 ) {
+      fskit_error("fskit_readdir read %" PRIu64 " entries, expected %d\n", total, TEST_NUM_FILES / 2 + 3 );
+      exit(1);
+   }
+
+   // renames within the directory move names between shards
+   rc = fskit_rename( core, "/test-dir/existing-file", "/test-dir/renamed-file", 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_rename rc = %d\n", rc );
+      exit(1);
+   }
+
+   check_listing( TEST_NUM_FILES / 2 + 3, "renamed-file", true );
+   check_listing( TEST_NUM_FILES / 2 + 3, "existing-file", false );
+
+   // a non-empty sharded directory can't be removed
+   rc = fskit_rmdir( core, "/test-dir", 0, 0 );
+   if( rc != -ENOTEMPTY ) {
+      fskit_error("fskit_rmdir rc = %d, expected %d\n", rc, -ENOTEMPTY );
+      exit(1);
+   }
+
+   fskit_print_tree( stdout, fskit_core_get_root( core ) );
+
+   // tearing down the filesystem reaches every shard
+   rc = fskit_test_end( core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   return 0;
+}
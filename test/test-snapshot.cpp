@@ -0,0 +1,197 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+
+#include "test-snapshot.h"
+
+#define TEST_NUM_FILES 50
+
+// list a snapshot, a few records at a time.
+// return the number of entries, and set *found if name is among them
+int list_snapshot( struct fskit_dir_snapshot* snap, char const* name, bool* found ) {
+
+   uint64_t buf[16];
+   uint64_t cookie = FSKIT_DIR_COOKIE_START;
+   int count = 0;
+
+   *found = false;
+
+   while( true ) {
+
+      ssize_t len = fskit_dir_snapshot_getdents( snap, cookie, (char*)buf, sizeof(buf) );
+      if( len < 0 ) {
+         fskit_error("fskit_dir_snapshot_getdents rc = %zd\n", len );
+         exit(1);
+      }
+
+      if( len == 0 ) {
+         break;
+      }
+
+      for( ssize_t off = 0; off < len; ) {
+
+         struct fskit_dirent64* rec = (struct fskit_dirent64*)((char*)buf + off);
+
+         if( rec->cookie <= cookie ) {
+            fskit_error("'%s' out of order: cookie %" PRIu64 " after %" PRIu64 "\n", rec->name, rec->cookie, cookie );
+            exit(1);
+         }
+
+         if( strcmp( rec->name, name ) == 0 ) {
+            *found = true;
+         }
+
+         cookie = rec->cookie;
+         off += rec->reclen;
+         count++;
+      }
+   }
+
+   return count;
+}
+
+// make sure a snapshot has the given size, and does or does not have the given name
+void check_snapshot( struct fskit_dir_snapshot* snap, int expected_count, char const* name, bool expected_found ) {
+
+   bool found = false;
+   int count = list_snapshot( snap, name, &found );
+
+   if( count != expected_count || (uint64_t)count != fskit_dir_snapshot_count( snap ) || found != expected_found ) {
+      fskit_error("listed %d entries (expected %d, count %" PRIu64 "), '%s' found = %d (expected %d)\n", count, expected_count, fskit_dir_snapshot_count( snap ), name, found, expected_found );
+      exit(1);
+   }
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   struct fskit_entry* dir = NULL;
+   struct fskit_dir_handle* dh = NULL;
+   struct fskit_dir_snapshot* before = NULL;
+   struct fskit_dir_snapshot* after = NULL;
+   char path[PATH_MAX+1];
+   int rc = 0;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = fskit_mkdir( core, "/test-dir", 0755, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir rc = %d\n", rc );
+      exit(1);
+   }
+
+   for( int i = 0; i < TEST_NUM_FILES; i++ ) {
+
+      snprintf( path, PATH_MAX, "/test-dir/file-%d", i );
+
+      fh = fskit_create( core, path, 0, 0, 0644, &rc );
+      if( fh == NULL ) {
+         fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+
+      fskit_close( core, fh );
+   }
+
+   dir = fskit_entry_resolve_path( core, "/test-dir", 0, 0, true, &rc );
+   if( dir == NULL ) {
+      fskit_error("fskit_entry_resolve_path rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_entry_enable_snapshots( dir );
+   fskit_entry_unlock( dir );
+
+   if( rc != 0 ) {
+      fskit_error("fskit_entry_enable_snapshots rc = %d\n", rc );
+      exit(1);
+   }
+
+   dh = fskit_opendir( core, "/test-dir", 0, 0, &rc );
+   if( dh == NULL ) {
+      fskit_error("fskit_opendir rc = %d\n", rc );
+      exit(1);
+   }
+
+   before = fskit_dir_snapshot_get( core, dh, &rc );
+   if( before == NULL ) {
+      fskit_error("fskit_dir_snapshot_get rc = %d\n", rc );
+      exit(1);
+   }
+
+   check_snapshot( before, TEST_NUM_FILES + 2, "file-0", true );
+
+   // change the directory while the snapshot is held
+   fh = fskit_create( core, "/test-dir/new-file", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   rc = fskit_unlink( core, "/test-dir/file-0", 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_unlink rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_rename( core, "/test-dir/file-1", "/test-dir/renamed-file", 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_rename rc = %d\n", rc );
+      exit(1);
+   }
+
+   // the old snapshot doesn't see any of it...
+   check_snapshot( before, TEST_NUM_FILES + 2, "file-0", true );
+   check_snapshot( before, TEST_NUM_FILES + 2, "file-1", true );
+   check_snapshot( before, TEST_NUM_FILES + 2, "new-file", false );
+
+   // ...but a new one sees all of it
+   after = fskit_dir_snapshot_get( core, dh, &rc );
+   if( after == NULL ) {
+      fskit_error("fskit_dir_snapshot_get rc = %d\n", rc );
+      exit(1);
+   }
+
+   check_snapshot( after, TEST_NUM_FILES + 2, "file-0", false );
+   check_snapshot( after, TEST_NUM_FILES + 2, "file-1", false );
+   check_snapshot( after, TEST_NUM_FILES + 2, "new-file", true );
+   check_snapshot( after, TEST_NUM_FILES + 2, "renamed-file", true );
+
+   fskit_dir_snapshot_put( before );
+   fskit_dir_snapshot_put( after );
+
+   fskit_closedir( core, dh );
+
+   fskit_print_tree( stdout, fskit_core_get_root( core ) );
+
+   rc = fskit_test_end( core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   return 0;
+}
@@ -0,0 +1,318 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-subtree.h"
+
+// which stat callback ran last
+static char last_stat = 0;
+
+int stat_cb_regex( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, struct stat* sb ) {
+   __atomic_store_n( &last_stat, 'r', __ATOMIC_RELAXED );
+   return 0;
+}
+
+int stat_cb_a( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, struct stat* sb ) {
+   __atomic_store_n( &last_stat, 'a', __ATOMIC_RELAXED );
+   return 0;
+}
+
+int stat_cb_sub( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, struct stat* sb ) {
+   __atomic_store_n( &last_stat, 's', __ATOMIC_RELAXED );
+   return 0;
+}
+
+int read_cb_a( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+   memset( buf, 'a', buflen );
+   return (int)buflen;
+}
+
+// set when the stat threads should stop 
+static volatile int stat_done = 0;
+
+// stat entries in a bound subtree while the main thread rebinds and moves it
+void* stat_main( void* arg ) {
+
+   struct fskit_core* core = (struct fskit_core*)arg;
+   struct stat sb;
+
+   while( !__atomic_load_n( &stat_done, __ATOMIC_ACQUIRE ) ) {
+
+      // may be mid-rename
+      fskit_stat( core, "/tenants/a/sub/deep", 0, 0, &sb );
+      fskit_stat( core, "/other/deep", 0, 0, &sb );
+      fskit_stat( core, "/tenants/a/sub/file", 0, 0, &sb );
+   }
+
+   return NULL;
+}
+
+// stat a path, and check which route handled it 
+void test_stat( struct fskit_core* core, char const* path, char expected ) {
+
+   struct stat sb;
+   last_stat = 0;
+
+   int rc = fskit_stat( core, path, 0, 0, &sb );
+   if( rc != 0 ) {
+      fskit_error("fskit_stat('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   if( last_stat != expected ) {
+      fskit_error("stat('%s') handled by '%c' (expected '%c')\n", path, last_stat, expected );
+      exit(1);
+   }
+}
+
+// look up a directory, and don't keep it locked 
+struct fskit_entry* test_lookup( struct fskit_core* core, char const* path ) {
+
+   int rc = 0;
+   struct fskit_entry* fent = fskit_entry_resolve_path( core, path, 0, 0, false, &rc );
+   if( fent == NULL ) {
+      fskit_error("fskit_entry_resolve_path('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   fskit_entry_unlock( fent );
+   return fent;
+}
+
+// bind a stat route to a subtree 
+int test_bind_stat( struct fskit_core* core, char const* path, fskit_entry_route_stat_callback_t stat_cb ) {
+
+   struct fskit_route_opts opts;
+   fskit_route_opts_init( &opts );
+   opts.subtree = test_lookup( core, path );
+
+   return fskit_route_stat_ex( core, NULL, stat_cb, FSKIT_CONCURRENT, &opts );
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_core* other_core = NULL;
+   pthread_t stat_threads[4];
+   int route_deep = 0;
+   struct fskit_file_handle* fh = NULL;
+   struct fskit_route_opts opts;
+   int rc = 0;
+   int route_a = 0;
+   char buf[10];
+   char const* dirs[] = {
+      "/tenants",
+      "/tenants/a",
+      "/tenants/a/sub",
+      "/tenants/b",
+      "/other",
+      NULL
+   };
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   for( int i = 0; dirs[i] != NULL; i++ ) {
+
+      rc = fskit_mkdir( core, dirs[i], 0755, 0, 0 );
+      if( rc != 0 ) {
+         fskit_error("fskit_mkdir('%s') rc = %d\n", dirs[i], rc );
+         exit(1);
+      }
+   }
+
+   rc = fskit_route_stat( core, FSKIT_ROUTE_ANY, stat_cb_regex, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_stat rc = %d\n", rc );
+      exit(1);
+   }
+
+   route_a = test_bind_stat( core, "/tenants/a", stat_cb_a );
+   if( route_a < 0 ) {
+      fskit_error("bind /tenants/a rc = %d\n", route_a );
+      exit(1);
+   }
+
+   // one route per type per directory 
+   rc = test_bind_stat( core, "/tenants/a", stat_cb_sub );
+   if( rc != -EEXIST ) {
+      fskit_error("bind /tenants/a again rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = test_bind_stat( core, "/tenants/a/sub", stat_cb_sub );
+   if( rc < 0 ) {
+      fskit_error("bind /tenants/a/sub rc = %d\n", rc );
+      exit(1);
+   }
+
+   // entries created after binding inherit it
+   rc = fskit_mkdir( core, "/tenants/a/late", 0755, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir rc = %d\n", rc );
+      exit(1);
+   }
+
+   fh = fskit_create( core, "/tenants/a/sub/file", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   // nearest bound ancestor wins, and bound routes take precedence over regexes
+   test_stat( core, "/tenants/a", 'a' );
+   test_stat( core, "/tenants/a/late", 'a' );
+   test_stat( core, "/tenants/a/sub", 's' );
+   test_stat( core, "/tenants/a/sub/file", 's' );
+   test_stat( core, "/tenants/b", 'r' );
+   test_stat( core, "/tenants", 'r' );
+   test_stat( core, "/other", 'r' );
+
+   // routes follow entries across renames
+   rc = fskit_rename( core, "/tenants/a/sub/file", "/tenants/b/file", 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_rename rc = %d\n", rc );
+      exit(1);
+   }
+
+   test_stat( core, "/tenants/b/file", 'r' );
+
+   rc = fskit_rename( core, "/tenants/b", "/tenants/a/b", 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_rename rc = %d\n", rc );
+      exit(1);
+   }
+
+   test_stat( core, "/tenants/a/b", 'a' );
+   test_stat( core, "/tenants/a/b/file", 'a' );
+
+   // I/O on open handles uses bound routes too
+   fskit_route_opts_init( &opts );
+   opts.subtree = test_lookup( core, "/tenants/a" );
+
+   rc = fskit_route_read_ex( core, NULL, read_cb_a, FSKIT_CONCURRENT, &opts );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_read_ex rc = %d\n", rc );
+      exit(1);
+   }
+
+   fh = fskit_open( core, "/tenants/a/b/file", 0, 0, O_RDONLY, 0, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_open rc = %d\n", rc );
+      exit(1);
+   }
+
+   memset( buf, 0, 10 );
+   rc = fskit_read( core, fh, buf, 10, 0 );
+   if( rc != 10 || buf[0] != 'a' ) {
+      fskit_error("fskit_read rc = %d, buf[0] = '%c'\n", rc, buf[0] );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   // only directories can be bound 
+   fskit_route_opts_init( &opts );
+   opts.subtree = test_lookup( core, "/tenants/a/b/file" );
+
+   rc = fskit_route_stat_ex( core, NULL, stat_cb_a, FSKIT_CONCURRENT, &opts );
+   if( rc != -ENOTDIR ) {
+      fskit_error("bind file rc = %d\n", rc );
+      exit(1);
+   }
+
+   // unbinding falls back to the next route
+   rc = fskit_unroute_stat( core, route_a );
+   if( rc != 0 ) {
+      fskit_error("fskit_unroute_stat rc = %d\n", rc );
+      exit(1);
+   }
+
+   test_stat( core, "/tenants/a/b/file", 'r' );
+   test_stat( core, "/tenants/a/sub", 's' );
+
+   // bound routes belong to their core: another core with the same tree only sees its own routes
+   other_core = fskit_core_new();
+   if( other_core == NULL ) {
+      exit(1);
+   }
+
+   rc = fskit_core_init( other_core, NULL );
+   check_rc( "fskit_core_init", rc, 0 );
+
+   check_rc( "fskit_mkdir", fskit_mkdir( other_core, "/tenants", 0755, 0, 0 ), 0 );
+   check_rc( "fskit_mkdir", fskit_mkdir( other_core, "/tenants/a", 0755, 0, 0 ), 0 );
+
+   rc = fskit_route_stat( other_core, FSKIT_ROUTE_ANY, stat_cb_regex, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_stat rc = %d\n", rc );
+      exit(1);
+   }
+
+   test_stat( other_core, "/tenants/a", 'r' );
+
+   // dispatch walks scopes without locking them, while they are rebound, moved, and destroyed
+   check_rc( "fskit_mkdir", fskit_mkdir( core, "/tenants/a/sub/deep", 0755, 0, 0 ), 0 );
+
+   for( int i = 0; i < 4; i++ ) {
+      pthread_create( &stat_threads[i], NULL, stat_main, core );
+   }
+
+   for( int i = 0; i < 200; i++ ) {
+
+      route_deep = test_bind_stat( core, "/tenants/a/sub/deep", stat_cb_a );
+      if( route_deep < 0 ) {
+         fskit_error("bind /tenants/a/sub/deep rc = %d\n", route_deep );
+         exit(1);
+      }
+
+      check_rc( "fskit_rename", fskit_rename( core, "/tenants/a/sub/deep", "/other/deep", 0, 0 ), 0 );
+      check_rc( "fskit_unroute_stat", fskit_unroute_stat( core, route_deep ), 0 );
+      check_rc( "fskit_rmdir", fskit_rmdir( core, "/other/deep", 0, 0 ), 0 );
+      check_rc( "fskit_mkdir", fskit_mkdir( core, "/tenants/a/sub/deep", 0755, 0, 0 ), 0 );
+   }
+
+   __atomic_store_n( &stat_done, 1, __ATOMIC_RELEASE );
+
+   for( int i = 0; i < 4; i++ ) {
+      pthread_join( stat_threads[i], NULL );
+   }
+
+   test_stat( core, "/tenants/a/sub/deep", 's' );
+   test_stat( other_core, "/tenants/a", 'r' );
+
+   rc = fskit_test_end( other_core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   fskit_print_tree( stdout, fskit_core_get_root( core ) );
+
+   rc = fskit_test_end( core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   return 0;
+}
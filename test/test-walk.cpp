@@ -0,0 +1,274 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+
+#include "test-walk.h"
+
+#include <set>
+#include <string>
+
+#define NUM_DIRS 8
+#define NUM_SUBDIRS 4
+#define NUM_FILES 16
+
+// what a walk saw
+struct walk_state {
+
+   pthread_mutex_t lock;
+   std::set<std::string> seen;
+
+   uint64_t total_size;
+   int max_depth;
+   int stop_after;              // stop once this many entries have been seen (if positive)
+   bool prune_odd;              // prune the odd-numbered top-level directories
+   bool unlink_tmp;             // unlink the .tmp files as they're met
+   bool fail_on_tmp;            // fail the walk with -EIO at the first .tmp file
+   int errors;
+};
+
+static struct fskit_core* g_core = NULL;
+
+int write_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+   return buflen;
+}
+
+int visitor( struct fskit_core* core, struct fskit_walk_entry const* went, void* cls ) {
+
+   struct walk_state* state = (struct walk_state*)cls;
+   std::string path( went->path );
+   int rc = FSKIT_WALK_CONTINUE;
+   size_t name_len = strlen( went->name );
+   bool is_tmp = ( name_len > 4 && strcmp( went->name + name_len - 4, ".tmp" ) == 0 );
+
+   pthread_mutex_lock( &state->lock );
+
+   // a directory is visited before anything in it
+   if( went->depth > 0 ) {
+
+      std::string parent = path.substr( 0, path.rfind( '/' ) );
+      if( parent.empty() ) {
+         parent = "/";
+      }
+
+      if( state->seen.count( parent ) == 0 ) {
+         fskit_error("'%s' visited before its directory '%s'\n", went->path, parent.c_str() );
+         state->errors++;
+      }
+   }
+
+   if( state->seen.count( path ) != 0 ) {
+      fskit_error("'%s' visited twice\n", went->path );
+      state->errors++;
+   }
+
+   if( path.compare( path.size() - name_len, name_len, went->name ) != 0 ) {
+      fskit_error("'%s' has name '%s'\n", went->path, went->name );
+      state->errors++;
+   }
+
+   state->seen.insert( path );
+   state->total_size += went->sb.st_size;
+
+   if( went->depth > state->max_depth ) {
+      state->max_depth = went->depth;
+   }
+
+   if( state->stop_after > 0 && (int)state->seen.size() >= state->stop_after ) {
+      rc = FSKIT_WALK_STOP;
+   }
+
+   pthread_mutex_unlock( &state->lock );
+
+   if( state->prune_odd && went->depth == 1 && S_ISDIR( went->sb.st_mode ) && (went->name[1] - '0') % 2 == 1 ) {
+      rc = FSKIT_WALK_PRUNE;
+   }
+
+   if( is_tmp && state->fail_on_tmp ) {
+      rc = -EIO;
+   }
+
+   if( is_tmp && state->unlink_tmp ) {
+
+      // nothing is locked during a visit, so we can change the tree as we go
+      int unlink_rc = fskit_unlink( core, went->path, 0, 0 );
+      if( unlink_rc != 0 ) {
+         fskit_error("fskit_unlink('%s') rc = %d\n", went->path, unlink_rc );
+         state->errors++;
+      }
+   }
+
+   return rc;
+}
+
+void state_init( struct walk_state* state ) {
+
+   pthread_mutex_init( &state->lock, NULL );
+   state->seen.clear();
+   state->total_size = 0;
+   state->max_depth = 0;
+   state->stop_after = 0;
+   state->prune_odd = false;
+   state->unlink_tmp = false;
+   state->fail_on_tmp = false;
+   state->errors = 0;
+}
+
+void check_state( char const* what, struct walk_state* state, size_t num_seen, uint64_t total_size, int max_depth ) {
+
+   if( state->errors != 0 || state->seen.size() != num_seen || state->total_size != total_size || state->max_depth != max_depth ) {
+
+      fskit_error("%s: %d errors, saw %zu entries (expected %zu), total size %" PRIu64 " (expected %" PRIu64 "), max depth %d (expected %d)\n",
+                  what, state->errors, state->seen.size(), num_seen, state->total_size, total_size, state->max_depth, max_depth );
+      exit(1);
+   }
+}
+
+// write a file with the given number of bytes
+void make_file( struct fskit_core* core, char const* path, size_t size ) {
+
+   int rc = 0;
+   char buf[256];
+
+   struct fskit_file_handle* fh = fskit_create( core, path, 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   memset( buf, 'a', sizeof(buf) );
+   if( size > 0 ) {
+      check_rc( "fskit_write", fskit_write( core, fh, buf, size, 0 ), (int)size );
+   }
+
+   fskit_close( core, fh );
+}
+
+int main( int argc, char** argv ) {
+
+   struct walk_state state;
+   char path[PATH_MAX];
+   size_t num_entries = 1;      // /w
+   uint64_t total_size = 0;
+   int thread_counts[] = { 1, 4 };
+   int rc = 0;
+
+   rc = fskit_test_begin( &g_core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   if( fskit_route_write( g_core, "/.*", write_cb, FSKIT_CONCURRENT ) < 0 ) {
+      fskit_error("%s", "failed to install routes\n" );
+      exit(1);
+   }
+
+   // /w/dI/sJ/fK, with file sizes that add up to something checkable
+   for( int i = 0; i < NUM_DIRS; i++ ) {
+      for( int j = 0; j < NUM_SUBDIRS; j++ ) {
+
+         snprintf( path, PATH_MAX, "/w/d%d/s%d", i, j );
+         check_rc( "fskit_mkdir_p", fskit_mkdir_p( g_core, path, 0755, 0, 0 ), 0 );
+
+         for( int k = 0; k < NUM_FILES; k++ ) {
+
+            snprintf( path, PATH_MAX, "/w/d%d/s%d/f%d", i, j, k );
+            make_file( g_core, path, k );
+            total_size += k;
+         }
+      }
+   }
+
+   num_entries += NUM_DIRS + NUM_DIRS * NUM_SUBDIRS + NUM_DIRS * NUM_SUBDIRS * NUM_FILES;
+
+   // a directory nobody but its owner can look into is visited, but not gone into
+   check_rc( "fskit_mkdir('/w/private')", fskit_mkdir( g_core, "/w/private", 0700, 0, 0 ), 0 );
+   make_file( g_core, "/w/private/secret", 100 );
+
+   for( size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++ ) {
+
+      int num_threads = thread_counts[t];
+
+      // everything
+      state_init( &state );
+      check_rc( "fskit_walk", fskit_walk( g_core, "/w", 0, 0, num_threads, visitor, &state ), 0 );
+      check_state( "full walk", &state, num_entries + 2, total_size + 100, 3 );
+
+      // everything user 1 can see
+      state_init( &state );
+      check_rc( "fskit_walk", fskit_walk( g_core, "/w/", 1, 1, num_threads, visitor, &state ), 0 );
+      check_state( "unprivileged walk", &state, num_entries + 1, total_size, 3 );
+
+      if( state.seen.count( "/w/d0/s0/f0" ) == 0 ) {
+         fskit_error("%s", "trailing '/' on the walk's root broke its children's paths\n" );
+         exit(1);
+      }
+
+      // pruned
+      state_init( &state );
+      state.prune_odd = true;
+      check_rc( "fskit_walk", fskit_walk( g_core, "/w", 0, 0, num_threads, visitor, &state ), 0 );
+      check_state( "pruned walk", &state, num_entries + 2 - (NUM_DIRS / 2) * (NUM_SUBDIRS + NUM_SUBDIRS * NUM_FILES), total_size / 2 + 100, 3 );
+
+      // stopped early
+      state_init( &state );
+      state.stop_after = 10;
+      check_rc( "fskit_walk", fskit_walk( g_core, "/w", 0, 0, num_threads, visitor, &state ), 0 );
+
+      if( state.errors != 0 || state.seen.size() < 10 || state.seen.size() >= num_entries / 2 ) {
+         fskit_error("stopped walk saw %zu entries, %d errors\n", state.seen.size(), state.errors );
+         exit(1);
+      }
+
+      // a file
+      state_init( &state );
+      check_rc( "fskit_walk", fskit_walk( g_core, "/w/d1/s2/f3", 0, 0, num_threads, visitor, &state ), 0 );
+      check_state( "file walk", &state, 1, 3, 0 );
+
+      // not there
+      state_init( &state );
+      check_rc( "fskit_walk", fskit_walk( g_core, "/w/nope", 0, 0, num_threads, visitor, &state ), -ENOENT );
+
+      // the visitor can fail the walk...
+      snprintf( path, PATH_MAX, "/w/d%d/s1/x.tmp", (int)t );
+      make_file( g_core, path, 0 );
+
+      state_init( &state );
+      state.fail_on_tmp = true;
+      check_rc( "fskit_walk", fskit_walk( g_core, "/w", 0, 0, num_threads, visitor, &state ), -EIO );
+
+      // ...or change the tree under it
+      state_init( &state );
+      state.unlink_tmp = true;
+      check_rc( "fskit_walk", fskit_walk( g_core, "/", 0, 0, num_threads, visitor, &state ), 0 );
+      check_state( "unlinking walk", &state, num_entries + 4, total_size + 100, 4 );
+
+      state_init( &state );
+      check_rc( "fskit_walk", fskit_walk( g_core, "/w", 0, 0, num_threads, visitor, &state ), 0 );
+      check_state( "walk after unlinking", &state, num_entries + 2, total_size + 100, 3 );
+   }
+
+   rc = fskit_test_end( g_core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   return 0;
+}